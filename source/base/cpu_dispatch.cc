@@ -0,0 +1,155 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/cpu_dispatch.h"
+#include "base/logging.h"
+
+#include <libyuv/cpu_id.h>
+
+#include <atomic>
+#include <cctype>
+#include <cstdlib>
+#include <iterator>
+
+namespace base {
+
+namespace {
+
+const char kMaxCpuIsaVariable[] = "ASPIA_MAX_CPU_ISA";
+
+const char* const kIsaNames[] = { "C", "SSE2", "SSSE3", "AVX2", "AVX512BW" };
+
+const int kNoLimit = -1;
+
+int maxIsaFromEnvironment()
+{
+    const char* value = std::getenv(kMaxCpuIsaVariable);
+    if (!value)
+        return static_cast<int>(CpuIsa::AVX512BW);
+
+    CpuIsa isa;
+    if (!parseCpuIsa(value, &isa))
+    {
+        LOG(LS_WARNING) << "Unknown instruction set in " << kMaxCpuIsaVariable << ": " << value;
+        return static_cast<int>(CpuIsa::AVX512BW);
+    }
+
+    LOG(LS_INFO) << "Instruction sets are limited to " << cpuIsaName(isa);
+    return static_cast<int>(isa);
+}
+
+std::atomic<int> max_isa_override = kNoLimit;
+
+} // namespace
+
+const char* cpuIsaName(CpuIsa isa)
+{
+    const int index = static_cast<int>(isa);
+
+    if (index < 0 || index >= static_cast<int>(std::size(kIsaNames)))
+        return "Unknown";
+
+    return kIsaNames[index];
+}
+
+bool parseCpuIsa(std::string_view name, CpuIsa* isa)
+{
+    for (size_t i = 0; i < std::size(kIsaNames); ++i)
+    {
+        std::string_view isa_name(kIsaNames[i]);
+
+        if (isa_name.size() != name.size())
+            continue;
+
+        bool equal = true;
+
+        for (size_t j = 0; j < name.size(); ++j)
+        {
+            if (std::toupper(static_cast<unsigned char>(name[j])) != isa_name[j])
+            {
+                equal = false;
+                break;
+            }
+        }
+
+        if (equal)
+        {
+            *isa = static_cast<CpuIsa>(i);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool isCpuIsaSupported(CpuIsa isa)
+{
+    switch (isa)
+    {
+        case CpuIsa::C:
+            return true;
+
+        case CpuIsa::SSE2:
+            return libyuv::TestCpuFlag(libyuv::kCpuHasSSE2);
+
+        case CpuIsa::SSSE3:
+            return libyuv::TestCpuFlag(libyuv::kCpuHasSSSE3);
+
+        case CpuIsa::AVX2:
+            return libyuv::TestCpuFlag(libyuv::kCpuHasAVX2);
+
+        case CpuIsa::AVX512BW:
+            return libyuv::TestCpuFlag(libyuv::kCpuHasAVX512BW);
+
+        default:
+            return false;
+    }
+}
+
+void setMaxCpuIsa(CpuIsa isa)
+{
+    max_isa_override = static_cast<int>(isa);
+}
+
+CpuIsa maxCpuIsa()
+{
+    const int value = max_isa_override;
+    if (value != kNoLimit)
+        return static_cast<CpuIsa>(value);
+
+    // The environment is read only once.
+    static const int environment_value = maxIsaFromEnvironment();
+    return static_cast<CpuIsa>(environment_value);
+}
+
+CpuIsa bestCpuIsa()
+{
+    const CpuIsa max_isa = maxCpuIsa();
+
+    for (int i = static_cast<int>(max_isa); i > 0; --i)
+    {
+        const CpuIsa isa = static_cast<CpuIsa>(i);
+
+        if (isCpuIsaSupported(isa))
+            return isa;
+    }
+
+    return CpuIsa::C;
+}
+
+} // namespace base
@@ -0,0 +1,126 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__CPU_DISPATCH_H
+#define BASE__CPU_DISPATCH_H
+
+#include <initializer_list>
+#include <string_view>
+#include <vector>
+
+namespace base {
+
+// Instruction sets for which optimized versions of functions are available. The values are
+// ordered: each next instruction set is considered a superset of the previous ones.
+enum class CpuIsa
+{
+    C        = 0,
+    SSE2     = 1,
+    SSSE3    = 2,
+    AVX2     = 3,
+    AVX512BW = 4
+};
+
+// Returns the name of the instruction set ("C", "SSE2", etc).
+const char* cpuIsaName(CpuIsa isa);
+
+// Converts the name of the instruction set (case insensitive) to the value. Returns false if
+// the name is unknown.
+bool parseCpuIsa(std::string_view name, CpuIsa* isa);
+
+// Returns true if the instruction set is supported by the processor. The limit set by
+// setMaxCpuIsa() is not taken into account.
+bool isCpuIsaSupported(CpuIsa isa);
+
+// Limits the instruction sets which can be selected by CpuDispatchTable. It is used for
+// benchmarking and for hosts where wide vector instructions lower the clock frequency of the
+// core. By default the limit is taken from the environment variable ASPIA_MAX_CPU_ISA (for
+// example "ASPIA_MAX_CPU_ISA=avx2"). If the variable is not set, the limit is not applied.
+// The limit affects only the tables which select the function after the call.
+void setMaxCpuIsa(CpuIsa isa);
+CpuIsa maxCpuIsa();
+
+// Returns the best instruction set which is supported by the processor and is allowed by the
+// limit.
+CpuIsa bestCpuIsa();
+
+// Table of variants of the function optimized for different instruction sets. Each family of
+// functions registers its variants once and the best of them is selected at run time.
+//
+// Usage:
+//   static const base::CpuDispatchTable<FuncType> kTable =
+//   {
+//       { base::CpuIsa::AVX2, func_AVX2 },
+//       { base::CpuIsa::SSE2, func_SSE2 },
+//       { base::CpuIsa::C,    func_C    }
+//   };
+//
+//   FuncType func = kTable.select();
+template <typename Func>
+class CpuDispatchTable
+{
+public:
+    struct Variant
+    {
+        CpuIsa isa;
+        Func func;
+    };
+
+    CpuDispatchTable(std::initializer_list<Variant> variants)
+        : variants_(variants)
+    {
+        // Nothing
+    }
+
+    // Returns the variant for the best supported and allowed instruction set. If the table does
+    // not contain a suitable variant, it returns nullptr. The table should always contain
+    // the C variant.
+    Func select() const { return select(nullptr); }
+
+    // Same as above. If |selected_isa| is not nullptr, it receives the instruction set of the
+    // selected variant.
+    Func select(CpuIsa* selected_isa) const
+    {
+        const CpuIsa max_isa = maxCpuIsa();
+        const Variant* best = nullptr;
+
+        for (const auto& variant : variants_)
+        {
+            if (variant.isa > max_isa || !isCpuIsaSupported(variant.isa))
+                continue;
+
+            if (!best || variant.isa > best->isa)
+                best = &variant;
+        }
+
+        if (!best)
+            return nullptr;
+
+        if (selected_isa)
+            *selected_isa = best->isa;
+
+        return best->func;
+    }
+
+private:
+    const std::vector<Variant> variants_;
+};
+
+} // namespace base
+
+#endif // BASE__CPU_DISPATCH_H
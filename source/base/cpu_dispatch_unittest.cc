@@ -0,0 +1,133 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/cpu_dispatch.h"
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+using TestFunc = int(*)();
+
+int testFunc_C() { return 0; }
+int testFunc_SSE2() { return 1; }
+int testFunc_AVX2() { return 3; }
+int testFunc_AVX512BW() { return 4; }
+
+const CpuDispatchTable<TestFunc> kTestTable =
+{
+    { CpuIsa::AVX512BW, testFunc_AVX512BW },
+    { CpuIsa::AVX2,     testFunc_AVX2     },
+    { CpuIsa::SSE2,     testFunc_SSE2     },
+    { CpuIsa::C,        testFunc_C        }
+};
+
+class ScopedMaxCpuIsa
+{
+public:
+    explicit ScopedMaxCpuIsa(CpuIsa isa)
+        : previous_(maxCpuIsa())
+    {
+        setMaxCpuIsa(isa);
+    }
+
+    ~ScopedMaxCpuIsa() { setMaxCpuIsa(previous_); }
+
+private:
+    const CpuIsa previous_;
+};
+
+} // namespace
+
+TEST(CpuDispatchTest, ParseName)
+{
+    CpuIsa isa = CpuIsa::C;
+
+    EXPECT_TRUE(parseCpuIsa("avx2", &isa));
+    EXPECT_EQ(isa, CpuIsa::AVX2);
+
+    EXPECT_TRUE(parseCpuIsa("AVX512BW", &isa));
+    EXPECT_EQ(isa, CpuIsa::AVX512BW);
+
+    EXPECT_TRUE(parseCpuIsa("c", &isa));
+    EXPECT_EQ(isa, CpuIsa::C);
+
+    EXPECT_FALSE(parseCpuIsa("avx", &isa));
+    EXPECT_FALSE(parseCpuIsa("", &isa));
+
+    for (int i = static_cast<int>(CpuIsa::C); i <= static_cast<int>(CpuIsa::AVX512BW); ++i)
+    {
+        EXPECT_TRUE(parseCpuIsa(cpuIsaName(static_cast<CpuIsa>(i)), &isa));
+        EXPECT_EQ(static_cast<int>(isa), i);
+    }
+}
+
+TEST(CpuDispatchTest, SelectsBestSupported)
+{
+    ScopedMaxCpuIsa max_isa(CpuIsa::AVX512BW);
+
+    CpuIsa selected = CpuIsa::C;
+    TestFunc func = kTestTable.select(&selected);
+    ASSERT_NE(func, nullptr);
+
+    EXPECT_TRUE(isCpuIsaSupported(selected));
+    EXPECT_EQ(func(), static_cast<int>(selected));
+
+    // SSSE3 has no variant in the table, so the best one is either a higher or a lower one.
+    if (bestCpuIsa() >= CpuIsa::SSE2)
+    {
+        EXPECT_GE(selected, CpuIsa::SSE2);
+    }
+}
+
+TEST(CpuDispatchTest, Override)
+{
+    {
+        ScopedMaxCpuIsa max_isa(CpuIsa::C);
+
+        EXPECT_EQ(bestCpuIsa(), CpuIsa::C);
+        EXPECT_EQ(kTestTable.select()(), 0);
+    }
+
+    if (isCpuIsaSupported(CpuIsa::AVX2))
+    {
+        // SSSE3 has no variant in the table, so the SSE2 one should be selected.
+        ScopedMaxCpuIsa max_isa(CpuIsa::SSSE3);
+        EXPECT_EQ(kTestTable.select()(), 1);
+    }
+
+    if (isCpuIsaSupported(CpuIsa::AVX512BW))
+    {
+        ScopedMaxCpuIsa max_isa(CpuIsa::AVX2);
+
+        EXPECT_EQ(bestCpuIsa(), CpuIsa::AVX2);
+        EXPECT_EQ(kTestTable.select()(), 3);
+    }
+}
+
+TEST(CpuDispatchTest, NoSuitableVariant)
+{
+    const CpuDispatchTable<TestFunc> table = { { CpuIsa::AVX512BW, testFunc_AVX512BW } };
+
+    ScopedMaxCpuIsa max_isa(CpuIsa::AVX2);
+    EXPECT_EQ(table.select(), nullptr);
+}
+
+} // namespace base
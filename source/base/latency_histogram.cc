@@ -0,0 +1,111 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/latency_histogram.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace base {
+
+LatencyHistogram::LatencyHistogram()
+{
+    clear();
+}
+
+void LatencyHistogram::add(const std::chrono::microseconds& value)
+{
+    const int64_t count = std::clamp<int64_t>(
+        value.count(), 0, std::numeric_limits<uint32_t>::max());
+
+    ++buckets_[bucketIndex(static_cast<uint32_t>(count))];
+    ++count_;
+
+    max_ = std::max(max_, std::chrono::microseconds(count));
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other)
+{
+    for (int i = 0; i < kBucketCount; ++i)
+        buckets_[i] += other.buckets_[i];
+
+    count_ += other.count_;
+    max_ = std::max(max_, other.max_);
+}
+
+void LatencyHistogram::clear()
+{
+    buckets_.fill(0);
+    count_ = 0;
+    max_ = std::chrono::microseconds::zero();
+}
+
+std::chrono::microseconds LatencyHistogram::percentile(int percent) const
+{
+    if (!count_)
+        return std::chrono::microseconds::zero();
+
+    percent = std::clamp(percent, 0, 100);
+
+    // The rank of the value (starting from 1) which is not exceeded by |percent| of the values.
+    const uint64_t rank = std::max<uint64_t>((count_ * percent + 99) / 100, 1);
+    uint64_t total = 0;
+
+    for (int i = 0; i < kBucketCount; ++i)
+    {
+        total += buckets_[i];
+
+        if (total >= rank)
+        {
+            return std::min(std::chrono::microseconds(bucketUpperBound(i)), max_);
+        }
+    }
+
+    return max_;
+}
+
+// static
+int LatencyHistogram::bucketIndex(uint32_t value)
+{
+    if (value < kExactBuckets)
+        return static_cast<int>(value);
+
+    // The position of the highest set bit (4 or more).
+    int exponent = 0;
+    for (uint32_t temp = value; temp > 1; temp >>= 1)
+        ++exponent;
+
+    const int sub_bucket = (value >> (exponent - 3)) & (kSubBuckets - 1);
+    return kExactBuckets + (exponent - 4) * kSubBuckets + sub_bucket;
+}
+
+// static
+uint32_t LatencyHistogram::bucketUpperBound(int index)
+{
+    if (index < kExactBuckets)
+        return static_cast<uint32_t>(index);
+
+    const int exponent = (index - kExactBuckets) / kSubBuckets + 4;
+    const uint64_t sub_bucket = (index - kExactBuckets) % kSubBuckets;
+
+    const uint64_t upper_bound = ((kSubBuckets + sub_bucket + 1) << (exponent - 3)) - 1;
+    return static_cast<uint32_t>(
+        std::min<uint64_t>(upper_bound, std::numeric_limits<uint32_t>::max()));
+}
+
+} // namespace base
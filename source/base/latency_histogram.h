@@ -0,0 +1,68 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__LATENCY_HISTOGRAM_H
+#define BASE__LATENCY_HISTOGRAM_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+namespace base {
+
+// Collects durations and calculates their percentiles with fixed memory. Values less than 16
+// microseconds are stored exactly, larger values are grouped into buckets with a width of 1/8 of
+// the power of two, so the relative error of a percentile does not exceed 12.5%. Values are
+// limited to about 70 minutes.
+// The class is not thread-safe.
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+    ~LatencyHistogram() = default;
+
+    LatencyHistogram(const LatencyHistogram& other) = default;
+    LatencyHistogram& operator=(const LatencyHistogram& other) = default;
+
+    void add(const std::chrono::microseconds& value);
+    void merge(const LatencyHistogram& other);
+    void clear();
+
+    uint64_t count() const { return count_; }
+    std::chrono::microseconds max() const { return max_; }
+
+    // Returns the value which is not exceeded by |percent| percent of the values. If the
+    // histogram is empty, it returns zero.
+    std::chrono::microseconds percentile(int percent) const;
+
+private:
+    static const int kExactBuckets = 16;
+    static const int kSubBuckets = 8;
+    static const int kBucketCount = kExactBuckets + (32 - 4) * kSubBuckets;
+
+    static int bucketIndex(uint32_t value);
+    static uint32_t bucketUpperBound(int index);
+
+    std::array<uint32_t, kBucketCount> buckets_;
+    uint64_t count_ = 0;
+    std::chrono::microseconds max_;
+};
+
+} // namespace base
+
+#endif // BASE__LATENCY_HISTOGRAM_H
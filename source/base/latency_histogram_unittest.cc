@@ -0,0 +1,118 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/latency_histogram.h"
+
+#include <gtest/gtest.h>
+
+#include <limits>
+
+namespace base {
+
+using std::chrono::microseconds;
+
+TEST(LatencyHistogramTest, Empty)
+{
+    LatencyHistogram histogram;
+
+    EXPECT_EQ(histogram.count(), 0);
+    EXPECT_EQ(histogram.max(), microseconds::zero());
+    EXPECT_EQ(histogram.percentile(50), microseconds::zero());
+    EXPECT_EQ(histogram.percentile(99), microseconds::zero());
+}
+
+TEST(LatencyHistogramTest, SmallValues)
+{
+    LatencyHistogram histogram;
+
+    for (int i = 1; i <= 10; ++i)
+        histogram.add(microseconds(i));
+
+    EXPECT_EQ(histogram.count(), 10);
+    EXPECT_EQ(histogram.max(), microseconds(10));
+
+    // Small values are stored exactly.
+    EXPECT_EQ(histogram.percentile(0), microseconds(1));
+    EXPECT_EQ(histogram.percentile(50), microseconds(5));
+    EXPECT_EQ(histogram.percentile(90), microseconds(9));
+    EXPECT_EQ(histogram.percentile(100), microseconds(10));
+}
+
+TEST(LatencyHistogramTest, Percentiles)
+{
+    LatencyHistogram histogram;
+
+    // 1ms ... 10s.
+    for (int i = 1; i <= 10000; ++i)
+        histogram.add(microseconds(i * 1000));
+
+    EXPECT_EQ(histogram.count(), 10000);
+    EXPECT_EQ(histogram.max(), microseconds(10000000));
+
+    const int percents[] = { 1, 50, 95, 99 };
+
+    for (const auto& percent : percents)
+    {
+        const int64_t expected = percent * 100 * 1000;
+        const int64_t actual = histogram.percentile(percent).count();
+
+        // The value is rounded up to the upper bound of the bucket.
+        EXPECT_GE(actual, expected);
+        EXPECT_LE(actual, expected + expected / 8);
+    }
+
+    EXPECT_EQ(histogram.percentile(100), histogram.max());
+}
+
+TEST(LatencyHistogramTest, OutOfRange)
+{
+    LatencyHistogram histogram;
+
+    histogram.add(microseconds(-100));
+    EXPECT_EQ(histogram.percentile(100), microseconds::zero());
+
+    histogram.add(std::chrono::hours(100));
+    EXPECT_EQ(histogram.count(), 2);
+    EXPECT_EQ(histogram.max(), microseconds(std::numeric_limits<uint32_t>::max()));
+    EXPECT_EQ(histogram.percentile(100), histogram.max());
+}
+
+TEST(LatencyHistogramTest, Merge)
+{
+    LatencyHistogram histogram1;
+    LatencyHistogram histogram2;
+
+    for (int i = 0; i < 50; ++i)
+    {
+        histogram1.add(microseconds(2));
+        histogram2.add(microseconds(12));
+    }
+
+    histogram1.merge(histogram2);
+
+    EXPECT_EQ(histogram1.count(), 100);
+    EXPECT_EQ(histogram1.max(), microseconds(12));
+    EXPECT_EQ(histogram1.percentile(50), microseconds(2));
+    EXPECT_EQ(histogram1.percentile(51), microseconds(12));
+
+    histogram1.clear();
+    EXPECT_EQ(histogram1.count(), 0);
+    EXPECT_EQ(histogram1.percentile(50), microseconds::zero());
+}
+
+} // namespace base
@@ -0,0 +1,79 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__THREAD_POOL_H
+#define BASE__THREAD_POOL_H
+
+#include "base/macros_magic.h"
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace base {
+
+// ThreadPool is a fixed set of worker threads used to split a piece of work into independent
+// parts and execute them in parallel. The calling thread always takes part in the execution, so
+// a pool created with |thread_count| equal to 1 does not start any threads at all and runs the
+// work serially.
+//
+// Usage:
+//   ThreadPool pool(4);
+//
+//   pool.parallelFor(band_count, [&](int band)
+//   {
+//       ... (process band with index |band|) ...
+//   });
+class ThreadPool
+{
+public:
+    explicit ThreadPool(int thread_count);
+    ~ThreadPool();
+
+    // Returns the number of threads (including the calling thread) that execute the work.
+    int threadCount() const { return static_cast<int>(workers_.size()) + 1; }
+
+    // Calls |task| for each index in the range [0, count) and blocks until all calls are
+    // completed. The order in which the indexes are executed is not defined.
+    // The method must not be called at the same time from different threads.
+    void parallelFor(int count, const std::function<void(int)>& task);
+
+private:
+    void workerThread();
+    void runTasks(std::unique_lock<std::mutex>& lock);
+
+    std::vector<std::thread> workers_;
+
+    std::mutex lock_;
+    std::condition_variable work_condition_;
+    std::condition_variable done_condition_;
+
+    const std::function<void(int)>* task_ = nullptr;
+    int task_count_ = 0;
+    int next_task_ = 0;
+    int pending_tasks_ = 0;
+    bool terminate_ = false;
+
+    DISALLOW_COPY_AND_ASSIGN(ThreadPool);
+};
+
+} // namespace base
+
+#endif // BASE__THREAD_POOL_H
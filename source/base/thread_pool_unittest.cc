@@ -0,0 +1,65 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/thread_pool.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+
+namespace base {
+
+TEST(ThreadPoolTest, ExecutesEachIndexOnce)
+{
+    for (int thread_count = 1; thread_count <= 4; ++thread_count)
+    {
+        ThreadPool pool(thread_count);
+        EXPECT_EQ(pool.threadCount(), thread_count);
+
+        for (int count = 0; count < 32; ++count)
+        {
+            std::vector<std::atomic_int> calls(count);
+
+            pool.parallelFor(count, [&](int index)
+            {
+                ++calls[index];
+            });
+
+            for (int i = 0; i < count; ++i)
+                EXPECT_EQ(calls[i], 1);
+        }
+    }
+}
+
+TEST(ThreadPoolTest, RepeatedRuns)
+{
+    ThreadPool pool(3);
+    std::atomic_int sum = 0;
+
+    for (int i = 0; i < 1000; ++i)
+    {
+        pool.parallelFor(5, [&](int index)
+        {
+            sum += index;
+        });
+    }
+
+    EXPECT_EQ(sum, 1000 * (0 + 1 + 2 + 3 + 4));
+}
+
+} // namespace base
@@ -19,14 +19,19 @@
 #include "client/client_desktop.h"
 #include "base/logging.h"
 #include "codec/cursor_decoder.h"
+#include "codec/tile_cache.h"
 #include "codec/video_decoder.h"
+#include "codec/video_encoder_zstd.h"
 #include "codec/video_util.h"
+#include "codec/zstd_dictionary.h"
 #include "common/desktop_session_constants.h"
 #include "desktop/mouse_cursor.h"
 
 #include <QCursor>
 #include <QPixmap>
 
+#include <algorithm>
+
 namespace client {
 
 ClientDesktop::ClientDesktop(const ConnectData& connect_data, Delegate* delegate, QObject* parent)
@@ -145,6 +150,26 @@ void ClientDesktop::sendConfig(const proto::desktop::Config& config)
 
     outgoing_message_.Clear();
     outgoing_message_.mutable_config()->CopyFrom(config);
+
+    // The flags are not user settings, the client always supports these features.
+    outgoing_message_.mutable_config()->set_flags(
+        config.flags() | proto::desktop::ENABLE_COPY_RECT | proto::desktop::ENABLE_RECT_ENCODING |
+        proto::desktop::ENABLE_ZSTD_HISTORY);
+
+    // The tile cache is used if the host supports it.
+    tile_cache_size_ =
+        std::min(static_cast<size_t>(host_tile_cache_size_), codec::TileCache::kDefaultCacheSize);
+    outgoing_message_.mutable_config()->set_tile_cache_size(
+        static_cast<uint32_t>(tile_cache_size_));
+
+    // The cursor dictionary is used if the host has the same built-in content.
+    if (host_zstd_dictionary_id_ == codec::ZstdDictionary::kBuiltinId)
+        outgoing_message_.mutable_config()->set_zstd_dictionary_id(host_zstd_dictionary_id_);
+
+    // The hosts which do not support the tiles ignore the size.
+    outgoing_message_.mutable_config()->set_zstd_tile_size(
+        codec::VideoEncoderZstd::kDefaultZstdTileSize);
+
     sendMessage(outgoing_message_);
 }
 
@@ -183,6 +208,9 @@ void ClientDesktop::readConfigRequest(const proto::desktop::ConfigRequest& confi
     // The list of supported video encodings is passed as a bit field.
     supported_video_encodings_ = config_request.video_encodings();
 
+    host_tile_cache_size_ = config_request.tile_cache_size();
+    host_zstd_dictionary_id_ = config_request.zstd_dictionary_id();
+
     // We notify the window about changes in the list of extensions.
     // A window can disable/enable some of its capabilities in accordance with this information.
     delegate_->extensionListChanged();
@@ -213,7 +241,7 @@ void ClientDesktop::readVideoPacket(const proto::desktop::VideoPacket& packet)
 {
     if (video_encoding_ != packet.encoding())
     {
-        video_decoder_ = codec::VideoDecoder::create(packet.encoding());
+        video_decoder_ = codec::VideoDecoder::create(packet.encoding(), tile_cache_size_);
         video_encoding_ = packet.encoding();
     }
 
@@ -254,12 +282,52 @@ void ClientDesktop::readVideoPacket(const proto::desktop::VideoPacket& packet)
         return;
     }
 
-    if (!video_decoder_->decode(packet, frame))
+    // The region is cleared when the window schedules the repaint.
+    desktop::Region* updated_region = frame->updatedRegion();
+
+    // Moved areas are copied before the decoding, the dirty rectangles may overwrite them.
+    const desktop::Rect frame_rect = desktop::Rect::makeSize(frame->size());
+
+    for (int i = 0; i < packet.copy_rect_size(); ++i)
+    {
+        const proto::desktop::CopyRect& copy_rect = packet.copy_rect(i);
+
+        const desktop::Rect dest_rect = codec::VideoUtil::fromVideoRect(copy_rect.dest_rect());
+        const desktop::Rect source_rect = desktop::Rect::makeXYWH(
+            copy_rect.source_x(), copy_rect.source_y(), dest_rect.width(), dest_rect.height());
+
+        if (dest_rect.isEmpty() ||
+            !frame_rect.containsRect(dest_rect) || !frame_rect.containsRect(source_rect))
+        {
+            onSessionError(tr("Wrong copy rectangle"));
+            return;
+        }
+
+        frame->copyPixelsWithin(source_rect.topLeft(), dest_rect);
+        updated_region->addRect(dest_rect);
+    }
+
+    // A packet may contain only the copied rectangles.
+    if ((packet.dirty_rect_size() || packet.tile_cache_op_size()) &&
+        !video_decoder_->decode(packet, frame))
     {
         onSessionError(tr("The video packet could not be decoded"));
         return;
     }
 
+    // The decoder has checked that the rectangles are inside the frame.
+
+    for (int i = 0; i < packet.dirty_rect_size(); ++i)
+        updated_region->addRect(codec::VideoUtil::fromVideoRect(packet.dirty_rect(i)));
+
+    for (int i = 0; i < packet.tile_cache_op_size(); ++i)
+    {
+        const proto::desktop::TileCacheOp& op = packet.tile_cache_op(i);
+
+        if (op.type() == proto::desktop::TileCacheOp::TYPE_LOAD)
+            updated_region->addRect(codec::VideoUtil::fromVideoRect(op.rect()));
+    }
+
     delegate_->drawDesktop();
 }
 
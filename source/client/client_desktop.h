@@ -93,6 +93,11 @@ private:
 
     QStringList supported_extensions_;
     uint32_t supported_video_encodings_ = 0;
+    uint32_t host_tile_cache_size_ = 0;
+    uint32_t host_zstd_dictionary_id_ = 0;
+
+    // The size of the tile cache sent to the host in the config.
+    size_t tile_cache_size_ = 0;
 
     proto::desktop::VideoEncoding video_encoding_ = proto::desktop::VIDEO_ENCODING_UNKNOWN;
     std::unique_ptr<codec::VideoDecoder> video_decoder_;
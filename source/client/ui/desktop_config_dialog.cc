@@ -94,6 +94,9 @@ DesktopConfigDialog::DesktopConfigDialog(proto::SessionType session_type,
     ui.slider_compression_ratio->setValue(config_.compress_ratio());
     onCompressionRatioChanged(config_.compress_ratio());
 
+    if (config_.flags() & proto::desktop::ENABLE_ZSTD_LONG_DISTANCE)
+        ui.checkbox_long_distance->setChecked(true);
+
     ui.spin_scale_factor->setValue(config_.scale_factor());
     ui.spin_update_interval->setValue(config_.update_interval());
 
@@ -144,6 +147,7 @@ void DesktopConfigDialog::onCodecChanged(int item_index)
     ui.slider_compression_ratio->setEnabled(has_pixel_format);
     ui.label_fast->setEnabled(has_pixel_format);
     ui.label_best->setEnabled(has_pixel_format);
+    ui.checkbox_long_distance->setEnabled(has_pixel_format);
 }
 
 void DesktopConfigDialog::onCompressionRatioChanged(int value)
@@ -216,6 +220,9 @@ void DesktopConfigDialog::onButtonBoxClicked(QAbstractButton* button)
         if (ui.checkbox_block_remote_input->isChecked())
             flags |= proto::desktop::BLOCK_REMOTE_INPUT;
 
+        if (ui.checkbox_long_distance->isChecked() && ui.checkbox_long_distance->isEnabled())
+            flags |= proto::desktop::ENABLE_ZSTD_LONG_DISTANCE;
+
         config_.set_flags(flags);
 
         emit configChanged(config_);
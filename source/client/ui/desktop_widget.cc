@@ -23,8 +23,11 @@
 
 #include <QApplication>
 #include <QPainter>
+#include <QPaintEvent>
 #include <QWheelEvent>
 
+#include <cmath>
+
 namespace client {
 
 namespace {
@@ -79,6 +82,23 @@ desktop::Frame* DesktopWidget::desktopFrame()
     return frame_.get();
 }
 
+void DesktopWidget::drawDesktop()
+{
+    if (!frame_)
+        return;
+
+    desktop::Region* updated_region = frame_->updatedRegion();
+    QRegion dirty_region;
+
+    for (desktop::Region::Iterator it(*updated_region); !it.isAtEnd(); it.advance())
+        dirty_region += scaledRect(it.rect());
+
+    updated_region->clear();
+
+    if (!dirty_region.isEmpty())
+        update(dirty_region);
+}
+
 void DesktopWidget::doMouseEvent(QEvent::Type event_type,
                                  const Qt::MouseButtons& buttons,
                                  const QPoint& pos,
@@ -222,13 +242,26 @@ void DesktopWidget::enableKeyCombinations(bool enable)
 #endif // defined(OS_WIN)
 }
 
-void DesktopWidget::paintEvent(QPaintEvent* /* event */)
+void DesktopWidget::paintEvent(QPaintEvent* event)
 {
     if (frame_)
     {
         QPainter painter(this);
-        painter.setRenderHint(QPainter::SmoothPixmapTransform);
-        painter.drawImage(rect(), frame_->constImage());
+        const QImage& image = frame_->constImage();
+
+        if (size() == image.size())
+        {
+            // Without scaling only the changed areas are copied.
+            for (const auto& rect : event->region())
+                painter.drawImage(rect.topLeft(), image, rect);
+        }
+        else
+        {
+            // The painter is clipped by the region of the event, so only the changed areas are
+            // scaled.
+            painter.setRenderHint(QPainter::SmoothPixmapTransform);
+            painter.drawImage(rect(), image);
+        }
     }
 
     delegate_->onDrawDesktop();
@@ -322,6 +355,26 @@ void DesktopWidget::executeKeyEvent(uint32_t usb_keycode, uint32_t flags)
     delegate_->onKeyEvent(usb_keycode, flags);
 }
 
+QRect DesktopWidget::scaledRect(const desktop::Rect& rect) const
+{
+    const desktop::Size& frame_size = frame_->size();
+
+    if (size() == frame_size.toQSize())
+        return QRect(rect.x(), rect.y(), rect.width(), rect.height());
+
+    const double scale_x = static_cast<double>(width()) / frame_size.width();
+    const double scale_y = static_cast<double>(height()) / frame_size.height();
+
+    // The smooth scaling interpolates between neighboring pixels, so the rectangle is expanded
+    // by one pixel on each side.
+    const int left = static_cast<int>(std::floor(rect.left() * scale_x)) - 1;
+    const int top = static_cast<int>(std::floor(rect.top() * scale_y)) - 1;
+    const int right = static_cast<int>(std::ceil(rect.right() * scale_x)) + 1;
+    const int bottom = static_cast<int>(std::ceil(rect.bottom() * scale_y)) + 1;
+
+    return QRect(QPoint(left, top), QPoint(right - 1, bottom - 1)).intersected(this->rect());
+}
+
 #if defined(OS_WIN)
 // static
 LRESULT CALLBACK DesktopWidget::keyboardHookProc(INT code, WPARAM wparam, LPARAM lparam)
@@ -58,6 +58,9 @@ public:
     void setDesktopSize(const desktop::Size& screen_size);
     desktop::Frame* desktopFrame();
 
+    // Schedules the repaint of the updated region of the desktop frame and clears the region.
+    void drawDesktop();
+
     void doMouseEvent(QEvent::Type event_type,
                       const Qt::MouseButtons& buttons,
                       const QPoint& pos,
@@ -87,6 +90,7 @@ protected:
 
 private:
     void executeKeyEvent(uint32_t usb_keycode, uint32_t flags);
+    QRect scaledRect(const desktop::Rect& rect) const;
 
 #if defined(OS_WIN)
     static LRESULT CALLBACK keyboardHookProc(INT code, WPARAM wparam, LPARAM lparam);
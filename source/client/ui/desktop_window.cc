@@ -182,7 +182,7 @@ void DesktopWindow::setDesktopRect(const desktop::Rect& screen_rect)
 
 void DesktopWindow::drawDesktop()
 {
-    desktop_->update();
+    desktop_->drawDesktop();
 }
 
 desktop::Frame* DesktopWindow::desktopFrame()
@@ -0,0 +1,193 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/color_palette.h"
+#include "base/logging.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace codec {
+
+namespace {
+
+int hashColor(uint32_t color)
+{
+    return static_cast<int>((color * 0x9E3779B1) >> 22);
+}
+
+} // namespace
+
+ColorPalette::ColorPalette()
+{
+    static_assert(kTableSize == 1 << (32 - 22));
+    static_assert(kTableSize >= kMaxColors * 2);
+
+    memset(table_indexes_, 0, sizeof(table_indexes_));
+}
+
+bool ColorPalette::collect(const uint8_t* data, int stride, int width, int height, int max_colors)
+{
+    DCHECK_LE(max_colors, kMaxColors);
+
+    memset(table_indexes_, 0, sizeof(table_indexes_));
+    color_count_ = 0;
+
+    // Neighboring pixels usually have the same color, the table is not searched for them.
+    uint32_t last_color = 0;
+    bool has_last_color = false;
+
+    for (int y = 0; y < height; ++y)
+    {
+        const uint32_t* row = reinterpret_cast<const uint32_t*>(data);
+
+        for (int x = 0; x < width; ++x)
+        {
+            const uint32_t color = row[x];
+
+            if (has_last_color && color == last_color)
+                continue;
+
+            last_color = color;
+            has_last_color = true;
+
+            int pos = hashColor(color);
+
+            while (table_indexes_[pos] && table_colors_[pos] != color)
+                pos = (pos + 1) & (kTableSize - 1);
+
+            if (table_indexes_[pos])
+                continue;
+
+            if (color_count_ == max_colors)
+                return false;
+
+            colors_[color_count_] = color;
+            table_colors_[pos] = color;
+            table_indexes_[pos] = static_cast<uint16_t>(++color_count_);
+        }
+
+        data += stride;
+    }
+
+    return true;
+}
+
+int ColorPalette::findIndex(uint32_t color) const
+{
+    int pos = hashColor(color);
+
+    while (table_colors_[pos] != color)
+    {
+        DCHECK(table_indexes_[pos]);
+        pos = (pos + 1) & (kTableSize - 1);
+    }
+
+    return table_indexes_[pos] - 1;
+}
+
+void ColorPalette::pack(const uint8_t* data, int stride, int width, int height,
+                        uint8_t* output) const
+{
+    const int bits = bitsPerIndex(color_count_);
+    const int pixels_per_byte = 8 / bits;
+    const size_t row_size = packedRowSize(width, bits);
+
+    for (int y = 0; y < height; ++y)
+    {
+        const uint32_t* row = reinterpret_cast<const uint32_t*>(data);
+
+        uint32_t last_color = row[0];
+        int last_index = findIndex(last_color);
+
+        for (int x = 0; x < width; x += pixels_per_byte)
+        {
+            const int count = std::min(pixels_per_byte, width - x);
+            int byte = 0;
+
+            for (int i = 0; i < count; ++i)
+            {
+                if (row[x + i] != last_color)
+                {
+                    last_color = row[x + i];
+                    last_index = findIndex(last_color);
+                }
+
+                byte |= last_index << (8 - bits * (i + 1));
+            }
+
+            output[x / pixels_per_byte] = static_cast<uint8_t>(byte);
+        }
+
+        data += stride;
+        output += row_size;
+    }
+}
+
+// static
+int ColorPalette::bitsPerIndex(int color_count)
+{
+    if (color_count <= 2)
+        return 1;
+    if (color_count <= 4)
+        return 2;
+    if (color_count <= 16)
+        return 4;
+    return 8;
+}
+
+// static
+size_t ColorPalette::packedRowSize(int width, int bits_per_index)
+{
+    return (static_cast<size_t>(width) * bits_per_index + 7) / 8;
+}
+
+// static
+void ColorPalette::unpackRow(const uint8_t* input,
+                             int width,
+                             int bits_per_index,
+                             const uint32_t* palette,
+                             int bytes_per_pixel,
+                             uint8_t* output)
+{
+    const int pixels_per_byte = 8 / bits_per_index;
+    const int mask = (1 << bits_per_index) - 1;
+
+    for (int x = 0; x < width; ++x)
+    {
+        const int shift = 8 - bits_per_index * (x % pixels_per_byte + 1);
+        const uint32_t color = palette[(input[x / pixels_per_byte] >> shift) & mask];
+
+        switch (bytes_per_pixel)
+        {
+            case 4:
+                reinterpret_cast<uint32_t*>(output)[x] = color;
+                break;
+
+            case 2:
+                reinterpret_cast<uint16_t*>(output)[x] = static_cast<uint16_t>(color);
+                break;
+
+            default:
+                output[x] = static_cast<uint8_t>(color);
+                break;
+        }
+    }
+}
+
+} // namespace codec
@@ -0,0 +1,83 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CODEC__COLOR_PALETTE_H
+#define CODEC__COLOR_PALETTE_H
+
+#include "base/macros_magic.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace codec {
+
+// Palette of a rectangle with few colors. The encoder sends the indexes of the colors in the
+// palette packed in 1, 2, 4 or 8 bits instead of the pixels. The rows of the packed indexes are
+// padded to a whole byte, the first pixel is in the highest bits of the byte.
+class ColorPalette
+{
+public:
+    ColorPalette();
+    ~ColorPalette() = default;
+
+    static constexpr int kMaxColors = 256;
+
+    // Collects the colors of the 32-bit pixels at |data|. Returns false if there are more than
+    // |max_colors| colors (the scan stops at this point).
+    bool collect(const uint8_t* data, int stride, int width, int height, int max_colors);
+
+    const uint32_t* colors() const { return colors_; }
+    int colorCount() const { return color_count_; }
+
+    // Replaces the 32-bit pixels at |data| with the indexes of their colors. All colors must be
+    // in the palette.
+    void pack(const uint8_t* data, int stride, int width, int height, uint8_t* output) const;
+
+    // Returns the number of bits for an index in the palette with |color_count| colors.
+    static int bitsPerIndex(int color_count);
+
+    static size_t packedRowSize(int width, int bits_per_index);
+
+    // Writes the colors of |width| packed indexes to |output|. |palette| must have kMaxColors
+    // entries, so any index is valid. The colors are written with |bytes_per_pixel| bytes.
+    static void unpackRow(const uint8_t* input,
+                          int width,
+                          int bits_per_index,
+                          const uint32_t* palette,
+                          int bytes_per_pixel,
+                          uint8_t* output);
+
+private:
+    int findIndex(uint32_t color) const;
+
+    static const int kTableSize = 1024;
+
+    uint32_t colors_[kMaxColors];
+    int color_count_ = 0;
+
+    // Open addressing hash table. |table_indexes_| contains the color index plus one, 0 marks
+    // an empty entry.
+    uint32_t table_colors_[kTableSize];
+    uint16_t table_indexes_[kTableSize];
+
+    DISALLOW_COPY_AND_ASSIGN(ColorPalette);
+};
+
+} // namespace codec
+
+#endif // CODEC__COLOR_PALETTE_H
@@ -0,0 +1,147 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/color_palette.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+namespace codec {
+
+TEST(ColorPaletteTest, Collect)
+{
+    std::vector<uint32_t> pixels(32 * 16, 0xFF102030);
+    const int stride = 32 * 4;
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(pixels.data());
+
+    ColorPalette palette;
+
+    ASSERT_TRUE(palette.collect(data, stride, 32, 16, 256));
+    ASSERT_EQ(palette.colorCount(), 1);
+    EXPECT_EQ(palette.colors()[0], 0xFF102030);
+
+    pixels[5] = 0xFF000000;
+    pixels[100] = 0xFFFFFFFF;
+    pixels[200] = 0xFF000000;
+
+    ASSERT_TRUE(palette.collect(data, stride, 32, 16, 256));
+    ASSERT_EQ(palette.colorCount(), 3);
+    EXPECT_EQ(palette.colors()[0], 0xFF102030);
+    EXPECT_EQ(palette.colors()[1], 0xFF000000);
+    EXPECT_EQ(palette.colors()[2], 0xFFFFFFFF);
+
+    // The pixel 100 is outside of the 4x3 rectangle.
+    ASSERT_TRUE(palette.collect(data, stride, 4, 3, 256));
+    EXPECT_EQ(palette.colorCount(), 1);
+
+    EXPECT_FALSE(palette.collect(data, stride, 32, 16, 2));
+}
+
+TEST(ColorPaletteTest, TooManyColors)
+{
+    std::vector<uint32_t> pixels(64 * 64);
+    for (size_t i = 0; i < pixels.size(); ++i)
+        pixels[i] = static_cast<uint32_t>(i % 257) * 0x010101;
+
+    ColorPalette palette;
+
+    EXPECT_FALSE(palette.collect(
+        reinterpret_cast<const uint8_t*>(pixels.data()), 64 * 4, 64, 64, 256));
+    EXPECT_TRUE(palette.collect(
+        reinterpret_cast<const uint8_t*>(pixels.data()), 64 * 4, 64, 1, 256));
+    EXPECT_EQ(palette.colorCount(), 64);
+}
+
+TEST(ColorPaletteTest, BitsPerIndex)
+{
+    EXPECT_EQ(ColorPalette::bitsPerIndex(2), 1);
+    EXPECT_EQ(ColorPalette::bitsPerIndex(3), 2);
+    EXPECT_EQ(ColorPalette::bitsPerIndex(4), 2);
+    EXPECT_EQ(ColorPalette::bitsPerIndex(5), 4);
+    EXPECT_EQ(ColorPalette::bitsPerIndex(16), 4);
+    EXPECT_EQ(ColorPalette::bitsPerIndex(17), 8);
+    EXPECT_EQ(ColorPalette::bitsPerIndex(256), 8);
+
+    EXPECT_EQ(ColorPalette::packedRowSize(61, 1), 8u);
+    EXPECT_EQ(ColorPalette::packedRowSize(61, 2), 16u);
+    EXPECT_EQ(ColorPalette::packedRowSize(61, 4), 31u);
+    EXPECT_EQ(ColorPalette::packedRowSize(61, 8), 61u);
+}
+
+TEST(ColorPaletteTest, PackAndUnpack)
+{
+    const int kWidth = 61;
+    const int kHeight = 7;
+
+    std::mt19937 random(1);
+
+    for (int color_count : { 2, 3, 4, 16, 17, 256 })
+    {
+        std::vector<uint32_t> pixels(kWidth * kHeight);
+        for (auto& pixel : pixels)
+            pixel = 0xFF000000 | (random() % color_count) * 0x9E3779;
+
+        ColorPalette palette;
+        ASSERT_TRUE(palette.collect(reinterpret_cast<const uint8_t*>(pixels.data()),
+                                    kWidth * 4, kWidth, kHeight, 256));
+
+        const int bits = ColorPalette::bitsPerIndex(palette.colorCount());
+        EXPECT_LE(palette.colorCount(), 1 << bits);
+
+        const size_t row_size = ColorPalette::packedRowSize(kWidth, bits);
+        std::vector<uint8_t> packed(row_size * kHeight);
+
+        palette.pack(reinterpret_cast<const uint8_t*>(pixels.data()), kWidth * 4,
+                     kWidth, kHeight, packed.data());
+
+        uint32_t colors[ColorPalette::kMaxColors] = { 0 };
+        std::copy(palette.colors(), palette.colors() + palette.colorCount(), colors);
+
+        for (int y = 0; y < kHeight; ++y)
+        {
+            std::vector<uint32_t> row(kWidth);
+            ColorPalette::unpackRow(packed.data() + y * row_size, kWidth, bits, colors, 4,
+                                    reinterpret_cast<uint8_t*>(row.data()));
+
+            for (int x = 0; x < kWidth; ++x)
+                ASSERT_EQ(row[x], pixels[y * kWidth + x]) << color_count << " " << x << " " << y;
+        }
+    }
+}
+
+TEST(ColorPaletteTest, UnpackSmallPixels)
+{
+    const uint32_t palette[ColorPalette::kMaxColors] = { 0x1234, 0xABCD };
+    const uint8_t packed[] = { 0xA0 }; // 1, 0, 1, 0
+
+    uint16_t row16[4];
+    ColorPalette::unpackRow(packed, 4, 1, palette, 2, reinterpret_cast<uint8_t*>(row16));
+    EXPECT_EQ(row16[0], 0xABCD);
+    EXPECT_EQ(row16[1], 0x1234);
+    EXPECT_EQ(row16[2], 0xABCD);
+    EXPECT_EQ(row16[3], 0x1234);
+
+    uint8_t row8[4];
+    ColorPalette::unpackRow(packed, 4, 1, palette, 1, row8);
+    EXPECT_EQ(row8[0], 0xCD);
+    EXPECT_EQ(row8[1], 0x34);
+}
+
+} // namespace codec
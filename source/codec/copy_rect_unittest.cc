@@ -0,0 +1,235 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/video_decoder.h"
+#include "codec/video_encoder_vpx.h"
+#include "codec/video_encoder_zstd.h"
+#include "codec/video_util.h"
+#include "desktop/desktop_frame_simple.h"
+#include "desktop/frame_generator.h"
+#include "desktop/move_detector.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+namespace codec {
+
+namespace {
+
+const desktop::Size kScreenSize(640, 480);
+const int kFrameCount = 6;
+
+// The VPX encoders are lossy, the decoded text only has to be readable.
+const double kMinVpxPsnr = 20.0;
+
+const uint32_t kZstdFlags = proto::desktop::ENABLE_RECT_ENCODING |
+                            proto::desktop::ENABLE_ZSTD_HISTORY;
+
+std::unique_ptr<VideoEncoder> createEncoder(proto::desktop::VideoEncoding encoding)
+{
+    switch (encoding)
+    {
+        case proto::desktop::VIDEO_ENCODING_VP8:
+            return std::unique_ptr<VideoEncoder>(VideoEncoderVPX::createVP8());
+
+        case proto::desktop::VIDEO_ENCODING_VP9:
+            return std::unique_ptr<VideoEncoder>(VideoEncoderVPX::createVP9());
+
+        case proto::desktop::VIDEO_ENCODING_ZSTD:
+            return std::unique_ptr<VideoEncoder>(VideoEncoderZstd::create(
+                desktop::PixelFormat::ARGB(), 8, 0, kZstdFlags));
+
+        default:
+            return nullptr;
+    }
+}
+
+// Returns the number of pixels with different colors. The alpha channel is not transferred.
+int differentPixels(const desktop::Frame& frame1, const desktop::Frame& frame2)
+{
+    int count = 0;
+
+    for (int y = 0; y < kScreenSize.height(); ++y)
+    {
+        const uint32_t* row1 = reinterpret_cast<const uint32_t*>(frame1.frameDataAtPos(0, y));
+        const uint32_t* row2 = reinterpret_cast<const uint32_t*>(frame2.frameDataAtPos(0, y));
+
+        for (int x = 0; x < kScreenSize.width(); ++x)
+        {
+            if ((row1[x] ^ row2[x]) & 0x00FFFFFF)
+                ++count;
+        }
+    }
+
+    return count;
+}
+
+// Returns the peak signal-to-noise ratio of the color channels of the frames.
+double psnr(const desktop::Frame& frame1, const desktop::Frame& frame2)
+{
+    double error = 0;
+
+    for (int y = 0; y < kScreenSize.height(); ++y)
+    {
+        const uint8_t* row1 = frame1.frameDataAtPos(0, y);
+        const uint8_t* row2 = frame2.frameDataAtPos(0, y);
+
+        for (int x = 0; x < kScreenSize.width() * 4; ++x)
+        {
+            if (x % 4 == 3)
+                continue;
+
+            const double diff = static_cast<double>(row1[x]) - static_cast<double>(row2[x]);
+            error += diff * diff;
+        }
+    }
+
+    if (error == 0)
+        return 100.0;
+
+    const double mse = error / (kScreenSize.width() * kScreenSize.height() * 3);
+    return 10.0 * std::log10(255.0 * 255.0 / mse);
+}
+
+class CopyRectTest : public testing::Test
+{
+protected:
+    // Sends the frames of a scrolling document as the host does and decodes them as the client
+    // does. The decoded frame is compared with the captured one after each packet.
+    void scroll(proto::desktop::VideoEncoding encoding)
+    {
+        std::unique_ptr<VideoEncoder> encoder = createEncoder(encoding);
+        std::unique_ptr<VideoDecoder> decoder = VideoDecoder::create(encoding);
+        ASSERT_TRUE(encoder && decoder);
+
+        desktop::FrameGenerator generator(
+            desktop::FrameGenerator::Type::SCROLLING, kScreenSize, kFrameCount);
+
+        std::unique_ptr<desktop::Frame> captured_frame =
+            desktop::FrameSimple::create(kScreenSize, desktop::PixelFormat::ARGB());
+        std::unique_ptr<desktop::Frame> encode_frame =
+            desktop::FrameSimple::create(kScreenSize, desktop::PixelFormat::ARGB());
+        std::unique_ptr<desktop::Frame> client_frame =
+            desktop::FrameSimple::create(kScreenSize, desktop::PixelFormat::ARGB());
+
+        desktop::MoveDetector move_detector;
+        const bool copy_rect_supported = VideoUtil::isCopyRectSupported(encoding);
+
+        copy_rect_count_ = 0;
+
+        for (int i = 0; i < kFrameCount; ++i)
+        {
+            captured_frame->updatedRegion()->clear();
+            ASSERT_TRUE(generator.nextFrame(captured_frame.get()));
+
+            // The host: the encoding frame contains the image which the client has.
+            desktop::Rect move_rect;
+            desktop::Point move_source;
+            bool has_move = false;
+
+            if (copy_rect_supported && i != 0)
+            {
+                has_move = move_detector.detect(*encode_frame, *captured_frame,
+                                                captured_frame->constUpdatedRegion(),
+                                                &move_rect, &move_source);
+                if (has_move)
+                    encode_frame->copyPixelsWithin(move_source, move_rect);
+            }
+
+            desktop::Region copy_region(captured_frame->constUpdatedRegion());
+            if (has_move)
+                copy_region.subtract(move_rect);
+
+            for (desktop::Region::Iterator it(copy_region); !it.isAtEnd(); it.advance())
+                encode_frame->copyPixelsFrom(*captured_frame, it.rect().topLeft(), it.rect());
+
+            encode_frame->updatedRegion()->clear();
+            encode_frame->updatedRegion()->addRegion(copy_region);
+
+            proto::desktop::VideoPacket packet;
+            if (!copy_region.isEmpty())
+                encoder->encode(encode_frame.get(), &packet);
+
+            if (has_move)
+            {
+                proto::desktop::CopyRect* copy_rect = packet.add_copy_rect();
+                VideoUtil::toVideoRect(move_rect, copy_rect->mutable_dest_rect());
+                copy_rect->set_source_x(move_source.x());
+                copy_rect->set_source_y(move_source.y());
+            }
+
+            // The client: the moved areas are copied before the decoding.
+            for (int j = 0; j < packet.copy_rect_size(); ++j)
+            {
+                const proto::desktop::CopyRect& copy_rect = packet.copy_rect(j);
+                client_frame->copyPixelsWithin(
+                    desktop::Point(copy_rect.source_x(), copy_rect.source_y()),
+                    VideoUtil::fromVideoRect(copy_rect.dest_rect()));
+                ++copy_rect_count_;
+            }
+
+            if (packet.dirty_rect_size())
+            {
+                ASSERT_TRUE(decoder->decode(packet, client_frame.get())) << i;
+            }
+
+            if (encoding == proto::desktop::VIDEO_ENCODING_ZSTD)
+            {
+                EXPECT_EQ(differentPixels(*client_frame, *captured_frame), 0) << i;
+            }
+            else
+            {
+                EXPECT_GE(psnr(*client_frame, *captured_frame), kMinVpxPsnr) << i;
+            }
+        }
+    }
+
+    int copy_rect_count_ = 0;
+};
+
+} // namespace
+
+TEST(CopyRectSupportTest, Encodings)
+{
+    EXPECT_TRUE(VideoUtil::isCopyRectSupported(proto::desktop::VIDEO_ENCODING_ZSTD));
+    EXPECT_FALSE(VideoUtil::isCopyRectSupported(proto::desktop::VIDEO_ENCODING_VP8));
+    EXPECT_FALSE(VideoUtil::isCopyRectSupported(proto::desktop::VIDEO_ENCODING_VP9));
+}
+
+TEST_F(CopyRectTest, ScrollZstd)
+{
+    scroll(proto::desktop::VIDEO_ENCODING_ZSTD);
+
+    // Each scroll is copied, only the new lines are encoded.
+    EXPECT_EQ(copy_rect_count_, kFrameCount - 1);
+}
+
+TEST_F(CopyRectTest, ScrollVP8)
+{
+    scroll(proto::desktop::VIDEO_ENCODING_VP8);
+    EXPECT_EQ(copy_rect_count_, 0);
+}
+
+TEST_F(CopyRectTest, ScrollVP9)
+{
+    scroll(proto::desktop::VIDEO_ENCODING_VP9);
+    EXPECT_EQ(copy_rect_count_, 0);
+}
+
+} // namespace codec
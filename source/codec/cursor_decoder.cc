@@ -23,7 +23,8 @@
 namespace codec {
 
 CursorDecoder::CursorDecoder()
-    : stream_(ZSTD_createDStream())
+    : stream_(ZSTD_createDStream()),
+      dictionary_(ZstdDictionary::createForCursor())
 {
     // Nothing
 }
@@ -42,6 +43,18 @@ bool CursorDecoder::decompressCursor(const proto::desktop::CursorShape& cursor_s
     size_t ret = ZSTD_initDStream(stream_.get());
     DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
 
+    if (cursor_shape.dictionary_id())
+    {
+        if (cursor_shape.dictionary_id() != ZstdDictionary::kBuiltinId)
+        {
+            LOG(LS_WARNING) << "Unknown dictionary: " << cursor_shape.dictionary_id();
+            return false;
+        }
+
+        ret = ZSTD_DCtx_refPrefix(stream_.get(), dictionary_->data(), dictionary_->size());
+        DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
+    }
+
     ZSTD_inBuffer input = { data.data(), data.size(), 0 };
     ZSTD_outBuffer output = { output_data, output_size, 0 };
 
@@ -55,6 +68,8 @@ bool CursorDecoder::decompressCursor(const proto::desktop::CursorShape& cursor_s
         }
     }
 
+    // The next cursors can refer to this one.
+    dictionary_->append(output_data, output_size);
     return true;
 }
 
@@ -80,6 +95,10 @@ std::shared_ptr<desktop::MouseCursor> CursorDecoder::decode(
             return nullptr;
         }
 
+        // The appended cursors of the dictionary are cleared with the cache on the host side.
+        if (cursor_shape.flags() & proto::desktop::CursorShape::RESET_CACHE)
+            dictionary_->reset();
+
         size_t image_size = size.width() * size.height() * sizeof(uint32_t);
         std::unique_ptr<uint8_t[]> image = std::make_unique<uint8_t[]>(image_size);
 
@@ -21,6 +21,7 @@
 
 #include "base/macros_magic.h"
 #include "codec/scoped_zstd_stream.h"
+#include "codec/zstd_dictionary.h"
 #include "proto/desktop.pb.h"
 
 #include <memory>
@@ -47,6 +48,7 @@ private:
 
     std::unique_ptr<desktop::MouseCursorCache> cache_;
     ScopedZstdDStream stream_;
+    std::unique_ptr<ZstdDictionary> dictionary_;
 
     DISALLOW_COPY_AND_ASSIGN(CursorDecoder);
 };
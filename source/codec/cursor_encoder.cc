@@ -37,12 +37,15 @@ uint8_t* outputBuffer(proto::desktop::CursorShape* cursor_shape, size_t size)
 
 } // namespace
 
-CursorEncoder::CursorEncoder()
+CursorEncoder::CursorEncoder(uint32_t dictionary_id)
     : stream_(ZSTD_createCStream()),
       cache_(kCacheSize)
 {
     static_assert(kCacheSize >= 2 && kCacheSize <= 31);
     static_assert(kCompressionRatio >= 1 && kCompressionRatio <= 22);
+
+    if (dictionary_id == ZstdDictionary::kBuiltinId)
+        dictionary_ = ZstdDictionary::createForCursor();
 }
 
 bool CursorEncoder::compressCursor(proto::desktop::CursorShape* cursor_shape,
@@ -51,6 +54,14 @@ bool CursorEncoder::compressCursor(proto::desktop::CursorShape* cursor_shape,
     size_t ret = ZSTD_initCStream(stream_.get(), kCompressionRatio);
     DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
 
+    if (dictionary_)
+    {
+        ret = ZSTD_CCtx_refPrefix(stream_.get(), dictionary_->data(), dictionary_->size());
+        DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
+
+        cursor_shape->set_dictionary_id(ZstdDictionary::kBuiltinId);
+    }
+
     const size_t input_size = mouse_cursor->stride() * mouse_cursor->size().height();
     const uint8_t* input_data = mouse_cursor->data();
 
@@ -74,6 +85,11 @@ bool CursorEncoder::compressCursor(proto::desktop::CursorShape* cursor_shape,
     DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
 
     cursor_shape->mutable_data()->resize(output.pos);
+
+    // The next cursors can refer to this one.
+    if (dictionary_)
+        dictionary_->append(input_data, input_size);
+
     return true;
 }
 
@@ -103,6 +119,10 @@ bool CursorEncoder::encode(std::unique_ptr<desktop::MouseCursor> mouse_cursor,
         cursor_shape->set_hotspot_x(mouse_cursor->hotSpot().x());
         cursor_shape->set_hotspot_y(mouse_cursor->hotSpot().y());
 
+        // The client clears the appended cursors of the dictionary with the cache.
+        if (dictionary_ && cache_.isEmpty())
+            dictionary_->reset();
+
         if (!compressCursor(cursor_shape, mouse_cursor.get()))
             return false;
 
@@ -21,6 +21,7 @@
 
 #include "base/macros_magic.h"
 #include "codec/scoped_zstd_stream.h"
+#include "codec/zstd_dictionary.h"
 #include "desktop/mouse_cursor_cache.h"
 #include "proto/desktop.pb.h"
 
@@ -29,7 +30,9 @@ namespace codec {
 class CursorEncoder
 {
 public:
-    CursorEncoder();
+    // If |dictionary_id| is equal to ZstdDictionary::kBuiltinId, the cursors are compressed with
+    // the dictionary (see CursorShape.dictionary_id in desktop.proto).
+    explicit CursorEncoder(uint32_t dictionary_id = 0);
     ~CursorEncoder() = default;
 
     bool encode(std::unique_ptr<desktop::MouseCursor> mouse_cursor,
@@ -40,6 +43,7 @@ private:
                         const desktop::MouseCursor* mouse_cursor);
 
     ScopedZstdCStream stream_;
+    std::unique_ptr<ZstdDictionary> dictionary_;
     desktop::MouseCursorCache cache_;
 
     DISALLOW_COPY_AND_ASSIGN(CursorEncoder);
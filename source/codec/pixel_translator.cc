@@ -17,8 +17,10 @@
 //
 
 #include "codec/pixel_translator.h"
+#include "base/cpu_dispatch.h"
 #include "base/macros_magic.h"
 #include "build/build_config.h"
+#include "codec/pixel_translator_simd.h"
 
 namespace codec {
 
@@ -209,12 +211,100 @@ private:
     DISALLOW_COPY_AND_ASSIGN(PixelTranslatorFrom8_16bppT);
 };
 
+using TranslateFunc = void(*)(const uint8_t*, int, uint8_t*, int, int, int);
+
+// Calls the vector version of the translation for a pair of the formats. Like the other
+// translators, it has no state which is changed by the translation.
+class PixelTranslatorVector : public PixelTranslator
+{
+public:
+    explicit PixelTranslatorVector(TranslateFunc translate_func)
+        : translate_func_(translate_func)
+    {
+        // Nothing
+    }
+
+    ~PixelTranslatorVector() = default;
+
+    void translate(const uint8_t* src, int src_stride,
+                   uint8_t* dst, int dst_stride,
+                   int width, int height) override
+    {
+        translate_func_(src, src_stride, dst, dst_stride, width, height);
+    }
+
+private:
+    const TranslateFunc translate_func_;
+
+    DISALLOW_COPY_AND_ASSIGN(PixelTranslatorVector);
+};
+
+// The tables do not contain the C variants. If no vector version is available, the translators
+// with the tables are used.
+template <typename SourceFormat, typename TargetFormat>
+TranslateFunc selectTranslateFunc()
+{
+    static const base::CpuDispatchTable<TranslateFunc> kTable =
+    {
+        { base::CpuIsa::AVX2, translatePixels_AVX2<SourceFormat, TargetFormat> },
+        { base::CpuIsa::SSE2, translatePixels_SSE2<SourceFormat, TargetFormat> }
+    };
+
+    return kTable.select();
+}
+
+// The vector versions are available for the formats which the client offers to the user: from
+// ARGB on the host and to ARGB on the client.
+TranslateFunc translateFunc(const desktop::PixelFormat& source_format,
+                            const desktop::PixelFormat& target_format)
+{
+    const desktop::PixelFormat argb = desktop::PixelFormat::ARGB();
+
+    if (source_format.isEqual(argb))
+    {
+        if (target_format.isEqual(argb))
+            return selectTranslateFunc<PixelFormatARGB, PixelFormatARGB>();
+
+        if (target_format.isEqual(desktop::PixelFormat::RGB565()))
+            return selectTranslateFunc<PixelFormatARGB, PixelFormatRGB565>();
+
+        if (target_format.isEqual(desktop::PixelFormat::RGB332()))
+            return selectTranslateFunc<PixelFormatARGB, PixelFormatRGB332>();
+
+        if (target_format.isEqual(desktop::PixelFormat::RGB222()))
+            return selectTranslateFunc<PixelFormatARGB, PixelFormatRGB222>();
+
+        if (target_format.isEqual(desktop::PixelFormat::RGB111()))
+            return selectTranslateFunc<PixelFormatARGB, PixelFormatRGB111>();
+    }
+    else if (target_format.isEqual(argb))
+    {
+        if (source_format.isEqual(desktop::PixelFormat::RGB565()))
+            return selectTranslateFunc<PixelFormatRGB565, PixelFormatARGB>();
+
+        if (source_format.isEqual(desktop::PixelFormat::RGB332()))
+            return selectTranslateFunc<PixelFormatRGB332, PixelFormatARGB>();
+
+        if (source_format.isEqual(desktop::PixelFormat::RGB222()))
+            return selectTranslateFunc<PixelFormatRGB222, PixelFormatARGB>();
+
+        if (source_format.isEqual(desktop::PixelFormat::RGB111()))
+            return selectTranslateFunc<PixelFormatRGB111, PixelFormatARGB>();
+    }
+
+    return nullptr;
+}
+
 } // namespace
 
 // static
 std::unique_ptr<PixelTranslator> PixelTranslator::create(
     const desktop::PixelFormat& source_format, const desktop::PixelFormat& target_format)
 {
+    TranslateFunc translate_func = translateFunc(source_format, target_format);
+    if (translate_func)
+        return std::make_unique<PixelTranslatorVector>(translate_func);
+
     switch (target_format.bytesPerPixel())
     {
         case 4:
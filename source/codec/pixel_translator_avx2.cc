@@ -0,0 +1,256 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/pixel_translator_simd.h"
+#include "build/build_config.h"
+
+#if defined(CC_MSVC)
+#include <intrin.h>
+#else
+#include <immintrin.h>
+#endif
+
+#include <cstring>
+#include <type_traits>
+
+namespace codec {
+
+namespace {
+
+const int kPixelsPerStep = 32;
+
+// |pixels| contains 8 ARGB pixels. Returns the channel scaled to |kMax| at |kTargetShift| in
+// each 32-bit lane.
+template <uint32_t kMax, int kSourceShift, int kTargetShift>
+FORCEINLINE __m256i channelFromARGB(__m256i pixels)
+{
+    const __m256i value =
+        _mm256_and_si256(_mm256_srli_epi32(pixels, kSourceShift), _mm256_set1_epi32(0xFF));
+
+    if constexpr (kMax == 255)
+    {
+        return _mm256_slli_epi32(value, kTargetShift);
+    }
+    else
+    {
+        static_assert(isExactDivisionBy255(kMax));
+
+        // The product fits in the low half of the lane, so the 16-bit multiplication is enough.
+        __m256i scaled = _mm256_add_epi32(
+            _mm256_mullo_epi16(value, _mm256_set1_epi32(kMax)), _mm256_set1_epi32(127));
+
+        scaled = _mm256_add_epi32(
+            scaled, _mm256_add_epi32(_mm256_srli_epi32(scaled, 8), _mm256_set1_epi32(1)));
+
+        return _mm256_slli_epi32(_mm256_srli_epi32(scaled, 8), kTargetShift);
+    }
+}
+
+template <typename TargetFormat>
+FORCEINLINE __m256i pixelsFromARGB(__m256i pixels)
+{
+    if constexpr (std::is_same_v<TargetFormat, PixelFormatARGB>)
+    {
+        // The tables do not keep the alpha channel.
+        return _mm256_and_si256(pixels, _mm256_set1_epi32(0x00FFFFFF));
+    }
+    else
+    {
+        const __m256i red = channelFromARGB<
+            TargetFormat::kRedMax, PixelFormatARGB::kRedShift, TargetFormat::kRedShift>(pixels);
+        const __m256i green = channelFromARGB<
+            TargetFormat::kGreenMax, PixelFormatARGB::kGreenShift, TargetFormat::kGreenShift>(pixels);
+        const __m256i blue = channelFromARGB<
+            TargetFormat::kBlueMax, PixelFormatARGB::kBlueShift, TargetFormat::kBlueShift>(pixels);
+
+        return _mm256_or_si256(_mm256_or_si256(red, green), blue);
+    }
+}
+
+// Packs 32-bit lanes with 16-bit values. The sign extension prevents the saturation. As all
+// packing instructions of AVX2, it works within the 128-bit halves, so the result contains
+// 4 values of |first|, 4 values of |second| and the same for the high halves.
+FORCEINLINE __m256i pack32To16(__m256i first, __m256i second)
+{
+    first = _mm256_srai_epi32(_mm256_slli_epi32(first, 16), 16);
+    second = _mm256_srai_epi32(_mm256_slli_epi32(second, 16), 16);
+
+    return _mm256_packs_epi32(first, second);
+}
+
+// |pixels| contains 16 pixels of 16 or 8 bits in 16-bit lanes. Returns the channel scaled to 255.
+template <uint32_t kMax, int kShift>
+FORCEINLINE __m256i channelToARGB(__m256i pixels)
+{
+    const __m256i value =
+        _mm256_and_si256(_mm256_srli_epi16(pixels, kShift), _mm256_set1_epi16(kMax));
+    const __m256i scaled = _mm256_mullo_epi16(value, _mm256_set1_epi16(255));
+
+    if constexpr (kMax == 1)
+    {
+        return scaled;
+    }
+    else
+    {
+        constexpr ChannelDivider kDivider = channelDivider(kMax);
+        static_assert(kDivider.multiplier != 0);
+
+        const __m256i multiplier = _mm256_set1_epi16(static_cast<int16_t>(kDivider.multiplier));
+        return _mm256_srli_epi16(_mm256_mulhi_epu16(scaled, multiplier), kDivider.shift - 16);
+    }
+}
+
+template <typename SourceFormat>
+FORCEINLINE void storeARGB(__m256i pixels, __m256i* dst)
+{
+    const __m256i red = channelToARGB<SourceFormat::kRedMax, SourceFormat::kRedShift>(pixels);
+    const __m256i green = channelToARGB<SourceFormat::kGreenMax, SourceFormat::kGreenShift>(pixels);
+    const __m256i blue = channelToARGB<SourceFormat::kBlueMax, SourceFormat::kBlueShift>(pixels);
+
+    // The low half of each pixel contains green and blue, the high half contains red.
+    const __m256i green_blue = _mm256_or_si256(_mm256_slli_epi16(green, 8), blue);
+
+    // The pixels 0-3 and 8-11 are in |low|, 4-7 and 12-15 are in |high|.
+    const __m256i low = _mm256_unpacklo_epi16(green_blue, red);
+    const __m256i high = _mm256_unpackhi_epi16(green_blue, red);
+
+    _mm256_storeu_si256(dst + 0, _mm256_permute2x128_si256(low, high, 0x20));
+    _mm256_storeu_si256(dst + 1, _mm256_permute2x128_si256(low, high, 0x31));
+}
+
+// Translates |kPixelsPerStep| pixels.
+template <typename SourceFormat, typename TargetFormat>
+FORCEINLINE void translateStep(const uint8_t* src, uint8_t* dst)
+{
+    const __m256i* src256 = reinterpret_cast<const __m256i*>(src);
+    __m256i* dst256 = reinterpret_cast<__m256i*>(dst);
+
+    if constexpr (std::is_same_v<SourceFormat, PixelFormatARGB>)
+    {
+        const __m256i pixels0 = pixelsFromARGB<TargetFormat>(_mm256_loadu_si256(src256 + 0));
+        const __m256i pixels1 = pixelsFromARGB<TargetFormat>(_mm256_loadu_si256(src256 + 1));
+        const __m256i pixels2 = pixelsFromARGB<TargetFormat>(_mm256_loadu_si256(src256 + 2));
+        const __m256i pixels3 = pixelsFromARGB<TargetFormat>(_mm256_loadu_si256(src256 + 3));
+
+        if constexpr (TargetFormat::kBytesPerPixel == 4)
+        {
+            _mm256_storeu_si256(dst256 + 0, pixels0);
+            _mm256_storeu_si256(dst256 + 1, pixels1);
+            _mm256_storeu_si256(dst256 + 2, pixels2);
+            _mm256_storeu_si256(dst256 + 3, pixels3);
+        }
+        else if constexpr (TargetFormat::kBytesPerPixel == 2)
+        {
+            const int kOrder = _MM_SHUFFLE(3, 1, 2, 0);
+
+            _mm256_storeu_si256(
+                dst256 + 0, _mm256_permute4x64_epi64(pack32To16(pixels0, pixels1), kOrder));
+            _mm256_storeu_si256(
+                dst256 + 1, _mm256_permute4x64_epi64(pack32To16(pixels2, pixels3), kOrder));
+        }
+        else
+        {
+            // Each group of 4 bytes contains 4 pixels. The groups are ordered by the halves of
+            // the source registers: 0, 2, 4, 6 for the low halves and 1, 3, 5, 7 for the high.
+            const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+            const __m256i pixels = _mm256_packus_epi16(pack32To16(pixels0, pixels1),
+                                                       pack32To16(pixels2, pixels3));
+
+            _mm256_storeu_si256(dst256, _mm256_permutevar8x32_epi32(pixels, order));
+        }
+    }
+    else
+    {
+        static_assert(std::is_same_v<TargetFormat, PixelFormatARGB>);
+
+        if constexpr (SourceFormat::kBytesPerPixel == 2)
+        {
+            storeARGB<SourceFormat>(_mm256_loadu_si256(src256 + 0), dst256 + 0);
+            storeARGB<SourceFormat>(_mm256_loadu_si256(src256 + 1), dst256 + 2);
+        }
+        else
+        {
+            const __m128i* src128 = reinterpret_cast<const __m128i*>(src);
+
+            storeARGB<SourceFormat>(
+                _mm256_cvtepu8_epi16(_mm_loadu_si128(src128 + 0)), dst256 + 0);
+            storeARGB<SourceFormat>(
+                _mm256_cvtepu8_epi16(_mm_loadu_si128(src128 + 1)), dst256 + 2);
+        }
+    }
+}
+
+} // namespace
+
+template <typename SourceFormat, typename TargetFormat>
+void translatePixels_AVX2(const uint8_t* src, int src_stride,
+                          uint8_t* dst, int dst_stride,
+                          int width, int height)
+{
+    const int step_count = width / kPixelsPerStep;
+    const int partial_width = width - (step_count * kPixelsPerStep);
+
+    for (int y = 0; y < height; ++y)
+    {
+        const uint8_t* src_ptr = src;
+        uint8_t* dst_ptr = dst;
+
+        for (int x = 0; x < step_count; ++x)
+        {
+            translateStep<SourceFormat, TargetFormat>(src_ptr, dst_ptr);
+
+            src_ptr += kPixelsPerStep * SourceFormat::kBytesPerPixel;
+            dst_ptr += kPixelsPerStep * TargetFormat::kBytesPerPixel;
+        }
+
+        if (partial_width)
+        {
+            // The end of the row is translated through the buffers of a whole step.
+            uint8_t src_buffer[kPixelsPerStep * SourceFormat::kBytesPerPixel] = { 0 };
+            uint8_t dst_buffer[kPixelsPerStep * TargetFormat::kBytesPerPixel];
+
+            memcpy(src_buffer, src_ptr, partial_width * SourceFormat::kBytesPerPixel);
+            translateStep<SourceFormat, TargetFormat>(src_buffer, dst_buffer);
+            memcpy(dst_ptr, dst_buffer, partial_width * TargetFormat::kBytesPerPixel);
+        }
+
+        src += src_stride;
+        dst += dst_stride;
+    }
+}
+
+template void translatePixels_AVX2<PixelFormatARGB, PixelFormatARGB>(
+    const uint8_t*, int, uint8_t*, int, int, int);
+template void translatePixels_AVX2<PixelFormatARGB, PixelFormatRGB565>(
+    const uint8_t*, int, uint8_t*, int, int, int);
+template void translatePixels_AVX2<PixelFormatARGB, PixelFormatRGB332>(
+    const uint8_t*, int, uint8_t*, int, int, int);
+template void translatePixels_AVX2<PixelFormatARGB, PixelFormatRGB222>(
+    const uint8_t*, int, uint8_t*, int, int, int);
+template void translatePixels_AVX2<PixelFormatARGB, PixelFormatRGB111>(
+    const uint8_t*, int, uint8_t*, int, int, int);
+template void translatePixels_AVX2<PixelFormatRGB565, PixelFormatARGB>(
+    const uint8_t*, int, uint8_t*, int, int, int);
+template void translatePixels_AVX2<PixelFormatRGB332, PixelFormatARGB>(
+    const uint8_t*, int, uint8_t*, int, int, int);
+template void translatePixels_AVX2<PixelFormatRGB222, PixelFormatARGB>(
+    const uint8_t*, int, uint8_t*, int, int, int);
+template void translatePixels_AVX2<PixelFormatRGB111, PixelFormatARGB>(
+    const uint8_t*, int, uint8_t*, int, int, int);
+
+} // namespace codec
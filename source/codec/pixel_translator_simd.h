@@ -0,0 +1,121 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CODEC__PIXEL_TRANSLATOR_SIMD_H
+#define CODEC__PIXEL_TRANSLATOR_SIMD_H
+
+#include <cstdint>
+
+namespace codec {
+
+// Pixel formats for which the vector versions of PixelTranslator are compiled. Each of them is
+// equal to the desktop::PixelFormat with the same name.
+template <int kBytesPerPixelT,
+          uint32_t kRedMaxT, uint32_t kGreenMaxT, uint32_t kBlueMaxT,
+          int kRedShiftT, int kGreenShiftT, int kBlueShiftT>
+struct PixelFormatT
+{
+    static const int kBytesPerPixel = kBytesPerPixelT;
+
+    static const uint32_t kRedMax = kRedMaxT;
+    static const uint32_t kGreenMax = kGreenMaxT;
+    static const uint32_t kBlueMax = kBlueMaxT;
+
+    static const int kRedShift = kRedShiftT;
+    static const int kGreenShift = kGreenShiftT;
+    static const int kBlueShift = kBlueShiftT;
+};
+
+using PixelFormatARGB = PixelFormatT<4, 255, 255, 255, 16, 8, 0>;
+using PixelFormatRGB565 = PixelFormatT<2, 31, 63, 31, 11, 5, 0>;
+using PixelFormatRGB332 = PixelFormatT<1, 7, 7, 3, 5, 2, 0>;
+using PixelFormatRGB222 = PixelFormatT<1, 3, 3, 3, 4, 2, 0>;
+using PixelFormatRGB111 = PixelFormatT<1, 1, 1, 1, 2, 1, 0>;
+
+// The vector versions give the same results as the tables of PixelTranslator:
+// - from ARGB: target = (source * target_max + 127) / 255;
+// - to ARGB: target = source * 255 / source_max.
+// The division by the maximum of a channel is done by the multiplication by |multiplier| and
+// the shift right by |shift|.
+struct ChannelDivider
+{
+    uint32_t multiplier;
+    int shift;
+};
+
+constexpr bool isExactDivider(uint32_t max, ChannelDivider divider)
+{
+    for (uint32_t value = 0; value <= max; ++value)
+    {
+        const uint32_t scaled = value * 255;
+
+        if (((scaled * divider.multiplier) >> divider.shift) != scaled / max)
+            return false;
+    }
+
+    return true;
+}
+
+// Returns the divider with a 16-bit multiplier and a shift of at least 16 bits, so it can be
+// used with the multiplication of the high halves of 16-bit values.
+constexpr ChannelDivider channelDivider(uint32_t max)
+{
+    for (int shift = 16; shift < 32; ++shift)
+    {
+        const ChannelDivider divider = { ((1U << shift) + max - 1) / max, shift };
+
+        if (divider.multiplier > 0xFFFF)
+            break;
+
+        if (isExactDivider(max, divider))
+            return divider;
+    }
+
+    return { 0, 0 };
+}
+
+// Returns true if (value + 1 + (value >> 8)) >> 8 is equal to value / 255 for all channel values
+// of ARGB scaled to |max|.
+constexpr bool isExactDivisionBy255(uint32_t max)
+{
+    for (uint32_t value = 0; value <= 255; ++value)
+    {
+        const uint32_t scaled = value * max + 127;
+
+        if (((scaled + 1 + (scaled >> 8)) >> 8) != scaled / 255)
+            return false;
+    }
+
+    return true;
+}
+
+// The functions have the same parameters as PixelTranslator::translate. They are instantiated
+// for the translation from ARGB to each of the formats above and from each of them to ARGB.
+template <typename SourceFormat, typename TargetFormat>
+void translatePixels_SSE2(const uint8_t* src, int src_stride,
+                          uint8_t* dst, int dst_stride,
+                          int width, int height);
+
+template <typename SourceFormat, typename TargetFormat>
+void translatePixels_AVX2(const uint8_t* src, int src_stride,
+                          uint8_t* dst, int dst_stride,
+                          int width, int height);
+
+} // namespace codec
+
+#endif // CODEC__PIXEL_TRANSLATOR_SIMD_H
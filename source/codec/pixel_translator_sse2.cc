@@ -0,0 +1,239 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/pixel_translator_simd.h"
+#include "build/build_config.h"
+
+#if defined(CC_MSVC)
+#include <intrin.h>
+#else
+#include <mmintrin.h>
+#include <emmintrin.h>
+#endif
+
+#include <cstring>
+#include <type_traits>
+
+namespace codec {
+
+namespace {
+
+const int kPixelsPerStep = 16;
+
+// |pixels| contains 4 ARGB pixels. Returns the channel scaled to |kMax| at |kTargetShift| in
+// each 32-bit lane.
+template <uint32_t kMax, int kSourceShift, int kTargetShift>
+FORCEINLINE __m128i channelFromARGB(__m128i pixels)
+{
+    const __m128i value = _mm_and_si128(_mm_srli_epi32(pixels, kSourceShift), _mm_set1_epi32(0xFF));
+
+    if constexpr (kMax == 255)
+    {
+        return _mm_slli_epi32(value, kTargetShift);
+    }
+    else
+    {
+        static_assert(isExactDivisionBy255(kMax));
+
+        // The product fits in the low half of the lane, so the 16-bit multiplication is enough.
+        __m128i scaled = _mm_add_epi32(
+            _mm_mullo_epi16(value, _mm_set1_epi32(kMax)), _mm_set1_epi32(127));
+
+        scaled = _mm_add_epi32(
+            scaled, _mm_add_epi32(_mm_srli_epi32(scaled, 8), _mm_set1_epi32(1)));
+
+        return _mm_slli_epi32(_mm_srli_epi32(scaled, 8), kTargetShift);
+    }
+}
+
+template <typename TargetFormat>
+FORCEINLINE __m128i pixelsFromARGB(__m128i pixels)
+{
+    if constexpr (std::is_same_v<TargetFormat, PixelFormatARGB>)
+    {
+        // The tables do not keep the alpha channel.
+        return _mm_and_si128(pixels, _mm_set1_epi32(0x00FFFFFF));
+    }
+    else
+    {
+        const __m128i red = channelFromARGB<
+            TargetFormat::kRedMax, PixelFormatARGB::kRedShift, TargetFormat::kRedShift>(pixels);
+        const __m128i green = channelFromARGB<
+            TargetFormat::kGreenMax, PixelFormatARGB::kGreenShift, TargetFormat::kGreenShift>(pixels);
+        const __m128i blue = channelFromARGB<
+            TargetFormat::kBlueMax, PixelFormatARGB::kBlueShift, TargetFormat::kBlueShift>(pixels);
+
+        return _mm_or_si128(_mm_or_si128(red, green), blue);
+    }
+}
+
+// Packs 32-bit lanes with 16-bit values. The sign extension prevents the saturation.
+FORCEINLINE __m128i pack32To16(__m128i first, __m128i second)
+{
+    first = _mm_srai_epi32(_mm_slli_epi32(first, 16), 16);
+    second = _mm_srai_epi32(_mm_slli_epi32(second, 16), 16);
+
+    return _mm_packs_epi32(first, second);
+}
+
+// |pixels| contains 8 pixels of 16 or 8 bits in 16-bit lanes. Returns the channel scaled to 255.
+template <uint32_t kMax, int kShift>
+FORCEINLINE __m128i channelToARGB(__m128i pixels)
+{
+    const __m128i value = _mm_and_si128(_mm_srli_epi16(pixels, kShift), _mm_set1_epi16(kMax));
+    const __m128i scaled = _mm_mullo_epi16(value, _mm_set1_epi16(255));
+
+    if constexpr (kMax == 1)
+    {
+        return scaled;
+    }
+    else
+    {
+        constexpr ChannelDivider kDivider = channelDivider(kMax);
+        static_assert(kDivider.multiplier != 0);
+
+        const __m128i multiplier = _mm_set1_epi16(static_cast<int16_t>(kDivider.multiplier));
+        return _mm_srli_epi16(_mm_mulhi_epu16(scaled, multiplier), kDivider.shift - 16);
+    }
+}
+
+template <typename SourceFormat>
+FORCEINLINE void storeARGB(__m128i pixels, __m128i* dst)
+{
+    const __m128i red = channelToARGB<SourceFormat::kRedMax, SourceFormat::kRedShift>(pixels);
+    const __m128i green = channelToARGB<SourceFormat::kGreenMax, SourceFormat::kGreenShift>(pixels);
+    const __m128i blue = channelToARGB<SourceFormat::kBlueMax, SourceFormat::kBlueShift>(pixels);
+
+    // The low half of each pixel contains green and blue, the high half contains red.
+    const __m128i green_blue = _mm_or_si128(_mm_slli_epi16(green, 8), blue);
+
+    _mm_storeu_si128(dst + 0, _mm_unpacklo_epi16(green_blue, red));
+    _mm_storeu_si128(dst + 1, _mm_unpackhi_epi16(green_blue, red));
+}
+
+// Translates |kPixelsPerStep| pixels.
+template <typename SourceFormat, typename TargetFormat>
+FORCEINLINE void translateStep(const uint8_t* src, uint8_t* dst)
+{
+    const __m128i* src128 = reinterpret_cast<const __m128i*>(src);
+    __m128i* dst128 = reinterpret_cast<__m128i*>(dst);
+
+    if constexpr (std::is_same_v<SourceFormat, PixelFormatARGB>)
+    {
+        const __m128i pixels0 = pixelsFromARGB<TargetFormat>(_mm_loadu_si128(src128 + 0));
+        const __m128i pixels1 = pixelsFromARGB<TargetFormat>(_mm_loadu_si128(src128 + 1));
+        const __m128i pixels2 = pixelsFromARGB<TargetFormat>(_mm_loadu_si128(src128 + 2));
+        const __m128i pixels3 = pixelsFromARGB<TargetFormat>(_mm_loadu_si128(src128 + 3));
+
+        if constexpr (TargetFormat::kBytesPerPixel == 4)
+        {
+            _mm_storeu_si128(dst128 + 0, pixels0);
+            _mm_storeu_si128(dst128 + 1, pixels1);
+            _mm_storeu_si128(dst128 + 2, pixels2);
+            _mm_storeu_si128(dst128 + 3, pixels3);
+        }
+        else if constexpr (TargetFormat::kBytesPerPixel == 2)
+        {
+            _mm_storeu_si128(dst128 + 0, pack32To16(pixels0, pixels1));
+            _mm_storeu_si128(dst128 + 1, pack32To16(pixels2, pixels3));
+        }
+        else
+        {
+            _mm_storeu_si128(dst128, _mm_packus_epi16(pack32To16(pixels0, pixels1),
+                                                      pack32To16(pixels2, pixels3)));
+        }
+    }
+    else
+    {
+        static_assert(std::is_same_v<TargetFormat, PixelFormatARGB>);
+
+        if constexpr (SourceFormat::kBytesPerPixel == 2)
+        {
+            storeARGB<SourceFormat>(_mm_loadu_si128(src128 + 0), dst128 + 0);
+            storeARGB<SourceFormat>(_mm_loadu_si128(src128 + 1), dst128 + 2);
+        }
+        else
+        {
+            const __m128i pixels = _mm_loadu_si128(src128);
+            const __m128i zero = _mm_setzero_si128();
+
+            storeARGB<SourceFormat>(_mm_unpacklo_epi8(pixels, zero), dst128 + 0);
+            storeARGB<SourceFormat>(_mm_unpackhi_epi8(pixels, zero), dst128 + 2);
+        }
+    }
+}
+
+} // namespace
+
+template <typename SourceFormat, typename TargetFormat>
+void translatePixels_SSE2(const uint8_t* src, int src_stride,
+                          uint8_t* dst, int dst_stride,
+                          int width, int height)
+{
+    const int step_count = width / kPixelsPerStep;
+    const int partial_width = width - (step_count * kPixelsPerStep);
+
+    for (int y = 0; y < height; ++y)
+    {
+        const uint8_t* src_ptr = src;
+        uint8_t* dst_ptr = dst;
+
+        for (int x = 0; x < step_count; ++x)
+        {
+            translateStep<SourceFormat, TargetFormat>(src_ptr, dst_ptr);
+
+            src_ptr += kPixelsPerStep * SourceFormat::kBytesPerPixel;
+            dst_ptr += kPixelsPerStep * TargetFormat::kBytesPerPixel;
+        }
+
+        if (partial_width)
+        {
+            // The end of the row is translated through the buffers of a whole step.
+            uint8_t src_buffer[kPixelsPerStep * SourceFormat::kBytesPerPixel] = { 0 };
+            uint8_t dst_buffer[kPixelsPerStep * TargetFormat::kBytesPerPixel];
+
+            memcpy(src_buffer, src_ptr, partial_width * SourceFormat::kBytesPerPixel);
+            translateStep<SourceFormat, TargetFormat>(src_buffer, dst_buffer);
+            memcpy(dst_ptr, dst_buffer, partial_width * TargetFormat::kBytesPerPixel);
+        }
+
+        src += src_stride;
+        dst += dst_stride;
+    }
+}
+
+template void translatePixels_SSE2<PixelFormatARGB, PixelFormatARGB>(
+    const uint8_t*, int, uint8_t*, int, int, int);
+template void translatePixels_SSE2<PixelFormatARGB, PixelFormatRGB565>(
+    const uint8_t*, int, uint8_t*, int, int, int);
+template void translatePixels_SSE2<PixelFormatARGB, PixelFormatRGB332>(
+    const uint8_t*, int, uint8_t*, int, int, int);
+template void translatePixels_SSE2<PixelFormatARGB, PixelFormatRGB222>(
+    const uint8_t*, int, uint8_t*, int, int, int);
+template void translatePixels_SSE2<PixelFormatARGB, PixelFormatRGB111>(
+    const uint8_t*, int, uint8_t*, int, int, int);
+template void translatePixels_SSE2<PixelFormatRGB565, PixelFormatARGB>(
+    const uint8_t*, int, uint8_t*, int, int, int);
+template void translatePixels_SSE2<PixelFormatRGB332, PixelFormatARGB>(
+    const uint8_t*, int, uint8_t*, int, int, int);
+template void translatePixels_SSE2<PixelFormatRGB222, PixelFormatARGB>(
+    const uint8_t*, int, uint8_t*, int, int, int);
+template void translatePixels_SSE2<PixelFormatRGB111, PixelFormatARGB>(
+    const uint8_t*, int, uint8_t*, int, int, int);
+
+} // namespace codec
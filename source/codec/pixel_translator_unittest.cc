@@ -0,0 +1,215 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/pixel_translator.h"
+#include "base/cpu_dispatch.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace codec {
+
+namespace {
+
+// Guard bytes after each row of the target, the translation must not change them.
+const int kGuardSize = 64;
+const uint8_t kGuardValue = 0xA5;
+
+class ScopedMaxCpuIsa
+{
+public:
+    explicit ScopedMaxCpuIsa(base::CpuIsa isa)
+        : previous_(base::maxCpuIsa())
+    {
+        base::setMaxCpuIsa(isa);
+    }
+
+    ~ScopedMaxCpuIsa() { base::setMaxCpuIsa(previous_); }
+
+private:
+    const base::CpuIsa previous_;
+};
+
+struct FormatPair
+{
+    const char* name;
+    desktop::PixelFormat source;
+    desktop::PixelFormat target;
+};
+
+std::vector<FormatPair> formatPairs()
+{
+    return
+    {
+        { "ARGB to ARGB", desktop::PixelFormat::ARGB(), desktop::PixelFormat::ARGB() },
+        { "ARGB to RGB565", desktop::PixelFormat::ARGB(), desktop::PixelFormat::RGB565() },
+        { "ARGB to RGB332", desktop::PixelFormat::ARGB(), desktop::PixelFormat::RGB332() },
+        { "ARGB to RGB222", desktop::PixelFormat::ARGB(), desktop::PixelFormat::RGB222() },
+        { "ARGB to RGB111", desktop::PixelFormat::ARGB(), desktop::PixelFormat::RGB111() },
+        { "RGB565 to ARGB", desktop::PixelFormat::RGB565(), desktop::PixelFormat::ARGB() },
+        { "RGB332 to ARGB", desktop::PixelFormat::RGB332(), desktop::PixelFormat::ARGB() },
+        { "RGB222 to ARGB", desktop::PixelFormat::RGB222(), desktop::PixelFormat::ARGB() },
+        { "RGB111 to ARGB", desktop::PixelFormat::RGB111(), desktop::PixelFormat::ARGB() }
+    };
+}
+
+// Translates the image with the instruction sets limited to |isa|. The target rows have the guard
+// bytes at the end.
+std::vector<uint8_t> translate(base::CpuIsa isa,
+                               const FormatPair& formats,
+                               const std::vector<uint8_t>& source,
+                               int width,
+                               int height)
+{
+    std::unique_ptr<PixelTranslator> translator;
+
+    {
+        ScopedMaxCpuIsa max_isa(isa);
+        translator = PixelTranslator::create(formats.source, formats.target);
+    }
+
+    EXPECT_TRUE(translator);
+    if (!translator)
+        return std::vector<uint8_t>();
+
+    // The source rows have a gap at the end to check the stride.
+    const int src_stride = width * formats.source.bytesPerPixel() + 8;
+    const int dst_stride = width * formats.target.bytesPerPixel() + kGuardSize;
+
+    std::vector<uint8_t> target(dst_stride * height, kGuardValue);
+
+    translator->translate(source.data(), src_stride, target.data(), dst_stride, width, height);
+    return target;
+}
+
+// Checks that the vector versions give the same results as the tables for |source|.
+void compareWithTables(const FormatPair& formats,
+                       const std::vector<uint8_t>& source,
+                       int width,
+                       int height)
+{
+    const std::vector<uint8_t> expected =
+        translate(base::CpuIsa::C, formats, source, width, height);
+
+    const int dst_stride = width * formats.target.bytesPerPixel() + kGuardSize;
+    const int row_size = width * formats.target.bytesPerPixel();
+
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = row_size; x < dst_stride; ++x)
+            ASSERT_EQ(expected[y * dst_stride + x], kGuardValue);
+    }
+
+    for (base::CpuIsa isa : { base::CpuIsa::SSE2, base::CpuIsa::AVX2 })
+    {
+        if (!base::isCpuIsaSupported(isa))
+            continue;
+
+        const std::vector<uint8_t> target = translate(isa, formats, source, width, height);
+        ASSERT_EQ(target.size(), expected.size());
+
+        const auto difference = std::mismatch(expected.begin(), expected.end(), target.begin());
+
+        EXPECT_TRUE(difference.first == expected.end())
+            << formats.name << ", " << base::cpuIsaName(isa) << ", width " << width
+            << ", the first different byte " << (difference.first - expected.begin());
+    }
+}
+
+} // namespace
+
+TEST(PixelTranslatorTest, RandomImages)
+{
+    std::mt19937 random(1);
+
+    for (const FormatPair& formats : formatPairs())
+    {
+        // The widths cover the whole vector steps and the rest of the rows.
+        for (int width = 1; width <= 100; ++width)
+        {
+            const int height = 3;
+            const int src_stride = width * formats.source.bytesPerPixel() + 8;
+
+            std::vector<uint8_t> source(src_stride * height);
+            for (auto& value : source)
+                value = static_cast<uint8_t>(random());
+
+            compareWithTables(formats, source, width, height);
+        }
+    }
+}
+
+TEST(PixelTranslatorTest, AllColors)
+{
+    for (const FormatPair& formats : formatPairs())
+    {
+        int width;
+        std::vector<uint8_t> source;
+
+        switch (formats.source.bytesPerPixel())
+        {
+            case 4:
+            {
+                // Each channel takes all values, the alpha channel changes too.
+                width = 256;
+
+                for (uint32_t i = 0; i < 256; ++i)
+                {
+                    const uint32_t pixel = (i << 24) | (i << 16) | ((255 - i) << 8) | (i * 7 & 0xFF);
+
+                    source.push_back(static_cast<uint8_t>(pixel));
+                    source.push_back(static_cast<uint8_t>(pixel >> 8));
+                    source.push_back(static_cast<uint8_t>(pixel >> 16));
+                    source.push_back(static_cast<uint8_t>(pixel >> 24));
+                }
+            }
+            break;
+
+            case 2:
+            {
+                width = 65536;
+
+                for (uint32_t i = 0; i < 65536; ++i)
+                {
+                    source.push_back(static_cast<uint8_t>(i));
+                    source.push_back(static_cast<uint8_t>(i >> 8));
+                }
+            }
+            break;
+
+            default:
+            {
+                width = 256;
+
+                for (uint32_t i = 0; i < 256; ++i)
+                    source.push_back(static_cast<uint8_t>(i));
+            }
+            break;
+        }
+
+        // The gap at the end of the row.
+        source.resize(source.size() + 8);
+
+        compareWithTables(formats, source, width, 1);
+    }
+}
+
+} // namespace codec
@@ -0,0 +1,292 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/region_simplifier.h"
+#include "base/logging.h"
+
+#include <algorithm>
+
+namespace codec {
+
+namespace {
+
+// Each rectangle is tried to be merged with this number of following rectangles.
+const size_t kMergeWindow = 8;
+
+// If the number of rectangles exceeds the limit this many times, the grid is made coarser before
+// the merging. The merging of many small rectangles would take most of the encoding time and
+// would be repeated for each coarser grid anyway.
+const size_t kCoarseGridFactor = 16;
+
+int64_t area(const desktop::Rect& rect)
+{
+    return static_cast<int64_t>(rect.width()) * rect.height();
+}
+
+bool isIntersected(const desktop::Rect& rect1, const desktop::Rect& rect2)
+{
+    return rect1.left() < rect2.right() && rect2.left() < rect1.right() &&
+           rect1.top() < rect2.bottom() && rect2.top() < rect1.bottom();
+}
+
+int32_t alignDown(int32_t value, int alignment)
+{
+    const int32_t remainder = value % alignment;
+    return (remainder < 0) ? (value - remainder - alignment) : (value - remainder);
+}
+
+int32_t alignUp(int32_t value, int alignment)
+{
+    return alignDown(value + alignment - 1, alignment);
+}
+
+// Tries to merge the rectangle |index| with the rectangle |other|. The bounding box of the two
+// rectangles absorbs all the rectangles inside it. The merge is rejected if the box crosses
+// some other rectangle (the result would overlap it) or if the extra pixels of the box cost
+// more than |rect_cost| for each saved rectangle. |max_height| is the height of the tallest
+// rectangle in |rects|.
+// The absorbed rectangles are not removed from |rects|, they are made empty at their top edge,
+// so the rectangles remain sorted by the top edge. The box replaces the rectangle |index|, which
+// has the top of the box.
+bool tryMerge(std::vector<desktop::Rect>* rects, size_t index, size_t other,
+              int64_t rect_cost, int32_t max_height)
+{
+    desktop::Rect box = (*rects)[index];
+    box.unionWith((*rects)[other]);
+
+    // The rectangles are sorted by the top edge, so only the rectangles in this range can
+    // intersect the box.
+    auto compare_top = [](const desktop::Rect& rect, int32_t value) { return rect.top() < value; };
+
+    const size_t first = std::lower_bound(rects->begin(), rects->end(),
+                                          box.top() - max_height, compare_top) - rects->begin();
+    const size_t last = std::lower_bound(rects->begin() + first, rects->end(),
+                                         box.bottom(), compare_top) - rects->begin();
+
+    int64_t covered_area = 0;
+    int64_t covered_count = 0;
+
+    for (size_t i = first; i < last; ++i)
+    {
+        const desktop::Rect& rect = (*rects)[i];
+
+        if (rect.isEmpty() || !isIntersected(box, rect))
+            continue;
+
+        if (!box.containsRect(rect))
+            return false;
+
+        covered_area += area(rect);
+        ++covered_count;
+    }
+
+    if (area(box) - covered_area >= rect_cost * (covered_count - 1))
+        return false;
+
+    for (size_t i = first; i < last; ++i)
+    {
+        desktop::Rect& rect = (*rects)[i];
+
+        if (i != index && !rect.isEmpty() && isIntersected(box, rect))
+            rect = desktop::Rect::makeXYWH(rect.left(), rect.top(), 0, 0);
+    }
+
+    (*rects)[index] = box;
+    return true;
+}
+
+// Merges the rectangles while it reduces the cost.
+void mergeByCost(std::vector<desktop::Rect>* rects, int64_t rect_cost)
+{
+    int32_t max_height = 0;
+    for (const auto& rect : *rects)
+        max_height = std::max(max_height, rect.height());
+
+    for (size_t i = 0; i < rects->size(); ++i)
+    {
+        if ((*rects)[i].isEmpty())
+            continue;
+
+        // The window contains the next kMergeWindow rectangles which are not merged yet.
+        size_t j = i + 1;
+        size_t window = 0;
+
+        while (j < rects->size() && window < kMergeWindow)
+        {
+            if ((*rects)[j].isEmpty())
+            {
+                ++j;
+                continue;
+            }
+
+            if (tryMerge(rects, i, j, rect_cost, max_height))
+            {
+                max_height = std::max(max_height, (*rects)[i].height());
+                j = i + 1;
+                window = 0;
+            }
+            else
+            {
+                ++j;
+                ++window;
+            }
+        }
+    }
+
+    // The merged rectangles are removed once for the whole pass.
+    rects->erase(std::remove_if(rects->begin(), rects->end(),
+                                [](const desktop::Rect& rect) { return rect.isEmpty(); }),
+                 rects->end());
+}
+
+desktop::Rect boundingBox(const std::vector<desktop::Rect>& rects)
+{
+    desktop::Rect box = rects.front();
+
+    for (const auto& rect : rects)
+        box.unionWith(rect);
+
+    return box;
+}
+
+} // namespace
+
+RegionSimplifier::RegionSimplifier(const Params& params)
+    : params_(params)
+{
+    DCHECK_GE(params_.alignment, 1);
+    DCHECK_GE(params_.rect_cost, 0);
+    DCHECK_GE(params_.max_rects, 0);
+}
+
+RegionSimplifier::~RegionSimplifier() = default;
+
+void RegionSimplifier::simplify(const desktop::Region& region,
+                                const desktop::Rect& bounds,
+                                std::vector<desktop::Rect>* rects)
+{
+    int alignment = params_.alignment;
+
+    alignRects(region, bounds, alignment, rects);
+
+    if (params_.max_rects)
+    {
+        const size_t coarse_limit = static_cast<size_t>(params_.max_rects) * kCoarseGridFactor;
+        const int max_alignment = std::max(bounds.width(), bounds.height());
+
+        if (rects->size() > coarse_limit)
+        {
+            // The grids finer than the alignment of the rectangles do not change them. For
+            // example, a checkerboard of 8x8 cells remains the same on the grids of 2, 4 and 8.
+            uint32_t edges = 0;
+
+            for (const auto& rect : *rects)
+            {
+                edges |= static_cast<uint32_t>(rect.left()) | static_cast<uint32_t>(rect.top()) |
+                    static_cast<uint32_t>(rect.right()) | static_cast<uint32_t>(rect.bottom());
+            }
+
+            // The lowest set bit of the edges is the alignment of all the rectangles.
+            const uint32_t rects_alignment = edges & (0U - edges);
+
+            if (rects_alignment > static_cast<uint32_t>(alignment) &&
+                rects_alignment < static_cast<uint32_t>(max_alignment))
+            {
+                alignment = static_cast<int>(rects_alignment);
+            }
+        }
+
+        while (rects->size() > coarse_limit && alignment < max_alignment)
+        {
+            alignment *= 2;
+            alignRects(region, bounds, alignment, rects);
+        }
+    }
+
+    if (params_.rect_cost > 0)
+        mergeByCost(rects, params_.rect_cost);
+
+    if (!params_.max_rects)
+        return;
+
+    // While there are too many rectangles, use a coarser grid. Each step at least halves
+    // the number of cells in the grid, so the number of rectangles quickly decreases.
+    while (rects->size() > static_cast<size_t>(params_.max_rects))
+    {
+        if (alignment >= std::max(bounds.width(), bounds.height()))
+        {
+            // The grid can not be coarser. The whole region is sent as one rectangle.
+            desktop::Rect box = boundingBox(*rects);
+
+            rects->clear();
+            rects->push_back(box);
+            break;
+        }
+
+        alignment *= 2;
+
+        alignRects(region, bounds, alignment, rects);
+
+        if (params_.rect_cost > 0)
+            mergeByCost(rects, params_.rect_cost);
+    }
+}
+
+void RegionSimplifier::alignRects(const desktop::Region& region,
+                                  const desktop::Rect& bounds,
+                                  int alignment,
+                                  std::vector<desktop::Rect>* rects)
+{
+    rects->clear();
+
+    if (alignment == 1)
+    {
+        for (desktop::Region::Iterator it(region); !it.isAtEnd(); it.advance())
+        {
+            desktop::Rect rect = it.rect();
+
+            rect.intersectWith(bounds);
+            if (!rect.isEmpty())
+                rects->push_back(rect);
+        }
+
+        return;
+    }
+
+    {
+        // The alignment keeps the order of the rectangles by their top edge.
+        desktop::Region::Builder builder(&aligned_region_);
+
+        for (desktop::Region::Iterator it(region); !it.isAtEnd(); it.advance())
+        {
+            const desktop::Rect& rect = it.rect();
+
+            desktop::Rect aligned_rect = desktop::Rect::makeLTRB(
+                alignDown(rect.left(), alignment), alignDown(rect.top(), alignment),
+                alignUp(rect.right(), alignment), alignUp(rect.bottom(), alignment));
+
+            aligned_rect.intersectWith(bounds);
+            builder.addRect(aligned_rect);
+        }
+    }
+
+    for (desktop::Region::Iterator it(aligned_region_); !it.isAtEnd(); it.advance())
+        rects->push_back(it.rect());
+}
+
+} // namespace codec
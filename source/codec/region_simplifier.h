@@ -0,0 +1,76 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CODEC__REGION_SIMPLIFIER_H
+#define CODEC__REGION_SIMPLIFIER_H
+
+#include "base/macros_magic.h"
+#include "desktop/desktop_region.h"
+
+#include <vector>
+
+namespace codec {
+
+// Converts the updated region of a frame to a short list of rectangles for the encoder.
+// Each rectangle costs the encoder a fixed overhead (a rectangle in the packet, a separate call
+// of the pixel translator, etc), so small rectangles located near each other are merged into
+// their bounding box when the extra pixels cost less than the rectangles saved. The number of
+// rectangles may also be limited.
+class RegionSimplifier
+{
+public:
+    struct Params
+    {
+        // The rectangles are expanded to a grid with cells of this size before merging. Merging
+        // rectangles which share cells of the grid costs nothing.
+        int alignment = 1;
+
+        // Overhead of one rectangle in pixels. 0 disables merging by the cost.
+        int rect_cost = 0;
+
+        // Maximum number of rectangles. 0 means no limit. If there are far more rectangles, the
+        // grid is made coarser before merging.
+        int max_rects = 0;
+    };
+
+    explicit RegionSimplifier(const Params& params);
+    ~RegionSimplifier();
+
+    // Stores to |rects| non-overlapping rectangles which cover |region| clipped by |bounds|.
+    // The rectangles are sorted by their top edge.
+    void simplify(const desktop::Region& region,
+                  const desktop::Rect& bounds,
+                  std::vector<desktop::Rect>* rects);
+
+private:
+    void alignRects(const desktop::Region& region,
+                    const desktop::Rect& bounds,
+                    int alignment,
+                    std::vector<desktop::Rect>* rects);
+
+    const Params params_;
+
+    // Kept between the calls to avoid memory allocations.
+    desktop::Region aligned_region_;
+
+    DISALLOW_COPY_AND_ASSIGN(RegionSimplifier);
+};
+
+} // namespace codec
+
+#endif // CODEC__REGION_SIMPLIFIER_H
@@ -0,0 +1,193 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/region_simplifier.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+namespace codec {
+
+namespace {
+
+const desktop::Rect kBounds = desktop::Rect::makeWH(640, 480);
+
+// Checks that the rectangles do not overlap, are sorted by the top edge and cover |region|.
+void expectValidRects(const desktop::Region& region, const std::vector<desktop::Rect>& rects)
+{
+    desktop::Region covered;
+
+    for (size_t i = 0; i < rects.size(); ++i)
+    {
+        EXPECT_FALSE(rects[i].isEmpty());
+        EXPECT_TRUE(kBounds.containsRect(rects[i]));
+
+        if (i > 0)
+        {
+            EXPECT_LE(rects[i - 1].top(), rects[i].top());
+        }
+
+        desktop::Region intersection(rects[i]);
+        intersection.intersectWith(covered);
+        EXPECT_TRUE(intersection.isEmpty());
+
+        covered.addRect(rects[i]);
+    }
+
+    desktop::Region uncovered(region);
+    uncovered.intersectWith(kBounds);
+    uncovered.subtract(covered);
+    EXPECT_TRUE(uncovered.isEmpty());
+}
+
+desktop::Region randomRegion(int count, uint32_t seed)
+{
+    std::mt19937 random(seed);
+    desktop::Region region;
+
+    for (int i = 0; i < count; ++i)
+    {
+        region.addRect(desktop::Rect::makeXYWH(
+            random() % 660 - 10, random() % 500 - 10, 1 + random() % 8, 1 + random() % 8));
+    }
+
+    return region;
+}
+
+} // namespace
+
+TEST(RegionSimplifierTest, NoSimplification)
+{
+    RegionSimplifier simplifier(RegionSimplifier::Params{});
+    desktop::Region region = randomRegion(100, 1);
+
+    std::vector<desktop::Rect> rects;
+    simplifier.simplify(region, kBounds, &rects);
+
+    expectValidRects(region, rects);
+
+    desktop::Region expected(region);
+    expected.intersectWith(kBounds);
+    EXPECT_TRUE(desktop::Region(rects.data(), static_cast<int>(rects.size())).equals(expected));
+}
+
+TEST(RegionSimplifierTest, MergesNearRects)
+{
+    RegionSimplifier::Params params;
+    params.rect_cost = 64;
+
+    RegionSimplifier simplifier(params);
+
+    desktop::Region region;
+    region.addRect(desktop::Rect::makeXYWH(10, 10, 8, 8));
+    region.addRect(desktop::Rect::makeXYWH(20, 10, 8, 8));  // Gap of 16 pixels.
+    region.addRect(desktop::Rect::makeXYWH(300, 10, 8, 8)); // Too far.
+
+    std::vector<desktop::Rect> rects;
+    simplifier.simplify(region, kBounds, &rects);
+
+    ASSERT_EQ(rects.size(), 2U);
+    EXPECT_EQ(rects[0], desktop::Rect::makeXYWH(10, 10, 18, 8));
+    EXPECT_EQ(rects[1], desktop::Rect::makeXYWH(300, 10, 8, 8));
+}
+
+TEST(RegionSimplifierTest, Alignment)
+{
+    RegionSimplifier::Params params;
+    params.alignment = 16;
+
+    RegionSimplifier simplifier(params);
+
+    desktop::Region region;
+    region.addRect(desktop::Rect::makeXYWH(1, 1, 2, 2));
+    region.addRect(desktop::Rect::makeXYWH(10, 10, 2, 2));
+    region.addRect(desktop::Rect::makeXYWH(635, 475, 2, 2));
+
+    std::vector<desktop::Rect> rects;
+    simplifier.simplify(region, kBounds, &rects);
+
+    ASSERT_EQ(rects.size(), 2U);
+    EXPECT_EQ(rects[0], desktop::Rect::makeXYWH(0, 0, 16, 16));
+    EXPECT_EQ(rects[1], desktop::Rect::makeXYWH(624, 464, 16, 16));
+}
+
+TEST(RegionSimplifierTest, RectBudget)
+{
+    for (int max_rects : { 1, 4, 16, 64 })
+    {
+        RegionSimplifier::Params params;
+        params.rect_cost = 64;
+        params.max_rects = max_rects;
+
+        RegionSimplifier simplifier(params);
+
+        for (uint32_t seed = 0; seed < 20; ++seed)
+        {
+            desktop::Region region = randomRegion(300, seed);
+
+            std::vector<desktop::Rect> rects;
+            simplifier.simplify(region, kBounds, &rects);
+
+            EXPECT_LE(rects.size(), static_cast<size_t>(max_rects));
+            expectValidRects(region, rects);
+        }
+    }
+}
+
+TEST(RegionSimplifierTest, Checkerboard)
+{
+    RegionSimplifier::Params params;
+    params.rect_cost = 64;
+    params.max_rects = 4;
+
+    RegionSimplifier simplifier(params);
+
+    // Far more rectangles than the limit. The grid is made coarser before the merging.
+    std::vector<desktop::Rect> cells;
+
+    for (int y = 0; y < kBounds.height(); y += 4)
+    {
+        for (int x = (y / 4 % 2) * 4; x < kBounds.width(); x += 8)
+            cells.push_back(desktop::Rect::makeXYWH(x, y, 4, 4));
+    }
+
+    const desktop::Region region(cells.data(), static_cast<int>(cells.size()));
+
+    std::vector<desktop::Rect> rects;
+    simplifier.simplify(region, kBounds, &rects);
+
+    ASSERT_EQ(rects.size(), 1U);
+    EXPECT_EQ(rects[0], kBounds);
+}
+
+TEST(RegionSimplifierTest, EmptyRegion)
+{
+    RegionSimplifier::Params params;
+    params.rect_cost = 64;
+    params.max_rects = 4;
+
+    RegionSimplifier simplifier(params);
+
+    std::vector<desktop::Rect> rects;
+    simplifier.simplify(desktop::Region(), kBounds, &rects);
+
+    EXPECT_TRUE(rects.empty());
+}
+
+} // namespace codec
@@ -18,7 +18,7 @@
 
 #include "codec/scale_reducer.h"
 #include "base/logging.h"
-#include "desktop/desktop_frame_aligned.h"
+#include "desktop/frame_pool.h"
 
 #include <libyuv/scale_argb.h>
 
@@ -87,7 +87,7 @@ const desktop::Frame* ScaleReducer::scaleFrame(const desktop::Frame* source_fram
     {
         desktop::Size size = scaledSize(source_frame->size(), scale_factor_);
 
-        scaled_frame_ = desktop::FrameAligned::create(size, source_frame->format(), 32);
+        scaled_frame_ = desktop::FramePool::instance()->allocate(size, source_frame->format());
         if (!scaled_frame_)
             return nullptr;
     }
@@ -96,9 +96,9 @@ const desktop::Frame* ScaleReducer::scaleFrame(const desktop::Frame* source_fram
     const desktop::Size& scaled_size = scaled_frame_->size();
 
     desktop::Rect scaled_frame_rect = desktop::Rect::makeSize(scaled_size);
-    desktop::Region* updated_region = scaled_frame_->updatedRegion();
-
-    updated_region->clear();
+    // The scaled rectangles keep the order of the source rectangles, which are sorted by their
+    // top edge.
+    desktop::Region::Builder updated_region(scaled_frame_->updatedRegion());
 
     for (desktop::Region::Iterator it(source_frame->constUpdatedRegion()); !it.isAtEnd(); it.advance())
     {
@@ -132,9 +132,11 @@ const desktop::Frame* ScaleReducer::scaleFrame(const desktop::Frame* source_fram
             LOG(LS_WARNING) << "libyuv::ARGBScaleClip failed";
         }
 
-        updated_region->addRect(scaled_rect);
+        updated_region.addRect(scaled_rect);
     }
 
+    updated_region.finish();
+
     scaled_frame_->setTopLeft(source_frame->topLeft());
     return scaled_frame_.get();
 }
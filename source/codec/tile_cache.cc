@@ -0,0 +1,152 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/tile_cache.h"
+#include "base/cpu_dispatch.h"
+#include "base/logging.h"
+#include "desktop/desktop_frame.h"
+#include "desktop/scanline_hash.h"
+
+namespace codec {
+
+namespace {
+
+using HashScanlineFunc = uint64_t(*)(const uint8_t* data, int size);
+
+const base::CpuDispatchTable<HashScanlineFunc> kHashScanlineTable =
+{
+    { base::CpuIsa::SSE2, desktop::hashScanline_SSE2 },
+    { base::CpuIsa::C,    desktop::hashScanline_C    }
+};
+
+constexpr size_t kMinCacheSize = 16;
+
+} // namespace
+
+TileCache::TileCache(size_t cache_size)
+    : cache_size_(cache_size)
+{
+    DCHECK(isValidCacheSize(cache_size_));
+    slots_.reserve(cache_size_);
+}
+
+TileCache::~TileCache() = default;
+
+// static
+uint64_t TileCache::hashTile(const desktop::Frame& frame, const desktop::Rect& rect)
+{
+    static const HashScanlineFunc hash_scanline = kHashScanlineTable.select();
+
+    const int row_size = rect.width() * frame.format().bytesPerPixel();
+    const uint8_t* row = frame.frameDataAtPos(rect.topLeft());
+
+    // Tiles of different sizes must not match even with the same data.
+    uint64_t hash = (static_cast<uint64_t>(rect.width()) << 32) | rect.height();
+
+    for (int y = 0; y < rect.height(); ++y)
+    {
+        hash = (hash ^ hash_scanline(row, row_size)) * 0x9E3779B97F4A7C15ULL;
+        row += frame.stride();
+    }
+
+    return hash ^ (hash >> 29);
+}
+
+uint32_t TileCache::find(const desktop::Frame& frame, const desktop::Rect& rect, uint64_t hash)
+{
+    auto it = index_.find(hash);
+    if (it == index_.end())
+        return kInvalidIndex;
+
+    const uint32_t index = it->second;
+    Slot& slot = slots_[index];
+
+    if (slot.size != rect.size())
+        return kInvalidIndex;
+
+    // The hash is not cryptographic, the pixels are compared to exclude collisions.
+    const int row_size = rect.width() * frame.format().bytesPerPixel();
+    const uint8_t* row = frame.frameDataAtPos(rect.topLeft());
+    const uint8_t* cached_row = slot.pixels.get();
+
+    for (int y = 0; y < rect.height(); ++y)
+    {
+        if (memcmp(row, cached_row, row_size) != 0)
+            return kInvalidIndex;
+
+        row += frame.stride();
+        cached_row += row_size;
+    }
+
+    lru_.splice(lru_.end(), lru_, slot.lru_pos);
+    return index;
+}
+
+uint32_t TileCache::add(const desktop::Frame& frame, const desktop::Rect& rect, uint64_t hash)
+{
+    DCHECK_LE(rect.width(), kTileSize);
+    DCHECK_LE(rect.height(), kTileSize);
+
+    uint32_t index;
+
+    if (slots_.size() < cache_size_)
+    {
+        index = static_cast<uint32_t>(slots_.size());
+
+        Slot& slot = slots_.emplace_back();
+        slot.pixels = std::make_unique<uint8_t[]>(
+            kTileSize * kTileSize * frame.format().bytesPerPixel());
+        slot.lru_pos = lru_.insert(lru_.end(), index);
+    }
+    else
+    {
+        // The least recently used slot is replaced.
+        index = lru_.front();
+        lru_.splice(lru_.end(), lru_, lru_.begin());
+
+        auto it = index_.find(slots_[index].hash);
+        if (it != index_.end() && it->second == index)
+            index_.erase(it);
+    }
+
+    Slot& slot = slots_[index];
+    slot.hash = hash;
+    slot.size = rect.size();
+
+    const int row_size = rect.width() * frame.format().bytesPerPixel();
+    const uint8_t* row = frame.frameDataAtPos(rect.topLeft());
+    uint8_t* cached_row = slot.pixels.get();
+
+    for (int y = 0; y < rect.height(); ++y)
+    {
+        memcpy(cached_row, row, row_size);
+        row += frame.stride();
+        cached_row += row_size;
+    }
+
+    index_[hash] = index;
+    return index;
+}
+
+// static
+bool TileCache::isValidCacheSize(size_t size)
+{
+    return size >= kMinCacheSize && size <= kMaxCacheSize;
+}
+
+} // namespace codec
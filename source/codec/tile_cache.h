@@ -0,0 +1,99 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CODEC__TILE_CACHE_H
+#define CODEC__TILE_CACHE_H
+
+#include "base/macros_magic.h"
+#include "desktop/desktop_geometry.h"
+
+#include <limits>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace desktop {
+class Frame;
+} // namespace desktop
+
+namespace codec {
+
+// The cache of the tiles of the frame on the host side. The frame is cut into the squares of
+// kTileSize pixels (the tiles at the right and the bottom edges may be smaller). The tiles which
+// are sent to the client are stored in the slots of the cache, the same tiles are stored by the
+// client in the slots with the same index. When a tile with the same pixels appears again, only
+// the index of the slot is sent. The host selects the slots for new tiles (the least recently
+// used one when the cache is full), the client just follows the commands of the host.
+class TileCache
+{
+public:
+    explicit TileCache(size_t cache_size);
+    ~TileCache();
+
+    static constexpr int kTileSize = 64;
+
+    // The maximum number of tiles which the host can cache. With 32-bit pixels a slot takes 16kB.
+    static constexpr size_t kMaxCacheSize = 2048;
+
+    // The number of tiles which the client requests by default.
+    static constexpr size_t kDefaultCacheSize = 1024;
+
+    static constexpr uint32_t kInvalidIndex = std::numeric_limits<uint32_t>::max();
+
+    // Calculates the hash of the pixels of |rect| in |frame|.
+    static uint64_t hashTile(const desktop::Frame& frame, const desktop::Rect& rect);
+
+    // Looks for the tile with the same pixels as |rect| in |frame|. |hash| is the result of
+    // hashTile() for the rectangle. If the tile is found, it becomes the most recently used one
+    // and its index is returned, otherwise kInvalidIndex is returned.
+    uint32_t find(const desktop::Frame& frame, const desktop::Rect& rect, uint64_t hash);
+
+    // Stores the pixels of |rect| in |frame| and returns the index of the slot.
+    uint32_t add(const desktop::Frame& frame, const desktop::Rect& rect, uint64_t hash);
+
+    size_t size() const { return cache_size_; }
+
+    static bool isValidCacheSize(size_t size);
+
+private:
+    struct Slot
+    {
+        uint64_t hash = 0;
+        desktop::Size size;
+        std::unique_ptr<uint8_t[]> pixels;
+        std::list<uint32_t>::iterator lru_pos;
+    };
+
+    const size_t cache_size_;
+
+    std::vector<Slot> slots_;
+
+    // Indexes of the slots from the least recently used to the most recently used one.
+    std::list<uint32_t> lru_;
+
+    // Slot index by the hash of the tile. If the hashes of different tiles collide, only the last
+    // added tile can be found.
+    std::unordered_map<uint64_t, uint32_t> index_;
+
+    DISALLOW_COPY_AND_ASSIGN(TileCache);
+};
+
+} // namespace codec
+
+#endif // CODEC__TILE_CACHE_H
@@ -0,0 +1,152 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/tile_cache.h"
+#include "desktop/desktop_frame_simple.h"
+
+#include <gtest/gtest.h>
+
+namespace codec {
+
+namespace {
+
+const int kTileSize = TileCache::kTileSize;
+
+// Fills the tile with the position |index| with the pixels which depend on |seed|.
+void fillTile(desktop::Frame* frame, int index, uint32_t seed)
+{
+    const int columns = frame->size().width() / kTileSize;
+    const int left = (index % columns) * kTileSize;
+    const int top = (index / columns) * kTileSize;
+
+    for (int y = 0; y < kTileSize; ++y)
+    {
+        uint32_t* row = reinterpret_cast<uint32_t*>(frame->frameDataAtPos(left, top + y));
+
+        for (int x = 0; x < kTileSize; ++x)
+            row[x] = (seed * 0x9E3779B1) ^ (y * kTileSize + x);
+    }
+}
+
+desktop::Rect tileRect(const desktop::Frame& frame, int index)
+{
+    const int columns = frame.size().width() / kTileSize;
+    return desktop::Rect::makeXYWH(
+        (index % columns) * kTileSize, (index / columns) * kTileSize, kTileSize, kTileSize);
+}
+
+} // namespace
+
+TEST(TileCacheTest, FindAddedTile)
+{
+    std::unique_ptr<desktop::Frame> frame = desktop::FrameSimple::create(
+        desktop::Size(kTileSize * 4, kTileSize * 4), desktop::PixelFormat::ARGB());
+
+    fillTile(frame.get(), 0, 1);
+    fillTile(frame.get(), 5, 1);
+    fillTile(frame.get(), 6, 2);
+
+    TileCache cache(16);
+
+    const desktop::Rect rect0 = tileRect(*frame, 0);
+    const uint64_t hash0 = TileCache::hashTile(*frame, rect0);
+
+    EXPECT_EQ(cache.find(*frame, rect0, hash0), TileCache::kInvalidIndex);
+
+    const uint32_t index = cache.add(*frame, rect0, hash0);
+    EXPECT_EQ(cache.find(*frame, rect0, hash0), index);
+
+    // The same pixels in another position of the frame.
+    const desktop::Rect rect5 = tileRect(*frame, 5);
+    EXPECT_EQ(TileCache::hashTile(*frame, rect5), hash0);
+    EXPECT_EQ(cache.find(*frame, rect5, hash0), index);
+
+    // Other pixels.
+    const desktop::Rect rect6 = tileRect(*frame, 6);
+    EXPECT_NE(TileCache::hashTile(*frame, rect6), hash0);
+    EXPECT_EQ(cache.find(*frame, rect6, TileCache::hashTile(*frame, rect6)),
+              TileCache::kInvalidIndex);
+
+    // Even with the same hash the pixels are compared.
+    EXPECT_EQ(cache.find(*frame, rect6, hash0), TileCache::kInvalidIndex);
+}
+
+TEST(TileCacheTest, EdgeTiles)
+{
+    std::unique_ptr<desktop::Frame> frame = desktop::FrameSimple::create(
+        desktop::Size(kTileSize * 2, kTileSize * 2), desktop::PixelFormat::ARGB());
+    memset(frame->frameData(), 0, frame->stride() * frame->size().height());
+
+    TileCache cache(16);
+
+    const desktop::Rect full_rect = desktop::Rect::makeWH(kTileSize, kTileSize);
+    const desktop::Rect edge_rect = desktop::Rect::makeWH(kTileSize, kTileSize / 2);
+
+    // The tiles with the same pixels but different sizes do not match.
+    const uint64_t full_hash = TileCache::hashTile(*frame, full_rect);
+    const uint64_t edge_hash = TileCache::hashTile(*frame, edge_rect);
+    EXPECT_NE(full_hash, edge_hash);
+
+    cache.add(*frame, full_rect, full_hash);
+    EXPECT_EQ(cache.find(*frame, edge_rect, edge_hash), TileCache::kInvalidIndex);
+    EXPECT_EQ(cache.find(*frame, edge_rect, full_hash), TileCache::kInvalidIndex);
+
+    const uint32_t index = cache.add(*frame, edge_rect, edge_hash);
+    EXPECT_EQ(cache.find(*frame, edge_rect, edge_hash), index);
+}
+
+TEST(TileCacheTest, LeastRecentlyUsedIsReplaced)
+{
+    const int kCacheSize = 16;
+
+    std::unique_ptr<desktop::Frame> frame = desktop::FrameSimple::create(
+        desktop::Size(kTileSize * 8, kTileSize * 4), desktop::PixelFormat::ARGB());
+
+    for (int i = 0; i < 32; ++i)
+        fillTile(frame.get(), i, i + 1);
+
+    TileCache cache(kCacheSize);
+    std::vector<uint64_t> hashes;
+
+    for (int i = 0; i < 32; ++i)
+        hashes.push_back(TileCache::hashTile(*frame, tileRect(*frame, i)));
+
+    for (int i = 0; i < kCacheSize; ++i)
+        EXPECT_EQ(cache.add(*frame, tileRect(*frame, i), hashes[i]), static_cast<uint32_t>(i));
+
+    // Tile 0 becomes the most recently used one, so tile 1 is replaced first.
+    EXPECT_EQ(cache.find(*frame, tileRect(*frame, 0), hashes[0]), 0u);
+    EXPECT_EQ(cache.add(*frame, tileRect(*frame, kCacheSize), hashes[kCacheSize]), 1u);
+    EXPECT_EQ(cache.add(*frame, tileRect(*frame, kCacheSize + 1), hashes[kCacheSize + 1]), 2u);
+
+    EXPECT_EQ(cache.find(*frame, tileRect(*frame, 1), hashes[1]), TileCache::kInvalidIndex);
+    EXPECT_EQ(cache.find(*frame, tileRect(*frame, 2), hashes[2]), TileCache::kInvalidIndex);
+    EXPECT_EQ(cache.find(*frame, tileRect(*frame, 0), hashes[0]), 0u);
+    EXPECT_EQ(cache.find(*frame, tileRect(*frame, kCacheSize), hashes[kCacheSize]), 1u);
+    EXPECT_EQ(cache.find(*frame, tileRect(*frame, 3), hashes[3]), 3u);
+}
+
+TEST(TileCacheTest, CacheSize)
+{
+    EXPECT_FALSE(TileCache::isValidCacheSize(0));
+    EXPECT_TRUE(TileCache::isValidCacheSize(TileCache::kDefaultCacheSize));
+    EXPECT_TRUE(TileCache::isValidCacheSize(TileCache::kMaxCacheSize));
+    EXPECT_FALSE(TileCache::isValidCacheSize(TileCache::kMaxCacheSize + 1));
+}
+
+} // namespace codec
@@ -23,12 +23,13 @@
 namespace codec {
 
 // static
-std::unique_ptr<VideoDecoder> VideoDecoder::create(proto::desktop::VideoEncoding encoding)
+std::unique_ptr<VideoDecoder> VideoDecoder::create(proto::desktop::VideoEncoding encoding,
+                                                   size_t tile_cache_size)
 {
     switch (encoding)
     {
         case proto::desktop::VIDEO_ENCODING_ZSTD:
-            return VideoDecoderZstd::create();
+            return VideoDecoderZstd::create(tile_cache_size);
 
         case proto::desktop::VIDEO_ENCODING_VP8:
             return VideoDecoderVPX::createVP8();
@@ -34,7 +34,10 @@ class VideoDecoder
 public:
     virtual ~VideoDecoder() = default;
 
-    static std::unique_ptr<VideoDecoder> create(proto::desktop::VideoEncoding encoding);
+    // |tile_cache_size| is the size of the tile cache negotiated with the host. It is used only
+    // by VIDEO_ENCODING_ZSTD.
+    static std::unique_ptr<VideoDecoder> create(proto::desktop::VideoEncoding encoding,
+                                                size_t tile_cache_size = 0);
 
     virtual bool decode(const proto::desktop::VideoPacket& packet, desktop::Frame* frame) = 0;
 };
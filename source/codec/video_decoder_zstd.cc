@@ -18,22 +18,37 @@
 
 #include "codec/video_decoder_zstd.h"
 #include "base/logging.h"
+#include "base/thread_pool.h"
 #include "codec/pixel_translator.h"
+#include "codec/tile_cache.h"
 #include "codec/video_util.h"
-#include "desktop/desktop_frame_aligned.h"
+#include "desktop/frame_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
 
 namespace codec {
 
-VideoDecoderZstd::VideoDecoderZstd()
-    : stream_(ZSTD_createDStream())
+namespace {
+
+const int kMaxThreadCount = 8;
+
+} // namespace
+
+VideoDecoderZstd::VideoDecoderZstd(size_t tile_cache_size)
+    : stream_(ZSTD_createDStream()),
+      tile_cache_size_(tile_cache_size)
 {
     // Nothing
 }
 
+VideoDecoderZstd::~VideoDecoderZstd() = default;
+
 // static
-std::unique_ptr<VideoDecoderZstd> VideoDecoderZstd::create()
+std::unique_ptr<VideoDecoderZstd> VideoDecoderZstd::create(size_t tile_cache_size)
 {
-    return std::unique_ptr<VideoDecoderZstd>(new VideoDecoderZstd());
+    return std::unique_ptr<VideoDecoderZstd>(new VideoDecoderZstd(tile_cache_size));
 }
 
 bool VideoDecoderZstd::decode(const proto::desktop::VideoPacket& packet,
@@ -43,9 +58,20 @@ bool VideoDecoderZstd::decode(const proto::desktop::VideoPacket& packet,
     {
         const proto::desktop::VideoPacketFormat& format = packet.format();
 
-        source_frame_ = desktop::FrameAligned::create(
-            desktop::Size(format.screen_rect().width(), format.screen_rect().height()),
-            VideoUtil::fromVideoPixelFormat(format.pixel_format()), 32);
+        const desktop::Size size(format.screen_rect().width(), format.screen_rect().height());
+        const desktop::PixelFormat pixel_format =
+            VideoUtil::fromVideoPixelFormat(format.pixel_format());
+
+        if (!source_frame_ || source_frame_->size() != size || source_frame_->format() != pixel_format)
+        {
+            // The cached tiles are in the previous pixel format.
+            if (source_frame_ && source_frame_->format() != pixel_format)
+                tile_cache_.clear();
+
+            // Return the previous buffer to the pool before taking a new one.
+            source_frame_.reset();
+            source_frame_ = desktop::FramePool::instance()->allocate(size, pixel_format);
+        }
 
         translator_ = PixelTranslator::create(source_frame_->format(), target_frame->format());
     }
@@ -58,53 +84,345 @@ bool VideoDecoderZstd::decode(const proto::desktop::VideoPacket& packet,
         return false;
     }
 
-    size_t ret = ZSTD_initDStream(stream_.get());
-    DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
+    if (packet.rect_encoding_size() && packet.rect_encoding_size() != packet.dirty_rect_size())
+    {
+        LOG(LS_WARNING) << "Wrong number of rectangle encodings";
+        return false;
+    }
+
+    if (packet.zstd_tile_size())
+    {
+        if (!decodeTiles(packet, target_frame))
+            return false;
+
+        return processTileCacheOps(packet, target_frame);
+    }
+
+    // Without the history each packet contains a separate stream.
+    if (!packet.continue_stream())
+        initStream(stream_.get());
 
-    desktop::Rect frame_rect = desktop::Rect::makeSize(source_frame_->size());
     ZSTD_inBuffer input = { packet.data().data(), packet.data().size(), 0 };
 
     for (int i = 0; i < packet.dirty_rect_size(); ++i)
     {
-        desktop::Rect rect = VideoUtil::fromVideoRect(packet.dirty_rect(i));
+        if (!decodeRect(packet, i, stream_.get(), &input, &palette_buffers_, target_frame))
+            return false;
+    }
+
+    // The rest of the data (block headers without pixels) is consumed, because the next packet
+    // may continue the stream from this point.
+    while (input.pos < input.size)
+    {
+        const size_t input_pos = input.pos;
+
+        ZSTD_outBuffer output = { nullptr, 0, 0 };
+        size_t ret = ZSTD_decompressStream(stream_.get(), &output, &input);
+        if (ZSTD_isError(ret) || input.pos == input_pos)
+            break;
+    }
+
+    return processTileCacheOps(packet, target_frame);
+}
+
+void VideoDecoderZstd::initStream(ZSTD_DStream* stream)
+{
+    size_t ret = ZSTD_initDStream(stream);
+    DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
+}
+
+bool VideoDecoderZstd::decodeTiles(const proto::desktop::VideoPacket& packet,
+                                   desktop::Frame* target_frame)
+{
+    // The first rectangle and the position of the data of each tile.
+    std::vector<std::pair<int, size_t>> tiles;
+    tiles.reserve(packet.zstd_tile_size());
+
+    uint64_t rect_count = 0;
+    uint64_t data_size = 0;
+
+    for (const auto& tile : packet.zstd_tile())
+    {
+        tiles.emplace_back(static_cast<int>(rect_count), static_cast<size_t>(data_size));
 
-        if (!frame_rect.containsRect(rect))
+        rect_count += tile.rect_count();
+        data_size += tile.data_size();
+
+        if (rect_count > static_cast<uint64_t>(packet.dirty_rect_size()) ||
+            data_size > packet.data().size())
         {
-            LOG(LS_WARNING) << "The rectangle is outside the screen area";
-            return false;
+            break;
         }
+    }
+
+    if (rect_count != static_cast<uint64_t>(packet.dirty_rect_size()) ||
+        data_size != packet.data().size())
+    {
+        LOG(LS_WARNING) << "The tiles do not match the rectangles or the data";
+        return false;
+    }
+
+    if (!thread_pool_)
+    {
+        const int thread_count = std::clamp(
+            static_cast<int>(std::thread::hardware_concurrency()), 1, kMaxThreadCount);
 
-        uint8_t* output_data = source_frame_->frameDataAtPos(rect.x(), rect.y());
-        const size_t output_size = rect.width() * source_frame_->format().bytesPerPixel();
+        thread_pool_ = std::make_unique<base::ThreadPool>(thread_count);
+        tile_threads_.resize(thread_count);
 
-        ZSTD_outBuffer output = { output_data, output_size, 0 };
-        int row_y = 0;
+        for (auto& thread : tile_threads_)
+            thread.stream.reset(ZSTD_createDStream());
+    }
+
+    // The threads take the tiles one by one. The tiles do not overlap, so each thread writes to
+    // its own parts of the frames.
+    std::atomic<int> next_tile(0);
+    std::atomic<bool> succeeded(true);
 
-        while (row_y < rect.height())
+    thread_pool_->parallelFor(thread_pool_->threadCount(), [&](int thread)
+    {
+        TileThread& state = tile_threads_[thread];
+
+        for (int i = next_tile++; i < packet.zstd_tile_size() && succeeded; i = next_tile++)
         {
-            ret = ZSTD_decompressStream(stream_.get(), &output, &input);
-            if (ZSTD_isError(ret))
+            const proto::desktop::ZstdTile& tile = packet.zstd_tile(i);
+            ZSTD_inBuffer input =
+                { packet.data().data() + tiles[i].second, tile.data_size(), 0 };
+
+            if (tile.data_size())
+                initStream(state.stream.get());
+
+            for (uint32_t j = 0; j < tile.rect_count(); ++j)
             {
-                LOG(LS_WARNING) << "ZSTD_decompressStream failed: " << ZSTD_getErrorName(ret);
+                if (!decodeRect(packet, tiles[i].first + j, state.stream.get(), &input,
+                                &state.palette_buffers, target_frame))
+                {
+                    succeeded = false;
+                    break;
+                }
+            }
+        }
+    });
+
+    return succeeded;
+}
+
+bool VideoDecoderZstd::decodeRect(const proto::desktop::VideoPacket& packet,
+                                  int index,
+                                  ZSTD_DStream* stream,
+                                  ZSTD_inBuffer* input,
+                                  PaletteBuffers* palette_buffers,
+                                  desktop::Frame* target_frame)
+{
+    const desktop::Rect frame_rect = desktop::Rect::makeSize(source_frame_->size());
+    const desktop::Rect rect = VideoUtil::fromVideoRect(packet.dirty_rect(index));
+
+    if (!frame_rect.containsRect(rect))
+    {
+        LOG(LS_WARNING) << "The rectangle is outside the screen area";
+        return false;
+    }
+
+    const int bytes_per_pixel = source_frame_->format().bytesPerPixel();
+
+    const proto::desktop::RectEncoding::Type type = packet.rect_encoding_size() ?
+        packet.rect_encoding(index).type() : proto::desktop::RectEncoding::TYPE_RAW;
+
+    switch (type)
+    {
+        case proto::desktop::RectEncoding::TYPE_RAW:
+            if (!decompressRows(stream,
+                                input,
+                                source_frame_->frameDataAtPos(rect.topLeft()),
+                                source_frame_->stride(),
+                                rect.width() * bytes_per_pixel,
+                                rect.height()))
                 return false;
+        break;
+
+        case proto::desktop::RectEncoding::TYPE_SOLID:
+        {
+            const uint32_t color = packet.rect_encoding(index).color();
+            uint8_t* row = source_frame_->frameDataAtPos(rect.topLeft());
+
+            for (int y = 0; y < rect.height(); ++y)
+            {
+                for (int x = 0; x < rect.width(); ++x)
+                    memcpy(row + x * bytes_per_pixel, &color, bytes_per_pixel);
+
+                row += source_frame_->stride();
             }
+        }
+        break;
 
-            // If we completely unpacked the row in the rectangle.
-            if (output.pos == output.size)
+        case proto::desktop::RectEncoding::TYPE_PALETTE:
+        {
+            const proto::desktop::RectEncoding& encoding = packet.rect_encoding(index);
+
+            if (encoding.palette_size() < 2 ||
+                encoding.palette_size() > ColorPalette::kMaxColors)
+            {
+                LOG(LS_WARNING) << "Invalid palette size: " << encoding.palette_size();
+                return false;
+            }
+
+            uint32_t* palette = palette_buffers->palette;
+            std::vector<uint8_t>& packed_data = palette_buffers->packed_data;
+
+            // Unused entries are zero, so any index in the data is valid.
+            std::fill(palette, palette + ColorPalette::kMaxColors, 0);
+            std::copy(encoding.palette().begin(), encoding.palette().end(), palette);
+
+            const int bits_per_index = ColorPalette::bitsPerIndex(encoding.palette_size());
+            const size_t row_size = ColorPalette::packedRowSize(rect.width(), bits_per_index);
+
+            packed_data.resize(row_size * rect.height());
+
+            if (!decompressRows(stream, input, packed_data.data(), row_size, row_size,
+                                rect.height()))
             {
-                ++row_y;
-                output_data += source_frame_->stride();
-                output.dst = output_data;
-                output.pos = 0;
+                return false;
+            }
+
+            const uint8_t* packed_row = packed_data.data();
+            uint8_t* row = source_frame_->frameDataAtPos(rect.topLeft());
+
+            for (int y = 0; y < rect.height(); ++y)
+            {
+                ColorPalette::unpackRow(packed_row, rect.width(), bits_per_index, palette,
+                                        bytes_per_pixel, row);
+                packed_row += row_size;
+                row += source_frame_->stride();
             }
         }
+        break;
+
+        default:
+            LOG(LS_WARNING) << "Unknown rectangle encoding: " << type;
+            return false;
+    }
+
+    translator_->translate(source_frame_->frameDataAtPos(rect.topLeft()),
+                           source_frame_->stride(),
+                           target_frame->frameDataAtPos(rect.topLeft()),
+                           target_frame->stride(),
+                           rect.width(),
+                           rect.height());
+    return true;
+}
+
+bool VideoDecoderZstd::decompressRows(ZSTD_DStream* stream, ZSTD_inBuffer* input,
+                                      uint8_t* output_data, size_t stride, size_t row_size,
+                                      int rows)
+{
+    ZSTD_outBuffer output = { output_data, row_size, 0 };
+    int row_y = 0;
+
+    while (row_y < rows)
+    {
+        const size_t input_pos = input->pos;
+        const size_t output_pos = output.pos;
+
+        size_t ret = ZSTD_decompressStream(stream, &output, input);
+        if (ZSTD_isError(ret))
+        {
+            LOG(LS_WARNING) << "ZSTD_decompressStream failed: " << ZSTD_getErrorName(ret);
+            return false;
+        }
 
-        translator_->translate(source_frame_->frameDataAtPos(rect.topLeft()),
-                               source_frame_->stride(),
-                               target_frame->frameDataAtPos(rect.topLeft()),
-                               target_frame->stride(),
-                               rect.width(),
-                               rect.height());
+        // If we completely unpacked the row in the rectangle.
+        if (output.pos == output.size)
+        {
+            ++row_y;
+            output_data += stride;
+            output.dst = output_data;
+            output.pos = 0;
+        }
+        else if (input->pos == input_pos && output.pos == output_pos)
+        {
+            LOG(LS_WARNING) << "Not enough data in the video packet";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool VideoDecoderZstd::processTileCacheOps(const proto::desktop::VideoPacket& packet,
+                                           desktop::Frame* target_frame)
+{
+    const desktop::Rect frame_rect = desktop::Rect::makeSize(source_frame_->size());
+    const int bytes_per_pixel = source_frame_->format().bytesPerPixel();
+
+    for (int i = 0; i < packet.tile_cache_op_size(); ++i)
+    {
+        const proto::desktop::TileCacheOp& op = packet.tile_cache_op(i);
+        const desktop::Rect rect = VideoUtil::fromVideoRect(op.rect());
+
+        if (!frame_rect.containsRect(rect) || rect.isEmpty() ||
+            rect.width() > TileCache::kTileSize || rect.height() > TileCache::kTileSize)
+        {
+            LOG(LS_WARNING) << "Invalid tile rectangle";
+            return false;
+        }
+
+        if (op.index() >= tile_cache_size_)
+        {
+            LOG(LS_WARNING) << "Invalid tile cache index: " << op.index();
+            return false;
+        }
+
+        const int row_size = rect.width() * bytes_per_pixel;
+
+        if (op.type() == proto::desktop::TileCacheOp::TYPE_STORE)
+        {
+            if (tile_cache_.size() <= op.index())
+                tile_cache_.resize(op.index() + 1);
+
+            CachedTile& tile = tile_cache_[op.index()];
+            if (!tile.pixels)
+            {
+                tile.pixels = std::make_unique<uint8_t[]>(
+                    TileCache::kTileSize * TileCache::kTileSize * bytes_per_pixel);
+            }
+
+            tile.size = rect.size();
+
+            const uint8_t* row = source_frame_->frameDataAtPos(rect.topLeft());
+            uint8_t* tile_row = tile.pixels.get();
+
+            for (int y = 0; y < rect.height(); ++y)
+            {
+                memcpy(tile_row, row, row_size);
+                row += source_frame_->stride();
+                tile_row += row_size;
+            }
+        }
+        else if (op.type() == proto::desktop::TileCacheOp::TYPE_LOAD)
+        {
+            if (tile_cache_.size() <= op.index() ||
+                !tile_cache_[op.index()].pixels ||
+                tile_cache_[op.index()].size != rect.size())
+            {
+                LOG(LS_WARNING) << "The tile is not found in the cache: " << op.index();
+                return false;
+            }
+
+            source_frame_->copyPixelsFrom(
+                tile_cache_[op.index()].pixels.get(), row_size, rect);
+
+            translator_->translate(source_frame_->frameDataAtPos(rect.topLeft()),
+                                   source_frame_->stride(),
+                                   target_frame->frameDataAtPos(rect.topLeft()),
+                                   target_frame->stride(),
+                                   rect.width(),
+                                   rect.height());
+        }
+        else
+        {
+            LOG(LS_WARNING) << "Unknown tile cache operation: " << op.type();
+            return false;
+        }
     }
 
     return true;
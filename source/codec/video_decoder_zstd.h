@@ -20,8 +20,16 @@
 #define CODEC__VIDEO_DECODER_ZSTD_H
 
 #include "base/macros_magic.h"
+#include "codec/color_palette.h"
 #include "codec/scoped_zstd_stream.h"
 #include "codec/video_decoder.h"
+#include "desktop/desktop_geometry.h"
+
+#include <vector>
+
+namespace base {
+class ThreadPool;
+} // namespace base
 
 namespace codec {
 
@@ -30,20 +38,70 @@ class PixelTranslator;
 class VideoDecoderZstd : public VideoDecoder
 {
 public:
-    ~VideoDecoderZstd() = default;
+    ~VideoDecoderZstd();
 
-    static std::unique_ptr<VideoDecoderZstd> create();
+    // |tile_cache_size| is the size of the tile cache negotiated in proto::desktop::Config.
+    // The packets with the other cache indexes are rejected.
+    static std::unique_ptr<VideoDecoderZstd> create(size_t tile_cache_size = 0);
 
     bool decode(const proto::desktop::VideoPacket& packet, desktop::Frame* target_frame) override;
 
 private:
-    VideoDecoderZstd();
+    explicit VideoDecoderZstd(size_t tile_cache_size);
+
+    // Used for the rectangles with a palette. Each thread has its own buffers.
+    struct PaletteBuffers
+    {
+        uint32_t palette[ColorPalette::kMaxColors];
+        std::vector<uint8_t> packed_data;
+    };
+
+    struct TileThread
+    {
+        ScopedZstdDStream stream;
+        PaletteBuffers palette_buffers;
+    };
+
+    // Starts a new stream.
+    void initStream(ZSTD_DStream* stream);
+
+    // Decodes the tiles of the packet in parallel (see ZstdTile in desktop.proto).
+    bool decodeTiles(const proto::desktop::VideoPacket& packet, desktop::Frame* target_frame);
+
+    // Decodes the dirty rectangle |index| of the packet from |input| and translates it to
+    // |target_frame|.
+    bool decodeRect(const proto::desktop::VideoPacket& packet,
+                    int index,
+                    ZSTD_DStream* stream,
+                    ZSTD_inBuffer* input,
+                    PaletteBuffers* palette_buffers,
+                    desktop::Frame* target_frame);
+
+    bool decompressRows(ZSTD_DStream* stream, ZSTD_inBuffer* input, uint8_t* output_data,
+                        size_t stride, size_t row_size, int rows);
+    bool processTileCacheOps(const proto::desktop::VideoPacket& packet,
+                             desktop::Frame* target_frame);
 
     ScopedZstdDStream stream_;
 
     std::unique_ptr<PixelTranslator> translator_;
     std::unique_ptr<desktop::Frame> source_frame_;
 
+    // Slots of the tile cache. The tiles are stored in the pixel format of the packets.
+    struct CachedTile
+    {
+        desktop::Size size;
+        std::unique_ptr<uint8_t[]> pixels;
+    };
+
+    const size_t tile_cache_size_;
+    std::vector<CachedTile> tile_cache_;
+
+    PaletteBuffers palette_buffers_;
+
+    std::unique_ptr<base::ThreadPool> thread_pool_;
+    std::vector<TileThread> tile_threads_; // One for each thread of the pool.
+
     DISALLOW_COPY_AND_ASSIGN(VideoDecoderZstd);
 };
 
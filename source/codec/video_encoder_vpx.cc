@@ -32,6 +32,13 @@ namespace {
 // Defines the dimension of a macro block. This is used to compute the active map for the encoder.
 const int kMacroBlockSize = 16;
 
+// The encoder processes whole macroblocks of the active map, so a separate rectangle is worth
+// about one macroblock of the color conversion.
+const int kRectCost = kMacroBlockSize * kMacroBlockSize;
+
+// Maximum number of rectangles in the packet.
+const int kMaxRects = 64;
+
 // Magic encoder profile numbers for I444 input formats.
 const int kVp9I420ProfileNumber = 0;
 
@@ -64,6 +71,15 @@ void setCommonCodecParameters(vpx_codec_enc_cfg_t* config, const desktop::Size&
     config->g_threads = (std::thread::hardware_concurrency() > 2) ? 2 : 1;
 }
 
+RegionSimplifier::Params simplifierParams()
+{
+    RegionSimplifier::Params params;
+    params.alignment = kMacroBlockSize;
+    params.rect_cost = kRectCost;
+    params.max_rects = kMaxRects;
+    return params;
+}
+
 void createImage(const desktop::Size& size,
                  std::unique_ptr<vpx_image_t>* out_image,
                  std::unique_ptr<uint8_t[]>* out_image_buffer)
@@ -144,7 +160,8 @@ VideoEncoderVPX* VideoEncoderVPX::createVP9()
 }
 
 VideoEncoderVPX::VideoEncoderVPX(proto::desktop::VideoEncoding encoding)
-    : encoding_(encoding)
+    : encoding_(encoding),
+      region_simplifier_(simplifierParams())
 {
     memset(&active_map_, 0, sizeof(active_map_));
     memset(&image_, 0, sizeof(image_));
@@ -274,6 +291,10 @@ void VideoEncoderVPX::prepareImageAndActiveMap(
     int padding = ((encoding_ == proto::desktop::VIDEO_ENCODING_VP9) ? 8 : 3);
     desktop::Region updated_region;
 
+    // The padding and the alignment keep the order of the rectangles by their top edge, so
+    // the region is built in one pass.
+    desktop::Region::Builder builder(&updated_region);
+
     for (desktop::Region::Iterator it(frame->constUpdatedRegion()); !it.isAtEnd(); it.advance())
     {
         const desktop::Rect& rect = it.rect();
@@ -284,15 +305,18 @@ void VideoEncoderVPX::prepareImageAndActiveMap(
         // must be listed in the active map. After padding we align each rectangle to 16x16
         // active-map macroblocks. This implicitly ensures all rects have even top-left coords,
         // which is is required by ARGBToI420().
-        updated_region.addRect(
+        builder.addRect(
             alignRect(desktop::Rect::makeLTRB(rect.left() - padding, rect.top() - padding,
                                             rect.right() + padding, rect.bottom() + padding)));
     }
 
-    // Clip back to the screen dimensions, in case they're not macroblock aligned. The conversion
-    // routines don't require even width & height, so this is safe even if the source dimensions
-    // are not even.
-    updated_region.intersectWith(desktop::Rect::makeWH(image_->w, image_->h));
+    builder.finish();
+
+    // Merge the rectangles on the macroblock grid and clip them back to the screen dimensions,
+    // in case they're not macroblock aligned. The conversion routines don't require even width &
+    // height, so this is safe even if the source dimensions are not even.
+    region_simplifier_.simplify(
+        updated_region, desktop::Rect::makeWH(image_->w, image_->h), &rects_);
 
     memset(active_map_.active_map, 0, active_map_size_);
 
@@ -302,10 +326,8 @@ void VideoEncoderVPX::prepareImageAndActiveMap(
     uint8_t* u_data = image_->planes[1];
     uint8_t* v_data = image_->planes[2];
 
-    for (desktop::Region::Iterator it(updated_region); !it.isAtEnd(); it.advance())
+    for (const auto& rect : rects_)
     {
-        const desktop::Rect& rect = it.rect();
-
         int y_offset = y_stride * rect.y() + rect.x();
         int uv_offset = uv_stride * rect.y() / 2 + rect.x() / 2;
 
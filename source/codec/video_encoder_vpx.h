@@ -20,6 +20,7 @@
 #define CODEC__VIDEO_ENCODER_VPX_H
 
 #include "base/macros_magic.h"
+#include "codec/region_simplifier.h"
 #include "codec/scoped_vpx_codec.h"
 #include "codec/video_encoder.h"
 
@@ -61,6 +62,9 @@ private:
     std::unique_ptr<vpx_image_t> image_;
     std::unique_ptr<uint8_t[]> image_buffer_;
 
+    RegionSimplifier region_simplifier_;
+    std::vector<desktop::Rect> rects_;
+
     DISALLOW_COPY_AND_ASSIGN(VideoEncoderVPX);
 };
 
@@ -18,38 +18,141 @@
 
 #include "codec/video_encoder_zstd.h"
 #include "base/logging.h"
+#include "base/thread_pool.h"
 #include "codec/pixel_translator.h"
 #include "codec/video_util.h"
 #include "desktop/desktop_frame.h"
 
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
 namespace codec {
 
 namespace {
 
-// Retrieves a pointer to the output buffer in |update| used for storing the
-// encoded rectangle data. Will resize the buffer to |size|.
-uint8_t* outputBuffer(proto::desktop::VideoPacket* packet, size_t size)
+// A separate rectangle costs the translator call, the rectangle in the packet and the same on
+// the client side. It is about as much as translating and compressing this number of pixels.
+const int kRectCost = 64;
+
+// With a lot of small rectangles the overhead grows faster than the amount of data, so the
+// number of rectangles is limited.
+const int kMaxRects = 64;
+
+// Size of the blocks for the detection of solid rectangles and rectangles with few colors.
+const int kBlockSize = 64;
+
+// The update is cut into tiles only if it covers at least this number of tiles, otherwise the
+// single stream compresses better and the threads do not pay off.
+const int kMinZstdTiles = 4;
+
+const uint32_t kMaxZstdTileSize = 1024;
+
+// The pixels are translated and compressed in chunks of this size, so Zstd reads them from the
+// cache of the processor and the buffer does not depend on the size of the update.
+const size_t kChunkSize = 128 * 1024;
+
+const int kMaxThreadCount = 8;
+
+// 32MB window for the long distance matching. The decoder accepts windows up to 128MB by
+// default, so it does not need any settings.
+const int kLongDistanceWindowLog = 25;
+
+RegionSimplifier::Params simplifierParams()
+{
+    RegionSimplifier::Params params;
+    params.rect_cost = kRectCost;
+    params.max_rects = kMaxRects;
+    return params;
+}
+
+// Passes |input| to |stream| and writes the compressed data to |output| from |*output_pos|.
+// The output grows as needed, so its size does not depend on the size of the input.
+bool compressStream(ZSTD_CCtx* stream, ZSTD_inBuffer* input, ZSTD_EndDirective directive,
+                    std::string* output, size_t* output_pos)
 {
-    packet->mutable_data()->resize(size);
-    return reinterpret_cast<uint8_t*>(packet->mutable_data()->data());
+    while (true)
+    {
+        if (*output_pos == output->size())
+            output->resize(std::max(output->size() * 2, ZSTD_CStreamOutSize()));
+
+        ZSTD_outBuffer output_buffer = { &(*output)[0], output->size(), *output_pos };
+
+        size_t ret = ZSTD_compressStream2(stream, &output_buffer, input, directive);
+        *output_pos = output_buffer.pos;
+
+        if (ZSTD_isError(ret))
+        {
+            LOG(LS_WARNING) << "ZSTD_compressStream2 failed: " << ZSTD_getErrorName(ret);
+            return false;
+        }
+
+        // A flush or the end of the frame is complete when nothing remains in the stream.
+        if (directive == ZSTD_e_continue ? input->pos == input->size : !ret)
+            return true;
+    }
 }
 
 } // namespace
 
 VideoEncoderZstd::VideoEncoderZstd(std::unique_ptr<PixelTranslator> translator,
                                    const desktop::PixelFormat& target_format,
-                                   int compression_ratio)
+                                   int compression_ratio,
+                                   size_t tile_cache_size,
+                                   uint32_t flags,
+                                   int zstd_tile_size)
     : target_format_(target_format),
       compress_ratio_(compression_ratio),
       stream_(ZSTD_createCStream()),
-      translator_(std::move(translator))
+      keep_history_(flags & proto::desktop::ENABLE_ZSTD_HISTORY),
+      translator_(std::move(translator)),
+      region_simplifier_(simplifierParams()),
+      chunk_buffer_(static_cast<uint8_t*>(base::alignedAlloc(kChunkSize, 32))),
+      enable_rect_encoding_(flags & proto::desktop::ENABLE_RECT_ENCODING),
+      zstd_tile_size_(zstd_tile_size)
 {
-    // Nothing
+    if (tile_cache_size)
+        tile_cache_ = std::make_unique<TileCache>(tile_cache_size);
+
+    if (zstd_tile_size_)
+    {
+        const int thread_count = std::clamp(
+            static_cast<int>(std::thread::hardware_concurrency()), 1, kMaxThreadCount);
+
+        thread_pool_ = std::make_unique<base::ThreadPool>(thread_count);
+        tile_threads_.resize(thread_count);
+
+        for (auto& thread : tile_threads_)
+        {
+            thread.stream.reset(ZSTD_createCStream());
+            thread.chunk_buffer.reset(static_cast<uint8_t*>(base::alignedAlloc(kChunkSize, 32)));
+
+            size_t ret = ZSTD_CCtx_setParameter(
+                thread.stream.get(), ZSTD_c_compressionLevel, compression_ratio);
+            DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
+        }
+    }
+
+    if (keep_history_ && (flags & proto::desktop::ENABLE_ZSTD_LONG_DISTANCE))
+    {
+        // The parameters are kept when the stream is restarted.
+        size_t ret = ZSTD_CCtx_setParameter(
+            stream_.get(), ZSTD_c_enableLongDistanceMatching, 1);
+        DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
+
+        ret = ZSTD_CCtx_setParameter(stream_.get(), ZSTD_c_windowLog, kLongDistanceWindowLog);
+        DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
+    }
 }
 
+VideoEncoderZstd::~VideoEncoderZstd() = default;
+
 // static
-VideoEncoderZstd* VideoEncoderZstd::create(
-    const desktop::PixelFormat& target_format, int compression_ratio)
+VideoEncoderZstd* VideoEncoderZstd::create(const desktop::PixelFormat& target_format,
+                                           int compression_ratio,
+                                           size_t tile_cache_size,
+                                           uint32_t flags,
+                                           int zstd_tile_size)
 {
     if (compression_ratio > ZSTD_maxCLevel())
         compression_ratio = ZSTD_maxCLevel();
@@ -64,36 +167,147 @@ VideoEncoderZstd* VideoEncoderZstd::create(
         return nullptr;
     }
 
-    return new VideoEncoderZstd(std::move(translator), target_format, compression_ratio);
+    if (tile_cache_size && !TileCache::isValidCacheSize(tile_cache_size))
+    {
+        LOG(LS_WARNING) << "Invalid tile cache size: " << tile_cache_size;
+        return nullptr;
+    }
+
+    if (zstd_tile_size && !isValidZstdTileSize(zstd_tile_size))
+    {
+        LOG(LS_WARNING) << "Invalid Zstd tile size: " << zstd_tile_size;
+        return nullptr;
+    }
+
+    return new VideoEncoderZstd(std::move(translator), target_format, compression_ratio,
+                                tile_cache_size, flags, zstd_tile_size);
 }
 
-void VideoEncoderZstd::compressPacket(proto::desktop::VideoPacket* packet,
-                                      const uint8_t* input_data,
-                                      size_t input_size)
+// static
+bool VideoEncoderZstd::isValidZstdTileSize(uint32_t size)
 {
-    size_t ret = ZSTD_initCStream(stream_.get(), compress_ratio_);
-    DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
+    return size >= kBlockSize && size <= kMaxZstdTileSize && size % kBlockSize == 0;
+}
 
-    const size_t output_size = ZSTD_compressBound(input_size);
-    uint8_t* output_data = outputBuffer(packet, output_size);
+const desktop::Region& VideoEncoderZstd::processTiles(const desktop::Frame* frame,
+                                                      proto::desktop::VideoPacket* packet)
+{
+    const int tile_size = TileCache::kTileSize;
+    const desktop::Rect frame_rect = desktop::Rect::makeSize(frame->size());
 
-    ZSTD_inBuffer input = { input_data, input_size, 0 };
-    ZSTD_outBuffer output = { output_data, output_size, 0 };
+    const int columns = (frame_rect.width() + tile_size - 1) / tile_size;
+    const int rows = (frame_rect.height() + tile_size - 1) / tile_size;
 
-    while (input.pos < input.size)
+    // Only the tiles which are changed completely are looked up in the cache. The rectangles of
+    // the region do not overlap, so a tile is changed completely if the sum of the areas of its
+    // intersections with them is equal to the area of the tile.
+    tile_coverage_.assign(columns * rows, 0);
+
+    for (desktop::Region::Iterator it(frame->constUpdatedRegion()); !it.isAtEnd(); it.advance())
     {
-        ret = ZSTD_compressStream(stream_.get(), &output, &input);
-        if (ZSTD_isError(ret))
+        const desktop::Rect& rect = it.rect();
+
+        for (int row = rect.top() / tile_size; row <= (rect.bottom() - 1) / tile_size; ++row)
         {
-            LOG(LS_WARNING) << "ZSTD_compressStream failed: " << ZSTD_getErrorName(ret);
-            return;
+            for (int column = rect.left() / tile_size;
+                 column <= (rect.right() - 1) / tile_size; ++column)
+            {
+                desktop::Rect tile = desktop::Rect::makeXYWH(
+                    column * tile_size, row * tile_size, tile_size, tile_size);
+                tile.intersectWith(rect);
+
+                tile_coverage_[row * columns + column] += tile.width() * tile.height();
+            }
         }
     }
 
-    ret = ZSTD_endStream(stream_.get(), &output);
-    DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
+    loaded_tiles_.clear();
+
+    for (int row = 0; row < rows; ++row)
+    {
+        for (int column = 0; column < columns; ++column)
+        {
+            desktop::Rect tile = desktop::Rect::makeXYWH(
+                column * tile_size, row * tile_size, tile_size, tile_size);
+            tile.intersectWith(frame_rect);
+
+            if (tile_coverage_[row * columns + column] != tile.width() * tile.height())
+                continue;
+
+            const uint64_t hash = TileCache::hashTile(*frame, tile);
+
+            proto::desktop::TileCacheOp* op = packet->add_tile_cache_op();
+            VideoUtil::toVideoRect(tile, op->mutable_rect());
+
+            uint32_t index = tile_cache_->find(*frame, tile, hash);
+            if (index != TileCache::kInvalidIndex)
+            {
+                // The client already has the tile.
+                op->set_type(proto::desktop::TileCacheOp::TYPE_LOAD);
+                loaded_tiles_.emplace_back(tile);
+            }
+            else
+            {
+                // The tile is encoded and the client stores it after decoding.
+                index = tile_cache_->add(*frame, tile, hash);
+                op->set_type(proto::desktop::TileCacheOp::TYPE_STORE);
+            }
+
+            op->set_index(index);
+        }
+    }
+
+    encode_region_ = frame->constUpdatedRegion();
+
+    if (!loaded_tiles_.empty())
+    {
+        encode_region_.subtract(desktop::Region(
+            loaded_tiles_.data(), static_cast<int>(loaded_tiles_.size())));
+    }
+
+    return encode_region_;
+}
+
+void VideoEncoderZstd::compressPacket(const desktop::Frame* frame,
+                                      proto::desktop::VideoPacket* packet)
+{
+    if (!keep_history_ || !stream_started_ || reset_stream_)
+    {
+        size_t ret = ZSTD_initCStream(stream_.get(), compress_ratio_);
+        DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
+
+        stream_started_ = keep_history_;
+        reset_stream_ = false;
+    }
+    else
+    {
+        packet->set_continue_stream(true);
+    }
+
+    std::string* output = packet->mutable_data();
+    size_t output_pos = 0;
 
-    packet->mutable_data()->resize(output.pos);
+    // With the history the packet ends with a flush instead of the end of the frame, so the
+    // next packets can refer to the data of this one.
+    ZSTD_inBuffer input = { nullptr, 0, 0 };
+
+    if (!compressBlocks(frame, 0, blocks_.size(), stream_.get(), chunk_buffer_.get(),
+                        output, &output_pos) ||
+        !compressStream(stream_.get(), &input, keep_history_ ? ZSTD_e_flush : ZSTD_e_end,
+                        output, &output_pos))
+    {
+        // The client cannot decode the following packets of the broken stream.
+        reset_stream_ = true;
+    }
+
+    output->resize(output_pos);
+}
+
+void VideoEncoderZstd::setEmptyPacket(proto::desktop::VideoPacket* packet)
+{
+    // The decoder keeps its stream only if the packet continues it.
+    if (keep_history_ && stream_started_)
+        packet->set_continue_stream(true);
 }
 
 void VideoEncoderZstd::encode(const desktop::Frame* frame, proto::desktop::VideoPacket* packet)
@@ -106,41 +320,389 @@ void VideoEncoderZstd::encode(const desktop::Frame* frame, proto::desktop::Video
             target_format_, packet->mutable_format()->mutable_pixel_format());
     }
 
+    // The stream is restarted with the new format, the decoder resets its stream at this time.
+    if (packet->has_format())
+        reset_stream_ = true;
+
+    const desktop::Region& region =
+        tile_cache_ ? processTiles(frame, packet) : frame->constUpdatedRegion();
+
+    region_simplifier_.simplify(region, desktop::Rect::makeSize(frame->size()), &rects_);
+
+    // All changed tiles are loaded from the cache of the client.
+    if (rects_.empty())
+    {
+        setEmptyPacket(packet);
+        return;
+    }
+
+    blocks_.clear();
+    palette_colors_.clear();
+    packed_data_.clear();
+    zstd_tiles_.clear();
+
+    bool use_zstd_tiles = false;
+
+    if (zstd_tile_size_)
+    {
+        int64_t area = 0;
+
+        for (const auto& rect : rects_)
+            area += static_cast<int64_t>(rect.width()) * rect.height();
+
+        use_zstd_tiles = area >= static_cast<int64_t>(kMinZstdTiles) *
+            zstd_tile_size_ * zstd_tile_size_;
+    }
+
+    for (const auto& rect : rects_)
+    {
+        if (!use_zstd_tiles)
+        {
+            addBlocks(frame, rect, 0);
+            continue;
+        }
+
+        // Each part of the rectangle inside a tile of the grid is a separate tile.
+        for (int top = rect.top(); top < rect.bottom();)
+        {
+            const int bottom =
+                std::min((top / zstd_tile_size_ + 1) * zstd_tile_size_, rect.bottom());
+
+            for (int left = rect.left(); left < rect.right();)
+            {
+                const int right =
+                    std::min((left / zstd_tile_size_ + 1) * zstd_tile_size_, rect.right());
+
+                ZstdTile tile;
+                tile.first_block = blocks_.size();
+
+                addBlocks(frame, desktop::Rect::makeLTRB(left, top, right, bottom),
+                          tile.first_block);
+
+                tile.block_count = blocks_.size() - tile.first_block;
+                zstd_tiles_.emplace_back(tile);
+
+                left = right;
+            }
+
+            top = bottom;
+        }
+    }
+
     size_t data_size = 0;
 
-    for (desktop::Region::Iterator it(frame->constUpdatedRegion()); !it.isAtEnd(); it.advance())
+    for (const auto& block : blocks_)
     {
-        const desktop::Rect& rect = it.rect();
+        data_size += block.data_size;
+        VideoUtil::toVideoRect(block.rect, packet->add_dirty_rect());
 
-        data_size += rect.width() * rect.height() * target_format_.bytesPerPixel();
-        VideoUtil::toVideoRect(rect, packet->add_dirty_rect());
+        if (enable_rect_encoding_)
+            addRectEncoding(block, packet->add_rect_encoding());
     }
 
-    if (translate_buffer_size_ < data_size)
+    // All rectangles are solid.
+    if (!data_size)
     {
-        translate_buffer_.reset(static_cast<uint8_t*>(base::alignedAlloc(data_size, 32)));
-        translate_buffer_size_ = data_size;
+        setEmptyPacket(packet);
+        return;
     }
 
-    uint8_t* translate_pos = translate_buffer_.get();
+    // If a tile cannot be compressed, the packet is sent as a single stream.
+    if (!use_zstd_tiles || !compressTiles(frame, packet))
+        compressPacket(frame, packet);
+}
 
-    for (desktop::Region::Iterator it(frame->constUpdatedRegion()); !it.isAtEnd(); it.advance())
+void VideoEncoderZstd::addBlocks(const desktop::Frame* frame, const desktop::Rect& rect,
+                                 size_t first_block)
+{
+    if (enable_rect_encoding_)
     {
-        const desktop::Rect& rect = it.rect();
-        const int stride = rect.width() * target_format_.bytesPerPixel();
+        classifyRect(frame, rect, first_block);
+        return;
+    }
+
+    Block block;
+    block.rect = rect;
+    block.data_size = rect.width() * rect.height() * target_format_.bytesPerPixel();
+    blocks_.emplace_back(block);
+}
+
+bool VideoEncoderZstd::compressBlocks(const desktop::Frame* frame,
+                                      size_t first_block,
+                                      size_t count,
+                                      ZSTD_CCtx* stream,
+                                      uint8_t* chunk_buffer,
+                                      std::string* output,
+                                      size_t* output_pos)
+{
+    const int bytes_per_pixel = target_format_.bytesPerPixel();
+
+    for (size_t i = first_block; i < first_block + count; ++i)
+    {
+        const Block& block = blocks_[i];
+        const desktop::Rect& rect = block.rect;
+
+        switch (block.type)
+        {
+            case proto::desktop::RectEncoding::TYPE_RAW:
+            {
+                // A chunk contains several rows or a part of a row if the row does not fit.
+                const int chunk_width =
+                    std::min(rect.width(), static_cast<int>(kChunkSize / bytes_per_pixel));
+                const int chunk_rows = static_cast<int>(
+                    kChunkSize / static_cast<size_t>(chunk_width * bytes_per_pixel));
+
+                for (int top = rect.top(); top < rect.bottom(); top += chunk_rows)
+                {
+                    const int rows = std::min(chunk_rows, rect.bottom() - top);
+
+                    for (int left = rect.left(); left < rect.right(); left += chunk_width)
+                    {
+                        const int width = std::min(chunk_width, rect.right() - left);
 
-        translator_->translate(frame->frameDataAtPos(rect.topLeft()),
-                               frame->stride(),
-                               translate_pos,
-                               stride,
-                               rect.width(),
-                               rect.height());
+                        translator_->translate(frame->frameDataAtPos(left, top),
+                                               frame->stride(),
+                                               chunk_buffer,
+                                               width * bytes_per_pixel,
+                                               width,
+                                               rows);
 
-        translate_pos += rect.height() * stride;
+                        ZSTD_inBuffer input =
+                            { chunk_buffer, static_cast<size_t>(width * bytes_per_pixel * rows), 0 };
+
+                        if (!compressStream(stream, &input, ZSTD_e_continue, output, output_pos))
+                            return false;
+                    }
+                }
+            }
+            break;
+
+            case proto::desktop::RectEncoding::TYPE_PALETTE:
+            {
+                // The indexes are already packed in the target layout.
+                ZSTD_inBuffer input =
+                    { packed_data_.data() + block.packed_pos, block.data_size, 0 };
+
+                if (!compressStream(stream, &input, ZSTD_e_continue, output, output_pos))
+                    return false;
+            }
+            break;
+
+            default:
+                break;
+        }
+    }
+
+    return true;
+}
+
+bool VideoEncoderZstd::compressTiles(const desktop::Frame* frame,
+                                     proto::desktop::VideoPacket* packet)
+{
+    for (auto& tile : zstd_tiles_)
+    {
+        tile.data_size = 0;
+
+        for (size_t i = tile.first_block; i < tile.first_block + tile.block_count; ++i)
+            tile.data_size += blocks_[i].data_size;
+    }
+
+    tile_data_.resize(zstd_tiles_.size());
+
+    // The threads take the tiles one by one. Each tile is written to its own buffer.
+    std::atomic<size_t> next_tile(0);
+    std::atomic<bool> failed(false);
+
+    thread_pool_->parallelFor(thread_pool_->threadCount(), [&](int thread)
+    {
+        TileThread& state = tile_threads_[thread];
+
+        for (size_t i = next_tile++; i < zstd_tiles_.size() && !failed; i = next_tile++)
+        {
+            if (!compressTile(frame, zstd_tiles_[i], &state, &tile_data_[i]))
+                failed = true;
+        }
+    });
+
+    if (failed)
+    {
+        LOG(LS_WARNING) << "Unable to compress the tiles";
+        return false;
     }
 
-    // Compress data with using Zstd compressor.
-    compressPacket(packet, translate_buffer_.get(), data_size);
+    std::string* data = packet->mutable_data();
+    data->clear();
+
+    for (size_t i = 0; i < zstd_tiles_.size(); ++i)
+    {
+        proto::desktop::ZstdTile* tile = packet->add_zstd_tile();
+        tile->set_rect_count(static_cast<uint32_t>(zstd_tiles_[i].block_count));
+        tile->set_data_size(static_cast<uint32_t>(tile_data_[i].size()));
+
+        data->append(tile_data_[i]);
+    }
+
+    return true;
+}
+
+bool VideoEncoderZstd::compressTile(const desktop::Frame* frame, const ZstdTile& tile,
+                                    TileThread* thread, std::string* output)
+{
+    output->clear();
+
+    if (!tile.data_size)
+        return true;
+
+    ZSTD_CCtx* stream = thread->stream.get();
+
+    size_t ret = ZSTD_CCtx_reset(stream, ZSTD_reset_session_only);
+    DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
+
+    // The size is written to the header of the frame and the parameters are selected for it.
+    ret = ZSTD_CCtx_setPledgedSrcSize(stream, tile.data_size);
+    DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
+
+    size_t output_pos = 0;
+    ZSTD_inBuffer input = { nullptr, 0, 0 };
+
+    if (!compressBlocks(frame, tile.first_block, tile.block_count, stream,
+                        thread->chunk_buffer.get(), output, &output_pos) ||
+        !compressStream(stream, &input, ZSTD_e_end, output, &output_pos))
+    {
+        output->clear();
+        return false;
+    }
+
+    output->resize(output_pos);
+    return true;
+}
+
+void VideoEncoderZstd::classifyRect(const desktop::Frame* frame, const desktop::Rect& rect,
+                                    size_t first_block)
+{
+    // The palette is used only if the indexes are at most half the size of the pixels.
+    const int max_colors =
+        1 << std::min(8, static_cast<int>(target_format_.bitsPerPixel()) / 2);
+
+    // The rectangle is cut into blocks on the grid of the frame. The neighbor blocks in a row
+    // with the raw pixels or with the same solid color are joined back.
+    for (int top = rect.top(); top < rect.bottom();)
+    {
+        const int bottom = std::min((top / kBlockSize + 1) * kBlockSize, rect.bottom());
+
+        for (int left = rect.left(); left < rect.right();)
+        {
+            const int right = std::min((left / kBlockSize + 1) * kBlockSize, rect.right());
+
+            Block block;
+            block.rect = desktop::Rect::makeLTRB(left, top, right, bottom);
+
+            const uint8_t* data = frame->frameDataAtPos(left, top);
+
+            if (!palette_.collect(data, frame->stride(), block.rect.width(),
+                                  block.rect.height(), max_colors))
+            {
+                block.data_size = block.rect.width() * block.rect.height() *
+                    target_format_.bytesPerPixel();
+            }
+            else if (palette_.colorCount() == 1)
+            {
+                block.type = proto::desktop::RectEncoding::TYPE_SOLID;
+                block.color = palette_.colors()[0];
+            }
+            else
+            {
+                block.type = proto::desktop::RectEncoding::TYPE_PALETTE;
+                block.palette_pos = palette_colors_.size();
+                block.palette_size = palette_.colorCount();
+                block.packed_pos = packed_data_.size();
+                block.data_size = block.rect.height() * ColorPalette::packedRowSize(
+                    block.rect.width(), ColorPalette::bitsPerIndex(block.palette_size));
+
+                palette_colors_.insert(palette_colors_.end(),
+                                       palette_.colors(),
+                                       palette_.colors() + block.palette_size);
+
+                packed_data_.resize(block.packed_pos + block.data_size);
+                palette_.pack(data, frame->stride(), block.rect.width(), block.rect.height(),
+                              packed_data_.data() + block.packed_pos);
+            }
+
+            left = right;
+
+            if (blocks_.size() > first_block)
+            {
+                Block& last = blocks_.back();
+
+                const bool can_join =
+                    last.rect.top() == block.rect.top() &&
+                    last.rect.bottom() == block.rect.bottom() &&
+                    last.rect.right() == block.rect.left() &&
+                    last.type == block.type &&
+                    (block.type == proto::desktop::RectEncoding::TYPE_RAW ||
+                     (block.type == proto::desktop::RectEncoding::TYPE_SOLID &&
+                      last.color == block.color));
+
+                if (can_join)
+                {
+                    last.rect = desktop::Rect::makeLTRB(
+                        last.rect.left(), last.rect.top(), block.rect.right(), last.rect.bottom());
+                    last.data_size += block.data_size;
+                    continue;
+                }
+            }
+
+            blocks_.emplace_back(block);
+        }
+
+        top = bottom;
+    }
+}
+
+void VideoEncoderZstd::addRectEncoding(const Block& block, proto::desktop::RectEncoding* encoding)
+{
+    encoding->set_type(block.type);
+
+    const uint32_t* colors;
+    int count;
+
+    switch (block.type)
+    {
+        case proto::desktop::RectEncoding::TYPE_SOLID:
+            colors = &block.color;
+            count = 1;
+            break;
+
+        case proto::desktop::RectEncoding::TYPE_PALETTE:
+            colors = palette_colors_.data() + block.palette_pos;
+            count = block.palette_size;
+            break;
+
+        default:
+            return;
+    }
+
+    // The colors are sent in the pixel format of the client.
+    const int bytes_per_pixel = target_format_.bytesPerPixel();
+    uint8_t translated[ColorPalette::kMaxColors * 4];
+
+    translator_->translate(reinterpret_cast<const uint8_t*>(colors),
+                           count * 4,
+                           translated,
+                           count * bytes_per_pixel,
+                           count,
+                           1);
+
+    for (int i = 0; i < count; ++i)
+    {
+        uint32_t color = 0;
+        memcpy(&color, translated + i * bytes_per_pixel, bytes_per_pixel);
+
+        if (block.type == proto::desktop::RectEncoding::TYPE_SOLID)
+            encoding->set_color(color);
+        else
+            encoding->add_palette(color);
+    }
 }
 
 } // namespace codec
@@ -20,10 +20,17 @@
 #define CODEC__VIDEO_ENCODER_ZSTD_H
 
 #include "base/aligned_memory.h"
+#include "codec/color_palette.h"
+#include "codec/region_simplifier.h"
 #include "codec/scoped_zstd_stream.h"
+#include "codec/tile_cache.h"
 #include "codec/video_encoder.h"
 #include "desktop/pixel_format.h"
 
+namespace base {
+class ThreadPool;
+} // namespace base
+
 namespace codec {
 
 class PixelTranslator;
@@ -31,28 +38,127 @@ class PixelTranslator;
 class VideoEncoderZstd : public VideoEncoder
 {
 public:
-    ~VideoEncoderZstd() = default;
+    ~VideoEncoderZstd();
+
+    // If |tile_cache_size| is not 0, the tiles of the frame are cached (see TileCache).
+    // |flags| is a combination of proto::desktop::ConfigFlags:
+    // ENABLE_RECT_ENCODING - solid rectangles and rectangles with few colors are sent as a color
+    // or as a palette with indexes (see RectEncoding in desktop.proto).
+    // ENABLE_ZSTD_HISTORY - the compression context is kept between the packets, so the data can
+    // refer to the previous packets. The stream is restarted when the screen format changes.
+    // ENABLE_ZSTD_LONG_DISTANCE - with ENABLE_ZSTD_HISTORY, the long distance matching with a
+    // large window is used.
+    // If |zstd_tile_size| is not 0, the large updates are cut into the squares of this size on
+    // the grid of the frame, which are compressed as separate Zstd frames in parallel (see
+    // ZstdTile in desktop.proto). The packets do not depend on the number of threads.
+    static VideoEncoderZstd* create(const desktop::PixelFormat& target_format,
+                                    int compression_ratio,
+                                    size_t tile_cache_size = 0,
+                                    uint32_t flags = 0,
+                                    int zstd_tile_size = 0);
 
-    static VideoEncoderZstd* create(
-        const desktop::PixelFormat& target_format, int compression_ratio);
+    static const int kDefaultZstdTileSize = 256;
+
+    // The size must be a multiple of 64 from 64 to 1024.
+    static bool isValidZstdTileSize(uint32_t size);
 
     void encode(const desktop::Frame* frame, proto::desktop::VideoPacket* packet) override;
 
 private:
     VideoEncoderZstd(std::unique_ptr<PixelTranslator> translator,
                      const desktop::PixelFormat& target_format,
-                     int compression_ratio);
-    void compressPacket(proto::desktop::VideoPacket* packet,
-                        const uint8_t* input_data,
-                        size_t input_size);
+                     int compression_ratio,
+                     size_t tile_cache_size,
+                     uint32_t flags,
+                     int zstd_tile_size);
+
+    struct Block
+    {
+        desktop::Rect rect;
+        proto::desktop::RectEncoding::Type type = proto::desktop::RectEncoding::TYPE_RAW;
+        uint32_t color = 0;
+        size_t palette_pos = 0;
+        int palette_size = 0;
+        size_t packed_pos = 0;
+        size_t data_size = 0;
+    };
+
+    // The blocks which are compressed as a separate Zstd frame.
+    struct ZstdTile
+    {
+        size_t first_block = 0;
+        size_t block_count = 0;
+        size_t data_size = 0;
+    };
+
+    struct TileThread
+    {
+        ScopedZstdCStream stream;
+        std::unique_ptr<uint8_t[], base::AlignedFreeDeleter> chunk_buffer;
+    };
+
+    // Adds the blocks of |rect|. The blocks are joined with the previous ones only if their index
+    // is not less than |first_block|.
+    void addBlocks(const desktop::Frame* frame, const desktop::Rect& rect, size_t first_block);
+
+    // Cuts |rect| into blocks and selects the encoding for each of them.
+    void classifyRect(const desktop::Frame* frame, const desktop::Rect& rect, size_t first_block);
+    void addRectEncoding(const Block& block, proto::desktop::RectEncoding* encoding);
+
+    // Translates the data of |count| blocks starting from |first_block| in chunks and passes it
+    // to |stream|. The compressed data is written to |output| from |*output_pos|.
+    bool compressBlocks(const desktop::Frame* frame,
+                        size_t first_block,
+                        size_t count,
+                        ZSTD_CCtx* stream,
+                        uint8_t* chunk_buffer,
+                        std::string* output,
+                        size_t* output_pos);
+
+    // Sends the tiles of the updated region which are found in the cache as references to the
+    // cache and stores the other tiles. Returns the region which remains to be encoded.
+    const desktop::Region& processTiles(const desktop::Frame* frame,
+                                        proto::desktop::VideoPacket* packet);
+
+    void compressPacket(const desktop::Frame* frame, proto::desktop::VideoPacket* packet);
+
+    // Translates and compresses the tiles of |zstd_tiles_| in parallel and adds them to the
+    // packet in order. Returns false and leaves the packet without tiles if any tile fails.
+    bool compressTiles(const desktop::Frame* frame, proto::desktop::VideoPacket* packet);
+    bool compressTile(const desktop::Frame* frame, const ZstdTile& tile, TileThread* thread,
+                      std::string* output);
+
+    // Marks the packet without data. It does not change the stream.
+    void setEmptyPacket(proto::desktop::VideoPacket* packet);
 
     // Client's pixel format
     desktop::PixelFormat target_format_;
     int compress_ratio_;
     ScopedZstdCStream stream_;
+    const bool keep_history_;
+    bool stream_started_ = false;
+    bool reset_stream_ = false;
     std::unique_ptr<PixelTranslator> translator_;
-    std::unique_ptr<uint8_t[], base::AlignedFreeDeleter> translate_buffer_;
-    size_t translate_buffer_size_ = 0;
+    RegionSimplifier region_simplifier_;
+    std::vector<desktop::Rect> rects_;
+    std::unique_ptr<uint8_t[], base::AlignedFreeDeleter> chunk_buffer_;
+
+    std::unique_ptr<TileCache> tile_cache_;
+    std::vector<int> tile_coverage_;
+    std::vector<desktop::Rect> loaded_tiles_;
+    desktop::Region encode_region_;
+
+    const bool enable_rect_encoding_;
+    ColorPalette palette_;
+    std::vector<Block> blocks_;
+    std::vector<uint32_t> palette_colors_;
+    std::vector<uint8_t> packed_data_;
+
+    const int zstd_tile_size_;
+    std::unique_ptr<base::ThreadPool> thread_pool_;
+    std::vector<TileThread> tile_threads_; // One for each thread of the pool.
+    std::vector<ZstdTile> zstd_tiles_;
+    std::vector<std::string> tile_data_;
 
     DISALLOW_COPY_AND_ASSIGN(VideoEncoderZstd);
 };
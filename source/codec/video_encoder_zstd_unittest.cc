@@ -0,0 +1,393 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/video_encoder_zstd.h"
+#include "codec/video_decoder_zstd.h"
+#include "codec/tile_cache.h"
+#include "desktop/desktop_frame_simple.h"
+
+#include <gtest/gtest.h>
+
+namespace codec {
+
+namespace {
+
+const desktop::Size kScreenSize(640, 480);
+const int kZstdTileSize = 64;
+const size_t kTileCacheSize = 16;
+
+const uint32_t kFlags = proto::desktop::ENABLE_RECT_ENCODING | proto::desktop::ENABLE_ZSTD_HISTORY;
+
+// Draws a window with text, a gradient and a solid background which depend on |seed|.
+void paintFrame(desktop::Frame* frame, uint32_t seed)
+{
+    for (int y = 0; y < frame->size().height(); ++y)
+    {
+        uint32_t* row = reinterpret_cast<uint32_t*>(frame->frameDataAtPos(0, y));
+
+        for (int x = 0; x < frame->size().width(); ++x)
+        {
+            uint32_t color = 0xFF2D2D30;
+
+            if (x >= 50 + static_cast<int>(seed) && x < 400 && y >= 40 && y < 300)
+                color = ((x * 7 + y * 3 + seed) % 11 < 3) ? 0xFF000000 : 0xFFFFFFFF;
+            else if (y >= 350)
+                color = 0xFF000000 | ((x + seed) & 0xFF) << 8 | (y & 0xFF);
+
+            row[x] = color;
+        }
+    }
+}
+
+class VideoEncoderZstdTest : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        source_ = desktop::FrameSimple::create(kScreenSize, desktop::PixelFormat::ARGB());
+        target_ = desktop::FrameSimple::create(kScreenSize, desktop::PixelFormat::ARGB());
+        expected_ = desktop::FrameSimple::create(kScreenSize, desktop::PixelFormat::ARGB());
+    }
+
+    // Paints the source frame and marks |rect| as updated.
+    void update(uint32_t seed, const desktop::Rect& rect)
+    {
+        paintFrame(source_.get(), seed);
+        source_->updatedRegion()->clear();
+        source_->updatedRegion()->addRect(rect);
+    }
+
+    bool sameFrames() const
+    {
+        return memcmp(target_->frameData(), expected_->frameData(),
+                      target_->stride() * kScreenSize.height()) == 0;
+    }
+
+    std::unique_ptr<desktop::Frame> source_;
+    std::unique_ptr<desktop::Frame> target_;
+    std::unique_ptr<desktop::Frame> expected_;
+};
+
+} // namespace
+
+TEST(VideoEncoderZstdTileSizeTest, Validation)
+{
+    EXPECT_TRUE(VideoEncoderZstd::isValidZstdTileSize(64));
+    EXPECT_TRUE(VideoEncoderZstd::isValidZstdTileSize(VideoEncoderZstd::kDefaultZstdTileSize));
+    EXPECT_TRUE(VideoEncoderZstd::isValidZstdTileSize(1024));
+
+    EXPECT_FALSE(VideoEncoderZstd::isValidZstdTileSize(0));
+    EXPECT_FALSE(VideoEncoderZstd::isValidZstdTileSize(32));
+    EXPECT_FALSE(VideoEncoderZstd::isValidZstdTileSize(100));
+    EXPECT_FALSE(VideoEncoderZstd::isValidZstdTileSize(2048));
+
+    std::unique_ptr<VideoEncoderZstd> encoder(
+        VideoEncoderZstd::create(desktop::PixelFormat::RGB565(), 8, 0, 0, 100));
+    EXPECT_FALSE(encoder);
+}
+
+TEST_F(VideoEncoderZstdTest, TilesMatchSingleStream)
+{
+    std::unique_ptr<VideoEncoderZstd> encoder(VideoEncoderZstd::create(
+        desktop::PixelFormat::RGB565(), 8, 0, kFlags, kZstdTileSize));
+    std::unique_ptr<VideoEncoderZstd> expected_encoder(VideoEncoderZstd::create(
+        desktop::PixelFormat::RGB565(), 8, 0, kFlags));
+    ASSERT_TRUE(encoder && expected_encoder);
+
+    std::unique_ptr<VideoDecoderZstd> decoder = VideoDecoderZstd::create();
+    std::unique_ptr<VideoDecoderZstd> expected_decoder = VideoDecoderZstd::create();
+
+    // The small updates continue the stream of the single stream packets between the tiled
+    // ones.
+    const desktop::Rect rects[] =
+    {
+        desktop::Rect::makeSize(kScreenSize),
+        desktop::Rect::makeXYWH(60, 45, 100, 30),
+        desktop::Rect::makeXYWH(37, 20, 500, 400),
+        desktop::Rect::makeXYWH(300, 360, 40, 20),
+        desktop::Rect::makeXYWH(0, 350, 640, 130)
+    };
+
+    const bool tiled[] = { true, false, true, false, true };
+
+    for (size_t i = 0; i < std::size(rects); ++i)
+    {
+        update(static_cast<uint32_t>(i), rects[i]);
+
+        proto::desktop::VideoPacket packet;
+        encoder->encode(source_.get(), &packet);
+        EXPECT_EQ(packet.zstd_tile_size() != 0, tiled[i]) << i;
+
+        proto::desktop::VideoPacket expected_packet;
+        expected_encoder->encode(source_.get(), &expected_packet);
+        EXPECT_EQ(expected_packet.zstd_tile_size(), 0);
+
+        ASSERT_TRUE(decoder->decode(packet, target_.get())) << i;
+        ASSERT_TRUE(expected_decoder->decode(expected_packet, expected_.get())) << i;
+        EXPECT_TRUE(sameFrames()) << i;
+    }
+}
+
+TEST_F(VideoEncoderZstdTest, TilesAreDeterministic)
+{
+    std::unique_ptr<VideoEncoderZstd> encoder1(VideoEncoderZstd::create(
+        desktop::PixelFormat::ARGB(), 8, 0, kFlags, kZstdTileSize));
+    std::unique_ptr<VideoEncoderZstd> encoder2(VideoEncoderZstd::create(
+        desktop::PixelFormat::ARGB(), 8, 0, kFlags, kZstdTileSize));
+
+    update(0, desktop::Rect::makeSize(kScreenSize));
+
+    proto::desktop::VideoPacket packet1;
+    proto::desktop::VideoPacket packet2;
+
+    encoder1->encode(source_.get(), &packet1);
+    encoder2->encode(source_.get(), &packet2);
+
+    EXPECT_GT(packet1.zstd_tile_size(), 1);
+    EXPECT_EQ(packet1.SerializeAsString(), packet2.SerializeAsString());
+}
+
+TEST_F(VideoEncoderZstdTest, BrokenTiles)
+{
+    std::unique_ptr<VideoEncoderZstd> encoder(VideoEncoderZstd::create(
+        desktop::PixelFormat::ARGB(), 8, 0, 0, kZstdTileSize));
+
+    update(0, desktop::Rect::makeSize(kScreenSize));
+
+    proto::desktop::VideoPacket packet;
+    encoder->encode(source_.get(), &packet);
+    ASSERT_GT(packet.zstd_tile_size(), 2);
+
+    {
+        proto::desktop::VideoPacket broken(packet);
+        broken.mutable_zstd_tile(1)->set_rect_count(0xFFFFFFFF);
+
+        std::unique_ptr<VideoDecoderZstd> decoder = VideoDecoderZstd::create();
+        EXPECT_FALSE(decoder->decode(broken, target_.get()));
+    }
+
+    {
+        proto::desktop::VideoPacket broken(packet);
+        broken.mutable_zstd_tile(1)->set_data_size(broken.zstd_tile(1).data_size() + 1);
+
+        std::unique_ptr<VideoDecoderZstd> decoder = VideoDecoderZstd::create();
+        EXPECT_FALSE(decoder->decode(broken, target_.get()));
+    }
+
+    {
+        proto::desktop::VideoPacket broken(packet);
+        broken.mutable_zstd_tile(0)->set_data_size(0);
+        broken.mutable_zstd_tile(1)->set_data_size(
+            packet.zstd_tile(0).data_size() + packet.zstd_tile(1).data_size());
+
+        std::unique_ptr<VideoDecoderZstd> decoder = VideoDecoderZstd::create();
+        EXPECT_FALSE(decoder->decode(broken, target_.get()));
+    }
+
+    std::unique_ptr<VideoDecoderZstd> decoder = VideoDecoderZstd::create();
+    EXPECT_TRUE(decoder->decode(packet, target_.get()));
+}
+
+TEST_F(VideoEncoderZstdTest, TileCacheRoundTrip)
+{
+    std::unique_ptr<VideoEncoderZstd> encoder(VideoEncoderZstd::create(
+        desktop::PixelFormat::ARGB(), 8, kTileCacheSize, kFlags));
+    std::unique_ptr<VideoEncoderZstd> expected_encoder(VideoEncoderZstd::create(
+        desktop::PixelFormat::ARGB(), 8, 0, kFlags));
+    ASSERT_TRUE(encoder && expected_encoder);
+
+    std::unique_ptr<VideoDecoderZstd> decoder = VideoDecoderZstd::create(kTileCacheSize);
+    std::unique_ptr<VideoDecoderZstd> expected_decoder = VideoDecoderZstd::create();
+
+    // 8 tiles of the window. The first two updates fill the cache, the third one returns the
+    // content of the first one.
+    const desktop::Rect rect = desktop::Rect::makeXYWH(64, 64, 256, 128);
+    const uint32_t seeds[] = { 0, 1, 0 };
+
+    proto::desktop::VideoPacket first_packet;
+
+    for (size_t i = 0; i < std::size(seeds); ++i)
+    {
+        update(seeds[i], rect);
+
+        proto::desktop::VideoPacket packet;
+        encoder->encode(source_.get(), &packet);
+        ASSERT_EQ(packet.tile_cache_op_size(), 8) << i;
+
+        for (int j = 0; j < packet.tile_cache_op_size(); ++j)
+        {
+            EXPECT_LT(packet.tile_cache_op(j).index(), kTileCacheSize) << i;
+
+            // The text repeats, so the first updates may already load some of the tiles.
+            if (i == 2)
+                EXPECT_EQ(packet.tile_cache_op(j).type(), proto::desktop::TileCacheOp::TYPE_LOAD);
+        }
+
+        // The loaded tiles are not encoded.
+        if (i == 2)
+            EXPECT_EQ(packet.dirty_rect_size(), 0);
+
+        if (i == 0)
+            first_packet = packet;
+
+        proto::desktop::VideoPacket expected_packet;
+        expected_encoder->encode(source_.get(), &expected_packet);
+
+        ASSERT_TRUE(decoder->decode(packet, target_.get())) << i;
+        ASSERT_TRUE(expected_decoder->decode(expected_packet, expected_.get())) << i;
+        EXPECT_TRUE(sameFrames()) << i;
+    }
+
+    // The indexes are checked against the negotiated size of the cache.
+    ASSERT_EQ(first_packet.tile_cache_op(0).type(), proto::desktop::TileCacheOp::TYPE_STORE);
+    first_packet.mutable_tile_cache_op(0)->set_index(kTileCacheSize);
+
+    decoder = VideoDecoderZstd::create(kTileCacheSize);
+    EXPECT_FALSE(decoder->decode(first_packet, target_.get()));
+
+    decoder = VideoDecoderZstd::create(TileCache::kMaxCacheSize);
+    EXPECT_TRUE(decoder->decode(first_packet, target_.get()));
+
+    decoder = VideoDecoderZstd::create();
+    EXPECT_FALSE(decoder->decode(first_packet, target_.get()));
+}
+
+TEST_F(VideoEncoderZstdTest, HistoryAcrossPackets)
+{
+    std::unique_ptr<VideoEncoderZstd> encoder(VideoEncoderZstd::create(
+        desktop::PixelFormat::ARGB(), 8, 0, kFlags));
+    std::unique_ptr<VideoEncoderZstd> expected_encoder(VideoEncoderZstd::create(
+        desktop::PixelFormat::ARGB(), 8, 0, proto::desktop::ENABLE_RECT_ENCODING));
+    ASSERT_TRUE(encoder && expected_encoder);
+
+    std::unique_ptr<VideoDecoderZstd> decoder = VideoDecoderZstd::create();
+    std::unique_ptr<VideoDecoderZstd> expected_decoder = VideoDecoderZstd::create();
+
+    // The last update returns the window of the first one.
+    const desktop::Rect window = desktop::Rect::makeXYWH(40, 40, 360, 260);
+    const desktop::Rect rects[] = { desktop::Rect::makeSize(kScreenSize), window, window };
+    const uint32_t seeds[] = { 0, 5, 0 };
+
+    for (size_t i = 0; i < std::size(rects); ++i)
+    {
+        update(seeds[i], rects[i]);
+
+        proto::desktop::VideoPacket packet;
+        encoder->encode(source_.get(), &packet);
+        EXPECT_EQ(packet.continue_stream(), i != 0) << i;
+
+        proto::desktop::VideoPacket expected_packet;
+        expected_encoder->encode(source_.get(), &expected_packet);
+        EXPECT_FALSE(expected_packet.continue_stream());
+
+        // The repeated window refers to the first packet.
+        if (i == 2)
+            EXPECT_LT(packet.data().size(), expected_packet.data().size());
+
+        ASSERT_TRUE(decoder->decode(packet, target_.get())) << i;
+        ASSERT_TRUE(expected_decoder->decode(expected_packet, expected_.get())) << i;
+        EXPECT_TRUE(sameFrames()) << i;
+    }
+}
+
+TEST_F(VideoEncoderZstdTest, HistoryIsResetWithFormat)
+{
+    std::unique_ptr<VideoEncoderZstd> encoder(VideoEncoderZstd::create(
+        desktop::PixelFormat::ARGB(), 8, 0, kFlags));
+    std::unique_ptr<VideoEncoderZstd> expected_encoder(VideoEncoderZstd::create(
+        desktop::PixelFormat::ARGB(), 8, 0, proto::desktop::ENABLE_RECT_ENCODING));
+    ASSERT_TRUE(encoder && expected_encoder);
+
+    std::unique_ptr<VideoDecoderZstd> decoder = VideoDecoderZstd::create();
+    std::unique_ptr<VideoDecoderZstd> expected_decoder = VideoDecoderZstd::create();
+
+    const desktop::Size small_size(320, 240);
+
+    std::unique_ptr<desktop::Frame> small_source =
+        desktop::FrameSimple::create(small_size, desktop::PixelFormat::ARGB());
+    std::unique_ptr<desktop::Frame> small_target =
+        desktop::FrameSimple::create(small_size, desktop::PixelFormat::ARGB());
+    std::unique_ptr<desktop::Frame> small_expected =
+        desktop::FrameSimple::create(small_size, desktop::PixelFormat::ARGB());
+
+    for (uint32_t seed = 0; seed < 4; ++seed)
+    {
+        // The size of the screen is changed after two packets.
+        const bool small = seed >= 2;
+
+        desktop::Frame* source = small ? small_source.get() : source_.get();
+        desktop::Frame* target = small ? small_target.get() : target_.get();
+        desktop::Frame* expected = small ? small_expected.get() : expected_.get();
+
+        paintFrame(source, seed);
+        source->updatedRegion()->clear();
+        source->updatedRegion()->addRect(desktop::Rect::makeSize(source->size()));
+
+        proto::desktop::VideoPacket packet;
+        encoder->encode(source, &packet);
+
+        // The packet with the new format starts a new stream.
+        EXPECT_EQ(packet.has_format(), seed == 0 || seed == 2) << seed;
+        EXPECT_EQ(packet.continue_stream(), !packet.has_format()) << seed;
+
+        proto::desktop::VideoPacket expected_packet;
+        expected_encoder->encode(source, &expected_packet);
+
+        ASSERT_TRUE(decoder->decode(packet, target)) << seed;
+        ASSERT_TRUE(expected_decoder->decode(expected_packet, expected)) << seed;
+        EXPECT_EQ(memcmp(target->frameData(), expected->frameData(),
+                         target->stride() * target->size().height()), 0) << seed;
+    }
+}
+
+TEST_F(VideoEncoderZstdTest, LongDistanceMatching)
+{
+    // Without the rectangle encoding each frame adds 1.2MB of pixels to the history.
+    std::unique_ptr<VideoEncoderZstd> encoder(VideoEncoderZstd::create(
+        desktop::PixelFormat::ARGB(), 8, 0,
+        proto::desktop::ENABLE_ZSTD_HISTORY | proto::desktop::ENABLE_ZSTD_LONG_DISTANCE));
+    std::unique_ptr<VideoEncoderZstd> expected_encoder(VideoEncoderZstd::create(
+        desktop::PixelFormat::ARGB(), 8, 0, proto::desktop::ENABLE_ZSTD_HISTORY));
+    ASSERT_TRUE(encoder && expected_encoder);
+
+    std::unique_ptr<VideoDecoderZstd> decoder = VideoDecoderZstd::create();
+    std::unique_ptr<VideoDecoderZstd> expected_decoder = VideoDecoderZstd::create();
+
+    // The last frame repeats the first one, which is out of the default window.
+    const uint32_t seeds[] = { 0, 10, 20, 30, 40, 50, 60, 0 };
+
+    for (size_t i = 0; i < std::size(seeds); ++i)
+    {
+        update(seeds[i], desktop::Rect::makeSize(kScreenSize));
+
+        proto::desktop::VideoPacket packet;
+        encoder->encode(source_.get(), &packet);
+
+        proto::desktop::VideoPacket expected_packet;
+        expected_encoder->encode(source_.get(), &expected_packet);
+
+        if (i == std::size(seeds) - 1)
+            EXPECT_LT(packet.data().size() * 2, expected_packet.data().size());
+
+        ASSERT_TRUE(decoder->decode(packet, target_.get())) << i;
+        ASSERT_TRUE(expected_decoder->decode(expected_packet, expected_.get())) << i;
+        EXPECT_TRUE(sameFrames()) << i;
+    }
+}
+
+} // namespace codec
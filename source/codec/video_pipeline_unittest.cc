@@ -0,0 +1,165 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/latency_histogram.h"
+#include "codec/video_decoder_zstd.h"
+#include "codec/video_encoder_zstd.h"
+#include "desktop/desktop_frame_simple.h"
+#include "desktop/frame_generator.h"
+#include "desktop/frame_trace.h"
+#include "desktop/screen_capturer_replay.h"
+
+#include <gtest/gtest.h>
+
+namespace codec {
+
+namespace {
+
+const desktop::Size kScreenSize(1280, 720);
+const int kTraceFrameCount = 30;
+
+// The trace is replayed twice, so the second pass starts again with the whole screen.
+const int kCaptureCount = 2 * kTraceFrameCount;
+
+const uint32_t kFlags = proto::desktop::ENABLE_RECT_ENCODING | proto::desktop::ENABLE_ZSTD_HISTORY;
+
+using Clock = std::chrono::steady_clock;
+
+std::chrono::microseconds elapsedSince(const Clock::time_point& start)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start);
+}
+
+std::vector<uint8_t> writeTrace(desktop::FrameGenerator::Type type)
+{
+    desktop::FrameGenerator generator(type, kScreenSize, kTraceFrameCount);
+    desktop::FrameTraceWriter writer(kScreenSize);
+
+    std::unique_ptr<desktop::Frame> frame =
+        desktop::FrameSimple::create(kScreenSize, desktop::PixelFormat::ARGB());
+
+    for (int i = 0; i < kTraceFrameCount; ++i)
+    {
+        frame->updatedRegion()->clear();
+
+        EXPECT_TRUE(generator.nextFrame(frame.get()));
+        EXPECT_TRUE(writer.addFrame(*frame, std::chrono::milliseconds(i * 40)));
+    }
+
+    return writer.finish();
+}
+
+// The alpha channel is not transferred.
+bool isEqualImage(const desktop::Frame& frame1, const desktop::Frame& frame2)
+{
+    for (int y = 0; y < frame1.size().height(); ++y)
+    {
+        const uint32_t* row1 = reinterpret_cast<const uint32_t*>(frame1.frameDataAtPos(0, y));
+        const uint32_t* row2 = reinterpret_cast<const uint32_t*>(frame2.frameDataAtPos(0, y));
+
+        for (int x = 0; x < frame1.size().width(); ++x)
+        {
+            if ((row1[x] & 0x00FFFFFF) != (row2[x] & 0x00FFFFFF))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+void recordHistogram(const std::string& name, const base::LatencyHistogram& histogram)
+{
+    testing::Test::RecordProperty(name + "_p50_us",
+                                  static_cast<int>(histogram.percentile(50).count()));
+    testing::Test::RecordProperty(name + "_p95_us",
+                                  static_cast<int>(histogram.percentile(95).count()));
+    testing::Test::RecordProperty(name + "_max_us", static_cast<int>(histogram.max().count()));
+}
+
+} // namespace
+
+// Runs the capture-encode-decode pipeline on the replayed traces of the generators. Besides the
+// check of the decoded image, the test is a repeatable baseline of the pipeline: the percentiles
+// of the stages and the amount of the encoded data are saved as the properties of the test
+// (see --gtest_output=xml).
+class VideoPipelineTest : public testing::TestWithParam<desktop::FrameGenerator::Type>
+{
+    // Nothing
+};
+
+TEST_P(VideoPipelineTest, Replay)
+{
+    std::vector<uint8_t> trace = writeTrace(GetParam());
+
+    std::unique_ptr<desktop::FrameTraceReader> reader =
+        desktop::FrameTraceReader::create(base::ConstBuffer(trace.data(), trace.size()));
+    ASSERT_TRUE(reader);
+
+    desktop::ScreenCapturerReplay capturer(std::move(reader), true);
+
+    std::unique_ptr<VideoEncoderZstd> encoder(VideoEncoderZstd::create(
+        desktop::PixelFormat::ARGB(), 8, 0, kFlags, VideoEncoderZstd::kDefaultZstdTileSize));
+    ASSERT_TRUE(encoder);
+
+    std::unique_ptr<VideoDecoderZstd> decoder = VideoDecoderZstd::create();
+    std::unique_ptr<desktop::Frame> target =
+        desktop::FrameSimple::create(kScreenSize, desktop::PixelFormat::ARGB());
+
+    base::LatencyHistogram capture_time;
+    base::LatencyHistogram encode_time;
+    base::LatencyHistogram decode_time;
+    int64_t encoded_bytes = 0;
+
+    for (int i = 0; i < kCaptureCount; ++i)
+    {
+        Clock::time_point start = Clock::now();
+
+        const desktop::Frame* frame = capturer.captureFrame();
+        ASSERT_TRUE(frame) << i;
+
+        capture_time.add(elapsedSince(start));
+
+        proto::desktop::VideoPacket packet;
+
+        start = Clock::now();
+        encoder->encode(frame, &packet);
+        encode_time.add(elapsedSince(start));
+
+        encoded_bytes += packet.ByteSizeLong();
+
+        start = Clock::now();
+        ASSERT_TRUE(decoder->decode(packet, target.get())) << i;
+        decode_time.add(elapsedSince(start));
+
+        EXPECT_TRUE(isEqualImage(*frame, *target)) << i;
+    }
+
+    recordHistogram("capture", capture_time);
+    recordHistogram("encode", encode_time);
+    recordHistogram("decode", decode_time);
+    RecordProperty("encoded_bytes_per_frame", static_cast<int>(encoded_bytes / kCaptureCount));
+}
+
+INSTANTIATE_TEST_CASE_P(Types,
+                        VideoPipelineTest,
+                        testing::Values(desktop::FrameGenerator::Type::TYPING,
+                                        desktop::FrameGenerator::Type::SCROLLING,
+                                        desktop::FrameGenerator::Type::WINDOW_DRAG,
+                                        desktop::FrameGenerator::Type::VIDEO));
+
+} // namespace codec
@@ -59,4 +59,9 @@ void VideoUtil::toVideoPixelFormat(
     to->set_blue_shift(from.blueShift());
 }
 
+bool VideoUtil::isCopyRectSupported(proto::desktop::VideoEncoding encoding)
+{
+    return encoding == proto::desktop::VIDEO_ENCODING_ZSTD;
+}
+
 } // namespace codec
@@ -38,6 +38,11 @@ public:
     static void toVideoPixelFormat(
         const desktop::PixelFormat& from, proto::desktop::PixelFormat* to);
 
+    // Returns true if the decoder of |encoding| keeps the pixels outside of the dirty rectangles,
+    // so the client may copy the moved areas in its frame. The VPX decoders output whole
+    // macroblocks from their own reference frames, which do not contain the copied pixels.
+    static bool isCopyRectSupported(proto::desktop::VideoEncoding encoding);
+
 private:
     DISALLOW_COPY_AND_ASSIGN(VideoUtil);
 };
@@ -0,0 +1,153 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/zstd_dictionary.h"
+
+namespace codec {
+
+namespace {
+
+// The colors are ordered from the least to the most frequent ones, because the matches at the end
+// of the dictionary have shorter offsets.
+const uint32_t kBackgroundColors[] =
+{
+    0xFF0078D7, // Selection and title bars.
+    0xFF2D2D30, // Panels of the dark themes.
+    0xFF1E1E1E, // Editors and consoles of the dark themes.
+    0xFFF0F0F0, // Dialogs and panels.
+    0xFFFFFFFF  // Documents and web pages.
+};
+
+const uint32_t kTextColors[] = { 0xFFD4D4D4, 0xFFFFFFFF, 0xFF000000 };
+
+const int kRunLength = 16;
+const int kEdgeSteps = 4;
+const int kStemWidth = 2;
+
+// About 16 cursors of 32x32 pixels.
+const size_t kCursorHistorySize = 64 * 1024;
+
+uint32_t blendColors(uint32_t from, uint32_t to, int step, int steps)
+{
+    uint32_t result = 0;
+
+    for (int shift = 0; shift < 32; shift += 8)
+    {
+        const int a = (from >> shift) & 0xFF;
+        const int b = (to >> shift) & 0xFF;
+
+        result |= static_cast<uint32_t>(a + (b - a) * step / steps) << shift;
+    }
+
+    return result;
+}
+
+void appendRun(std::vector<uint32_t>* pixels, uint32_t color, int length)
+{
+    pixels->insert(pixels->end(), length, color);
+}
+
+// A stem of a glyph with the antialiased edges on |background|.
+void appendStem(std::vector<uint32_t>* pixels, uint32_t background, uint32_t text)
+{
+    appendRun(pixels, background, kRunLength);
+
+    for (int step = 1; step < kEdgeSteps; ++step)
+        pixels->push_back(blendColors(background, text, step, kEdgeSteps));
+
+    appendRun(pixels, text, kStemWidth);
+
+    for (int step = kEdgeSteps - 1; step > 0; --step)
+        pixels->push_back(blendColors(background, text, step, kEdgeSteps));
+}
+
+std::vector<uint32_t> builtinPixels()
+{
+    std::vector<uint32_t> pixels;
+
+    // A row of a cursor: the transparent area, the black outline, the white fill and the
+    // translucent shadow.
+    appendRun(&pixels, 0x00000000, kRunLength);
+    appendRun(&pixels, 0xFF000000, 1);
+    appendRun(&pixels, 0xFFFFFFFF, kRunLength / 2);
+    appendRun(&pixels, 0xFF000000, 1);
+    appendRun(&pixels, 0x40000000, 2);
+    appendRun(&pixels, 0x00000000, kRunLength);
+
+    for (uint32_t background : kBackgroundColors)
+    {
+        for (uint32_t text : kTextColors)
+        {
+            if (text != background)
+                appendStem(&pixels, background, text);
+        }
+
+        appendRun(&pixels, background, kRunLength);
+    }
+
+    return pixels;
+}
+
+} // namespace
+
+ZstdDictionary::ZstdDictionary(std::vector<uint8_t> builtin, size_t max_history)
+    : buffer_(std::move(builtin)),
+      builtin_size_(buffer_.size()),
+      max_history_(max_history)
+{
+    // Nothing
+}
+
+ZstdDictionary::~ZstdDictionary() = default;
+
+// static
+std::unique_ptr<ZstdDictionary> ZstdDictionary::createForCursor()
+{
+    const std::vector<uint32_t> pixels = builtinPixels();
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(pixels.data());
+
+    std::vector<uint8_t> builtin(data, data + pixels.size() * sizeof(uint32_t));
+
+    return std::unique_ptr<ZstdDictionary>(new ZstdDictionary(std::move(builtin), kCursorHistorySize));
+}
+
+void ZstdDictionary::append(const uint8_t* data, size_t size)
+{
+    if (size > max_history_)
+    {
+        data += size - max_history_;
+        size = max_history_;
+    }
+
+    const size_t history_size = buffer_.size() - builtin_size_;
+
+    if (history_size + size > max_history_)
+    {
+        const size_t drop_size = history_size + size - max_history_;
+        buffer_.erase(buffer_.begin() + builtin_size_, buffer_.begin() + builtin_size_ + drop_size);
+    }
+
+    buffer_.insert(buffer_.end(), data, data + size);
+}
+
+void ZstdDictionary::reset()
+{
+    buffer_.resize(builtin_size_);
+}
+
+} // namespace codec
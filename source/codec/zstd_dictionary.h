@@ -0,0 +1,70 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CODEC__ZSTD_DICTIONARY_H
+#define CODEC__ZSTD_DICTIONARY_H
+
+#include "base/macros_magic.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace codec {
+
+// The raw content dictionary for the Zstd streams of the cursor shapes. Zstd treats the content
+// of the dictionary as if it preceded the data of the stream, so even the first bytes of a small
+// stream can refer to it. The dictionary starts with the built-in content (runs and antialiased
+// edges of the typical colors of windows and cursors). The images of the previous cursors are
+// appended to it, so the dictionary adapts to the session. The host and the client build the
+// same dictionary, it is never transferred.
+class ZstdDictionary
+{
+public:
+    ~ZstdDictionary();
+
+    // ID of the built-in content which is negotiated in Config. It must be changed with any
+    // change of the content, so the peers with different contents never use it.
+    static constexpr uint32_t kBuiltinId = 1;
+
+    // Creates the dictionary for the 32-bit cursor images with the alpha channel. The images of
+    // the previous cursors are appended to it, up to 64kB (the oldest ones are dropped first).
+    static std::unique_ptr<ZstdDictionary> createForCursor();
+
+    // Appends the data of a stream.
+    void append(const uint8_t* data, size_t size);
+
+    // Removes the appended data.
+    void reset();
+
+    const uint8_t* data() const { return buffer_.data(); }
+    size_t size() const { return buffer_.size(); }
+
+private:
+    ZstdDictionary(std::vector<uint8_t> builtin, size_t max_history);
+
+    std::vector<uint8_t> buffer_;
+    const size_t builtin_size_;
+    const size_t max_history_;
+
+    DISALLOW_COPY_AND_ASSIGN(ZstdDictionary);
+};
+
+} // namespace codec
+
+#endif // CODEC__ZSTD_DICTIONARY_H
@@ -0,0 +1,135 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/zstd_dictionary.h"
+
+#include <gtest/gtest.h>
+#include <zstd.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace codec {
+
+namespace {
+
+// A 32x32 arrow: the black outline, the white fill and the translucent shadow on the transparent
+// background.
+std::vector<uint32_t> arrowCursor()
+{
+    const int kSize = 32;
+    std::vector<uint32_t> pixels(kSize * kSize, 0x00000000);
+
+    for (int y = 0; y < kSize; ++y)
+    {
+        const int width = std::min(y + 1, kSize / 2);
+        uint32_t* row = &pixels[y * kSize];
+
+        for (int x = 0; x < width; ++x)
+            row[x] = (x == 0 || x == width - 1 || y == kSize / 2) ? 0xFF000000 : 0xFFFFFFFF;
+
+        row[width] = 0x40000000;
+        row[width + 1] = 0x40000000;
+    }
+
+    return pixels;
+}
+
+std::string compress(const std::vector<uint32_t>& pixels, const ZstdDictionary* dictionary)
+{
+    ZSTD_CCtx* context = ZSTD_createCCtx();
+    EXPECT_FALSE(ZSTD_isError(ZSTD_CCtx_setParameter(context, ZSTD_c_compressionLevel, 8)));
+
+    if (dictionary)
+    {
+        EXPECT_FALSE(ZSTD_isError(
+            ZSTD_CCtx_refPrefix(context, dictionary->data(), dictionary->size())));
+    }
+
+    const size_t input_size = pixels.size() * sizeof(uint32_t);
+    std::string output(ZSTD_compressBound(input_size), 0);
+
+    const size_t size = ZSTD_compress2(context, &output[0], output.size(), pixels.data(), input_size);
+    EXPECT_FALSE(ZSTD_isError(size));
+    output.resize(ZSTD_isError(size) ? 0 : size);
+
+    ZSTD_freeCCtx(context);
+    return output;
+}
+
+std::vector<uint32_t> decompress(const std::string& input, size_t pixel_count,
+                                 const ZstdDictionary* dictionary)
+{
+    ZSTD_DCtx* context = ZSTD_createDCtx();
+
+    if (dictionary)
+    {
+        EXPECT_FALSE(ZSTD_isError(
+            ZSTD_DCtx_refPrefix(context, dictionary->data(), dictionary->size())));
+    }
+
+    std::vector<uint32_t> pixels(pixel_count);
+
+    const size_t size = ZSTD_decompressDCtx(
+        context, pixels.data(), pixels.size() * sizeof(uint32_t), input.data(), input.size());
+    EXPECT_EQ(size, pixels.size() * sizeof(uint32_t));
+
+    ZSTD_freeDCtx(context);
+    return pixels;
+}
+
+} // namespace
+
+TEST(ZstdDictionaryTest, CursorHistory)
+{
+    std::unique_ptr<ZstdDictionary> dictionary = ZstdDictionary::createForCursor();
+    const size_t builtin_size = dictionary->size();
+
+    std::vector<uint8_t> cursor(40 * 1024);
+    for (size_t i = 0; i < cursor.size(); ++i)
+        cursor[i] = static_cast<uint8_t>(i * 7);
+
+    dictionary->append(cursor.data(), cursor.size());
+    EXPECT_EQ(dictionary->size(), builtin_size + cursor.size());
+
+    // The second cursor does not fit, the oldest data is dropped. The new data is at the end.
+    std::vector<uint8_t> other(40 * 1024, 0x5A);
+    dictionary->append(other.data(), other.size());
+    EXPECT_EQ(dictionary->size(), builtin_size + 64 * 1024);
+    EXPECT_EQ(memcmp(dictionary->data() + dictionary->size() - other.size(),
+                     other.data(), other.size()), 0);
+    EXPECT_EQ(memcmp(dictionary->data() + builtin_size,
+                     cursor.data() + cursor.size() - (24 * 1024), 24 * 1024), 0);
+
+    dictionary->reset();
+    EXPECT_EQ(dictionary->size(), builtin_size);
+}
+
+TEST(ZstdDictionaryTest, SmallCursor)
+{
+    std::unique_ptr<ZstdDictionary> dictionary = ZstdDictionary::createForCursor();
+    const std::vector<uint32_t> cursor = arrowCursor();
+
+    const std::string plain = compress(cursor, nullptr);
+    const std::string with_dictionary = compress(cursor, dictionary.get());
+
+    EXPECT_LT(with_dictionary.size(), plain.size());
+    EXPECT_EQ(decompress(with_dictionary, cursor.size(), dictionary.get()), cursor);
+}
+
+} // namespace codec
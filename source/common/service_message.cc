@@ -0,0 +1,61 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "common/service_message.h"
+#include "base/logging.h"
+
+namespace common {
+
+namespace {
+
+const char kServiceMessageMarker = 0;
+
+} // namespace
+
+bool isServiceMessage(const QByteArray& buffer)
+{
+    return !buffer.isEmpty() && buffer.at(0) == kServiceMessageMarker;
+}
+
+QByteArray serializeServiceMessage(const google::protobuf::MessageLite& message)
+{
+    const size_t size = message.ByteSizeLong();
+
+    QByteArray buffer;
+    buffer.resize(static_cast<int>(size + 1));
+    buffer[0] = kServiceMessageMarker;
+
+    message.SerializeWithCachedSizesToArray(reinterpret_cast<uint8_t*>(buffer.data() + 1));
+    return buffer;
+}
+
+bool parseServiceMessage(const QByteArray& buffer, google::protobuf::MessageLite* message)
+{
+    if (!isServiceMessage(buffer))
+        return false;
+
+    if (!message->ParseFromArray(buffer.constData() + 1, buffer.size() - 1))
+    {
+        LOG(LS_WARNING) << "Received service message that is not a valid protocol buffer";
+        return false;
+    }
+
+    return true;
+}
+
+} // namespace common
@@ -0,0 +1,42 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef COMMON__SERVICE_MESSAGE_H
+#define COMMON__SERVICE_MESSAGE_H
+
+#include <QByteArray>
+
+#include <google/protobuf/message_lite.h>
+
+namespace common {
+
+// The host service and the session process exchange their own messages in the IPC channel of the
+// session together with the messages of the client. A service message starts with a zero byte.
+// A serialized protocol buffer never starts with it (the field number 0 is invalid), so the
+// messages are told apart without parsing. The service drops the messages of the client which
+// start with it, so the client cannot send a service message to the session.
+bool isServiceMessage(const QByteArray& buffer);
+
+QByteArray serializeServiceMessage(const google::protobuf::MessageLite& message);
+
+// Returns false if |buffer| is not a service message or it cannot be parsed.
+bool parseServiceMessage(const QByteArray& buffer, google::protobuf::MessageLite* message);
+
+} // namespace common
+
+#endif // COMMON__SERVICE_MESSAGE_H
@@ -0,0 +1,84 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "common/message_serialization.h"
+#include "common/service_message.h"
+#include "proto/desktop.pb.h"
+#include "proto/host.pb.h"
+
+#include <gtest/gtest.h>
+
+namespace common {
+
+TEST(ServiceMessageTest, StatsRequestAndReply)
+{
+    proto::host::ServiceToSession request;
+    request.set_pipeline_stats_request(true);
+
+    const QByteArray request_buffer = serializeServiceMessage(request);
+    EXPECT_TRUE(isServiceMessage(request_buffer));
+
+    proto::host::ServiceToSession parsed_request;
+    ASSERT_TRUE(parseServiceMessage(request_buffer, &parsed_request));
+    EXPECT_TRUE(parsed_request.pipeline_stats_request());
+
+    proto::host::SessionToService reply;
+    proto::desktop::PipelineStats::Histogram* histogram =
+        reply.mutable_pipeline_stats()->add_histogram();
+    histogram->set_stage(proto::desktop::PipelineStats::STAGE_ENCODE);
+    histogram->set_count(10);
+    histogram->set_p50(1500);
+
+    const QByteArray reply_buffer = serializeServiceMessage(reply);
+    EXPECT_TRUE(isServiceMessage(reply_buffer));
+
+    proto::host::SessionToService parsed_reply;
+    ASSERT_TRUE(parseServiceMessage(reply_buffer, &parsed_reply));
+    ASSERT_EQ(parsed_reply.pipeline_stats().histogram_size(), 1);
+    EXPECT_EQ(parsed_reply.pipeline_stats().histogram(0).stage(),
+              proto::desktop::PipelineStats::STAGE_ENCODE);
+    EXPECT_EQ(parsed_reply.pipeline_stats().histogram(0).count(), 10U);
+    EXPECT_EQ(parsed_reply.pipeline_stats().histogram(0).p50(), 1500U);
+}
+
+TEST(ServiceMessageTest, ClientMessages)
+{
+    // The messages of the client and the session are never taken for the service messages.
+    proto::desktop::ClientToHost client_message;
+    client_message.mutable_pointer_event()->set_x(10);
+    EXPECT_FALSE(isServiceMessage(serializeMessage(client_message)));
+
+    client_message.Clear();
+    client_message.mutable_extension()->set_name("system_info");
+    EXPECT_FALSE(isServiceMessage(serializeMessage(client_message)));
+
+    proto::desktop::HostToClient host_message;
+    host_message.mutable_video_packet()->set_data(std::string(100, '\0'));
+    EXPECT_FALSE(isServiceMessage(serializeMessage(host_message)));
+
+    proto::host::ServiceToSession message;
+    EXPECT_FALSE(isServiceMessage(QByteArray()));
+    EXPECT_FALSE(parseServiceMessage(serializeMessage(client_message), &message));
+
+    // A forged message is detected without parsing, so the service can drop it.
+    QByteArray forged(1, '\0');
+    forged.append(serializeMessage(client_message));
+    EXPECT_TRUE(isServiceMessage(forged));
+}
+
+} // namespace common
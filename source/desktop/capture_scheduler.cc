@@ -18,33 +18,207 @@
 
 #include "desktop/capture_scheduler.h"
 
+#include <algorithm>
+#include <cmath>
+
 namespace desktop {
 
+namespace {
+
+// Weight of the last measurement in the smoothed stage times.
+const double kSmoothingFactor = 0.125;
+
+// The interval is kept this much longer than the slowest stage to leave the CPU for other tasks.
+const double kCpuHeadroom = 1.25;
+
+// Limits of the interval. The configured interval may be zero, so the increased interval is at
+// least kMinIncreasedInterval.
+constexpr std::chrono::milliseconds kMinIncreasedInterval(10);
+constexpr std::chrono::milliseconds kMaxInterval(1000);
+
+// Number of the frames without changes in a row after which the idle mode begins.
+const int kIdleFrameCount = 30;
+
+// In the idle mode the interval grows by half with each frame without changes up to this value.
+constexpr std::chrono::milliseconds kMaxIdleInterval(500);
+
+double smooth(double value, double sample)
+{
+    return value + (sample - value) * kSmoothingFactor;
+}
+
+} // namespace
+
 CaptureScheduler::CaptureScheduler(const std::chrono::milliseconds& update_interval)
-    : update_interval_(update_interval)
+    : min_interval_(std::min(update_interval, kMaxInterval)),
+      active_interval_(min_interval_),
+      idle_interval_(min_interval_)
 {
-    // Nothing
+    counters_.interval = min_interval_;
 }
 
 void CaptureScheduler::beginCapture()
 {
+    std::scoped_lock lock(lock_);
     begin_time_ = std::chrono::high_resolution_clock::now();
+    capture_now_ = false;
 }
 
-void CaptureScheduler::endCapture()
+void CaptureScheduler::endCapture(bool has_changes)
 {
+    std::scoped_lock lock(lock_);
     end_time_ = std::chrono::high_resolution_clock::now();
+
+    if (has_changes)
+        empty_frames_ = 0;
+    else
+        ++empty_frames_;
+
+    addCaptureTime(std::chrono::duration_cast<std::chrono::microseconds>(end_time_ - begin_time_));
+    updateInterval();
 }
 
 std::chrono::milliseconds CaptureScheduler::nextCaptureDelay() const
 {
-    std::chrono::milliseconds diff_time =
-        std::chrono::duration_cast<std::chrono::milliseconds>(end_time_ - begin_time_);
+    std::scoped_lock lock(lock_);
+
+    if (capture_now_)
+        return std::chrono::milliseconds::zero();
+
+    // The interval is counted from the beginning of the last capture.
+    std::chrono::milliseconds diff_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::high_resolution_clock::now() - begin_time_);
+
+    if (diff_time > counters_.interval)
+        diff_time = counters_.interval;
+
+    return counters_.interval - diff_time;
+}
+
+void CaptureScheduler::wakeUp()
+{
+    std::scoped_lock lock(lock_);
+
+    // In the idle mode the last capture may be up to kMaxIdleInterval ago. The screen is captured
+    // right away, so the response to the input is not delayed by the idle interval.
+    if (counters_.reason == Reason::IDLE)
+        capture_now_ = true;
+
+    empty_frames_ = 0;
+    idle_interval_ = active_interval_;
+
+    counters_.interval = active_interval_;
+    counters_.reason = active_reason_;
+}
+
+void CaptureScheduler::addEncodeTime(const std::chrono::microseconds& encode_time)
+{
+    std::scoped_lock lock(lock_);
+
+    encode_time_ = smooth(encode_time_, static_cast<double>(encode_time.count()));
+    counters_.encode_time = std::chrono::microseconds(static_cast<int64_t>(encode_time_));
+}
+
+void CaptureScheduler::setPendingBytes(int64_t pending_bytes)
+{
+    std::scoped_lock lock(lock_);
+    counters_.pending_bytes = pending_bytes;
+}
+
+CaptureScheduler::Counters CaptureScheduler::counters() const
+{
+    std::scoped_lock lock(lock_);
+    return counters_;
+}
+
+void CaptureScheduler::addCaptureTime(const std::chrono::microseconds& capture_time)
+{
+    capture_time_ = smooth(capture_time_, static_cast<double>(capture_time.count()));
+    counters_.capture_time = std::chrono::microseconds(static_cast<int64_t>(capture_time_));
+}
+
+void CaptureScheduler::updateInterval()
+{
+    // The capture and the encoding are executed in parallel, so the frame rate is limited by
+    // the slowest stage.
+    const double busy_time = std::max(capture_time_, encode_time_) * kCpuHeadroom;
+
+    const std::chrono::milliseconds cpu_interval(
+        static_cast<int64_t>(std::ceil(busy_time / 1000.0)));
+
+    const std::chrono::milliseconds target_interval =
+        std::min(std::max(min_interval_, cpu_interval), kMaxInterval);
+
+    const std::chrono::milliseconds prev_interval = active_interval_;
+    std::chrono::milliseconds interval;
+
+    if (counters_.pending_bytes >= kBacklogHighBytes)
+    {
+        // The link does not keep up with the screen updates.
+        interval = std::max(prev_interval * 2, kMinIncreasedInterval);
+    }
+    else if (prev_interval > target_interval && counters_.pending_bytes > kBacklogLowBytes)
+    {
+        // Wait until the backlog is sent.
+        interval = prev_interval;
+    }
+    else if (prev_interval > target_interval)
+    {
+        // There is headroom. The interval decreases gradually to avoid oscillation.
+        interval = std::max(target_interval, prev_interval * 3 / 4);
+    }
+    else
+    {
+        interval = target_interval;
+    }
+
+    active_interval_ = std::min(std::max(interval, target_interval), kMaxInterval);
+
+    if (active_interval_ == min_interval_)
+        active_reason_ = Reason::MIN_INTERVAL;
+    else if (active_interval_ == target_interval)
+        active_reason_ = Reason::CPU;
+    else
+        active_reason_ = Reason::BACKLOG;
+
+    Reason reason = active_reason_;
+
+    if (empty_frames_ >= kIdleFrameCount)
+    {
+        idle_interval_ = std::min(
+            std::max(idle_interval_ * 3 / 2, kMinIncreasedInterval), kMaxIdleInterval);
+
+        if (idle_interval_ > active_interval_)
+            reason = Reason::IDLE;
+        else
+            idle_interval_ = active_interval_;
+    }
+    else
+    {
+        idle_interval_ = active_interval_;
+    }
+
+    switch (reason)
+    {
+        case Reason::MIN_INTERVAL:
+            ++counters_.min_interval_count;
+            break;
+
+        case Reason::CPU:
+            ++counters_.cpu_count;
+            break;
+
+        case Reason::BACKLOG:
+            ++counters_.backlog_count;
+            break;
 
-    if (diff_time > update_interval_)
-        diff_time = update_interval_;
+        case Reason::IDLE:
+            ++counters_.idle_count;
+            break;
+    }
 
-    return update_interval_ - diff_time;
+    counters_.interval = (reason == Reason::IDLE) ? idle_interval_ : active_interval_;
+    counters_.reason = reason;
 }
 
 } // namespace desktop
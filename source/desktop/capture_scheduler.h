@@ -22,24 +22,114 @@
 #include "base/macros_magic.h"
 
 #include <chrono>
+#include <cstdint>
+#include <mutex>
 
 namespace desktop {
 
+// Calculates the delay before the next capture of the screen. The interval between the captures
+// starts from the configured update interval and adapts to the load:
+// - if the capture or the encoding takes longer than the interval, the interval grows to the
+//   time of the slowest stage, so the CPU is not saturated;
+// - if the outgoing data is not sent yet (the link is slower than the screen updates), the
+//   interval is doubled until the backlog is sent;
+// - when the load goes down, the interval gradually returns to the configured minimum;
+// - if the screen does not change for a while, the interval grows until there are changes again
+//   or the user input arrives (see wakeUp()).
+// The capture is measured by beginCapture() and endCapture(), the encoding time and the backlog
+// are reported by other threads.
 class CaptureScheduler
 {
 public:
     explicit CaptureScheduler(const std::chrono::milliseconds& update_interval);
     ~CaptureScheduler() = default;
 
+    // If the outgoing data exceeds this size, the interval is doubled. The host stops encoding
+    // new frames at the same size.
+    static constexpr int64_t kBacklogHighBytes = 1024 * 1024;
+
+    // The interval does not decrease until the outgoing data is less than this size. The host
+    // resumes the encoding at the same size.
+    static constexpr int64_t kBacklogLowBytes = 256 * 1024;
+
+    enum class Reason
+    {
+        MIN_INTERVAL, // There is no load. The configured interval is used.
+        CPU,          // The interval is limited by the time of the capture or the encoding.
+        BACKLOG,      // The interval is increased because the outgoing data is not sent.
+        IDLE          // The interval is increased because the screen does not change.
+    };
+
+    struct Counters
+    {
+        // Smoothed times of the stages.
+        std::chrono::microseconds capture_time{ 0 };
+        std::chrono::microseconds encode_time{ 0 };
+
+        // Size of the outgoing data which is not sent yet.
+        int64_t pending_bytes = 0;
+
+        // Current interval between the captures and the reason why it was chosen.
+        std::chrono::milliseconds interval{ 0 };
+        Reason reason = Reason::MIN_INTERVAL;
+
+        // Number of intervals chosen for each reason.
+        uint64_t min_interval_count = 0;
+        uint64_t cpu_count = 0;
+        uint64_t backlog_count = 0;
+        uint64_t idle_count = 0;
+    };
+
     void beginCapture();
-    void endCapture();
+
+    // |has_changes| tells whether the captured frame contains any changes.
+    void endCapture(bool has_changes);
+
+    // Returns the delay from the current moment to the next capture.
     std::chrono::milliseconds nextCaptureDelay() const;
 
+    // Leaves the idle mode. Called when the user input arrives and the screen is likely to
+    // change soon. If the idle mode was active, the next capture is due immediately.
+    void wakeUp();
+
+    // Reports the time of encoding of one frame.
+    void addEncodeTime(const std::chrono::microseconds& encode_time);
+
+    // Reports the size of the outgoing data which is not sent yet.
+    void setPendingBytes(int64_t pending_bytes);
+
+    Counters counters() const;
+
 private:
-    std::chrono::milliseconds update_interval_;
+    void addCaptureTime(const std::chrono::microseconds& capture_time);
+    void updateInterval();
+
+    const std::chrono::milliseconds min_interval_;
+
+    // The interval chosen by the load, without the idle mode.
+    std::chrono::milliseconds active_interval_;
+    Reason active_reason_ = Reason::MIN_INTERVAL;
+
+    // The interval in the idle mode.
+    std::chrono::milliseconds idle_interval_;
+
+    // Number of the captured frames without changes in a row.
+    int empty_frames_ = 0;
+
+    // The next capture is due immediately after leaving the idle mode.
+    bool capture_now_ = false;
+
     std::chrono::time_point<std::chrono::high_resolution_clock> begin_time_;
     std::chrono::time_point<std::chrono::high_resolution_clock> end_time_;
 
+    // Smoothed times of the stages in microseconds.
+    double capture_time_ = 0;
+    double encode_time_ = 0;
+
+    Counters counters_;
+
+    mutable std::mutex lock_;
+
     DISALLOW_COPY_AND_ASSIGN(CaptureScheduler);
 };
 
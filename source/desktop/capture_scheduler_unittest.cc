@@ -0,0 +1,178 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "desktop/capture_scheduler.h"
+
+#include <gtest/gtest.h>
+
+namespace desktop {
+
+namespace {
+
+void runCaptures(CaptureScheduler* scheduler, int count, bool has_changes = true)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        scheduler->beginCapture();
+        scheduler->endCapture(has_changes);
+    }
+}
+
+} // namespace
+
+TEST(CaptureSchedulerTest, MinInterval)
+{
+    CaptureScheduler scheduler(std::chrono::milliseconds(30));
+
+    runCaptures(&scheduler, 10);
+
+    CaptureScheduler::Counters counters = scheduler.counters();
+    EXPECT_EQ(counters.interval, std::chrono::milliseconds(30));
+    EXPECT_EQ(counters.reason, CaptureScheduler::Reason::MIN_INTERVAL);
+    EXPECT_EQ(counters.min_interval_count, 10);
+    EXPECT_LE(scheduler.nextCaptureDelay(), std::chrono::milliseconds(30));
+}
+
+TEST(CaptureSchedulerTest, SlowEncoding)
+{
+    CaptureScheduler scheduler(std::chrono::milliseconds(30));
+
+    for (int i = 0; i < 100; ++i)
+    {
+        scheduler.addEncodeTime(std::chrono::milliseconds(80));
+        runCaptures(&scheduler, 1);
+    }
+
+    CaptureScheduler::Counters counters = scheduler.counters();
+    EXPECT_EQ(counters.reason, CaptureScheduler::Reason::CPU);
+    EXPECT_GE(counters.interval, std::chrono::milliseconds(80));
+    EXPECT_LE(counters.interval, std::chrono::milliseconds(110));
+    EXPECT_GT(counters.cpu_count, 0);
+
+    // The encoding became fast again. The interval returns to the minimum.
+    for (int i = 0; i < 100; ++i)
+    {
+        scheduler.addEncodeTime(std::chrono::milliseconds(1));
+        runCaptures(&scheduler, 1);
+    }
+
+    counters = scheduler.counters();
+    EXPECT_EQ(counters.interval, std::chrono::milliseconds(30));
+    EXPECT_EQ(counters.reason, CaptureScheduler::Reason::MIN_INTERVAL);
+}
+
+TEST(CaptureSchedulerTest, Backlog)
+{
+    CaptureScheduler scheduler(std::chrono::milliseconds(30));
+
+    scheduler.setPendingBytes(8 * 1024 * 1024);
+    runCaptures(&scheduler, 1);
+
+    CaptureScheduler::Counters counters = scheduler.counters();
+    EXPECT_EQ(counters.interval, std::chrono::milliseconds(60));
+    EXPECT_EQ(counters.reason, CaptureScheduler::Reason::BACKLOG);
+
+    runCaptures(&scheduler, 10);
+    EXPECT_EQ(scheduler.counters().interval, std::chrono::milliseconds(1000));
+
+    // The backlog is partially sent. The interval does not change.
+    scheduler.setPendingBytes(512 * 1024);
+    runCaptures(&scheduler, 1);
+    EXPECT_EQ(scheduler.counters().interval, std::chrono::milliseconds(1000));
+
+    // The backlog is sent. The interval decreases gradually.
+    scheduler.setPendingBytes(0);
+    runCaptures(&scheduler, 1);
+    EXPECT_EQ(scheduler.counters().interval, std::chrono::milliseconds(750));
+    EXPECT_EQ(scheduler.counters().reason, CaptureScheduler::Reason::BACKLOG);
+
+    runCaptures(&scheduler, 20);
+    EXPECT_EQ(scheduler.counters().interval, std::chrono::milliseconds(30));
+    EXPECT_EQ(scheduler.counters().reason, CaptureScheduler::Reason::MIN_INTERVAL);
+}
+
+TEST(CaptureSchedulerTest, BacklogWatermarks)
+{
+    CaptureScheduler scheduler(std::chrono::milliseconds(30));
+
+    // The host still encodes new frames below the high watermark.
+    scheduler.setPendingBytes(CaptureScheduler::kBacklogHighBytes - 1);
+    runCaptures(&scheduler, 1);
+    EXPECT_EQ(scheduler.counters().interval, std::chrono::milliseconds(30));
+    EXPECT_EQ(scheduler.counters().reason, CaptureScheduler::Reason::MIN_INTERVAL);
+
+    // The host stops encoding at the high watermark, the captures become less frequent.
+    scheduler.setPendingBytes(CaptureScheduler::kBacklogHighBytes);
+    runCaptures(&scheduler, 1);
+    EXPECT_EQ(scheduler.counters().interval, std::chrono::milliseconds(60));
+    EXPECT_EQ(scheduler.counters().reason, CaptureScheduler::Reason::BACKLOG);
+
+    // The host is still blocked above the low watermark.
+    scheduler.setPendingBytes(CaptureScheduler::kBacklogLowBytes + 1);
+    runCaptures(&scheduler, 1);
+    EXPECT_EQ(scheduler.counters().interval, std::chrono::milliseconds(60));
+
+    // The host resumes the encoding at the low watermark.
+    scheduler.setPendingBytes(CaptureScheduler::kBacklogLowBytes);
+    runCaptures(&scheduler, 1);
+    EXPECT_EQ(scheduler.counters().interval, std::chrono::milliseconds(45));
+}
+
+TEST(CaptureSchedulerTest, Idle)
+{
+    CaptureScheduler scheduler(std::chrono::milliseconds(30));
+
+    runCaptures(&scheduler, 29, false);
+    EXPECT_EQ(scheduler.counters().interval, std::chrono::milliseconds(30));
+    EXPECT_EQ(scheduler.counters().reason, CaptureScheduler::Reason::MIN_INTERVAL);
+
+    runCaptures(&scheduler, 1, false);
+    EXPECT_EQ(scheduler.counters().interval, std::chrono::milliseconds(45));
+    EXPECT_EQ(scheduler.counters().reason, CaptureScheduler::Reason::IDLE);
+
+    runCaptures(&scheduler, 20, false);
+    EXPECT_EQ(scheduler.counters().interval, std::chrono::milliseconds(500));
+    EXPECT_EQ(scheduler.counters().idle_count, 21);
+
+    // The user input returns the interval and the screen is captured right away.
+    scheduler.wakeUp();
+    EXPECT_EQ(scheduler.counters().interval, std::chrono::milliseconds(30));
+    EXPECT_EQ(scheduler.counters().reason, CaptureScheduler::Reason::MIN_INTERVAL);
+    EXPECT_EQ(scheduler.nextCaptureDelay(), std::chrono::milliseconds::zero());
+
+    runCaptures(&scheduler, 29, false);
+    EXPECT_EQ(scheduler.counters().reason, CaptureScheduler::Reason::MIN_INTERVAL);
+
+    // Any change leaves the idle mode too.
+    runCaptures(&scheduler, 1, true);
+    runCaptures(&scheduler, 29, false);
+    EXPECT_EQ(scheduler.counters().reason, CaptureScheduler::Reason::MIN_INTERVAL);
+}
+
+TEST(CaptureSchedulerTest, WakeUpWithoutIdle)
+{
+    CaptureScheduler scheduler(std::chrono::milliseconds(1000));
+
+    runCaptures(&scheduler, 1);
+
+    // Outside of the idle mode the input does not change the pacing.
+    scheduler.wakeUp();
+    EXPECT_GT(scheduler.nextCaptureDelay(), std::chrono::milliseconds(500));
+}
+
+} // namespace desktop
@@ -56,6 +56,37 @@ void Frame::copyPixelsFrom(const Frame& src_frame, const Point& src_pos, const R
     copyPixelsFrom(src_frame.frameDataAtPos(src_pos), src_frame.stride(), dest_rect);
 }
 
+void Frame::copyPixelsWithin(const Point& src_pos, const Rect& dest_rect)
+{
+    const Rect frame_rect = Rect::makeSize(size());
+
+    CHECK(frame_rect.containsRect(dest_rect));
+    CHECK(frame_rect.containsRect(Rect::makeXYWH(src_pos, dest_rect.size())));
+
+    size_t bytes_per_row = format_.bytesPerPixel() * dest_rect.width();
+
+    if (src_pos.y() >= dest_rect.y())
+    {
+        // The rows are copied from top to bottom, so the source rows are read before they are
+        // overwritten.
+        for (int y = 0; y < dest_rect.height(); ++y)
+        {
+            memmove(frameDataAtPos(dest_rect.x(), dest_rect.y() + y),
+                    frameDataAtPos(src_pos.x(), src_pos.y() + y),
+                    bytes_per_row);
+        }
+    }
+    else
+    {
+        for (int y = dest_rect.height() - 1; y >= 0; --y)
+        {
+            memmove(frameDataAtPos(dest_rect.x(), dest_rect.y() + y),
+                    frameDataAtPos(src_pos.x(), src_pos.y() + y),
+                    bytes_per_row);
+        }
+    }
+}
+
 uint8_t* Frame::frameDataAtPos(const Point& pos) const
 {
     return frameDataAtPos(pos.x(), pos.y());
@@ -42,6 +42,9 @@ public:
     void copyPixelsFrom(const uint8_t* src_buffer, int src_stride, const Rect& dest_rect);
     void copyPixelsFrom(const Frame& src_frame, const Point& src_pos, const Rect& dest_rect);
 
+    // Copies the pixels from |src_pos| to |dest_rect| within the frame. The areas may overlap.
+    void copyPixelsWithin(const Point& src_pos, const Rect& dest_rect);
+
     const Region& constUpdatedRegion() const { return updated_region_; }
     Region* updatedRegion() { return &updated_region_; }
 
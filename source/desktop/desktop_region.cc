@@ -20,6 +20,7 @@
 
 #include <assert.h>
 #include <algorithm>
+#include <limits>
 
 namespace desktop {
 
@@ -29,19 +30,6 @@ Region::RowSpan::RowSpan(int32_t left, int32_t right)
     // Nothing
 }
 
-Region::Row::Row(const Row&) = default;
-Region::Row::Row(Row&&) noexcept = default;
-
-Region::Row::Row(int32_t top, int32_t bottom) :
-    top(top), bottom(bottom)
-{
-    // Nothing
-}
-
-Region::Row::~Row() = default;
-
-Region::Row& Region::Row::operator=(const Row& other) = default;
-
 Region::Region() = default;
 
 Region::Region(const Rect& rect)
@@ -54,70 +42,46 @@ Region::Region(const Rect* rects, int count)
     addRects(rects, count);
 }
 
-Region::Region(const Region& other)
-{
-    *this = other;
-}
-
-Region::~Region()
-{
-    clear();
-}
-
-Region& Region::operator=(const Region& other)
-{
-    if (this == &other)
-        return *this;
+Region::Region(const Region& other) = default;
 
-    clear();
-    rows_ = other.rows_;
+Region::~Region() = default;
 
-    for (Rows::iterator it = rows_.begin(); it != rows_.end(); ++it)
-    {
-        // Copy each row.
-        Row* row = it->second;
-        it->second = new Row(*row);
-    }
-
-    return *this;
-}
+Region& Region::operator=(const Region& other) = default;
 
 bool Region::equals(const Region& region) const
 {
-    // Iterate over rows of the tow regions and compare each row.
-    Rows::const_iterator it1 = rows_.begin();
-    Rows::const_iterator it2 = region.rows_.begin();
+    if (rows_.size() != region.rows_.size())
+        return false;
 
-    while (it1 != rows_.end())
+    // Iterate over rows of the tow regions and compare each row.
+    for (size_t i = 0; i < rows_.size(); ++i)
     {
-        if (it2 == region.rows_.end() || it1->first != it2->first)
-            return false;
+        const Row& row1 = rows_[i];
+        const Row& row2 = region.rows_[i];
 
-        const Row* row1 = it1->second;
-        const Row* row2 = it2->second;
-
-        if (row1->top != row2->top ||
-            row1->bottom != row2->bottom ||
-            row1->spans != row2->spans)
+        if (row1.top != row2.top ||
+            row1.bottom != row2.bottom ||
+            row1.span_count != row2.span_count)
         {
             return false;
         }
 
-        ++it1;
-        ++it2;
+        if (!std::equal(spans_.begin() + row1.first_span,
+                        spans_.begin() + row1.first_span + row1.span_count,
+                        region.spans_.begin() + row2.first_span))
+        {
+            return false;
+        }
     }
 
-    return it2 == region.rows_.end();
+    return true;
 }
 
 void Region::clear()
 {
-    for (Rows::iterator row = rows_.begin(); row != rows_.end(); ++row)
-    {
-        delete row->second;
-    }
-
     rows_.clear();
+    spans_.clear();
+    compaction_threshold_ = 0;
 }
 
 void Region::setRect(const Rect& rect)
@@ -133,60 +97,69 @@ void Region::addRect(const Rect& rect)
 
     // Top of the part of the |rect| that hasn't been inserted yet. Increased as
     // we iterate over the rows until it reaches |rect.bottom()|.
-    int top = rect.top();
+    int32_t top = rect.top();
 
     // Iterate over all rows that may intersect with |rect| and add new rows when
     // necessary.
-    Rows::iterator row = rows_.upper_bound(top);
+    size_t row = std::upper_bound(
+        rows_.begin(), rows_.end(), top,
+        [](int32_t value, const Row& row) { return value < row.bottom; }) - rows_.begin();
+
     while (top < rect.bottom())
     {
-        if (row == rows_.end() || top < row->second->top)
+        if (row == rows_.size() || top < rows_[row].top)
         {
             // If |top| is above the top of the current |row| then add a new row above
             // the current one.
             int32_t bottom = rect.bottom();
 
-            if (row != rows_.end() && row->second->top < bottom)
-                bottom = row->second->top;
+            if (row != rows_.size() && rows_[row].top < bottom)
+                bottom = rows_[row].top;
 
-            row = rows_.insert(row, Rows::value_type(bottom, new Row(top, bottom)));
+            rows_.insert(row, Row{ top, bottom, static_cast<uint32_t>(spans_.size()), 0 });
         }
-        else if (top > row->second->top)
+        else if (top > rows_[row].top)
         {
             // If the |top| falls in the middle of the |row| then split |row| into
             // two, at |top|, and leave |row| referring to the lower of the two,
-            // ready to insert a new span into.
-            assert(top <= row->second->bottom);
-            Rows::iterator new_row =
-                rows_.insert(row, Rows::value_type(top, new Row(row->second->top, top)));
-            row->second->top = top;
-            new_row->second->spans = row->second->spans;
+            // ready to insert a new span into. Both rows share the same spans.
+            assert(top <= rows_[row].bottom);
+
+            Row upper_row = rows_[row];
+            upper_row.bottom = top;
+            rows_[row].top = top;
+
+            rows_.insert(row, upper_row);
+            ++row;
         }
 
-        if (rect.bottom() < row->second->bottom)
+        if (rect.bottom() < rows_[row].bottom)
         {
             // If the bottom of the |rect| falls in the middle of the |row| split
             // |row| into two, at |top|, and leave |row| referring to the upper of
             // the two, ready to insert a new span into.
-            Rows::iterator new_row =
-                rows_.insert(row, Rows::value_type(rect.bottom(), new Row(top, rect.bottom())));
-            row->second->top = rect.bottom();
-            new_row->second->spans = row->second->spans;
-            row = new_row;
+            Row upper_row = rows_[row];
+            upper_row.top = top;
+            upper_row.bottom = rect.bottom();
+            rows_[row].top = rect.bottom();
+
+            rows_.insert(row, upper_row);
         }
 
         // Add a new span to the current row.
-        addSpanToRow(row->second, rect.left(), rect.right());
-        top = row->second->bottom;
+        addSpanToRow(&rows_[row], rect.left(), rect.right());
+        top = rows_[row].bottom;
 
-        mergeWithPrecedingRow(row);
+        row = mergeWithPrecedingRow(row);
 
         // Move to the next row.
         ++row;
     }
 
-    if (row != rows_.end())
+    if (row != rows_.size())
         mergeWithPrecedingRow(row);
+
+    compactSpansIfNeeded();
 }
 
 void Region::addRects(const Rect* rects, int count)
@@ -197,106 +170,335 @@ void Region::addRects(const Rect* rects, int count)
     }
 }
 
-void Region::mergeWithPrecedingRow(Rows::iterator row_it)
+void Region::addRegion(const Region& region)
 {
-    assert(row_it != rows_.end());
+    if (region.isEmpty() || this == &region)
+        return;
 
-    if (row_it != rows_.begin())
+    if (isEmpty())
     {
-        Rows::iterator previous_row_it = row_it;
-        --previous_row_it;
+        *this = region;
+        return;
+    }
 
-        Row* previous_row = previous_row_it->second;
-        Row* row = row_it->second;
+    combineWith(region.view(), Operation::UNION);
+}
 
-        // If |row| and |previous_row| are next to each other and contain the same
-        // set of spans then they can be merged.
-        if (previous_row->bottom == row->top &&
-            previous_row->spans == row->spans)
-        {
-            row->top = previous_row->top;
-            delete previous_row;
-            rows_.erase(previous_row_it);
-        }
+void Region::intersect(const Region& region1, const Region& region2)
+{
+    clear();
+
+    if (region1.isEmpty() || region2.isEmpty())
+        return;
+
+    combine(region1.view(), region2.view(), Operation::INTERSECT);
+}
+
+void Region::intersectWith(const Region& region)
+{
+    if (this == &region || isEmpty())
+        return;
+
+    if (region.isEmpty())
+    {
+        clear();
+        return;
     }
+
+    combineWith(region.view(), Operation::INTERSECT);
 }
 
-void Region::addRegion(const Region& region)
+void Region::intersectWith(const Rect& rect)
 {
-    // TODO(sergeyu): This function is not optimized - potentially it can iterate
-    // over rows of the two regions similar to how it works in Intersect().
-    for (Iterator it(region); !it.isAtEnd(); it.advance())
+    if (isEmpty())
+        return;
+
+    if (rect.isEmpty())
     {
-        addRect(it.rect());
+        clear();
+        return;
     }
+
+    Row rect_row;
+    RowSpan rect_span;
+
+    combineWith(rectView(rect, &rect_row, &rect_span), Operation::INTERSECT);
 }
 
-void Region::intersect(const Region& region1, const Region& region2)
+void Region::subtract(const Region& region)
 {
-    clear();
+    if (this == &region)
+    {
+        clear();
+        return;
+    }
 
-    Rows::const_iterator it1 = region1.rows_.begin();
-    Rows::const_iterator end1 = region1.rows_.end();
-    Rows::const_iterator it2 = region2.rows_.begin();
-    Rows::const_iterator end2 = region2.rows_.end();
+    if (region.isEmpty() || isEmpty())
+        return;
+
+    combineWith(region.view(), Operation::SUBTRACT);
+}
 
-    if (it1 == end1 || it2 == end2)
+void Region::subtract(const Rect& rect)
+{
+    if (rect.isEmpty() || isEmpty())
         return;
 
-    while (it1 != end1 && it2 != end2)
+    Row rect_row;
+    RowSpan rect_span;
+
+    combineWith(rectView(rect, &rect_row, &rect_span), Operation::SUBTRACT);
+}
+
+void Region::translate(int32_t dx, int32_t dy)
+{
+    for (Row& row : rows_)
+    {
+        row.top += dy;
+        row.bottom += dy;
+    }
+
+    if (dx != 0)
     {
-        // Arrange for |it1| to always be the top-most of the rows.
-        if (it2->second->top < it1->second->top)
+        // Translate each span.
+        for (RowSpan& span : spans_)
         {
-            std::swap(it1, it2);
-            std::swap(end1, end2);
+            span.left += dx;
+            span.right += dx;
         }
+    }
+}
 
-        // Skip |it1| if it doesn't intersect |it2| at all.
-        if (it1->second->bottom <= it2->second->top)
+void Region::swap(Region* region)
+{
+    std::swap(rows_, region->rows_);
+    std::swap(spans_, region->spans_);
+    std::swap(compaction_threshold_, region->compaction_threshold_);
+}
+
+Region::RowsView Region::view() const
+{
+    return RowsView{ rows_.data(), rows_.size(), spans_.data() };
+}
+
+// static
+Region::RowsView Region::rectView(const Rect& rect, Row* row, RowSpan* span)
+{
+    *span = RowSpan(rect.left(), rect.right());
+    *row = Row{ rect.top(), rect.bottom(), 0, 1 };
+
+    return RowsView{ row, 1, span };
+}
+
+// static
+bool Region::compareSpanRight(const RowSpan& r, int32_t value)
+{
+    return r.right < value;
+}
+
+// static
+bool Region::compareSpanLeft(const RowSpan& r, int32_t value)
+{
+    return r.left < value;
+}
+
+void Region::addSpanToRow(Row* row, int32_t left, int32_t right)
+{
+    const size_t first = row->first_span;
+    const size_t count = row->span_count;
+
+    // First check if the new span is located to the right of all existing spans.
+    // This is an optimization to avoid binary search in the case when rectangles
+    // are inserted sequentially from left to right.
+    if (count == 0 || left > spans_[first + count - 1].right)
+    {
+        if (count == 0 || first + count == spans_.size())
         {
-            ++it1;
+            // The spans of the row are at the end of the buffer and the new span can be just
+            // appended. Other rows sharing the spans are not affected because they do not
+            // refer to the spans after their own.
+            if (count == 0)
+                row->first_span = static_cast<uint32_t>(spans_.size());
+
+            spans_.push_back(RowSpan(left, right));
+            ++row->span_count;
+            return;
+        }
+    }
+
+    // Copy the spans of the row to the end of the buffer combining them with the new span.
+    // The buffer may be reallocated, so the spans are accessed by their indexes.
+    const size_t new_first = spans_.size();
+    const RowSpan new_span(left, right);
+    bool inserted = false;
+
+    for (size_t i = first; i < first + count; ++i)
+    {
+        const RowSpan span = spans_[i];
+
+        if (span.right < new_span.left)
+        {
+            spans_.push_back(span);
             continue;
         }
 
-        // Top of the |it1| row is above the top of |it2|, so top of the
-        // intersection is always the top of |it2|.
-        int32_t top = it2->second->top;
-        int32_t bottom = std::min(it1->second->bottom, it2->second->bottom);
+        if (!inserted)
+        {
+            spans_.push_back(new_span);
+            inserted = true;
+        }
 
-        Rows::iterator new_row =
-            rows_.insert(rows_.end(), Rows::value_type(bottom, new Row(top, bottom)));
+        RowSpan& last = spans_.back();
 
-        intersectRows(it1->second->spans, it2->second->spans, new_row->second->spans);
-        if (new_row->second->spans.empty())
+        if (span.left <= last.right)
         {
-            delete new_row->second;
-            rows_.erase(new_row);
+            // The spans overlap or touch each other.
+            last.left = std::min(last.left, span.left);
+            last.right = std::max(last.right, span.right);
         }
         else
         {
-            mergeWithPrecedingRow(new_row);
+            spans_.push_back(span);
         }
+    }
 
-        // If |it1| was completely consumed, move to the next one.
-        if (it1->second->bottom == bottom)
-            ++it1;
-        // If |it2| was completely consumed, move to the next one.
-        if (it2->second->bottom == bottom)
-            ++it2;
+    if (!inserted)
+        spans_.push_back(new_span);
+
+    row->first_span = static_cast<uint32_t>(new_first);
+    row->span_count = static_cast<uint32_t>(spans_.size() - new_first);
+}
+
+bool Region::isSameSpans(const Row& row1, const Row& row2) const
+{
+    if (row1.span_count != row2.span_count)
+        return false;
+
+    if (row1.first_span == row2.first_span)
+        return true;
+
+    return std::equal(spans_.begin() + row1.first_span,
+                      spans_.begin() + row1.first_span + row1.span_count,
+                      spans_.begin() + row2.first_span);
+}
+
+size_t Region::mergeWithPrecedingRow(size_t index)
+{
+    assert(index < rows_.size());
+
+    if (index == 0)
+        return index;
+
+    const Row& previous_row = rows_[index - 1];
+    Row& row = rows_[index];
+
+    // If |row| and |previous_row| are next to each other and contain the same
+    // set of spans then they can be merged.
+    if (previous_row.bottom == row.top && isSameSpans(previous_row, row))
+    {
+        row.top = previous_row.top;
+        rows_.erase(index - 1);
+        return index - 1;
+    }
+
+    return index;
+}
+
+void Region::compactSpansIfNeeded()
+{
+    static const size_t kMinCompactionThreshold = 64;
+
+    if (spans_.size() < compaction_threshold_)
+        return;
+
+    size_t used_spans = 0;
+    for (const Row& row : rows_)
+        used_spans += row.span_count;
+
+    if (used_spans * 2 < spans_.size())
+    {
+        // Copy the spans of the rows to a new buffer in the order of the rows.
+        RowSpanSet spans;
+        spans.reserve(used_spans);
+
+        for (Row& row : rows_)
+        {
+            const size_t first = spans.size();
+
+            for (size_t i = row.first_span; i < row.first_span + row.span_count; ++i)
+                spans.push_back(spans_[i]);
+
+            row.first_span = static_cast<uint32_t>(first);
+        }
+
+        spans_ = std::move(spans);
     }
+
+    compaction_threshold_ = std::max(spans_.size() * 2, kMinCompactionThreshold);
+}
+
+bool Region::isSpanInRow(const Row& row, const RowSpan& span) const
+{
+    const RowSpan* begin = spans_.data() + row.first_span;
+    const RowSpan* end = begin + row.span_count;
+
+    // Find the first span that starts at or after |span.left| and then check if
+    // it's the same span.
+    const RowSpan* it = std::lower_bound(begin, end, span.left, compareSpanLeft);
+
+    return it != end && *it == span;
 }
 
 // static
-void Region::intersectRows(const RowSpanSet& set1, const RowSpanSet& set2, RowSpanSet& output)
+void Region::unionRows(const RowSpan* set1, size_t count1,
+                       const RowSpan* set2, size_t count2,
+                       RowSpanSet& output)
 {
-    RowSpanSet::const_iterator it1 = set1.begin();
-    RowSpanSet::const_iterator end1 = set1.end();
-    RowSpanSet::const_iterator it2 = set2.begin();
-    RowSpanSet::const_iterator end2 = set2.end();
-    assert(it1 != end1 && it2 != end2);
+    const RowSpan* end1 = set1 + count1;
+    const RowSpan* end2 = set2 + count2;
 
-    do
+    bool has_span = false;
+    RowSpan current;
+
+    while (set1 != end1 || set2 != end2)
+    {
+        // Take the left-most of the spans.
+        const RowSpan* next;
+
+        if (set2 == end2 || (set1 != end1 && set1->left <= set2->left))
+            next = set1++;
+        else
+            next = set2++;
+
+        if (has_span && next->left <= current.right)
+        {
+            // The spans overlap or touch each other.
+            current.right = std::max(current.right, next->right);
+            continue;
+        }
+
+        if (has_span)
+            output.push_back(current);
+
+        current = *next;
+        has_span = true;
+    }
+
+    if (has_span)
+        output.push_back(current);
+}
+
+// static
+void Region::intersectRows(const RowSpan* set1, size_t count1,
+                           const RowSpan* set2, size_t count2,
+                           RowSpanSet& output)
+{
+    const RowSpan* it1 = set1;
+    const RowSpan* end1 = set1 + count1;
+    const RowSpan* it2 = set2;
+    const RowSpan* end2 = set2 + count2;
+
+    while (it1 != end1 && it2 != end2)
     {
         // Arrange for |it1| to always be the left-most of the spans.
         if (it2->left < it1->left)
@@ -316,7 +518,7 @@ void Region::intersectRows(const RowSpanSet& set1, const RowSpanSet& set2, RowSp
         int32_t right = std::min(it1->right, it2->right);
         assert(left < right);
 
-        output.emplace_back(left, right);
+        output.push_back(RowSpan(left, right));
 
         // If |it1| was completely consumed, move to the next one.
         if (it1->right == right)
@@ -325,313 +527,262 @@ void Region::intersectRows(const RowSpanSet& set1, const RowSpanSet& set2, RowSp
         if (it2->right == right)
             ++it2;
     }
-    while (it1 != end1 && it2 != end2);
 }
 
-void Region::intersectWith(const Region& region)
-{
-    Region old_region;
-    swap(&old_region);
-    intersect(old_region, region);
-}
-
-void Region::intersectWith(const Rect& rect)
-{
-    Region region;
-    region.addRect(rect);
-    intersectWith(region);
-}
-
-void Region::subtract(const Region& region)
+// static
+void Region::subtractRows(const RowSpan* set_a, size_t count_a,
+                          const RowSpan* set_b, size_t count_b,
+                          RowSpanSet& output)
 {
-    if (region.rows_.empty())
-        return;
-
-    // |row_b| refers to the current row being subtracted.
-    Rows::const_iterator row_b = region.rows_.begin();
-
-    // Current vertical position at which subtraction is happening.
-    int top = row_b->second->top;
+    const RowSpan* it_b = set_b;
+    const RowSpan* end_b = set_b + count_b;
 
-  // |row_a| refers to the current row we are subtracting from. Skip all rows
-  // above |top|.
-  Rows::iterator row_a = rows_.upper_bound(top);
-
-    // Step through rows of the both regions subtracting content of |row_b| from
-    // |row_a|.
-    while (row_a != rows_.end() && row_b != region.rows_.end())
+    // Iterate over all spans in |set_a| adding parts of it that do not intersect
+    // with |set_b| to the |output|.
+    for (const RowSpan* it_a = set_a; it_a != set_a + count_a; ++it_a)
     {
-        // Skip |row_a| if it doesn't intersect with the |row_b|.
-        if (row_a->second->bottom <= top)
+        // If there is no intersection then append the current span and continue.
+        if (it_b == end_b || it_a->right < it_b->left)
         {
-            // Each output row is merged with previously-processed rows before further
-            // rows are processed.
-            mergeWithPrecedingRow(row_a);
-            ++row_a;
+            output.push_back(*it_a);
             continue;
         }
 
-        if (top > row_a->second->top)
-        {
-            // If |top| falls in the middle of |row_a| then split |row_a| into two, at
-            // |top|, and leave |row_a| referring to the lower of the two, ready to
-            // subtract spans from.
-            assert(top <= row_a->second->bottom);
-            Rows::iterator new_row =
-                rows_.insert(row_a, Rows::value_type(top, new Row(row_a->second->top, top)));
-
-            row_a->second->top = top;
-            new_row->second->spans = row_a->second->spans;
-        }
-        else if (top < row_a->second->top)
+        // Iterate over |set_b| spans that may intersect with |it_a|.
+        int pos = it_a->left;
+
+        while (it_b != end_b && it_b->left < it_a->right)
         {
-            // If the |top| is above |row_a| then skip the range between |top| and
-            // top of |row_a| because it's empty.
-            top = row_a->second->top;
-            if (top >= row_b->second->bottom)
+            if (it_b->left > pos)
+                output.push_back(RowSpan(pos, it_b->left));
+            if (it_b->right > pos)
             {
-                ++row_b;
-                if (row_b != region.rows_.end())
-                    top = row_b->second->top;
-                continue;
+                pos = it_b->right;
+                if (pos >= it_a->right)
+                    break;
             }
+            ++it_b;
         }
 
-        if (row_b->second->bottom < row_a->second->bottom)
-        {
-            // If the bottom of |row_b| falls in the middle of the |row_a| split
-            // |row_a| into two, at |top|, and leave |row_a| referring to the upper of
-            // the two, ready to subtract spans from.
-            int bottom = row_b->second->bottom;
-            Rows::iterator new_row =
-                rows_.insert(row_a, Rows::value_type(bottom, new Row(top, bottom)));
-            row_a->second->top = bottom;
-            new_row->second->spans = row_a->second->spans;
-            row_a = new_row;
-        }
+        if (pos < it_a->right)
+            output.push_back(RowSpan(pos, it_a->right));
+    }
+}
 
-        // At this point the vertical range covered by |row_a| lays within the
-        // range covered by |row_b|. Subtract |row_b| spans from |row_a|.
-        RowSpanSet new_spans;
-        subtractRows(row_a->second->spans, row_b->second->spans, new_spans);
-        new_spans.swap(row_a->second->spans);
-        top = row_a->second->bottom;
+void Region::combine(const RowsView& a, const RowsView& b, Operation operation)
+{
+    static const int32_t kMaxPosition = std::numeric_limits<int32_t>::max();
 
-        if (top >= row_b->second->bottom)
-        {
-            ++row_b;
-            if (row_b != region.rows_.end())
-                top = row_b->second->top;
-        }
+    const Row* row_a = a.rows;
+    const Row* end_a = a.rows + a.count;
+    const Row* row_b = b.rows;
+    const Row* end_b = b.rows + b.count;
+
+    // Current vertical position. Everything above it is already processed.
+    int32_t top = std::numeric_limits<int32_t>::min();
+
+    while (row_a != end_a || row_b != end_b)
+    {
+        const int32_t top_a = (row_a != end_a) ? std::max(row_a->top, top) : kMaxPosition;
+        const int32_t top_b = (row_b != end_b) ? std::max(row_b->top, top) : kMaxPosition;
+
+        // Skip the empty space above the rows.
+        top = std::min(top_a, top_b);
 
-        // Check if the row is empty after subtraction and delete it. Otherwise move
-        // to the next one.
-        if (row_a->second->spans.empty())
+        const bool in_a = (top_a == top);
+        const bool in_b = (top_b == top);
+
+        // The band ends where any of the current rows ends or the next row begins.
+        int32_t bottom = in_a ? row_a->bottom : top_a;
+        bottom = std::min(bottom, in_b ? row_b->bottom : top_b);
+
+        const RowSpan* spans_a = in_a ? a.spans + row_a->first_span : nullptr;
+        const size_t count_a = in_a ? row_a->span_count : 0;
+        const RowSpan* spans_b = in_b ? b.spans + row_b->first_span : nullptr;
+        const size_t count_b = in_b ? row_b->span_count : 0;
+
+        const size_t first_span = spans_.size();
+
+        switch (operation)
         {
-            Rows::iterator row_to_delete = row_a;
-            ++row_a;
-            delete row_to_delete->second;
-            rows_.erase(row_to_delete);
+            case Operation::UNION:
+                unionRows(spans_a, count_a, spans_b, count_b, spans_);
+                break;
+
+            case Operation::INTERSECT:
+                intersectRows(spans_a, count_a, spans_b, count_b, spans_);
+                break;
+
+            case Operation::SUBTRACT:
+                subtractRows(spans_a, count_a, spans_b, count_b, spans_);
+                break;
         }
-        else
-        {
-            mergeWithPrecedingRow(row_a);
+
+        finishRow(top, bottom, first_span);
+
+        top = bottom;
+
+        // Move to the next rows if the current ones were completely consumed.
+        if (in_a && row_a->bottom == bottom)
             ++row_a;
-        }
+        if (in_b && row_b->bottom == bottom)
+            ++row_b;
     }
-
-    if (row_a != rows_.end())
-        mergeWithPrecedingRow(row_a);
 }
 
-void Region::subtract(const Rect& rect)
+void Region::combineWith(const RowsView& other, Operation operation)
 {
-    Region region;
-    region.addRect(rect);
-    subtract(region);
+    // The current content is moved to a temporary region which keeps its memory between
+    // the calls, and the result is built in place of it.
+    static thread_local Region old_region;
+
+    old_region.clear();
+    swap(&old_region);
+
+    combine(old_region.view(), other, operation);
 }
 
-void Region::translate(int32_t dx, int32_t dy)
+void Region::finishRow(int32_t top, int32_t bottom, size_t first_span)
 {
-    Rows new_rows;
+    const uint32_t span_count = static_cast<uint32_t>(spans_.size() - first_span);
+    if (!span_count)
+        return;
 
-    for (Rows::iterator it = rows_.begin(); it != rows_.end(); ++it)
+    if (!rows_.empty())
     {
-        Row* row = it->second;
-
-        row->top += dy;
-        row->bottom += dy;
-
-        if (dx != 0)
+        Row& previous_row = rows_.back();
+
+        // If the row and the preceding row are next to each other and contain the same set of
+        // spans then they can be merged.
+        if (previous_row.bottom == top &&
+            previous_row.span_count == span_count &&
+            std::equal(spans_.begin() + first_span, spans_.end(),
+                       spans_.begin() + previous_row.first_span))
         {
-            // Translate each span.
-            for (RowSpanSet::iterator span = row->spans.begin();
-                 span != row->spans.end(); ++span)
-            {
-                span->left += dx;
-                span->right += dx;
-            }
+            previous_row.bottom = bottom;
+            spans_.truncate(first_span);
+            return;
         }
-
-        if (dy != 0)
-            new_rows.insert(new_rows.end(), Rows::value_type(row->bottom, row));
     }
 
-    if (dy != 0)
-        new_rows.swap(rows_);
+    rows_.push_back(Row{ top, bottom, static_cast<uint32_t>(first_span), span_count });
 }
 
-void Region::swap(Region* region)
+Region::Builder::Builder(Region* region)
+    : region_(region),
+      top_(std::numeric_limits<int32_t>::min())
 {
-    rows_.swap(region->rows_);
+    region_->clear();
 }
 
-// static
-bool Region::compareSpanRight(const RowSpan& r, int32_t value)
+Region::Builder::~Builder()
 {
-    return r.right < value;
+    if (!finished_)
+        finish();
 }
 
-// static
-bool Region::compareSpanLeft(const RowSpan& r, int32_t value)
+void Region::Builder::addRect(const Rect& rect)
 {
-    return r.left < value;
-}
+    assert(!finished_);
 
-// static
-void Region::addSpanToRow(Row* row, int32_t left, int32_t right)
-{
-    // First check if the new span is located to the right of all existing spans.
-    // This is an optimization to avoid binary search in the case when rectangles
-    // are inserted sequentially from left to right.
-    if (row->spans.empty() || left > row->spans.back().right)
-    {
-        row->spans.emplace_back(left, right);
-        return;
-    }
-
-    // Find the first span that ends at or after |left|.
-    RowSpanSet::iterator start =
-        std::lower_bound(row->spans.begin(), row->spans.end(), left, compareSpanRight);
-    assert(start < row->spans.end());
-
-    // Find the first span that starts after |right|.
-    RowSpanSet::iterator end =
-        std::lower_bound(start, row->spans.end(), right + 1, compareSpanLeft);
-    if (end == row->spans.begin())
-    {
-        // There are no overlaps. Just insert the new span at the beginning.
-        row->spans.insert(row->spans.begin(), RowSpan(left, right));
+    if (rect.isEmpty())
         return;
-    }
 
-    // Move end to the left, so that it points the last span that ends at or
-    // before |right|.
-    --end;
+    // Rectangles must be sorted by their top edge.
+    assert(rect.top() >= top_);
 
-    // At this point [start, end] is the range of spans that intersect with the
-    // new one.
-    if (end < start)
-    {
-        // There are no overlaps. Just insert the new span at the correct position.
-        row->spans.insert(start, RowSpan(left, right));
-        return;
-    }
+    addRowsAbove(rect.top());
 
-    left = std::min(left, start->left);
-    right = std::max(right, end->right);
+    const ActiveRect active_rect = { rect.left(), rect.right(), rect.bottom() };
 
-    // Replace range [start, end] with the new span.
-    *start = RowSpan(left, right);
-    ++start;
-    ++end;
-    if (start < end)
-        row->spans.erase(start, end);
+    active_.insert(std::upper_bound(active_.begin(), active_.end(), active_rect,
+                                    [](const ActiveRect& r1, const ActiveRect& r2)
+                                    {
+                                        return r1.left < r2.left;
+                                    }),
+                   active_rect);
 }
 
-// static
-bool Region::isSpanInRow(const Row& row, const RowSpan& span)
+void Region::Builder::finish()
 {
-    // Find the first span that starts at or after |span.left| and then check if
-    // it's the same span.
-    RowSpanSet::const_iterator it =
-        std::lower_bound(row.spans.begin(), row.spans.end(), span.left, compareSpanLeft);
+    assert(!finished_);
 
-    return it != row.spans.end() && *it == span;
+    addRowsAbove(std::numeric_limits<int32_t>::max());
+    finished_ = true;
 }
 
-// static
-void Region::subtractRows(const RowSpanSet& set_a, const RowSpanSet& set_b, RowSpanSet& output)
+void Region::Builder::addRowsAbove(int32_t y)
 {
-    assert(!set_a.empty() && !set_b.empty());
-
-    RowSpanSet::const_iterator it_b = set_b.begin();
+    RowSpanSet& spans = region_->spans_;
 
-    // Iterate over all spans in |set_a| adding parts of it that do not intersect
-    // with |set_b| to the |output|.
-    for (RowSpanSet::const_iterator it_a = set_a.begin(); it_a != set_a.end(); ++it_a)
+    while (!active_.empty() && top_ < y)
     {
-        // If there is no intersection then append the current span and continue.
-        if (it_b == set_b.end() || it_a->right < it_b->left)
-        {
-            output.emplace_back(*it_a);
-            continue;
-        }
+        // The row ends where any of the active rectangles ends.
+        int32_t bottom = y;
+        for (const ActiveRect& active_rect : active_)
+            bottom = std::min(bottom, active_rect.bottom);
 
-        // Iterate over |set_b| spans that may intersect with |it_a|.
-        int pos = it_a->left;
+        const size_t first_span = spans.size();
 
-        while (it_b != set_b.end() && it_b->left < it_a->right)
+        // The rectangles are sorted by the left edge, so their spans can be merged in one pass.
+        for (const ActiveRect& active_rect : active_)
         {
-            if (it_b->left > pos)
-                output.emplace_back(pos, it_b->left);
-            if (it_b->right > pos)
-            {
-                pos = it_b->right;
-                if (pos >= it_a->right)
-                    break;
-            }
-            ++it_b;
+            if (spans.size() > first_span && active_rect.left <= spans.back().right)
+                spans.back().right = std::max(spans.back().right, active_rect.right);
+            else
+                spans.push_back(RowSpan(active_rect.left, active_rect.right));
         }
 
-        if (pos < it_a->right)
-            output.emplace_back(pos, it_a->right);
+        region_->finishRow(top_, bottom, first_span);
+        top_ = bottom;
+
+        active_.erase(std::remove_if(active_.begin(), active_.end(),
+                                     [bottom](const ActiveRect& active_rect)
+                                     {
+                                         return active_rect.bottom <= bottom;
+                                     }),
+                      active_.end());
     }
+
+    top_ = std::max(top_, y);
 }
 
 Region::Iterator::Iterator(const Region& region)
     : region_(region),
-      row_(region.rows_.begin()),
-      previous_row_(region.rows_.end())
+      row_(0),
+      previous_row_(region.rows_.size()),
+      row_span_(0)
 {
     if (!isAtEnd())
     {
-        assert(row_->second->spans.size() > 0);
-        row_span_ = row_->second->spans.begin();
+        assert(region_.rows_[row_].span_count > 0);
+        row_span_ = region_.rows_[row_].first_span;
         updateCurrentRect();
     }
 }
 
 bool Region::Iterator::isAtEnd() const
 {
-    return row_ == region_.rows_.end();
+    return row_ == region_.rows_.size();
 }
 
 void Region::Iterator::advance()
 {
     assert(!isAtEnd());
 
+    const Rows& rows = region_.rows_;
+
     for (;;)
     {
         ++row_span_;
-        if (row_span_ == row_->second->spans.end())
+        if (row_span_ == rows[row_].first_span + rows[row_].span_count)
         {
             previous_row_ = row_;
             ++row_;
-            if (row_ != region_.rows_.end())
+            if (row_ != rows.size())
             {
-                assert(row_->second->spans.size() > 0);
-                row_span_ = row_->second->spans.begin();
+                assert(rows[row_].span_count > 0);
+                row_span_ = rows[row_].first_span;
             }
         }
 
@@ -641,9 +792,9 @@ void Region::Iterator::advance()
         // If the same span exists on the previous row then skip it, as we've
         // already returned this span merged into the previous one, via
         // UpdateCurrentRect().
-        if (previous_row_ != region_.rows_.end() &&
-            previous_row_->second->bottom == row_->second->top &&
-            isSpanInRow(*previous_row_->second, *row_span_))
+        if (previous_row_ != rows.size() &&
+            rows[previous_row_].bottom == rows[row_].top &&
+            region_.isSpanInRow(rows[previous_row_], region_.spans_[row_span_]))
         {
             continue;
         }
@@ -657,20 +808,23 @@ void Region::Iterator::advance()
 
 void Region::Iterator::updateCurrentRect()
 {
+    const Rows& rows = region_.rows_;
+    const RowSpan& span = region_.spans_[row_span_];
+
     // Merge the current rectangle with the matching spans from later rows.
     int bottom;
-    Rows::const_iterator bottom_row = row_;
-    Rows::const_iterator previous;
+    size_t bottom_row = row_;
+    size_t previous;
     do
     {
-        bottom = bottom_row->second->bottom;
+        bottom = rows[bottom_row].bottom;
         previous = bottom_row;
         ++bottom_row;
-    } while (bottom_row != region_.rows_.end() &&
-             previous->second->bottom == bottom_row->second->top &&
-             isSpanInRow(*bottom_row->second, *row_span_));
+    } while (bottom_row != rows.size() &&
+             rows[previous].bottom == rows[bottom_row].top &&
+             region_.isSpanInRow(rows[bottom_row], span));
 
-    rect_ = Rect::makeLTRB(row_span_->left, row_->second->top, row_span_->right, bottom);
+    rect_ = Rect::makeLTRB(span.left, rows[row_].top, span.right, bottom);
 }
 
 } // namespace desktop
@@ -21,7 +21,9 @@
 
 #include "desktop/desktop_geometry.h"
 
-#include <map>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
 #include <vector>
 
 namespace desktop {
@@ -30,6 +32,12 @@ namespace desktop {
 //
 // Internally each region is stored as a set of rows where each row contains one
 // or more rectangles aligned vertically.
+//
+// The rows are kept in one array sorted by their position and the spans of all rows are kept
+// in one shared buffer. The spans in the buffer are never modified: a row that gets new spans
+// appends them to the end of the buffer, so the rows split from one row can share their
+// spans. The unused spans are dropped when they make up most of the buffer. A region with
+// a single rectangle does not allocate memory at all.
 class Region
 {
 private:
@@ -39,9 +47,9 @@ private:
     // RowSpan represents a horizontal span withing a single row.
     struct RowSpan
     {
+        RowSpan() = default;
         RowSpan(int32_t left, int32_t right);
 
-        // Used by std::vector<>.
         bool operator==(const RowSpan& that) const
         {
             return left == that.left && right == that.right;
@@ -51,29 +59,167 @@ private:
         int32_t right;
     };
 
-    using RowSpanSet = std::vector<RowSpan>;
-
     // Row represents a single row of a region. A row is set of rectangles that
-    // have the same vertical position.
+    // have the same vertical position. The spans of the row are stored in |spans_| starting
+    // with the index |first_span|.
     struct Row
     {
-        Row(const Row&);
-        Row(Row&&) noexcept;
-        Row(int32_t top, int32_t bottom);
-        ~Row();
-
-        Row& operator=(const Row& other);
-
         int32_t top;
         int32_t bottom;
 
-        RowSpanSet spans;
+        uint32_t first_span;
+        uint32_t span_count;
+    };
+
+    // Growable array of trivially copyable elements which keeps up to |kInlineCapacity|
+    // elements without allocating memory. The capacity is kept when the array is cleared, so
+    // a region which is refilled does not allocate memory again.
+    template <typename T, size_t kInlineCapacity>
+    class FlatArray
+    {
+    public:
+        static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+
+        FlatArray() = default;
+        FlatArray(const FlatArray& other) { *this = other; }
+        FlatArray(FlatArray&& other) noexcept { moveFrom(other); }
+        ~FlatArray() { freeHeap(); }
+
+        FlatArray& operator=(const FlatArray& other)
+        {
+            if (this != &other)
+            {
+                size_ = 0;
+                reserve(other.size_);
+                copyElements(data_, other.data_, other.size_);
+                size_ = other.size_;
+            }
+
+            return *this;
+        }
+
+        FlatArray& operator=(FlatArray&& other) noexcept
+        {
+            if (this != &other)
+            {
+                freeHeap();
+                moveFrom(other);
+            }
+
+            return *this;
+        }
+
+        bool empty() const { return size_ == 0; }
+        size_t size() const { return size_; }
+
+        T* data() { return data_; }
+        const T* data() const { return data_; }
+
+        T* begin() { return data_; }
+        const T* begin() const { return data_; }
+        T* end() { return data_ + size_; }
+        const T* end() const { return data_ + size_; }
+
+        T& operator[](size_t index) { return data_[index]; }
+        const T& operator[](size_t index) const { return data_[index]; }
+
+        T& back() { return data_[size_ - 1]; }
+        const T& back() const { return data_[size_ - 1]; }
+
+        void clear() { size_ = 0; }
+
+        void push_back(const T& value)
+        {
+            if (size_ == capacity_)
+                reserve(capacity_ * 2);
+
+            data_[size_++] = value;
+        }
+
+        void insert(size_t index, const T& value)
+        {
+            if (size_ == capacity_)
+                reserve(capacity_ * 2);
+
+            memmove(data_ + index + 1, data_ + index, (size_ - index) * sizeof(T));
+            data_[index] = value;
+            ++size_;
+        }
+
+        void erase(size_t index)
+        {
+            memmove(data_ + index, data_ + index + 1, (size_ - index - 1) * sizeof(T));
+            --size_;
+        }
+
+        // Only shrinking is allowed.
+        void truncate(size_t size)
+        {
+            if (size < size_)
+                size_ = size;
+        }
+
+        void reserve(size_t capacity)
+        {
+            if (capacity <= capacity_)
+                return;
+
+            T* data = new T[capacity];
+            copyElements(data, data_, size_);
+
+            freeHeap();
+
+            data_ = data;
+            capacity_ = capacity;
+        }
+
+    private:
+        static void copyElements(T* dest, const T* src, size_t count)
+        {
+            if (count)
+                memcpy(dest, src, count * sizeof(T));
+        }
+
+        bool isInline() const { return data_ == inline_; }
+
+        void freeHeap()
+        {
+            if (!isInline())
+                delete[] data_;
+
+            data_ = inline_;
+            capacity_ = kInlineCapacity;
+        }
+
+        void moveFrom(FlatArray& other)
+        {
+            if (other.isInline())
+            {
+                data_ = inline_;
+                capacity_ = kInlineCapacity;
+                copyElements(data_, other.data_, other.size_);
+            }
+            else
+            {
+                data_ = other.data_;
+                capacity_ = other.capacity_;
+            }
+
+            size_ = other.size_;
+
+            other.data_ = other.inline_;
+            other.capacity_ = kInlineCapacity;
+            other.size_ = 0;
+        }
+
+        T inline_[kInlineCapacity];
+        T* data_ = inline_;
+        size_t size_ = 0;
+        size_t capacity_ = kInlineCapacity;
     };
 
-    // Type used to store list of rows in the region. The bottom position of row
-    // is used as the key so that rows are always ordered by their position. The
-    // map stores pointers to make Translate() more efficient.
-    using Rows = std::map<int, Row*>;
+    using Rows = FlatArray<Row, 1>;
+    using RowSpanSet = FlatArray<RowSpan, 1>;
 
 public:
     // Iterator that can be used to iterate over rectangles of a DesktopRegion.
@@ -97,12 +243,61 @@ public:
         // into |rect_|, to generate more efficient output.
         void updateCurrentRect();
 
-        Rows::const_iterator row_;
-        Rows::const_iterator previous_row_;
-        RowSpanSet::const_iterator row_span_;
+        // Indexes of the rows in |region_.rows_| and of the span in |region_.spans_|.
+        size_t row_;
+        size_t previous_row_;
+        size_t row_span_;
         Rect rect_;
     };
 
+    // Builds a region in one pass from rectangles sorted by their top edge. It is much faster
+    // than adding the same rectangles with addRect() one by one, because the rows of the region
+    // are appended to its end and never have to be split or merged again.
+    //
+    // Usage:
+    //   Region::Builder builder(&region);
+    //
+    //   builder.addRect(rect1);
+    //   builder.addRect(rect2); // rect2.top() >= rect1.top()
+    //   ...
+    //   builder.finish();
+    class Builder
+    {
+    public:
+        // The previous content of |region| is cleared.
+        explicit Builder(Region* region);
+        ~Builder();
+
+        // Rectangles must be added in order of non-decreasing top edge. The order of
+        // rectangles with the same top edge does not matter and they may overlap.
+        void addRect(const Rect& rect);
+
+        // Adds the remaining rows to the region. It is called by the destructor if it was not
+        // called before. Rectangles can not be added after the call.
+        void finish();
+
+    private:
+        struct ActiveRect
+        {
+            int32_t left;
+            int32_t right;
+            int32_t bottom;
+        };
+
+        // Adds the rows of the active rectangles which are located above |y|.
+        void addRowsAbove(int32_t y);
+
+        Region* const region_;
+
+        // Rectangles which cross the current position sorted by the left edge.
+        std::vector<ActiveRect> active_;
+
+        // Everything above this position is already added to the region.
+        int32_t top_;
+
+        bool finished_ = false;
+    };
+
     Region();
     explicit Region(const Rect& rect);
     Region(const Rect* rects, int count);
@@ -147,29 +342,69 @@ public:
     void swap(Region* region);
 
 private:
+    enum class Operation { UNION, INTERSECT, SUBTRACT };
+
+    // A range of rows of a region (or a single rectangle) used as an operand of combine().
+    struct RowsView
+    {
+        const Row* rows;
+        size_t count;
+        const RowSpan* spans;
+    };
+
+    RowsView view() const;
+    static RowsView rectView(const Rect& rect, Row* row, RowSpan* span);
+
     // Comparison functions used for std::lower_bound(). Compare left or right
     // edges withs a given |value|.
     static bool compareSpanLeft(const RowSpan& r, int32_t value);
     static bool compareSpanRight(const RowSpan& r, int32_t value);
 
     // Adds a new span to the row, coalescing spans if necessary.
-    static void addSpanToRow(Row* row, int32_t left, int32_t right);
+    void addSpanToRow(Row* row, int32_t left, int32_t right);
 
     // Returns true if the |span| exists in the given |row|.
-    static bool isSpanInRow(const Row& row, const RowSpan& rect);
-
-    // Calculates the intersection of two sets of spans.
-    static void intersectRows(const RowSpanSet& set1, const RowSpanSet& set2, RowSpanSet& output);
-
-    static void subtractRows(const RowSpanSet& set_a, const RowSpanSet& set_b, RowSpanSet& output);
-
-    // Merges |row| with the row above it if they contain the same spans. Doesn't
-    // do anything if called with |row| set to rows_.begin() (i.e. first row of
-    // the region). If the rows were merged |row| remains a valid iterator to the
-    // merged row.
-    void mergeWithPrecedingRow(Rows::iterator row_it);
+    bool isSpanInRow(const Row& row, const RowSpan& span) const;
+
+    // Returns true if the rows contain the same set of spans.
+    bool isSameSpans(const Row& row1, const Row& row2) const;
+
+    // Merges the row |index| with the row above it if they contain the same spans. Doesn't
+    // do anything if called with the first row of the region. Returns the index of the row
+    // which contains the spans of the row |index| after the call.
+    size_t mergeWithPrecedingRow(size_t index);
+
+    // Drops the unused spans from |spans_| if there are too many of them.
+    void compactSpansIfNeeded();
+
+    // Calculates the union, the intersection and the difference of two sets of spans and
+    // appends the result to |output|.
+    static void unionRows(const RowSpan* set1, size_t count1,
+                          const RowSpan* set2, size_t count2,
+                          RowSpanSet& output);
+    static void intersectRows(const RowSpan* set1, size_t count1,
+                              const RowSpan* set2, size_t count2,
+                              RowSpanSet& output);
+    static void subtractRows(const RowSpan* set_a, size_t count_a,
+                             const RowSpan* set_b, size_t count_b,
+                             RowSpanSet& output);
+
+    // Walks over the rows of |a| and |b| from top to bottom and appends the result of
+    // |operation| for each horizontal band to the end of the region.
+    void combine(const RowsView& a, const RowsView& b, Operation operation);
+
+    // Replaces the region with the result of |operation| on the region and |other|.
+    void combineWith(const RowsView& other, Operation operation);
+
+    // Adds the row which spans are appended to the end of |spans_| starting with |first_span|.
+    // An empty row is dropped and a row equal to the preceding adjacent row is merged with it.
+    void finishRow(int32_t top, int32_t bottom, size_t first_span);
 
     Rows rows_;
+    RowSpanSet spans_;
+
+    // Size of |spans_| at which the unused spans are checked next time.
+    size_t compaction_threshold_ = 0;
 };
 
 } // namespace desktop
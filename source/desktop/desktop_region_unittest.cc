@@ -21,6 +21,7 @@
 #include <gtest/gtest.h>
 
 #include <algorithm>
+#include <vector>
 
 namespace desktop {
 
@@ -1152,6 +1153,68 @@ TEST(desktop_region_test, subtract_rect_on_same_col)
     }
 }
 
+TEST(desktop_region_test, builder)
+{
+    {
+        Region region(Rect::makeXYWH(1, 2, 3, 4));
+        Region::Builder builder(&region);
+        builder.finish();
+        EXPECT_TRUE(region.isEmpty());
+    }
+
+    {
+        Region region;
+        Region::Builder builder(&region);
+        builder.addRect(Rect::makeLTRB(0, 0, 10, 10));
+        builder.addRect(Rect::makeLTRB(10, 0, 20, 10));
+        builder.addRect(Rect::makeLTRB(30, 5, 40, 10));
+        builder.addRect(Rect::makeLTRB(0, 10, 20, 20));
+        builder.addRect(Rect::makeLTRB(5, 15, 5, 30));
+        builder.finish();
+
+        static const Rect expected_rects[] =
+        {
+            Rect::makeLTRB(0, 0, 20, 20),
+            Rect::makeLTRB(30, 5, 40, 10)
+        };
+        compareRegion(region, expected_rects, sizeof(expected_rects) / sizeof(expected_rects[0]));
+    }
+}
+
+TEST(desktop_region_test, builder_matches_add_rect)
+{
+    for (int c = 0; c < 1000; ++c)
+    {
+        std::vector<Rect> rects;
+
+        for (int i = 0; i < 50; ++i)
+        {
+            rects.push_back(Rect::makeXYWH(radmonInt(100), radmonInt(100),
+                                           radmonInt(30), radmonInt(30)));
+        }
+
+        std::stable_sort(rects.begin(), rects.end(), [](const Rect& r1, const Rect& r2)
+        {
+            return r1.top() < r2.top();
+        });
+
+        Region expected;
+        Region region;
+
+        {
+            Region::Builder builder(&region);
+
+            for (const auto& rect : rects)
+            {
+                expected.addRect(rect);
+                builder.addRect(rect);
+            }
+        }
+
+        EXPECT_TRUE(region.equals(expected));
+    }
+}
+
 TEST(desktop_region_test, performance)
 {
     for (int c = 0; c < 1000; ++c)
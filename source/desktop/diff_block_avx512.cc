@@ -0,0 +1,103 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "desktop/diff_block_avx512.h"
+#include "build/build_config.h"
+
+#if defined(CC_MSVC)
+#include <intrin.h>
+#else
+#include <immintrin.h>
+#endif
+
+namespace desktop {
+
+namespace {
+
+FORCEINLINE __m512i load512(const uint8_t* data)
+{
+    return _mm512_loadu_si512(reinterpret_cast<const void*>(data));
+}
+
+// Loads two rows of 32 bytes into one register.
+FORCEINLINE __m512i load2x256(const uint8_t* row1, const uint8_t* row2)
+{
+    const __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row1));
+    const __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row2));
+
+    return _mm512_inserti64x4(_mm512_castsi256_si512(low), high, 1);
+}
+
+} // namespace
+
+uint8_t diffFullBlock_32x32_AVX512(const uint8_t* image1, const uint8_t* image2, int bytes_per_row)
+{
+    // Each row of the block is 128 bytes (two registers).
+    for (int i = 0; i < 32; ++i)
+    {
+        __mmask64 mask = _mm512_cmpneq_epi8_mask(load512(image1), load512(image2));
+        mask |= _mm512_cmpneq_epi8_mask(load512(image1 + 64), load512(image2 + 64));
+
+        if (mask)
+            return 1U;
+
+        image1 += bytes_per_row;
+        image2 += bytes_per_row;
+    }
+
+    return 0U;
+}
+
+uint8_t diffFullBlock_16x16_AVX512(const uint8_t* image1, const uint8_t* image2, int bytes_per_row)
+{
+    // Each row of the block is 64 bytes (one register). Two rows are checked per iteration.
+    for (int i = 0; i < 16; i += 2)
+    {
+        __mmask64 mask = _mm512_cmpneq_epi8_mask(load512(image1), load512(image2));
+        mask |= _mm512_cmpneq_epi8_mask(load512(image1 + bytes_per_row),
+                                        load512(image2 + bytes_per_row));
+
+        if (mask)
+            return 1U;
+
+        image1 += bytes_per_row * 2;
+        image2 += bytes_per_row * 2;
+    }
+
+    return 0U;
+}
+
+uint8_t diffFullBlock_8x8_AVX512(const uint8_t* image1, const uint8_t* image2, int bytes_per_row)
+{
+    // Each row of the block is 32 bytes. Two rows are packed into one register.
+    for (int i = 0; i < 8; i += 2)
+    {
+        const __mmask64 mask =
+            _mm512_cmpneq_epi8_mask(load2x256(image1, image1 + bytes_per_row),
+                                    load2x256(image2, image2 + bytes_per_row));
+        if (mask)
+            return 1U;
+
+        image1 += bytes_per_row * 2;
+        image2 += bytes_per_row * 2;
+    }
+
+    return 0U;
+}
+
+} // namespace desktop
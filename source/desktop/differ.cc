@@ -17,27 +17,46 @@
 //
 
 #include "desktop/differ.h"
+#include "base/cpu_dispatch.h"
 #include "base/logging.h"
+#include "base/thread_pool.h"
 #include "desktop/diff_block_avx2.h"
+#include "desktop/diff_block_avx512.h"
 #include "desktop/diff_block_sse2.h"
 #include "desktop/diff_block_sse3.h"
 #include "desktop/diff_block_c.h"
+#include "desktop/scanline_hash.h"
+#include "build/build_config.h"
 
-#include <libyuv/cpu_id.h>
+#if defined(CC_MSVC)
+#include <intrin.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
 
 namespace desktop {
 
 namespace {
 
 const int kBytesPerPixel = 4;
-const int kBlockSize = 8;
-const int kBytesPerBlock = kBytesPerPixel * kBlockSize;
+
+const int kBitsPerWord = 64;
+
+// Screens larger than these use bigger blocks by default.
+const int kMaxPixelsFor8x8Blocks = 2560 * 1600;
+const int kMaxPixelsFor16x16Blocks = 3840 * 2160;
+
+// On smaller screens, waking up the worker threads costs more than the comparison itself.
+const int kMinPixelsPerThread = 1920 * 1080;
+const int kMaxThreadCount = 8;
 
 //
 // Check for diffs in upper-left portion of the block. The size of the portion
 // to check is specified by the |width| and |height| values.
 // Note that if we force the capturer to always return images whose width and
-// height are multiples of kBlockSize, then this will never be called.
+// height are multiples of the block size, then this will never be called.
 //
 uint8_t diffPartialBlock(const uint8_t* prev_image,
                          const uint8_t* curr_image,
@@ -57,157 +76,555 @@ uint8_t diffPartialBlock(const uint8_t* prev_image,
     return 0U;
 }
 
+// Returns the index of the lowest set bit in |value|. |value| must not be zero.
+FORCEINLINE int countTrailingZeros(uint64_t value)
+{
+#if defined(CC_MSVC)
+    unsigned long index;
+#if defined(ARCH_CPU_X86_64)
+    _BitScanForward64(&index, value);
+#else
+    if (!_BitScanForward(&index, static_cast<uint32_t>(value)))
+    {
+        _BitScanForward(&index, static_cast<uint32_t>(value >> 32));
+        index += 32;
+    }
+#endif
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(value);
+#endif
+}
+
+// Sets and clears the bit of |word| in the |summary| of a row. The summary has a bit for each
+// word of the row and may consist of several words itself.
+FORCEINLINE void setSummaryBit(uint64_t* summary, int word)
+{
+    summary[word / kBitsPerWord] |= 1ULL << (word % kBitsPerWord);
+}
+
+FORCEINLINE void clearSummaryBit(uint64_t* summary, int word)
+{
+    summary[word / kBitsPerWord] &= ~(1ULL << (word % kBitsPerWord));
+}
+
+// Returns a mask with the bits from |first| (inclusive) to |last| (exclusive) set.
+FORCEINLINE uint64_t bitRangeMask(int first, int last)
+{
+    const uint64_t high = (last == kBitsPerWord) ? ~0ULL : ((1ULL << last) - 1);
+    return high & ~((1ULL << first) - 1);
+}
+
+// Returns true if all the bits from |first| to |last| are set in |row|.
+bool isBitRangeSet(const uint64_t* row, int first, int last)
+{
+    while (first < last)
+    {
+        const int word = first / kBitsPerWord;
+        const int word_last = std::min(last, (word + 1) * kBitsPerWord);
+        const uint64_t mask =
+            bitRangeMask(first % kBitsPerWord, word_last - word * kBitsPerWord);
+
+        if ((row[word] & mask) != mask)
+            return false;
+
+        first = word_last;
+    }
+
+    return true;
+}
+
+// Clears the bits from |first| to |last| in |row| and updates the |summary| of the row.
+void clearBitRange(uint64_t* row, uint64_t* summary, int first, int last)
+{
+    while (first < last)
+    {
+        const int word = first / kBitsPerWord;
+        const int word_last = std::min(last, (word + 1) * kBitsPerWord);
+
+        row[word] &= ~bitRangeMask(first % kBitsPerWord, word_last - word * kBitsPerWord);
+        if (!row[word])
+            clearSummaryBit(summary, word);
+
+        first = word_last;
+    }
+}
+
+// Sets the bits from |first| to |last| in |row| and updates the |summary| of the row.
+void setBitRange(uint64_t* row, uint64_t* summary, int first, int last)
+{
+    while (first < last)
+    {
+        const int word = first / kBitsPerWord;
+        const int word_last = std::min(last, (word + 1) * kBitsPerWord);
+
+        row[word] |= bitRangeMask(first % kBitsPerWord, word_last - word * kBitsPerWord);
+        setSummaryBit(summary, word);
+
+        first = word_last;
+    }
+}
+
+// Packs the results of the block comparisons into one row of the diff map.
+class RowWriter
+{
+public:
+    RowWriter(uint64_t* row, uint64_t* summary, int summary_stride)
+        : row_(row),
+          summary_(summary)
+    {
+        std::fill_n(summary_, summary_stride, 0);
+    }
+
+    FORCEINLINE void add(uint8_t is_different)
+    {
+        word_ |= static_cast<uint64_t>(is_different) << bit_;
+
+        if (++bit_ == kBitsPerWord)
+            flush();
+    }
+
+    void finish()
+    {
+        if (bit_ != 0)
+            flush();
+    }
+
+private:
+    void flush()
+    {
+        row_[index_] = word_;
+
+        if (word_)
+            setSummaryBit(summary_, index_);
+
+        ++index_;
+        word_ = 0;
+        bit_ = 0;
+    }
+
+    uint64_t* const row_;
+    uint64_t* const summary_;
+
+    uint64_t word_ = 0;
+    int bit_ = 0;
+    int index_ = 0;
+};
+
+using DiffFullBlockFunc = uint8_t(*)(const uint8_t*, const uint8_t*, int);
+using HashScanlineFunc = uint64_t(*)(const uint8_t*, int);
+
+// Variants of the block comparison functions for each block size.
+const base::CpuDispatchTable<DiffFullBlockFunc> kDiffFullBlock8x8Table =
+{
+    { base::CpuIsa::AVX512BW, diffFullBlock_8x8_AVX512 },
+    { base::CpuIsa::AVX2,     diffFullBlock_8x8_AVX2   },
+    { base::CpuIsa::SSSE3,    diffFullBlock_8x8_SSE3   },
+    { base::CpuIsa::SSE2,     diffFullBlock_8x8_SSE2   },
+    { base::CpuIsa::C,        diffFullBlock_8x8_C      }
+};
+
+const base::CpuDispatchTable<DiffFullBlockFunc> kDiffFullBlock16x16Table =
+{
+    { base::CpuIsa::AVX512BW, diffFullBlock_16x16_AVX512 },
+    { base::CpuIsa::AVX2,     diffFullBlock_16x16_AVX2   },
+    { base::CpuIsa::SSSE3,    diffFullBlock_16x16_SSE3   },
+    { base::CpuIsa::SSE2,     diffFullBlock_16x16_SSE2   },
+    { base::CpuIsa::C,        diffFullBlock_16x16_C      }
+};
+
+const base::CpuDispatchTable<DiffFullBlockFunc> kDiffFullBlock32x32Table =
+{
+    { base::CpuIsa::AVX512BW, diffFullBlock_32x32_AVX512 },
+    { base::CpuIsa::AVX2,     diffFullBlock_32x32_AVX2   },
+    { base::CpuIsa::SSSE3,    diffFullBlock_32x32_SSE3   },
+    { base::CpuIsa::SSE2,     diffFullBlock_32x32_SSE2   },
+    { base::CpuIsa::C,        diffFullBlock_32x32_C      }
+};
+
+const base::CpuDispatchTable<HashScanlineFunc> kHashScanlineTable =
+{
+    { base::CpuIsa::SSE2, hashScanline_SSE2 },
+    { base::CpuIsa::C,    hashScanline_C    }
+};
+
+DiffFullBlockFunc diffFullBlockFunc(int block_size)
+{
+    const base::CpuDispatchTable<DiffFullBlockFunc>* table;
+
+    switch (block_size)
+    {
+        case 8: table = &kDiffFullBlock8x8Table; break;
+        case 16: table = &kDiffFullBlock16x16Table; break;
+        case 32: table = &kDiffFullBlock32x32Table; break;
+
+        default:
+            NOTREACHED();
+            return nullptr;
+    }
+
+    base::CpuIsa isa = base::CpuIsa::C;
+    DiffFullBlockFunc func = table->select(&isa);
+
+    LOG(LS_INFO) << base::cpuIsaName(isa) << " differ loaded";
+    return func;
+}
+
+int validBlockSize(int block_size)
+{
+    if (Differ::isValidBlockSize(block_size))
+        return block_size;
+
+    LOG(LS_WARNING) << "Unsupported block size: " << block_size;
+    return Differ::kDefaultBlockSize;
+}
+
 } // namespace
 
-Differ::Differ(const Size& size)
+Differ::Differ(const Size& size, int block_size, int thread_count)
     : screen_rect_(Rect::makeSize(size)),
+      block_size_(validBlockSize(block_size)),
+      bytes_per_block_(block_size_ * kBytesPerPixel),
       bytes_per_row_(size.width() * kBytesPerPixel),
-      diff_width_(((size.width() + kBlockSize - 1) / kBlockSize) + 1),
-      diff_height_(((size.height() + kBlockSize - 1) / kBlockSize) + 1),
-      full_blocks_x_(size.width() / kBlockSize),
-      full_blocks_y_(size.height() / kBlockSize)
+      full_blocks_x_(size.width() / block_size_),
+      full_blocks_y_(size.height() / block_size_),
+      diff_width_((size.width() + block_size_ - 1) / block_size_),
+      diff_height_((size.height() + block_size_ - 1) / block_size_),
+      diff_stride_((diff_width_ + kBitsPerWord - 1) / kBitsPerWord),
+      summary_stride_((diff_stride_ + kBitsPerWord - 1) / kBitsPerWord)
 {
-    const int diff_info_size = diff_width_ * diff_height_;
-
-    diff_info_ = std::make_unique<uint8_t[]>(diff_info_size);
-    memset(diff_info_.get(), 0, diff_info_size);
+    diff_info_ = std::make_unique<uint64_t[]>(diff_stride_ * diff_height_);
+    row_summary_ = std::make_unique<uint64_t[]>(summary_stride_ * diff_height_);
 
     // Calc size of partial blocks which may be present on right and bottom edge.
-    partial_column_width_ = size.width() - (full_blocks_x_ * kBlockSize);
-    partial_row_height_ = size.height() - (full_blocks_y_ * kBlockSize);
+    partial_column_width_ = size.width() - (full_blocks_x_ * block_size_);
+    partial_row_height_ = size.height() - (full_blocks_y_ * block_size_);
 
     // Offset from the start of one block-row to the next.
-    block_stride_y_ = bytes_per_row_ * kBlockSize;
+    block_stride_y_ = bytes_per_row_ * block_size_;
 
-    if (libyuv::TestCpuFlag(libyuv::kCpuHasAVX2))
-    {
-        LOG(LS_INFO) << "AVX2 differ loaded";
-
-        if constexpr (kBlockSize == 8)
-            diff_full_block_func_ = diffFullBlock_8x8_AVX2;
-        else if constexpr (kBlockSize == 16)
-            diff_full_block_func_ = diffFullBlock_16x16_AVX2;
-        else if constexpr (kBlockSize == 32)
-            diff_full_block_func_ = diffFullBlock_32x32_AVX2;
-    }
-    else if (libyuv::TestCpuFlag(libyuv::kCpuHasSSSE3))
+    diff_full_block_func_ = diffFullBlockFunc(block_size_);
+
+    hash_scanline_func_ = kHashScanlineTable.select();
+
+    // There is no point in creating more bands than there are rows of blocks.
+    thread_count = std::min(thread_count, diff_height_);
+    if (thread_count > 1)
     {
-        LOG(LS_INFO) << "SSE3 differ loaded";
-
-        if constexpr (kBlockSize == 8)
-            diff_full_block_func_ = diffFullBlock_8x8_SSE3;
-        else if constexpr (kBlockSize == 16)
-            diff_full_block_func_ = diffFullBlock_16x16_SSE3;
-        else if constexpr (kBlockSize == 32)
-            diff_full_block_func_ = diffFullBlock_32x32_SSE3;
+        LOG(LS_INFO) << "Differ uses " << thread_count << " threads";
+        thread_pool_ = std::make_unique<base::ThreadPool>(thread_count);
     }
-    else if (libyuv::TestCpuFlag(libyuv::kCpuHasSSE2))
+}
+
+Differ::~Differ() = default;
+
+// static
+bool Differ::isValidBlockSize(int block_size)
+{
+    return block_size == 8 || block_size == 16 || block_size == 32;
+}
+
+// static
+int Differ::defaultBlockSize(const Size& size)
+{
+    const int64_t pixels = static_cast<int64_t>(size.width()) * size.height();
+
+    if (pixels <= kMaxPixelsFor8x8Blocks)
+        return 8;
+
+    if (pixels <= kMaxPixelsFor16x16Blocks)
+        return 16;
+
+    return 32;
+}
+
+void Differ::setFingerprintsEnabled(bool enable)
+{
+    fingerprints_enabled_ = enable;
+    fingerprints_image_ = nullptr;
+
+    if (enable)
     {
-        LOG(LS_INFO) << "SSE2 differ loaded";
-
-        if constexpr (kBlockSize == 8)
-            diff_full_block_func_ = diffFullBlock_8x8_SSE2;
-        else if constexpr (kBlockSize == 16)
-            diff_full_block_func_ = diffFullBlock_16x16_SSE2;
-        else if constexpr (kBlockSize == 32)
-            diff_full_block_func_ = diffFullBlock_32x32_SSE2;
+        curr_fingerprints_.resize(screen_rect_.height());
+        prev_fingerprints_.resize(screen_rect_.height());
     }
     else
     {
-        LOG(LS_INFO) << "C differ loaded";
-
-        if constexpr (kBlockSize == 8)
-            diff_full_block_func_ = diffFullBlock_8x8_C;
-        else if constexpr (kBlockSize == 16)
-            diff_full_block_func_ = diffFullBlock_16x16_C;
-        else if constexpr (kBlockSize == 32)
-            diff_full_block_func_ = diffFullBlock_32x32_C;
+        curr_fingerprints_.clear();
+        prev_fingerprints_.clear();
     }
 }
 
+// static
+int Differ::defaultThreadCount(const Size& size)
+{
+    const int64_t pixels = static_cast<int64_t>(size.width()) * size.height();
+
+    int thread_count = static_cast<int>(pixels / kMinPixelsPerThread);
+    thread_count = std::min(thread_count, static_cast<int>(std::thread::hardware_concurrency()));
+
+    return std::clamp(thread_count, 1, kMaxThreadCount);
+}
+
 //
 // Identify all of the blocks that contain changed pixels.
 //
-void Differ::markDirtyBlocks(const uint8_t* prev_image, const uint8_t* curr_image)
+void Differ::forEachBand(const std::function<void(int first_row, int last_row)>& func)
 {
-    const uint8_t* prev_block_row_start = prev_image;
-    const uint8_t* curr_block_row_start = curr_image;
+    // The last partial row (if any) is handled as a regular row.
+    const int block_rows = diff_height_;
 
-    // Offset from the start of one diff_info row to the next.
-    const int diff_stride = diff_width_;
+    if (!thread_pool_)
+    {
+        func(0, block_rows);
+        return;
+    }
 
-    uint8_t* is_diff_row_start = diff_info_.get();
+    // Each band writes only to its own rows of |diff_info_|, so the bands do not need any
+    // synchronization. The bands are merged later by mergeBlocks() as a whole.
+    const int band_count = thread_pool_->threadCount();
 
-    for (int y = 0; y < full_blocks_y_; ++y)
+    thread_pool_->parallelFor(band_count, [&](int band)
     {
-        const uint8_t* prev_block = prev_block_row_start;
-        const uint8_t* curr_block = curr_block_row_start;
+        const int first_row = (block_rows * band) / band_count;
+        const int last_row = (block_rows * (band + 1)) / band_count;
 
-        uint8_t* is_different = is_diff_row_start;
+        func(first_row, last_row);
+    });
+}
 
-        for (int x = 0; x < full_blocks_x_; ++x)
-        {
-            // Mark this block as being modified so that it gets
-            // incorporated into a dirty rect.
-            *is_different = diff_full_block_func_(prev_block, curr_block, bytes_per_row_);
+//
+// Identify all of the blocks that contain changed pixels.
+//
+void Differ::markDirtyBlocks(const uint8_t* prev_image, const uint8_t* curr_image,
+                             bool compare_fingerprints)
+{
+    forEachBand([&](int first_row, int last_row)
+    {
+        markDirtyBlockRows(prev_image, curr_image, first_row, last_row, compare_fingerprints);
+    });
+}
+
+//
+// Identify the blocks that contain changed pixels in the rows of blocks
+// from |first_row| (inclusive) to |last_row| (exclusive).
+//
+void Differ::markDirtyBlockRows(const uint8_t* prev_image, const uint8_t* curr_image,
+                                int first_row, int last_row, bool compare_fingerprints)
+{
+    for (int y = first_row; y < last_row; ++y)
+    {
+        const uint8_t* prev_block = prev_image + y * block_stride_y_;
+        const uint8_t* curr_block = curr_image + y * block_stride_y_;
 
-            prev_block += kBytesPerBlock;
-            curr_block += kBytesPerBlock;
+        uint64_t* is_diff_row_start = diff_info_.get() + y * diff_stride_;
 
-            ++is_different;
+        if (fingerprints_enabled_ && !updateFingerprints(curr_image, y, compare_fingerprints))
+        {
+            // None of the scanlines has changed, so there is nothing to compare in this row.
+            std::fill_n(is_diff_row_start, diff_stride_, 0);
+            std::fill_n(&row_summary_[y * summary_stride_], summary_stride_, 0);
+            continue;
         }
 
-        // If there is a partial column at the end, handle it.
-        // This condition should rarely, if ever, occur.
-        if (partial_column_width_ != 0)
+        RowWriter is_different(is_diff_row_start, &row_summary_[y * summary_stride_],
+                               summary_stride_);
+
+        if (y < full_blocks_y_)
         {
-            *is_different = diffPartialBlock(prev_block,
-                                             curr_block,
-                                             bytes_per_row_,
-                                             kBytesPerBlock,
-                                             kBlockSize);
+            for (int x = 0; x < full_blocks_x_; ++x)
+            {
+                // Mark this block as being modified so that it gets
+                // incorporated into a dirty rect.
+                is_different.add(diff_full_block_func_(prev_block, curr_block, bytes_per_row_));
+
+                prev_block += bytes_per_block_;
+                curr_block += bytes_per_block_;
+            }
+
+            // If there is a partial column at the end, handle it.
+            // This condition should rarely, if ever, occur.
+            if (partial_column_width_ != 0)
+            {
+                is_different.add(diffPartialBlock(prev_block,
+                                                  curr_block,
+                                                  bytes_per_row_,
+                                                  partial_column_width_ * kBytesPerPixel,
+                                                  block_size_));
+            }
         }
+        else
+        {
+            // If the screen height is not a multiple of the block size, then this
+            // handles the last partial row. This situation is far more common than
+            // the 'partial column' case.
+            for (int x = 0; x < full_blocks_x_; ++x)
+            {
+                is_different.add(diffPartialBlock(prev_block,
+                                                  curr_block,
+                                                  bytes_per_row_,
+                                                  bytes_per_block_,
+                                                  partial_row_height_));
+
+                prev_block += bytes_per_block_;
+                curr_block += bytes_per_block_;
+            }
 
-        // Update pointers for next row.
-        prev_block_row_start += block_stride_y_;
-        curr_block_row_start += block_stride_y_;
+            if (partial_column_width_ != 0)
+            {
+                is_different.add(diffPartialBlock(prev_block,
+                                                  curr_block,
+                                                  bytes_per_row_,
+                                                  partial_column_width_ * kBytesPerPixel,
+                                                  partial_row_height_));
+            }
+        }
 
-        is_diff_row_start += diff_stride;
+        is_different.finish();
     }
+}
 
-    // If the screen height is not a multiple of the block size, then this
-    // handles the last partial row. This situation is far more common than
-    // the 'partial column' case.
-    if (partial_row_height_ != 0)
+void Differ::markHintBlocks(const Region& hint)
+{
+    if (!hint_info_)
     {
-        const uint8_t* prev_block = prev_block_row_start;
-        const uint8_t* curr_block = curr_block_row_start;
+        hint_info_ = std::make_unique<uint64_t[]>(diff_stride_ * diff_height_);
+        hint_summary_ = std::make_unique<uint64_t[]>(summary_stride_ * diff_height_);
+    }
 
-        uint8_t* is_different = is_diff_row_start;
+    for (Region::Iterator it(hint); !it.isAtEnd(); it.advance())
+    {
+        Rect rect = it.rect();
+
+        rect.intersectWith(screen_rect_);
+        if (rect.isEmpty())
+            continue;
+
+        // Expand the rectangle to the block boundaries.
+        const int first_x = rect.left() / block_size_;
+        const int last_x = (rect.right() + block_size_ - 1) / block_size_;
+        const int first_y = rect.top() / block_size_;
+        const int last_y = (rect.bottom() + block_size_ - 1) / block_size_;
+
+        for (int y = first_y; y < last_y; ++y)
+        {
+            setBitRange(hint_info_.get() + y * diff_stride_,
+                        &hint_summary_[y * summary_stride_], first_x, last_x);
+        }
+    }
+}
+
+//
+// Identify the blocks that contain changed pixels among the blocks marked in |hint_info_|
+// in the rows of blocks from |first_row| (inclusive) to |last_row| (exclusive).
+//
+void Differ::markDirtyHintBlockRows(const uint8_t* prev_image, const uint8_t* curr_image,
+                                    int first_row, int last_row)
+{
+    for (int y = first_row; y < last_row; ++y)
+    {
+        uint64_t* hint_row = hint_info_.get() + y * diff_stride_;
+        uint64_t* is_diff_row = diff_info_.get() + y * diff_stride_;
+        uint64_t* hint_summary = &hint_summary_[y * summary_stride_];
+        uint64_t* row_summary = &row_summary_[y * summary_stride_];
 
-        for (int x = 0; x < full_blocks_x_; ++x)
+        std::fill_n(is_diff_row, diff_stride_, 0);
+        std::fill_n(row_summary, summary_stride_, 0);
+
+        // Only the words which have marked blocks are visited.
+        for (int i = 0; i < summary_stride_; ++i)
         {
-            *is_different = diffPartialBlock(prev_block,
-                                             curr_block,
-                                             bytes_per_row_,
-                                             kBytesPerBlock,
-                                             partial_row_height_);
-
-            prev_block += kBytesPerBlock;
-            curr_block += kBytesPerBlock;
-            ++is_different;
+            while (hint_summary[i] != 0)
+            {
+                const int word = i * kBitsPerWord + countTrailingZeros(hint_summary[i]);
+                uint64_t blocks = hint_row[word];
+                uint64_t dirty = 0;
+
+                hint_row[word] = 0;
+                clearSummaryBit(hint_summary, word);
+
+                while (blocks != 0)
+                {
+                    const int bit = countTrailingZeros(blocks);
+                    blocks &= blocks - 1;
+
+                    const uint64_t is_different =
+                        diffBlock(prev_image, curr_image, word * kBitsPerWord + bit, y);
+
+                    dirty |= is_different << bit;
+                }
+
+                is_diff_row[word] = dirty;
+                if (dirty)
+                    setSummaryBit(row_summary, word);
+            }
         }
+    }
+}
+
+uint8_t Differ::diffBlock(const uint8_t* prev_image, const uint8_t* curr_image,
+                          int x, int y) const
+{
+    const int offset = y * block_stride_y_ + x * bytes_per_block_;
+
+    const int width = (x < full_blocks_x_) ? block_size_ : partial_column_width_;
+    const int height = (y < full_blocks_y_) ? block_size_ : partial_row_height_;
+
+    if (width == block_size_ && height == block_size_)
+        return diff_full_block_func_(prev_image + offset, curr_image + offset, bytes_per_row_);
+
+    return diffPartialBlock(prev_image + offset, curr_image + offset,
+                            bytes_per_row_, width * kBytesPerPixel, height);
+}
+
+bool Differ::updateFingerprints(const uint8_t* curr_image, int block_row, bool compare)
+{
+    const int first_line = block_row * block_size_;
+    const int last_line = std::min(first_line + block_size_, screen_rect_.height());
 
-        if (partial_column_width_ != 0)
+    const uint8_t* scanline = curr_image + first_line * bytes_per_row_;
+    bool changed = !compare;
+
+    for (int y = first_line; y < last_line; ++y)
+    {
+        const uint64_t fingerprint = hash_scanline_func_(scanline, bytes_per_row_);
+
+        if (fingerprint != prev_fingerprints_[y])
+            changed = true;
+
+        curr_fingerprints_[y] = fingerprint;
+        scanline += bytes_per_row_;
+    }
+
+    return changed;
+}
+
+int Differ::dirtyRunLength(const uint64_t* row, int x) const
+{
+    const int first = x;
+
+    while (x < diff_width_)
+    {
+        const int bit = x % kBitsPerWord;
+
+        // The bits above the end of the row are never set, so the run always ends there.
+        const uint64_t clean = ~(row[x / kBitsPerWord] >> bit);
+        if (!clean)
         {
-            *is_different =
-                diffPartialBlock(prev_block,
-                                 curr_block,
-                                 bytes_per_row_,
-                                 partial_column_width_ * kBytesPerPixel,
-                                 partial_row_height_);
+            // All the remaining bits of the word are set.
+            x += kBitsPerWord;
+            continue;
         }
+
+        const int length = countTrailingZeros(clean);
+        x += length;
+
+        // The run ends inside this word.
+        if (bit + length < kBitsPerWord)
+            break;
     }
+
+    return std::min(x, diff_width_) - first;
 }
 
 //
@@ -217,86 +634,64 @@ void Differ::markDirtyBlocks(const uint8_t* prev_image, const uint8_t* curr_imag
 //
 void Differ::mergeBlocks(Region* dirty_region)
 {
-    uint8_t* is_diff_row_start = diff_info_.get();
-    const int diff_stride = diff_width_;
+    uint64_t* is_diff_row_start = diff_info_.get();
+
+    // The rectangles are found from top to bottom, so the region is built in one pass.
+    Region::Builder builder(dirty_region);
 
     for (int y = 0; y < diff_height_; ++y)
     {
-        uint8_t* is_different = is_diff_row_start;
+        uint64_t* row_summary = &row_summary_[y * summary_stride_];
 
-        for (int x = 0; x < diff_width_; ++x)
+        // The rows without changes are skipped entirely by their summary. Inside the row only
+        // the non-zero words are visited.
+        for (int i = 0; i < summary_stride_; ++i)
         {
-            // We've found a modified block. Look at blocks to the right and
-            // below to group this block with as many others as we can.
-            if (*is_different != 0)
+            while (row_summary[i] != 0)
             {
-                // Width and height of the rectangle in blocks.
-                int width  = 1;
-                int height = 1;
-
-                *is_different = 0;
+                const int word = i * kBitsPerWord + countTrailingZeros(row_summary[i]);
 
-                // Group with blocks to the right.
-                // We can keep looking until we find an unchanged block because
-                // we have a boundary block which is never marked as having
-                // diffs.
-                uint8_t* right = is_different + 1;
+                // We've found a modified block. Look at blocks to the right and
+                // below to group this block with as many others as we can.
+                const int x = word * kBitsPerWord + countTrailingZeros(is_diff_row_start[word]);
 
-                while (*right != 0)
-                {
-                    *right++ = 0;
-                    ++width;
-                }
+                // Width and height of the rectangle in blocks.
+                const int width = dirtyRunLength(is_diff_row_start, x);
+                int height = 1;
 
                 // Group with blocks below.
                 // The entire width of blocks that we matched above much match
                 // for each row that we add.
-                uint8_t* bottom = is_different;
-                bool found_new_row;
+                uint64_t* bottom = is_diff_row_start + diff_stride_;
 
-                do
+                while (y + height < diff_height_ && isBitRangeSet(bottom, x, x + width))
                 {
-                    found_new_row = true;
-                    bottom += diff_stride;
-                    right = bottom;
-
-                    for (int x2 = 0; x2 < width; ++x2)
-                    {
-                        if (*right++ == 0)
-                            found_new_row = false;
-                    }
-
-                    if (found_new_row)
-                    {
-                        ++height;
-
-                        // We need to go back and erase the diff markers so
-                        // that we don't try to add these blocks a second time.
-                        right = bottom;
-
-                        for (int x2 = 0; x2 < width; ++x2)
-                        {
-                            *right++ = 0;
-                        }
-                    }
-                } while (found_new_row);
-
-                Rect dirty_rect = Rect::makeXYWH(x * kBlockSize, y * kBlockSize,
-                                                 width * kBlockSize, height * kBlockSize);
+                    // We need to erase the diff markers so that we don't try to add
+                    // these blocks a second time.
+                    clearBitRange(bottom, &row_summary_[(y + height) * summary_stride_],
+                                  x, x + width);
+
+                    bottom += diff_stride_;
+                    ++height;
+                }
+
+                clearBitRange(is_diff_row_start, row_summary, x, x + width);
+
+                Rect dirty_rect = Rect::makeXYWH(x * block_size_, y * block_size_,
+                                                 width * block_size_, height * block_size_);
 
                 dirty_rect.intersectWith(screen_rect_);
 
                 // Add rect to region.
-                dirty_region->addRect(dirty_rect);
+                builder.addRect(dirty_rect);
             }
-
-            // Increment to next block in this row.
-            ++is_different;
         }
 
         // Go to start of next row.
-        is_diff_row_start += diff_stride;
+        is_diff_row_start += diff_stride_;
     }
+
+    builder.finish();
 }
 
 void Differ::calcDirtyRegion(const uint8_t* prev_image,
@@ -305,8 +700,18 @@ void Differ::calcDirtyRegion(const uint8_t* prev_image,
 {
     dirty_region->clear();
 
+    bool compare_fingerprints = false;
+
+    if (fingerprints_enabled_)
+    {
+        // The fingerprints of the previous call become the fingerprints of |prev_image|.
+        compare_fingerprints = (prev_image == fingerprints_image_);
+        curr_fingerprints_.swap(prev_fingerprints_);
+        fingerprints_image_ = curr_image;
+    }
+
     // Identify all the blocks that contain changed pixels.
-    markDirtyBlocks(prev_image, curr_image);
+    markDirtyBlocks(prev_image, curr_image, compare_fingerprints);
 
     //
     // Now that we've identified the blocks that have changed, merge adjacent
@@ -315,4 +720,26 @@ void Differ::calcDirtyRegion(const uint8_t* prev_image,
     mergeBlocks(dirty_region);
 }
 
+void Differ::calcDirtyRegion(const uint8_t* prev_image,
+                             const uint8_t* curr_image,
+                             const Region& hint,
+                             Region* dirty_region)
+{
+    dirty_region->clear();
+
+    // The fingerprints are calculated only for the compared rows, so they can not be trusted
+    // on the next call.
+    fingerprints_image_ = nullptr;
+
+    markHintBlocks(hint);
+
+    // Compare only the blocks marked by the hint.
+    forEachBand([&](int first_row, int last_row)
+    {
+        markDirtyHintBlockRows(prev_image, curr_image, first_row, last_row);
+    });
+
+    mergeBlocks(dirty_region);
+}
+
 } // namespace desktop
@@ -22,27 +22,96 @@
 #include "base/macros_magic.h"
 #include "desktop/desktop_region.h"
 
+#include <functional>
 #include <memory>
+#include <vector>
+
+namespace base {
+class ThreadPool;
+} // namespace base
 
 namespace desktop {
 
 // Class to search for changed regions of the screen.
+// The screen is compared in square blocks of |block_size| pixels (8, 16 or 32). Larger blocks
+// need fewer comparisons but give less precise dirty rectangles.
+// If |thread_count| is greater than 1, then the search for changed blocks is split into
+// horizontal bands which are processed in parallel. The result does not depend on the number
+// of threads.
 class Differ
 {
 public:
-    explicit Differ(const Size& size);
-    ~Differ() = default;
+    static const int kDefaultBlockSize = 8;
+
+    explicit Differ(const Size& size,
+                    int block_size = kDefaultBlockSize,
+                    int thread_count = 1);
+    ~Differ();
+
+    // Returns true if the differ has a comparison function for |block_size|.
+    static bool isValidBlockSize(int block_size);
+
+    // Returns the recommended block size for the screen of size |size|.
+    static int defaultBlockSize(const Size& size);
+
+    // Returns the recommended number of threads for the screen of size |size|.
+    static int defaultThreadCount(const Size& size);
+
+    int blockSize() const { return block_size_; }
+
+    // Enables the fingerprints pre-pass. A 64-bit fingerprint is calculated for each scanline of
+    // the current image, and the rows of blocks whose scanline fingerprints did not change since
+    // the previous call are not compared block by block. The fingerprints of the previous call
+    // are trusted only if |prev_image| is the image that was passed as |curr_image| then.
+    void setFingerprintsEnabled(bool enable);
+    bool isFingerprintsEnabled() const { return fingerprints_enabled_; }
+
+    // Returns the scanline fingerprints of the last image passed as |curr_image|. The vector is
+    // empty if the fingerprints are disabled.
+    const std::vector<uint64_t>& scanlineFingerprints() const { return curr_fingerprints_; }
+
+    void calcDirtyRegion(const uint8_t* prev_image,
+                         const uint8_t* curr_image,
+                         Region* changed_region);
 
+    // Same as above, but only the blocks which intersect |hint| are compared. It is used by
+    // the capturers which know what areas of the screen could have changed (for example, from
+    // the records of a mirror driver). The cost of the search is proportional to the area of
+    // the hint. The changes outside the hint are not detected.
+    // The fingerprints are not used and are invalidated by this call.
     void calcDirtyRegion(const uint8_t* prev_image,
                          const uint8_t* curr_image,
+                         const Region& hint,
                          Region* changed_region);
 
 private:
-    void markDirtyBlocks(const uint8_t* prev_image, const uint8_t* curr_image);
+    // Calls |func| for each band of rows of blocks. The bands are executed in parallel if
+    // the differ has a thread pool.
+    void forEachBand(const std::function<void(int first_row, int last_row)>& func);
+
+    void markDirtyBlocks(const uint8_t* prev_image, const uint8_t* curr_image,
+                         bool compare_fingerprints);
+    // Marks the blocks which intersect |hint| in |hint_info_|.
+    void markHintBlocks(const Region& hint);
+    // Compares only the blocks marked in |hint_info_| and clears the marks.
+    void markDirtyHintBlockRows(const uint8_t* prev_image, const uint8_t* curr_image,
+                                int first_row, int last_row);
+    // Compares a single block (full or partial) with coordinates |x| and |y| in blocks.
+    uint8_t diffBlock(const uint8_t* prev_image, const uint8_t* curr_image, int x, int y) const;
+    void markDirtyBlockRows(const uint8_t* prev_image, const uint8_t* curr_image,
+                            int first_row, int last_row, bool compare_fingerprints);
+    // Calculates the fingerprints of the scanlines in the row of blocks |block_row|. Returns
+    // false if |compare| is true and no fingerprint differs from the previous image.
+    bool updateFingerprints(const uint8_t* curr_image, int block_row, bool compare);
     void mergeBlocks(Region* dirty_region);
 
+    // Returns the number of consecutive dirty blocks in |row| starting with the block |x|.
+    int dirtyRunLength(const uint64_t* row, int x) const;
+
     const Rect screen_rect_;
 
+    const int block_size_;
+    const int bytes_per_block_;
     const int bytes_per_row_;
 
     const int full_blocks_x_;
@@ -53,14 +122,44 @@ private:
 
     int block_stride_y_;
 
+    // Number of blocks in a row and in a column (including partial blocks).
     const int diff_width_;
     const int diff_height_;
 
-    std::unique_ptr<uint8_t[]> diff_info_;
+    // Number of 64-bit words in one row of |diff_info_|.
+    const int diff_stride_;
+
+    // Number of 64-bit words in the summary of one row.
+    const int summary_stride_;
+
+    // The diff map: one bit per block, each row starts on a new word.
+    std::unique_ptr<uint64_t[]> diff_info_;
+
+    // Summary of the diff map: bit N in the row summary is set if word N of the row in
+    // |diff_info_| is not zero. Rows of more than 64 words have a summary of several words.
+    std::unique_ptr<uint64_t[]> row_summary_;
+
+    // The blocks to be compared by the hint-driven search. It has the same layout as
+    // |diff_info_| and is allocated on the first use.
+    std::unique_ptr<uint64_t[]> hint_info_;
+    std::unique_ptr<uint64_t[]> hint_summary_;
 
     typedef uint8_t(*DiffFullBlockFunc)(const uint8_t*, const uint8_t*, int);
     DiffFullBlockFunc diff_full_block_func_;
 
+    typedef uint64_t(*HashScanlineFunc)(const uint8_t*, int);
+    HashScanlineFunc hash_scanline_func_;
+
+    bool fingerprints_enabled_ = false;
+
+    // The image for which |curr_fingerprints_| were calculated.
+    const uint8_t* fingerprints_image_ = nullptr;
+
+    std::vector<uint64_t> curr_fingerprints_;
+    std::vector<uint64_t> prev_fingerprints_;
+
+    std::unique_ptr<base::ThreadPool> thread_pool_;
+
     DISALLOW_COPY_AND_ASSIGN(Differ);
 };
 
@@ -0,0 +1,352 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "desktop/differ.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+namespace desktop {
+
+namespace {
+
+const int kBytesPerPixel = 4;
+
+class DifferTest : public testing::Test
+{
+protected:
+    void initBuffers(const Size& size)
+    {
+        size_ = size;
+
+        const size_t buffer_size = size.width() * size.height() * kBytesPerPixel;
+
+        prev_.assign(buffer_size, 0);
+        curr_.assign(buffer_size, 0);
+
+        std::mt19937 random(size.width() * 31 + size.height());
+        for (size_t i = 0; i < buffer_size; ++i)
+            prev_[i] = static_cast<uint8_t>(random());
+
+        curr_ = prev_;
+    }
+
+    void changePixel(int x, int y)
+    {
+        curr_[(y * size_.width() + x) * kBytesPerPixel] ^= 0xFF;
+    }
+
+    void changeRandomPixels(int count, uint32_t seed)
+    {
+        std::mt19937 random(seed);
+
+        for (int i = 0; i < count; ++i)
+            changePixel(random() % size_.width(), random() % size_.height());
+    }
+
+    Region calcDirtyRegion(int thread_count, int block_size = Differ::kDefaultBlockSize)
+    {
+        Differ differ(size_, block_size, thread_count);
+        Region region;
+
+        differ.calcDirtyRegion(prev_.data(), curr_.data(), &region);
+        return region;
+    }
+
+    // Checks that every changed pixel is inside |region|.
+    void expectChangesCovered(const Region& region)
+    {
+        for (int y = 0; y < size_.height(); ++y)
+        {
+            for (int x = 0; x < size_.width(); ++x)
+            {
+                const size_t offset = (y * size_.width() + x) * kBytesPerPixel;
+
+                if (memcmp(&prev_[offset], &curr_[offset], kBytesPerPixel) == 0)
+                    continue;
+
+                Region pixel(Rect::makeXYWH(x, y, 1, 1));
+                pixel.intersectWith(region);
+
+                EXPECT_FALSE(pixel.isEmpty()) << "x=" << x << " y=" << y;
+            }
+        }
+    }
+
+    Size size_;
+    std::vector<uint8_t> prev_;
+    std::vector<uint8_t> curr_;
+};
+
+} // namespace
+
+TEST_F(DifferTest, NoChanges)
+{
+    initBuffers(Size(256, 128));
+
+    for (int thread_count = 1; thread_count <= 4; ++thread_count)
+        EXPECT_TRUE(calcDirtyRegion(thread_count).isEmpty());
+}
+
+TEST_F(DifferTest, FullChange)
+{
+    initBuffers(Size(256, 128));
+
+    for (int y = 0; y < size_.height(); ++y)
+    {
+        for (int x = 0; x < size_.width(); ++x)
+            changePixel(x, y);
+    }
+
+    for (int thread_count = 1; thread_count <= 4; ++thread_count)
+    {
+        EXPECT_TRUE(calcDirtyRegion(thread_count).equals(
+            Region(Rect::makeSize(size_))));
+    }
+}
+
+TEST_F(DifferTest, PartialBlocks)
+{
+    initBuffers(Size(253, 131));
+
+    changePixel(252, 0);
+    changePixel(0, 130);
+    changePixel(252, 130);
+    changePixel(100, 50);
+
+    for (int thread_count = 1; thread_count <= 4; ++thread_count)
+    {
+        Region expected;
+        expected.addRect(Rect::makeLTRB(248, 0, 253, 8));
+        expected.addRect(Rect::makeLTRB(0, 128, 8, 131));
+        expected.addRect(Rect::makeLTRB(248, 128, 253, 131));
+        expected.addRect(Rect::makeLTRB(96, 48, 104, 56));
+
+        EXPECT_TRUE(calcDirtyRegion(thread_count).equals(expected));
+    }
+}
+
+TEST_F(DifferTest, ParallelMatchesSerial)
+{
+    const Size kSizes[] = { Size(64, 64), Size(640, 480), Size(1023, 769), Size(8, 1000) };
+
+    for (const auto& size : kSizes)
+    {
+        initBuffers(size);
+
+        for (uint32_t seed = 0; seed < 4; ++seed)
+        {
+            changeRandomPixels(static_cast<int>(seed * 50 + 1), seed);
+
+            Region serial = calcDirtyRegion(1);
+            expectChangesCovered(serial);
+
+            for (int thread_count = 2; thread_count <= 8; ++thread_count)
+                EXPECT_TRUE(calcDirtyRegion(thread_count).equals(serial));
+        }
+    }
+}
+
+TEST_F(DifferTest, BlockSizes)
+{
+    initBuffers(Size(253, 131));
+
+    changePixel(17, 3);
+    changePixel(252, 130);
+
+    {
+        Region expected;
+        expected.addRect(Rect::makeLTRB(16, 0, 32, 16));
+        expected.addRect(Rect::makeLTRB(240, 128, 253, 131));
+
+        EXPECT_TRUE(calcDirtyRegion(1, 16).equals(expected));
+    }
+
+    {
+        Region expected;
+        expected.addRect(Rect::makeLTRB(0, 0, 32, 32));
+        expected.addRect(Rect::makeLTRB(224, 128, 253, 131));
+
+        EXPECT_TRUE(calcDirtyRegion(1, 32).equals(expected));
+    }
+}
+
+TEST_F(DifferTest, BlockSizesParallelMatchesSerial)
+{
+    const int kBlockSizes[] = { 8, 16, 32 };
+
+    initBuffers(Size(1023, 769));
+    changeRandomPixels(300, 1);
+
+    for (int block_size : kBlockSizes)
+    {
+        Region serial = calcDirtyRegion(1, block_size);
+        expectChangesCovered(serial);
+
+        for (int thread_count = 2; thread_count <= 4; ++thread_count)
+            EXPECT_TRUE(calcDirtyRegion(thread_count, block_size).equals(serial));
+    }
+}
+
+TEST_F(DifferTest, FingerprintsMatchFullComparison)
+{
+    for (int thread_count = 1; thread_count <= 3; thread_count += 2)
+    {
+        initBuffers(Size(640, 483));
+
+        Differ differ(size_, Differ::kDefaultBlockSize, thread_count);
+        differ.setFingerprintsEnabled(true);
+
+        Region region;
+
+        for (uint32_t i = 0; i < 6; ++i)
+        {
+            // The frames are compared in turns as the capturers do: the current image of the
+            // previous call becomes the previous image of the next call.
+            prev_.swap(curr_);
+            curr_ = prev_;
+
+            // Every other frame does not change.
+            if (i % 2)
+                changeRandomPixels(static_cast<int>(i * 10), i);
+
+            differ.calcDirtyRegion(prev_.data(), curr_.data(), &region);
+            EXPECT_TRUE(region.equals(calcDirtyRegion(1)));
+            EXPECT_EQ(differ.scanlineFingerprints().size(), static_cast<size_t>(size_.height()));
+        }
+    }
+}
+
+TEST_F(DifferTest, FingerprintsWithOtherPreviousImage)
+{
+    initBuffers(Size(128, 64));
+
+    Differ differ(size_);
+    differ.setFingerprintsEnabled(true);
+
+    Region region;
+
+    // The fingerprints of |curr_| are calculated.
+    differ.calcDirtyRegion(prev_.data(), curr_.data(), &region);
+    EXPECT_TRUE(region.isEmpty());
+
+    // A different previous image must be compared in full.
+    std::vector<uint8_t> other = curr_;
+    other[0] ^= 0xFF;
+
+    differ.calcDirtyRegion(other.data(), curr_.data(), &region);
+    EXPECT_TRUE(region.equals(Region(Rect::makeWH(8, 8))));
+}
+
+TEST_F(DifferTest, FullHintMatchesFullComparison)
+{
+    initBuffers(Size(253, 131));
+    changeRandomPixels(50, 5);
+
+    for (int block_size : { 8, 16, 32 })
+    {
+        for (int thread_count = 1; thread_count <= 3; ++thread_count)
+        {
+            Differ differ(size_, block_size, thread_count);
+            Region region;
+
+            differ.calcDirtyRegion(prev_.data(), curr_.data(), Region(Rect::makeSize(size_)),
+                                   &region);
+
+            EXPECT_TRUE(region.equals(calcDirtyRegion(1, block_size)));
+        }
+    }
+}
+
+TEST_F(DifferTest, HintRestrictsComparison)
+{
+    initBuffers(Size(253, 131));
+
+    changePixel(5, 5);      // Outside of the hint.
+    changePixel(100, 60);   // Inside of the hint.
+    changePixel(250, 129);  // Inside of the partial block of the hint.
+    changePixel(113, 100);  // Outside of the hint, but inside its block.
+
+    Region hint;
+    hint.addRect(Rect::makeXYWH(90, 50, 20, 20));
+    hint.addRect(Rect::makeXYWH(245, 125, 8, 6));
+    hint.addRect(Rect::makeXYWH(117, 97, 2, 2));
+    hint.addRect(Rect::makeXYWH(500, 500, 10, 10)); // Outside of the screen.
+
+    Region expected;
+    expected.addRect(Rect::makeLTRB(96, 56, 104, 64));
+    expected.addRect(Rect::makeLTRB(248, 128, 253, 131));
+    expected.addRect(Rect::makeLTRB(112, 96, 120, 104));
+
+    for (int thread_count = 1; thread_count <= 3; ++thread_count)
+    {
+        Differ differ(size_, Differ::kDefaultBlockSize, thread_count);
+        Region region;
+
+        differ.calcDirtyRegion(prev_.data(), curr_.data(), hint, &region);
+        EXPECT_TRUE(region.equals(expected));
+
+        // The marks of the hint must not leak to the next call.
+        differ.calcDirtyRegion(prev_.data(), curr_.data(), Region(), &region);
+        EXPECT_TRUE(region.isEmpty());
+    }
+}
+
+TEST_F(DifferTest, WideScreen)
+{
+    // A row of 8x8 blocks takes more than 64 words, so the row summary takes several words.
+    initBuffers(Size(40000, 20));
+
+    changePixel(3, 3);
+    changePixel(33000, 10);
+    changePixel(39999, 19);
+
+    Region expected;
+    expected.addRect(Rect::makeLTRB(0, 0, 8, 8));
+    expected.addRect(Rect::makeLTRB(33000, 8, 33008, 16));
+    expected.addRect(Rect::makeLTRB(39992, 16, 40000, 20));
+
+    for (int thread_count = 1; thread_count <= 2; ++thread_count)
+    {
+        EXPECT_TRUE(calcDirtyRegion(thread_count).equals(expected));
+
+        Differ differ(size_, Differ::kDefaultBlockSize, thread_count);
+        Region region;
+
+        differ.calcDirtyRegion(prev_.data(), curr_.data(), Region(Rect::makeSize(size_)),
+                               &region);
+        EXPECT_TRUE(region.equals(expected));
+    }
+}
+
+TEST(DifferBlockSizeTest, DefaultBlockSize)
+{
+    EXPECT_EQ(Differ::defaultBlockSize(Size(1920, 1080)), 8);
+    EXPECT_EQ(Differ::defaultBlockSize(Size(3840, 2160)), 16);
+    EXPECT_EQ(Differ::defaultBlockSize(Size(7680, 2160)), 32);
+
+    EXPECT_TRUE(Differ::isValidBlockSize(8));
+    EXPECT_TRUE(Differ::isValidBlockSize(16));
+    EXPECT_TRUE(Differ::isValidBlockSize(32));
+    EXPECT_FALSE(Differ::isValidBlockSize(4));
+    EXPECT_FALSE(Differ::isValidBlockSize(64));
+}
+
+} // namespace desktop
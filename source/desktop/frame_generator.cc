@@ -0,0 +1,293 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "desktop/frame_generator.h"
+#include "desktop/desktop_frame.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace desktop {
+
+namespace {
+
+const int kGlyphWidth = 8;
+const int kGlyphHeight = 16;
+const int kLineHeight = 20;
+const int kTextMargin = 16;
+
+// Scrolling by the mouse wheel usually moves the content by three lines.
+const int kScrollStep = kLineHeight * 3;
+
+const int kTitleHeight = 24;
+
+const uint32_t kPageColor = 0xFFFFFFFF;
+const uint32_t kTextColor = 0xFF202020;
+const uint32_t kTitleColor = 0xFF3060A0;
+
+uint32_t hash(uint32_t value)
+{
+    value ^= value >> 16;
+    value *= 0x7FEB352D;
+    value ^= value >> 15;
+    value *= 0x846CA68B;
+    value ^= value >> 16;
+    return value;
+}
+
+// Pixel of a text document. The document consists of lines of random length with random glyphs.
+uint32_t textPixel(int x, int y)
+{
+    if (x < 0 || y < 0)
+        return kPageColor;
+
+    const uint32_t line = y / kLineHeight;
+    const uint32_t column = x / kGlyphWidth;
+    const int glyph_y = y % kLineHeight;
+
+    if (glyph_y >= kGlyphHeight || column >= hash(line) % 160)
+        return kPageColor;
+
+    // Every sixth glyph is a space.
+    const uint32_t glyph = hash(line * 65536 + column);
+    if (glyph % 6 == 0)
+        return kPageColor;
+
+    const uint32_t glyph_row = hash(glyph + glyph_y);
+    return (glyph_row & (1 << (x % kGlyphWidth))) ? kTextColor : kPageColor;
+}
+
+uint32_t desktopPixel(int x, int y)
+{
+    return 0xFF204060 + ((x >> 5) & 0x0F) + (((y >> 5) & 0x0F) << 8);
+}
+
+template <typename Function>
+void fillRect(Frame* frame, const Rect& rect, Function pixel)
+{
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        uint32_t* row = reinterpret_cast<uint32_t*>(frame->frameDataAtPos(rect.left(), y));
+
+        for (int x = rect.left(); x < rect.right(); ++x)
+            *row++ = pixel(x, y);
+    }
+}
+
+} // namespace
+
+FrameGenerator::FrameGenerator(Type type, const Size& screen_size, int frame_count)
+    : type_(type),
+      screen_size_(screen_size),
+      frame_count_(frame_count)
+{
+    rewind();
+}
+
+bool FrameGenerator::nextFrame(Frame* frame)
+{
+    if (frame_count_ && frame_number_ >= frame_count_)
+        return false;
+
+    if (frame->size() != screen_size_ || frame->format() != PixelFormat::ARGB())
+        return false;
+
+    switch (type_)
+    {
+        case Type::TYPING:
+            drawTyping(frame);
+            break;
+
+        case Type::SCROLLING:
+            drawScrolling(frame);
+            break;
+
+        case Type::WINDOW_DRAG:
+            drawWindowDrag(frame);
+            break;
+
+        case Type::VIDEO:
+            drawVideo(frame);
+            break;
+    }
+
+    ++frame_number_;
+    return true;
+}
+
+void FrameGenerator::rewind()
+{
+    frame_number_ = 0;
+    caret_pos_ = Point(kTextMargin, kTextMargin);
+
+    window_rect_ = Rect::makeXYWH(
+        0, 0, std::max(screen_size_.width() / 3, 1), std::max(screen_size_.height() / 3, 1));
+    window_delta_ = Point(8, 5);
+}
+
+void FrameGenerator::drawTyping(Frame* frame)
+{
+    const Rect screen_rect = Rect::makeSize(screen_size_);
+
+    if (!frame_number_)
+    {
+        fillRect(frame, screen_rect, [](int /* x */, int /* y */) { return kPageColor; });
+        frame->updatedRegion()->addRect(screen_rect);
+    }
+
+    if (caret_pos_.x() + kGlyphWidth * 2 > screen_size_.width() - kTextMargin)
+        caret_pos_ = Point(kTextMargin, caret_pos_.y() + kLineHeight);
+
+    if (caret_pos_.y() + kLineHeight > screen_size_.height() - kTextMargin)
+        caret_pos_ = Point(kTextMargin, kTextMargin);
+
+    // The glyph replaces the caret and the caret moves to the next position.
+    Rect glyph_rect = Rect::makeXYWH(caret_pos_.x(), caret_pos_.y(), kGlyphWidth, kGlyphHeight);
+    glyph_rect.intersectWith(screen_rect);
+
+    const Point origin = caret_pos_;
+    fillRect(frame, glyph_rect, [origin](int x, int y)
+    {
+        return textPixel(x - origin.x() + kGlyphWidth, y - origin.y());
+    });
+
+    Rect caret_rect = Rect::makeXYWH(
+        caret_pos_.x() + kGlyphWidth, caret_pos_.y(), 2, kGlyphHeight);
+    caret_rect.intersectWith(screen_rect);
+
+    fillRect(frame, caret_rect, [](int /* x */, int /* y */) { return kTextColor; });
+
+    frame->updatedRegion()->addRect(glyph_rect);
+    frame->updatedRegion()->addRect(caret_rect);
+
+    caret_pos_.translate(kGlyphWidth, 0);
+}
+
+void FrameGenerator::drawScrolling(Frame* frame)
+{
+    const Rect screen_rect = Rect::makeSize(screen_size_);
+    const int offset = frame_number_ * kScrollStep;
+
+    if (!frame_number_ || kScrollStep >= screen_size_.height())
+    {
+        fillRect(frame, screen_rect, [offset](int x, int y) { return textPixel(x, y + offset); });
+    }
+    else
+    {
+        const int moved_height = screen_size_.height() - kScrollStep;
+
+        memmove(frame->frameData(),
+                frame->frameDataAtPos(0, kScrollStep),
+                static_cast<size_t>(frame->stride()) * (moved_height - 1) +
+                    screen_size_.width() * frame->format().bytesPerPixel());
+
+        fillRect(frame,
+                 Rect::makeLTRB(0, moved_height, screen_size_.width(), screen_size_.height()),
+                 [offset](int x, int y) { return textPixel(x, y + offset); });
+    }
+
+    frame->updatedRegion()->addRect(screen_rect);
+}
+
+void FrameGenerator::drawWindowDrag(Frame* frame)
+{
+    const Rect screen_rect = Rect::makeSize(screen_size_);
+
+    if (!frame_number_)
+    {
+        drawBackground(frame, screen_rect);
+        drawWindow(frame);
+        frame->updatedRegion()->addRect(screen_rect);
+        return;
+    }
+
+    const Rect prev_rect = window_rect_;
+
+    int dx = window_delta_.x();
+    int dy = window_delta_.y();
+
+    if (window_rect_.left() + dx < 0 || window_rect_.right() + dx > screen_size_.width())
+        dx = -dx;
+
+    if (window_rect_.top() + dy < 0 || window_rect_.bottom() + dy > screen_size_.height())
+        dy = -dy;
+
+    window_delta_ = Point(dx, dy);
+    window_rect_.translate(dx, dy);
+
+    drawBackground(frame, prev_rect);
+    drawWindow(frame);
+
+    frame->updatedRegion()->addRect(prev_rect);
+    frame->updatedRegion()->addRect(window_rect_);
+}
+
+void FrameGenerator::drawVideo(Frame* frame)
+{
+    const Rect screen_rect = Rect::makeSize(screen_size_);
+
+    if (!frame_number_)
+    {
+        drawBackground(frame, screen_rect);
+        frame->updatedRegion()->addRect(screen_rect);
+    }
+
+    const int width = screen_size_.width() / 2;
+    const int height = width * 9 / 16;
+
+    Rect video_rect = Rect::makeXYWH((screen_size_.width() - width) / 2,
+                                     (screen_size_.height() - height) / 2,
+                                     width, height);
+    video_rect.intersectWith(screen_rect);
+
+    // Smooth gradients moving in different directions with some noise, like in a real video.
+    const int time = frame_number_;
+    fillRect(frame, video_rect, [time](int x, int y)
+    {
+        const uint32_t red = (x + time * 4) & 0xFF;
+        const uint32_t green = (y + time * 2) & 0xFF;
+        const uint32_t blue = ((x + y) / 2 + hash((x / 4) * 4096 + (y / 4) + time) % 32) & 0xFF;
+
+        return 0xFF000000 | (red << 16) | (green << 8) | blue;
+    });
+
+    frame->updatedRegion()->addRect(video_rect);
+}
+
+void FrameGenerator::drawBackground(Frame* frame, const Rect& rect)
+{
+    fillRect(frame, rect, desktopPixel);
+}
+
+void FrameGenerator::drawWindow(Frame* frame)
+{
+    const Rect window_rect = window_rect_;
+
+    fillRect(frame, window_rect, [window_rect](int x, int y)
+    {
+        const int window_y = y - window_rect.top();
+
+        if (window_y < kTitleHeight)
+            return kTitleColor;
+
+        return textPixel(x - window_rect.left() - kTextMargin,
+                         window_y - kTitleHeight - kTextMargin);
+    });
+}
+
+} // namespace desktop
@@ -0,0 +1,72 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef DESKTOP__FRAME_GENERATOR_H
+#define DESKTOP__FRAME_GENERATOR_H
+
+#include "base/macros_magic.h"
+#include "desktop/frame_source.h"
+
+namespace desktop {
+
+// Generates typical screen activity. The output depends only on the type, the size of the screen
+// and the frame number, so it is repeatable.
+class FrameGenerator : public FrameSource
+{
+public:
+    enum class Type
+    {
+        TYPING,      // A character and a caret appear in each frame.
+        SCROLLING,   // The whole screen scrolls up by a few lines in each frame.
+        WINDOW_DRAG, // A window moves across the screen.
+        VIDEO        // A video plays in the center of the screen.
+    };
+
+    // If |frame_count| is 0, the sequence is endless.
+    FrameGenerator(Type type, const Size& screen_size, int frame_count);
+    ~FrameGenerator() = default;
+
+    // FrameSource implementation.
+    Size screenSize() const override { return screen_size_; }
+    bool nextFrame(Frame* frame) override;
+    void rewind() override;
+
+private:
+    void drawTyping(Frame* frame);
+    void drawScrolling(Frame* frame);
+    void drawWindowDrag(Frame* frame);
+    void drawVideo(Frame* frame);
+
+    void drawBackground(Frame* frame, const Rect& rect);
+    void drawWindow(Frame* frame);
+
+    const Type type_;
+    const Size screen_size_;
+    const int frame_count_;
+
+    int frame_number_ = 0;
+    Point caret_pos_;
+    Rect window_rect_;
+    Point window_delta_;
+
+    DISALLOW_COPY_AND_ASSIGN(FrameGenerator);
+};
+
+} // namespace desktop
+
+#endif // DESKTOP__FRAME_GENERATOR_H
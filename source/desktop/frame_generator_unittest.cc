@@ -0,0 +1,146 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "desktop/frame_generator.h"
+#include "desktop/desktop_frame_simple.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+namespace desktop {
+
+namespace {
+
+const Size kScreenSize(800, 600);
+
+bool isEqualFrame(const Frame& frame1, const Frame& frame2)
+{
+    if (frame1.size() != frame2.size())
+        return false;
+
+    const size_t row_size = frame1.size().width() * frame1.format().bytesPerPixel();
+
+    for (int y = 0; y < frame1.size().height(); ++y)
+    {
+        if (memcmp(frame1.frameDataAtPos(0, y), frame2.frameDataAtPos(0, y), row_size) != 0)
+            return false;
+    }
+
+    return true;
+}
+
+} // namespace
+
+class FrameGeneratorTest : public testing::TestWithParam<FrameGenerator::Type>
+{
+    // Nothing
+};
+
+TEST_P(FrameGeneratorTest, Repeatable)
+{
+    FrameGenerator generator1(GetParam(), kScreenSize, 20);
+    FrameGenerator generator2(GetParam(), kScreenSize, 20);
+
+    std::unique_ptr<Frame> frame1 = FrameSimple::create(kScreenSize, PixelFormat::ARGB());
+    std::unique_ptr<Frame> frame2 = FrameSimple::create(kScreenSize, PixelFormat::ARGB());
+
+    const Rect screen_rect = Rect::makeSize(kScreenSize);
+
+    for (int i = 0; i < 20; ++i)
+    {
+        frame1->updatedRegion()->clear();
+        frame2->updatedRegion()->clear();
+
+        ASSERT_TRUE(generator1.nextFrame(frame1.get()));
+        ASSERT_TRUE(generator2.nextFrame(frame2.get()));
+
+        EXPECT_TRUE(isEqualFrame(*frame1, *frame2));
+        EXPECT_TRUE(frame1->constUpdatedRegion().equals(frame2->constUpdatedRegion()));
+        EXPECT_FALSE(frame1->constUpdatedRegion().isEmpty());
+
+        for (Region::Iterator it(frame1->constUpdatedRegion()); !it.isAtEnd(); it.advance())
+            EXPECT_TRUE(screen_rect.containsRect(it.rect()));
+
+        // The first frame covers the whole screen.
+        if (!i)
+        {
+            EXPECT_TRUE(frame1->constUpdatedRegion().equals(Region(screen_rect)));
+        }
+    }
+
+    // The end of the sequence.
+    EXPECT_FALSE(generator1.nextFrame(frame1.get()));
+
+    // After the rewind the sequence starts again.
+    generator1.rewind();
+    generator2.rewind();
+
+    ASSERT_TRUE(generator1.nextFrame(frame1.get()));
+    ASSERT_TRUE(generator2.nextFrame(frame2.get()));
+    EXPECT_TRUE(isEqualFrame(*frame1, *frame2));
+}
+
+TEST_P(FrameGeneratorTest, InvalidFrame)
+{
+    FrameGenerator generator(GetParam(), kScreenSize, 0);
+
+    std::unique_ptr<Frame> frame = FrameSimple::create(Size(640, 480), PixelFormat::ARGB());
+    EXPECT_FALSE(generator.nextFrame(frame.get()));
+}
+
+INSTANTIATE_TEST_CASE_P(Types,
+                        FrameGeneratorTest,
+                        testing::Values(FrameGenerator::Type::TYPING,
+                                        FrameGenerator::Type::SCROLLING,
+                                        FrameGenerator::Type::WINDOW_DRAG,
+                                        FrameGenerator::Type::VIDEO));
+
+TEST(FrameGeneratorScrollingTest, ContentMoves)
+{
+    FrameGenerator generator(FrameGenerator::Type::SCROLLING, kScreenSize, 0);
+
+    std::unique_ptr<Frame> frame = FrameSimple::create(kScreenSize, PixelFormat::ARGB());
+    std::unique_ptr<Frame> prev_frame = FrameSimple::create(kScreenSize, PixelFormat::ARGB());
+
+    ASSERT_TRUE(generator.nextFrame(frame.get()));
+    prev_frame->copyPixelsFrom(*frame, Point(0, 0), Rect::makeSize(kScreenSize));
+    ASSERT_TRUE(generator.nextFrame(frame.get()));
+
+    // The content of the previous frame is found in the new one at some offset.
+    const size_t row_size = kScreenSize.width() * frame->format().bytesPerPixel();
+    int offset = 1;
+
+    for (; offset < kScreenSize.height(); ++offset)
+    {
+        bool equal = true;
+
+        for (int y = offset; y < kScreenSize.height() && equal; ++y)
+        {
+            equal = memcmp(frame->frameDataAtPos(0, y - offset),
+                           prev_frame->frameDataAtPos(0, y), row_size) == 0;
+        }
+
+        if (equal)
+            break;
+    }
+
+    EXPECT_LT(offset, kScreenSize.height() / 2);
+}
+
+} // namespace desktop
@@ -0,0 +1,197 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "desktop/frame_pool.h"
+#include "base/aligned_memory.h"
+
+#include <list>
+#include <mutex>
+
+namespace desktop {
+
+namespace {
+
+const size_t kBufferAlignment = 32;
+
+// A 4K frame takes about 32MB, so the pool of the process keeps a couple of such buffers.
+const size_t kMaxCachedBytes = 96 * 1024 * 1024; // 96MB
+
+} // namespace
+
+class FramePool::Storage
+{
+public:
+    explicit Storage(size_t max_cached_bytes)
+        : max_cached_bytes_(max_cached_bytes)
+    {
+        // Nothing
+    }
+
+    ~Storage()
+    {
+        clear();
+    }
+
+    uint8_t* take(const Size& size, const PixelFormat& format)
+    {
+        std::scoped_lock lock(lock_);
+
+        // Search from the most recently released buffer.
+        for (auto it = buffers_.rbegin(); it != buffers_.rend(); ++it)
+        {
+            if (it->size == size && it->format == format)
+            {
+                uint8_t* data = it->data;
+
+                cached_bytes_ -= it->bytes;
+                buffers_.erase(std::next(it).base());
+                return data;
+            }
+        }
+
+        return nullptr;
+    }
+
+    void put(const Size& size, const PixelFormat& format, uint8_t* data, size_t bytes)
+    {
+        std::scoped_lock lock(lock_);
+
+        if (bytes > max_cached_bytes_)
+        {
+            base::alignedFree(data);
+            return;
+        }
+
+        // Free the least recently released buffers.
+        while (cached_bytes_ + bytes > max_cached_bytes_)
+        {
+            cached_bytes_ -= buffers_.front().bytes;
+            base::alignedFree(buffers_.front().data);
+            buffers_.pop_front();
+        }
+
+        buffers_.push_back({ size, format, data, bytes });
+        cached_bytes_ += bytes;
+    }
+
+    size_t cachedBytes() const
+    {
+        std::scoped_lock lock(lock_);
+        return cached_bytes_;
+    }
+
+    void clear()
+    {
+        std::scoped_lock lock(lock_);
+
+        for (const auto& buffer : buffers_)
+            base::alignedFree(buffer.data);
+
+        buffers_.clear();
+        cached_bytes_ = 0;
+    }
+
+private:
+    struct Buffer
+    {
+        Size size;
+        PixelFormat format;
+        uint8_t* data;
+        size_t bytes;
+    };
+
+    const size_t max_cached_bytes_;
+
+    // Sorted by the time of the release.
+    std::list<Buffer> buffers_;
+    size_t cached_bytes_ = 0;
+
+    mutable std::mutex lock_;
+
+    DISALLOW_COPY_AND_ASSIGN(Storage);
+};
+
+class FramePool::PooledFrame : public Frame
+{
+public:
+    PooledFrame(const Size& size, const PixelFormat& format, int stride, uint8_t* data,
+                std::shared_ptr<Storage> storage)
+        : Frame(size, format, stride, data),
+          storage_(std::move(storage))
+    {
+        // Nothing
+    }
+
+    ~PooledFrame()
+    {
+        storage_->put(size(), format(), data_, stride() * size().height());
+    }
+
+private:
+    std::shared_ptr<Storage> storage_;
+
+    DISALLOW_COPY_AND_ASSIGN(PooledFrame);
+};
+
+FramePool::FramePool(size_t max_cached_bytes)
+    : storage_(std::make_shared<Storage>(max_cached_bytes))
+{
+    // Nothing
+}
+
+FramePool::~FramePool()
+{
+    // The buffers of the frames which are still alive are freed when the frames are destroyed.
+    storage_->clear();
+}
+
+// static
+FramePool* FramePool::instance()
+{
+    // The pool is never destroyed, so the frames may be released at any time.
+    static FramePool* pool = new FramePool(kMaxCachedBytes);
+    return pool;
+}
+
+std::unique_ptr<Frame> FramePool::allocate(const Size& size, const PixelFormat& format)
+{
+    const int stride = size.width() * format.bytesPerPixel();
+
+    uint8_t* data = storage_->take(size, format);
+    if (!data)
+    {
+        data = reinterpret_cast<uint8_t*>(
+            base::alignedAlloc(stride * size.height(), kBufferAlignment));
+        if (!data)
+            return nullptr;
+    }
+
+    return std::make_unique<PooledFrame>(size, format, stride, data, storage_);
+}
+
+size_t FramePool::cachedBytes() const
+{
+    return storage_->cachedBytes();
+}
+
+void FramePool::clear()
+{
+    storage_->clear();
+}
+
+} // namespace desktop
@@ -0,0 +1,65 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef DESKTOP__FRAME_POOL_H
+#define DESKTOP__FRAME_POOL_H
+
+#include "desktop/desktop_frame.h"
+
+#include <memory>
+
+namespace desktop {
+
+// Keeps the buffers of the released frames for reuse. Frame buffers are large (tens of megabytes
+// for high resolutions), and allocating and freeing them on each resolution switch or session
+// restart causes allocation spikes and page faults. The frames allocated from the pool return
+// their buffers to it when destroyed. The buffers are 32-byte aligned and are reused only for
+// frames with the same size and pixel format. If the released buffers exceed the limit of the
+// pool, the least recently released ones are freed.
+// The class is thread-safe. A frame may outlive the pool; its buffer is freed then.
+class FramePool
+{
+public:
+    explicit FramePool(size_t max_cached_bytes);
+    ~FramePool();
+
+    // Returns the pool shared by all users in the process.
+    static FramePool* instance();
+
+    // Returns a frame with a buffer from the pool or a newly allocated one. Returns nullptr if
+    // the memory could not be allocated.
+    std::unique_ptr<Frame> allocate(const Size& size, const PixelFormat& format);
+
+    // Returns the size of the buffers kept for reuse.
+    size_t cachedBytes() const;
+
+    // Frees all the buffers kept for reuse.
+    void clear();
+
+private:
+    class Storage;
+    class PooledFrame;
+
+    std::shared_ptr<Storage> storage_;
+
+    DISALLOW_COPY_AND_ASSIGN(FramePool);
+};
+
+} // namespace desktop
+
+#endif // DESKTOP__FRAME_POOL_H
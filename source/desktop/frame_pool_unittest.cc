@@ -0,0 +1,100 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "desktop/frame_pool.h"
+
+#include <gtest/gtest.h>
+
+namespace desktop {
+
+TEST(FramePoolTest, ReuseBuffer)
+{
+    FramePool pool(64 * 1024 * 1024);
+
+    std::unique_ptr<Frame> frame = pool.allocate(Size(640, 480), PixelFormat::ARGB());
+    ASSERT_TRUE(frame);
+    EXPECT_EQ(frame->size(), Size(640, 480));
+    EXPECT_EQ(frame->stride(), 640 * 4);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(frame->frameData()) % 32, 0);
+
+    uint8_t* data = frame->frameData();
+    frame.reset();
+    EXPECT_EQ(pool.cachedBytes(), 640 * 480 * 4);
+
+    // A frame with another size or format does not get the buffer.
+    frame = pool.allocate(Size(480, 640), PixelFormat::ARGB());
+    ASSERT_TRUE(frame);
+    EXPECT_NE(frame->frameData(), data);
+
+    std::unique_ptr<Frame> frame2 = pool.allocate(Size(640, 480), PixelFormat::RGB565());
+    ASSERT_TRUE(frame2);
+    EXPECT_NE(frame2->frameData(), data);
+    EXPECT_EQ(pool.cachedBytes(), 640 * 480 * 4);
+
+    std::unique_ptr<Frame> frame3 = pool.allocate(Size(640, 480), PixelFormat::ARGB());
+    ASSERT_TRUE(frame3);
+    EXPECT_EQ(frame3->frameData(), data);
+    EXPECT_EQ(pool.cachedBytes(), 0);
+}
+
+TEST(FramePoolTest, Limit)
+{
+    const size_t kFrameBytes = 100 * 100 * 4;
+    FramePool pool(kFrameBytes * 2);
+
+    std::unique_ptr<Frame> frame1 = pool.allocate(Size(100, 100), PixelFormat::ARGB());
+    std::unique_ptr<Frame> frame2 = pool.allocate(Size(100, 100), PixelFormat::ARGB());
+    std::unique_ptr<Frame> frame3 = pool.allocate(Size(100, 100), PixelFormat::ARGB());
+    std::unique_ptr<Frame> large_frame = pool.allocate(Size(200, 200), PixelFormat::ARGB());
+
+    uint8_t* data3 = frame3->frameData();
+
+    frame1.reset();
+    frame2.reset();
+    frame3.reset();
+
+    // The least recently released buffer is freed.
+    EXPECT_EQ(pool.cachedBytes(), kFrameBytes * 2);
+
+    // The buffer is larger than the limit of the pool.
+    large_frame.reset();
+    EXPECT_EQ(pool.cachedBytes(), kFrameBytes * 2);
+
+    // The most recently released buffer is used first.
+    frame1 = pool.allocate(Size(100, 100), PixelFormat::ARGB());
+    EXPECT_EQ(frame1->frameData(), data3);
+
+    pool.clear();
+    EXPECT_EQ(pool.cachedBytes(), 0);
+}
+
+TEST(FramePoolTest, FrameOutlivesPool)
+{
+    std::unique_ptr<Frame> frame;
+
+    {
+        FramePool pool(64 * 1024 * 1024);
+        frame = pool.allocate(Size(100, 100), PixelFormat::ARGB());
+        ASSERT_TRUE(frame);
+    }
+
+    memset(frame->frameData(), 0, frame->stride() * frame->size().height());
+    frame.reset();
+}
+
+} // namespace desktop
@@ -0,0 +1,48 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef DESKTOP__FRAME_SOURCE_H
+#define DESKTOP__FRAME_SOURCE_H
+
+#include "desktop/desktop_geometry.h"
+
+namespace desktop {
+
+class Frame;
+
+// A sequence of screen changes which does not require a real screen. Used by
+// ScreenCapturerReplay to measure the capture-encode pipeline on any platform.
+class FrameSource
+{
+public:
+    virtual ~FrameSource() = default;
+
+    virtual Size screenSize() const = 0;
+
+    // Applies the next change of the sequence to |frame| and adds the changed area to the updated
+    // region of |frame|. The first change after creation or rewind() covers the whole screen.
+    // Returns false at the end of the sequence or if an error occurred.
+    virtual bool nextFrame(Frame* frame) = 0;
+
+    // Returns to the beginning of the sequence.
+    virtual void rewind() = 0;
+};
+
+} // namespace desktop
+
+#endif // DESKTOP__FRAME_SOURCE_H
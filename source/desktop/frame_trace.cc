@@ -0,0 +1,311 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "desktop/frame_trace.h"
+#include "base/logging.h"
+#include "desktop/desktop_frame.h"
+
+#include <cstring>
+#include <limits>
+
+namespace desktop {
+
+namespace {
+
+const char kMagic[4] = { 'A', 'F', 'T', 'R' };
+const uint32_t kVersion = 1;
+const int kBytesPerPixel = 4;
+
+struct TraceHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t frame_count;
+    uint32_t reserved;
+};
+
+struct FrameHeader
+{
+    uint32_t timestamp;
+    uint32_t rect_count;
+};
+
+struct RectHeader
+{
+    int32_t x;
+    int32_t y;
+    int32_t width;
+    int32_t height;
+};
+
+static_assert(sizeof(TraceHeader) == 24, "Unexpected trace header size");
+static_assert(sizeof(FrameHeader) == 8, "Unexpected frame header size");
+static_assert(sizeof(RectHeader) == 16, "Unexpected rectangle header size");
+
+size_t alignSize(size_t size)
+{
+    return (size + 7) & ~static_cast<size_t>(7);
+}
+
+template <typename T>
+void append(std::vector<uint8_t>* buffer, const T& value)
+{
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(&value);
+    buffer->insert(buffer->end(), data, data + sizeof(T));
+}
+
+} // namespace
+
+FrameTraceWriter::FrameTraceWriter(const Size& screen_size)
+    : screen_size_(screen_size)
+{
+    // Nothing
+}
+
+bool FrameTraceWriter::addFrame(const Frame& frame, const std::chrono::milliseconds& timestamp)
+{
+    if (frame.size() != screen_size_ || frame.format() != PixelFormat::ARGB())
+    {
+        LOG(LS_WARNING) << "The frame does not match the trace";
+        return false;
+    }
+
+    const Rect screen_rect = Rect::makeSize(screen_size_);
+
+    Region region;
+    if (offsets_.empty())
+        region.addRect(screen_rect);
+    else
+        region.addRegion(frame.constUpdatedRegion());
+
+    region.intersectWith(screen_rect);
+
+    std::vector<Rect> rects;
+    for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+        rects.push_back(it.rect());
+
+    offsets_.push_back(records_.size());
+
+    FrameHeader frame_header;
+    frame_header.timestamp = static_cast<uint32_t>(timestamp.count());
+    frame_header.rect_count = static_cast<uint32_t>(rects.size());
+    append(&records_, frame_header);
+
+    for (const auto& rect : rects)
+        append(&records_, RectHeader{ rect.x(), rect.y(), rect.width(), rect.height() });
+
+    for (const auto& rect : rects)
+    {
+        const size_t row_size = rect.width() * kBytesPerPixel;
+        const uint8_t* row = frame.frameDataAtPos(rect.topLeft());
+
+        for (int y = 0; y < rect.height(); ++y)
+        {
+            records_.insert(records_.end(), row, row + row_size);
+            row += frame.stride();
+        }
+    }
+
+    records_.resize(alignSize(records_.size()));
+    return true;
+}
+
+std::vector<uint8_t> FrameTraceWriter::finish() const
+{
+    TraceHeader header;
+    memcpy(header.magic, kMagic, sizeof(header.magic));
+    header.version = kVersion;
+    header.width = screen_size_.width();
+    header.height = screen_size_.height();
+    header.frame_count = static_cast<uint32_t>(offsets_.size());
+    header.reserved = 0;
+
+    const uint64_t records_offset = sizeof(TraceHeader) + offsets_.size() * sizeof(uint64_t);
+
+    std::vector<uint8_t> trace;
+    trace.reserve(records_offset + records_.size());
+
+    append(&trace, header);
+
+    for (const auto& offset : offsets_)
+        append(&trace, records_offset + offset);
+
+    trace.insert(trace.end(), records_.begin(), records_.end());
+    return trace;
+}
+
+FrameTraceReader::FrameTraceReader(
+    const base::ConstBuffer& buffer, const Size& screen_size, uint32_t frame_count)
+    : buffer_(buffer),
+      screen_size_(screen_size),
+      frame_count_(frame_count)
+{
+    // Nothing
+}
+
+// static
+std::unique_ptr<FrameTraceReader> FrameTraceReader::create(const base::ConstBuffer& buffer)
+{
+    if (!buffer.isValid() || buffer.size() < sizeof(TraceHeader))
+    {
+        LOG(LS_WARNING) << "The trace is too small";
+        return nullptr;
+    }
+
+    TraceHeader header;
+    memcpy(&header, buffer.data(), sizeof(header));
+
+    if (memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion)
+    {
+        LOG(LS_WARNING) << "Unknown trace format";
+        return nullptr;
+    }
+
+    static const uint32_t kMaxScreenSize = std::numeric_limits<uint16_t>::max();
+
+    if (!header.width || header.width > kMaxScreenSize ||
+        !header.height || header.height > kMaxScreenSize || !header.frame_count)
+    {
+        LOG(LS_WARNING) << "Invalid trace header";
+        return nullptr;
+    }
+
+    if ((buffer.size() - sizeof(TraceHeader)) / sizeof(uint64_t) < header.frame_count)
+    {
+        LOG(LS_WARNING) << "The trace is truncated";
+        return nullptr;
+    }
+
+    return std::unique_ptr<FrameTraceReader>(new FrameTraceReader(
+        buffer, Size(header.width, header.height), header.frame_count));
+}
+
+std::chrono::milliseconds FrameTraceReader::nextTimestamp() const
+{
+    size_t size;
+    const uint8_t* record = frameRecord(next_frame_, &size);
+    if (!record || size < sizeof(FrameHeader))
+        return std::chrono::milliseconds::zero();
+
+    FrameHeader frame_header;
+    memcpy(&frame_header, record, sizeof(frame_header));
+
+    return std::chrono::milliseconds(frame_header.timestamp);
+}
+
+bool FrameTraceReader::nextFrame(Frame* frame)
+{
+    if (frame->size() != screen_size_ || frame->format() != PixelFormat::ARGB())
+    {
+        LOG(LS_WARNING) << "The frame does not match the trace";
+        return false;
+    }
+
+    size_t size;
+    const uint8_t* record = frameRecord(next_frame_, &size);
+    if (!record)
+        return false;
+
+    FrameHeader frame_header;
+    if (size < sizeof(frame_header))
+        return false;
+
+    memcpy(&frame_header, record, sizeof(frame_header));
+    record += sizeof(frame_header);
+    size -= sizeof(frame_header);
+
+    if (size / sizeof(RectHeader) < frame_header.rect_count)
+    {
+        LOG(LS_WARNING) << "The frame record is truncated";
+        return false;
+    }
+
+    const uint8_t* pixels = record + frame_header.rect_count * sizeof(RectHeader);
+    size_t pixels_size = size - frame_header.rect_count * sizeof(RectHeader);
+
+    const Rect screen_rect = Rect::makeSize(screen_size_);
+
+    for (uint32_t i = 0; i < frame_header.rect_count; ++i)
+    {
+        RectHeader rect_header;
+        memcpy(&rect_header, record + i * sizeof(RectHeader), sizeof(rect_header));
+
+        const Rect rect = Rect::makeXYWH(
+            rect_header.x, rect_header.y, rect_header.width, rect_header.height);
+
+        if (rect.isEmpty() || !screen_rect.containsRect(rect))
+        {
+            LOG(LS_WARNING) << "The rectangle is outside the screen area";
+            return false;
+        }
+
+        const size_t row_size = rect.width() * kBytesPerPixel;
+        if (pixels_size / row_size < static_cast<size_t>(rect.height()))
+        {
+            LOG(LS_WARNING) << "The frame record is truncated";
+            return false;
+        }
+
+        frame->copyPixelsFrom(pixels, static_cast<int>(row_size), rect);
+        frame->updatedRegion()->addRect(rect);
+
+        pixels += row_size * rect.height();
+        pixels_size -= row_size * rect.height();
+    }
+
+    ++next_frame_;
+    return true;
+}
+
+void FrameTraceReader::rewind()
+{
+    next_frame_ = 0;
+}
+
+const uint8_t* FrameTraceReader::frameRecord(uint32_t index, size_t* size) const
+{
+    if (index >= frame_count_)
+        return nullptr;
+
+    uint64_t offset;
+    memcpy(&offset, buffer_.data() + sizeof(TraceHeader) + index * sizeof(uint64_t),
+           sizeof(offset));
+
+    uint64_t next_offset = buffer_.size();
+    if (index + 1 < frame_count_)
+    {
+        memcpy(&next_offset,
+               buffer_.data() + sizeof(TraceHeader) + (index + 1) * sizeof(uint64_t),
+               sizeof(next_offset));
+    }
+
+    const uint64_t records_offset = sizeof(TraceHeader) + frame_count_ * sizeof(uint64_t);
+
+    if (offset < records_offset || offset > next_offset || next_offset > buffer_.size())
+    {
+        LOG(LS_WARNING) << "Invalid frame offset";
+        return nullptr;
+    }
+
+    *size = static_cast<size_t>(next_offset - offset);
+    return buffer_.data() + offset;
+}
+
+} // namespace desktop
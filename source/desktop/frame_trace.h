@@ -0,0 +1,101 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef DESKTOP__FRAME_TRACE_H
+#define DESKTOP__FRAME_TRACE_H
+
+#include "base/const_buffer.h"
+#include "base/macros_magic.h"
+#include "desktop/frame_source.h"
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace desktop {
+
+// The trace stores a sequence of frames as deltas: each frame contains only its updated
+// rectangles and their pixels. All values are little-endian and the records are 8-byte aligned,
+// so the trace may be used directly from a memory-mapped file.
+//
+// Header                 magic "AFTR", version, screen width and height, frame count.
+// Frame offsets          uint64_t for each frame, from the beginning of the trace.
+// Frame records          timestamp in milliseconds, number of rectangles, rectangles (x, y,
+//                        width, height) and the pixels of the rectangles in the same order, rows
+//                        without padding. The pixel format is always ARGB.
+//
+// The first frame always covers the whole screen.
+
+class FrameTraceWriter
+{
+public:
+    explicit FrameTraceWriter(const Size& screen_size);
+    ~FrameTraceWriter() = default;
+
+    // Adds the updated region of |frame| to the trace. Returns false if the size or the format of
+    // the frame does not match the trace.
+    bool addFrame(const Frame& frame, const std::chrono::milliseconds& timestamp);
+
+    // Returns the complete trace.
+    std::vector<uint8_t> finish() const;
+
+private:
+    const Size screen_size_;
+
+    std::vector<uint64_t> offsets_;
+    std::vector<uint8_t> records_;
+
+    DISALLOW_COPY_AND_ASSIGN(FrameTraceWriter);
+};
+
+class FrameTraceReader : public FrameSource
+{
+public:
+    ~FrameTraceReader() = default;
+
+    // Checks the header of |buffer| and creates the reader. The buffer must stay valid while the
+    // reader exists. Returns nullptr if the buffer does not contain a trace.
+    static std::unique_ptr<FrameTraceReader> create(const base::ConstBuffer& buffer);
+
+    int frameCount() const { return static_cast<int>(frame_count_); }
+
+    // Returns the timestamp of the frame which will be returned by the next call of nextFrame().
+    std::chrono::milliseconds nextTimestamp() const;
+
+    // FrameSource implementation.
+    Size screenSize() const override { return screen_size_; }
+    bool nextFrame(Frame* frame) override;
+    void rewind() override;
+
+private:
+    FrameTraceReader(const base::ConstBuffer& buffer, const Size& screen_size, uint32_t frame_count);
+
+    const uint8_t* frameRecord(uint32_t index, size_t* size) const;
+
+    const base::ConstBuffer buffer_;
+    const Size screen_size_;
+    const uint32_t frame_count_;
+    uint32_t next_frame_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(FrameTraceReader);
+};
+
+} // namespace desktop
+
+#endif // DESKTOP__FRAME_TRACE_H
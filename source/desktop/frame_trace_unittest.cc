@@ -0,0 +1,152 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "desktop/frame_trace.h"
+#include "desktop/desktop_frame_simple.h"
+#include "desktop/frame_generator.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+namespace desktop {
+
+namespace {
+
+const Size kScreenSize(320, 240);
+const int kFrameCount = 30;
+
+bool isEqualFrame(const Frame& frame1, const Frame& frame2)
+{
+    const size_t row_size = frame1.size().width() * frame1.format().bytesPerPixel();
+
+    for (int y = 0; y < frame1.size().height(); ++y)
+    {
+        if (memcmp(frame1.frameDataAtPos(0, y), frame2.frameDataAtPos(0, y), row_size) != 0)
+            return false;
+    }
+
+    return true;
+}
+
+std::vector<uint8_t> writeTrace(FrameGenerator::Type type)
+{
+    FrameGenerator generator(type, kScreenSize, kFrameCount);
+    FrameTraceWriter writer(kScreenSize);
+
+    std::unique_ptr<Frame> frame = FrameSimple::create(kScreenSize, PixelFormat::ARGB());
+
+    for (int i = 0; i < kFrameCount; ++i)
+    {
+        frame->updatedRegion()->clear();
+
+        EXPECT_TRUE(generator.nextFrame(frame.get()));
+        EXPECT_TRUE(writer.addFrame(*frame, std::chrono::milliseconds(i * 40)));
+    }
+
+    return writer.finish();
+}
+
+} // namespace
+
+TEST(FrameTraceTest, RoundTrip)
+{
+    const FrameGenerator::Type types[] =
+    {
+        FrameGenerator::Type::TYPING,
+        FrameGenerator::Type::SCROLLING,
+        FrameGenerator::Type::WINDOW_DRAG,
+        FrameGenerator::Type::VIDEO
+    };
+
+    for (const auto& type : types)
+    {
+        std::vector<uint8_t> trace = writeTrace(type);
+
+        std::unique_ptr<FrameTraceReader> reader =
+            FrameTraceReader::create(base::ConstBuffer(trace.data(), trace.size()));
+        ASSERT_TRUE(reader);
+        EXPECT_EQ(reader->frameCount(), kFrameCount);
+        EXPECT_EQ(reader->screenSize(), kScreenSize);
+
+        FrameGenerator generator(type, kScreenSize, kFrameCount);
+
+        std::unique_ptr<Frame> expected = FrameSimple::create(kScreenSize, PixelFormat::ARGB());
+        std::unique_ptr<Frame> actual = FrameSimple::create(kScreenSize, PixelFormat::ARGB());
+
+        for (int i = 0; i < kFrameCount; ++i)
+        {
+            expected->updatedRegion()->clear();
+            actual->updatedRegion()->clear();
+
+            EXPECT_EQ(reader->nextTimestamp(), std::chrono::milliseconds(i * 40));
+
+            ASSERT_TRUE(generator.nextFrame(expected.get()));
+            ASSERT_TRUE(reader->nextFrame(actual.get()));
+
+            EXPECT_TRUE(isEqualFrame(*expected, *actual));
+            EXPECT_TRUE(expected->constUpdatedRegion().equals(actual->constUpdatedRegion()));
+        }
+
+        EXPECT_FALSE(reader->nextFrame(actual.get()));
+
+        // The first frame after the rewind covers the whole screen.
+        reader->rewind();
+        actual->updatedRegion()->clear();
+
+        ASSERT_TRUE(reader->nextFrame(actual.get()));
+        EXPECT_TRUE(actual->constUpdatedRegion().equals(Region(Rect::makeSize(kScreenSize))));
+    }
+}
+
+TEST(FrameTraceTest, InvalidTrace)
+{
+    std::vector<uint8_t> trace = writeTrace(FrameGenerator::Type::TYPING);
+
+    // Too small for the header.
+    EXPECT_FALSE(FrameTraceReader::create(base::ConstBuffer(trace.data(), 16)));
+
+    // The offset table is truncated.
+    EXPECT_FALSE(FrameTraceReader::create(base::ConstBuffer(trace.data(), 64)));
+
+    // Invalid magic.
+    std::vector<uint8_t> invalid_magic = trace;
+    invalid_magic[0] = 'X';
+    EXPECT_FALSE(FrameTraceReader::create(
+        base::ConstBuffer(invalid_magic.data(), invalid_magic.size())));
+
+    // The pixels of the last frame are truncated.
+    std::unique_ptr<FrameTraceReader> reader =
+        FrameTraceReader::create(base::ConstBuffer(trace.data(), trace.size() - 16));
+    ASSERT_TRUE(reader);
+
+    std::unique_ptr<Frame> frame = FrameSimple::create(kScreenSize, PixelFormat::ARGB());
+
+    for (int i = 0; i < kFrameCount - 1; ++i)
+        EXPECT_TRUE(reader->nextFrame(frame.get()));
+
+    EXPECT_FALSE(reader->nextFrame(frame.get()));
+
+    // A frame of another size.
+    reader->rewind();
+
+    std::unique_ptr<Frame> other_frame = FrameSimple::create(Size(100, 100), PixelFormat::ARGB());
+    EXPECT_FALSE(reader->nextFrame(other_frame.get()));
+}
+
+} // namespace desktop
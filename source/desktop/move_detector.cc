@@ -0,0 +1,329 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "desktop/move_detector.h"
+#include "desktop/desktop_frame.h"
+
+#include <cstring>
+
+namespace desktop {
+
+namespace {
+
+// Width of the hashed row segments in pixels.
+const int kSegmentWidth = 16;
+
+// Only every eighth row of the current frame is looked up in the index.
+const int kSampleRowStep = 8;
+
+// Smaller updated areas are not checked (typing, blinking caret).
+const int kMinAreaWidth = 64;
+const int kMinAreaHeight = 32;
+
+const int kMinVotes = 8;
+
+// The found rectangle must be at least this large to be worth a copy.
+const int kMinMovedPixels = 64 * 32;
+
+const uint64_t kHashBase = 0x100000001B3;
+
+// kHashBase ^ (kSegmentWidth - 1).
+constexpr uint64_t hashBasePower()
+{
+    uint64_t result = 1;
+
+    for (int i = 0; i < kSegmentWidth - 1; ++i)
+        result *= kHashBase;
+
+    return result;
+}
+
+const uint64_t kHashBasePower = hashBasePower();
+
+uint64_t segmentHash(const uint32_t* pixels)
+{
+    uint64_t hash = 0;
+
+    for (int i = 0; i < kSegmentWidth; ++i)
+        hash = hash * kHashBase + pixels[i];
+
+    return hash;
+}
+
+// Segments of a solid color occur everywhere and give no information about the offset.
+bool isSolidSegment(const uint32_t* pixels)
+{
+    return pixels[0] == pixels[kSegmentWidth / 2] && pixels[0] == pixels[kSegmentWidth - 1];
+}
+
+const uint32_t* rowAt(const Frame& frame, int x, int y)
+{
+    return reinterpret_cast<const uint32_t*>(frame.frameDataAtPos(x, y));
+}
+
+// The offsets are packed as unsigned values, a left shift of a negative value is undefined.
+uint64_t packOffset(int dx, int dy)
+{
+    return (static_cast<uint64_t>(static_cast<uint32_t>(dx)) << 32) | static_cast<uint32_t>(dy);
+}
+
+size_t roundUpToPowerOfTwo(size_t value)
+{
+    size_t result = 1;
+
+    while (result < value)
+        result <<= 1;
+
+    return result;
+}
+
+} // namespace
+
+bool MoveDetector::detect(const Frame& previous_frame,
+                          const Frame& current_frame,
+                          const Region& updated_region,
+                          Rect* dest_rect,
+                          Point* source_pos)
+{
+    if (previous_frame.size() != current_frame.size() ||
+        previous_frame.format() != current_frame.format() ||
+        current_frame.format().bytesPerPixel() != sizeof(uint32_t))
+    {
+        return false;
+    }
+
+    const Rect frame_rect = Rect::makeSize(current_frame.size());
+
+    Rect area;
+    for (Region::Iterator it(updated_region); !it.isAtEnd(); it.advance())
+        area.unionWith(it.rect());
+
+    area.intersectWith(frame_rect);
+
+    if (area.width() < kMinAreaWidth || area.height() < kMinAreaHeight)
+        return false;
+
+    buildIndex(previous_frame, area);
+    vote(current_frame, area);
+
+    auto best = votes_.cend();
+
+    for (auto it = votes_.cbegin(); it != votes_.cend(); ++it)
+    {
+        if (best == votes_.cend() || it->second.count > best->second.count)
+            best = it;
+    }
+
+    if (best == votes_.cend() || best->second.count < kMinVotes)
+        return false;
+
+    const int dx = static_cast<int32_t>(static_cast<uint32_t>(best->first >> 32));
+    const int dy = static_cast<int32_t>(static_cast<uint32_t>(best->first));
+
+    // The destination must be inside the updated area and the source inside the frame.
+    Rect range = frame_rect;
+    range.translate(dx, dy);
+    range.intersectWith(area);
+
+    Rect bounds = best->second.bounds;
+    bounds.intersectWith(range);
+
+    if (bounds.isEmpty())
+        return false;
+
+    const size_t row_size = bounds.width() * sizeof(uint32_t);
+
+    auto is_row_equal = [&](int y)
+    {
+        return memcmp(rowAt(current_frame, bounds.left(), y),
+                      rowAt(previous_frame, bounds.left() - dx, y - dy),
+                      row_size) == 0;
+    };
+
+    // The longest run of equal rows within the bounds of the votes.
+    int top = 0;
+    int bottom = 0;
+
+    for (int y = bounds.top(); y < bounds.bottom();)
+    {
+        if (!is_row_equal(y))
+        {
+            ++y;
+            continue;
+        }
+
+        const int run_top = y;
+        while (y < bounds.bottom() && is_row_equal(y))
+            ++y;
+
+        if (y - run_top > bottom - top)
+        {
+            top = run_top;
+            bottom = y;
+        }
+    }
+
+    if (top == bottom)
+        return false;
+
+    // The run may continue outside the bounds of the votes (the rows with solid segments only do
+    // not vote).
+    while (top > range.top() && is_row_equal(top - 1))
+        --top;
+
+    while (bottom < range.bottom() && is_row_equal(bottom))
+        ++bottom;
+
+    auto is_column_equal = [&](int x)
+    {
+        for (int y = top; y < bottom; ++y)
+        {
+            if (*rowAt(current_frame, x, y) != *rowAt(previous_frame, x - dx, y - dy))
+                return false;
+        }
+
+        return true;
+    };
+
+    int left = bounds.left();
+    int right = bounds.right();
+
+    while (left > range.left() && is_column_equal(left - 1))
+        --left;
+
+    while (right < range.right() && is_column_equal(right))
+        ++right;
+
+    if ((right - left) * (bottom - top) < kMinMovedPixels)
+        return false;
+
+    *dest_rect = Rect::makeLTRB(left, top, right, bottom);
+    *source_pos = Point(left - dx, top - dy);
+    return true;
+}
+
+void MoveDetector::buildIndex(const Frame& frame, const Rect& area)
+{
+    const size_t segment_count =
+        static_cast<size_t>(area.height()) * (area.width() / kSegmentWidth);
+
+    // The index is at most half full, so the probe sequences are short.
+    const size_t capacity = roundUpToPowerOfTwo(segment_count * 2);
+
+    index_.assign(capacity, Entry{ 0, 0, 0 });
+    index_mask_ = capacity - 1;
+
+    for (int y = area.top(); y < area.bottom(); ++y)
+    {
+        for (int x = area.left(); x + kSegmentWidth <= area.right(); x += kSegmentWidth)
+        {
+            const uint32_t* pixels = rowAt(frame, x, y);
+            if (isSolidSegment(pixels))
+                continue;
+
+            // Zero marks an empty entry.
+            const uint64_t hash = segmentHash(pixels) | 1;
+
+            size_t pos = static_cast<size_t>(hash) & index_mask_;
+
+            while (index_[pos].hash && index_[pos].hash != hash)
+                pos = (pos + 1) & index_mask_;
+
+            if (index_[pos].hash)
+            {
+                // The segment is repeated, its offset is ambiguous.
+                index_[pos].x = -1;
+            }
+            else
+            {
+                index_[pos] = Entry{ hash, x, y };
+            }
+        }
+    }
+}
+
+const MoveDetector::Entry* MoveDetector::findEntry(uint64_t hash) const
+{
+    size_t pos = static_cast<size_t>(hash) & index_mask_;
+
+    while (index_[pos].hash)
+    {
+        if (index_[pos].hash == hash)
+            return &index_[pos];
+
+        pos = (pos + 1) & index_mask_;
+    }
+
+    return nullptr;
+}
+
+void MoveDetector::vote(const Frame& frame, const Rect& area)
+{
+    votes_.clear();
+
+    for (int y = area.top(); y < area.bottom(); y += kSampleRowStep)
+    {
+        const uint32_t* row = rowAt(frame, 0, y);
+
+        uint64_t hash = 0;
+        bool hash_valid = false;
+
+        for (int x = area.left(); x + kSegmentWidth <= area.right(); ++x)
+        {
+            if (!hash_valid)
+            {
+                hash = segmentHash(row + x);
+                hash_valid = true;
+            }
+            else
+            {
+                // Rolling hash: remove the first pixel of the previous segment and add the last
+                // pixel of the current one.
+                hash = (hash - row[x - 1] * kHashBasePower) * kHashBase +
+                    row[x + kSegmentWidth - 1];
+            }
+
+            if (isSolidSegment(row + x))
+                continue;
+
+            const Entry* entry = findEntry(hash | 1);
+            if (!entry || entry->x < 0)
+                continue;
+
+            const int dx = x - entry->x;
+            const int dy = y - entry->y;
+
+            if (!dx && !dy)
+                continue;
+
+            const Rect segment_rect = Rect::makeXYWH(x, y, kSegmentWidth, 1);
+
+            auto result = votes_.try_emplace(packOffset(dx, dy), Vote{ 0, segment_rect });
+            Vote& vote = result.first->second;
+
+            ++vote.count;
+            vote.bounds.unionWith(segment_rect);
+
+            // The next segments overlap the matched one and most likely vote for the same offset.
+            x += kSegmentWidth - 1;
+            hash_valid = false;
+        }
+    }
+}
+
+} // namespace desktop
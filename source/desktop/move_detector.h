@@ -0,0 +1,84 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef DESKTOP__MOVE_DETECTOR_H
+#define DESKTOP__MOVE_DETECTOR_H
+
+#include "base/macros_magic.h"
+#include "desktop/desktop_geometry.h"
+
+#include <unordered_map>
+#include <vector>
+
+namespace desktop {
+
+class Frame;
+class Region;
+
+// Finds an area which was moved between two frames: a scrolled document or a dragged window.
+// The client copies such an area within its own frame instead of receiving it again.
+//
+// Short row segments of the previous frame are indexed by their hashes. The segments of the
+// current frame (in every few rows, at every horizontal position) are looked up in the index,
+// and each match votes for its offset. The offset with the most votes is verified pixel by pixel
+// and the largest matching rectangle around the votes is returned.
+class MoveDetector
+{
+public:
+    MoveDetector() = default;
+    ~MoveDetector() = default;
+
+    // Searches |current_frame| for an area moved from another place of |previous_frame|.
+    // |updated_region| contains the differences between the frames, only this area is searched.
+    // Returns true if the area is found: the pixels of |dest_rect| in |current_frame| are equal to
+    // the pixels of the rectangle of the same size at |source_pos| in |previous_frame|.
+    bool detect(const Frame& previous_frame,
+                const Frame& current_frame,
+                const Region& updated_region,
+                Rect* dest_rect,
+                Point* source_pos);
+
+private:
+    struct Entry
+    {
+        uint64_t hash;
+        int32_t x; // -1 if the segment occurs more than once.
+        int32_t y;
+    };
+
+    struct Vote
+    {
+        int count;
+        Rect bounds;
+    };
+
+    void buildIndex(const Frame& frame, const Rect& area);
+    const Entry* findEntry(uint64_t hash) const;
+    void vote(const Frame& frame, const Rect& area);
+
+    std::vector<Entry> index_;
+    size_t index_mask_ = 0;
+
+    std::unordered_map<uint64_t, Vote> votes_;
+
+    DISALLOW_COPY_AND_ASSIGN(MoveDetector);
+};
+
+} // namespace desktop
+
+#endif // DESKTOP__MOVE_DETECTOR_H
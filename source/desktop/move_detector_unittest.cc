@@ -0,0 +1,165 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "desktop/move_detector.h"
+#include "desktop/desktop_frame_simple.h"
+#include "desktop/frame_generator.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <random>
+
+namespace desktop {
+
+namespace {
+
+const Size kScreenSize(800, 600);
+
+// Generates two consecutive frames of |type| after |skip_frames| frames.
+void generateFrames(FrameGenerator::Type type,
+                    int skip_frames,
+                    std::unique_ptr<Frame>* previous_frame,
+                    std::unique_ptr<Frame>* current_frame)
+{
+    FrameGenerator generator(type, kScreenSize, 0);
+
+    *previous_frame = FrameSimple::create(kScreenSize, PixelFormat::ARGB());
+    *current_frame = FrameSimple::create(kScreenSize, PixelFormat::ARGB());
+
+    for (int i = 0; i <= skip_frames; ++i)
+        ASSERT_TRUE(generator.nextFrame(current_frame->get()));
+
+    const Rect frame_rect = Rect::makeSize(kScreenSize);
+    (*previous_frame)->copyPixelsFrom(**current_frame, frame_rect.topLeft(), frame_rect);
+
+    (*current_frame)->updatedRegion()->clear();
+    ASSERT_TRUE(generator.nextFrame(current_frame->get()));
+}
+
+bool isEqualRect(const Frame& frame1, const Frame& frame2, const Rect& rect)
+{
+    const size_t row_size = rect.width() * frame1.format().bytesPerPixel();
+
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        if (memcmp(frame1.frameDataAtPos(rect.left(), y),
+                   frame2.frameDataAtPos(rect.left(), y), row_size) != 0)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+} // namespace
+
+TEST(MoveDetectorTest, Scrolling)
+{
+    std::unique_ptr<Frame> previous_frame;
+    std::unique_ptr<Frame> current_frame;
+    generateFrames(FrameGenerator::Type::SCROLLING, 2, &previous_frame, &current_frame);
+
+    MoveDetector detector;
+    Rect dest_rect;
+    Point source_pos;
+
+    ASSERT_TRUE(detector.detect(*previous_frame, *current_frame,
+                                current_frame->constUpdatedRegion(), &dest_rect, &source_pos));
+
+    // The content moves up, the new lines appear at the bottom.
+    EXPECT_EQ(source_pos.x(), dest_rect.x());
+    EXPECT_GT(source_pos.y(), dest_rect.y());
+    EXPECT_EQ(dest_rect.width(), kScreenSize.width());
+    EXPECT_EQ(dest_rect.bottom() + source_pos.y() - dest_rect.y(), kScreenSize.height());
+
+    // After the copy, the moved area matches the current frame.
+    previous_frame->copyPixelsWithin(source_pos, dest_rect);
+    EXPECT_TRUE(isEqualRect(*previous_frame, *current_frame, dest_rect));
+}
+
+TEST(MoveDetectorTest, WindowDrag)
+{
+    std::unique_ptr<Frame> previous_frame;
+    std::unique_ptr<Frame> current_frame;
+    generateFrames(FrameGenerator::Type::WINDOW_DRAG, 3, &previous_frame, &current_frame);
+
+    MoveDetector detector;
+    Rect dest_rect;
+    Point source_pos;
+
+    ASSERT_TRUE(detector.detect(*previous_frame, *current_frame,
+                                current_frame->constUpdatedRegion(), &dest_rect, &source_pos));
+
+    // The window moves both horizontally and vertically.
+    EXPECT_NE(source_pos.x(), dest_rect.x());
+    EXPECT_NE(source_pos.y(), dest_rect.y());
+
+    // Most of the window (a third of the screen) is copied.
+    EXPECT_GT(dest_rect.width(), kScreenSize.width() / 3 - 16);
+    EXPECT_GT(dest_rect.height(), kScreenSize.height() / 3 - 16);
+
+    previous_frame->copyPixelsWithin(source_pos, dest_rect);
+    EXPECT_TRUE(isEqualRect(*previous_frame, *current_frame, dest_rect));
+}
+
+TEST(MoveDetectorTest, NoMove)
+{
+    std::unique_ptr<Frame> previous_frame;
+    std::unique_ptr<Frame> current_frame;
+    generateFrames(FrameGenerator::Type::VIDEO, 1, &previous_frame, &current_frame);
+
+    MoveDetector detector;
+    Rect dest_rect;
+    Point source_pos;
+
+    EXPECT_FALSE(detector.detect(*previous_frame, *current_frame,
+                                 current_frame->constUpdatedRegion(), &dest_rect, &source_pos));
+
+    // Random noise.
+    std::mt19937 engine;
+    std::uniform_int_distribution<int> distribution(0, 255);
+
+    for (int y = 0; y < kScreenSize.height(); ++y)
+    {
+        uint8_t* row = current_frame->frameDataAtPos(0, y);
+
+        for (int x = 0; x < kScreenSize.width() * 4; ++x)
+            row[x] = static_cast<uint8_t>(distribution(engine));
+    }
+
+    EXPECT_FALSE(detector.detect(*previous_frame, *current_frame,
+                                 Region(Rect::makeSize(kScreenSize)), &dest_rect, &source_pos));
+}
+
+TEST(MoveDetectorTest, SmallArea)
+{
+    std::unique_ptr<Frame> previous_frame;
+    std::unique_ptr<Frame> current_frame;
+    generateFrames(FrameGenerator::Type::TYPING, 5, &previous_frame, &current_frame);
+
+    MoveDetector detector;
+    Rect dest_rect;
+    Point source_pos;
+
+    EXPECT_FALSE(detector.detect(*previous_frame, *current_frame,
+                                 current_frame->constUpdatedRegion(), &dest_rect, &source_pos));
+}
+
+} // namespace desktop
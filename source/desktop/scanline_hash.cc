@@ -0,0 +1,215 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "desktop/scanline_hash.h"
+#include "build/build_config.h"
+
+#if defined(CC_MSVC)
+#include <intrin.h>
+#else
+#include <mmintrin.h>
+#include <emmintrin.h>
+#endif
+
+#include <cstring>
+
+namespace desktop {
+
+namespace {
+
+const int kStripeSize = 32;
+const int kStripesPerBlock = 8;
+const int kLanes = 4;
+
+const uint64_t kPrime32 = 0x9E3779B1ULL;
+const uint64_t kPrime64_1 = 0x9E3779B185EBCA87ULL;
+const uint64_t kPrime64_2 = 0xC2B2AE3D27D4EB4FULL;
+const uint64_t kPrime64_3 = 0x165667B19E3779F9ULL;
+
+// Keys for each stripe of a block. The stripe N uses the keys from N to N + 3.
+const uint64_t kStripeKeys[kStripesPerBlock + kLanes - 1] =
+{
+    0xBE4BA423396CFEB8ULL, 0x1CAD21F72C81017CULL, 0xDB979083E96DD4DEULL, 0x1F67B3B7A4A44072ULL,
+    0x78E5C0CC4EE679CBULL, 0x2172FFCC7DD05A82ULL, 0x8E2443F7744608B8ULL, 0x4C263A81E69035E0ULL,
+    0xCB00C391BB52283CULL, 0xA32E531B8B65D088ULL, 0x4EF90DA297486471ULL
+};
+
+// Keys used when the accumulators are scrambled at the end of each block.
+const uint64_t kScrambleKeys[kLanes] =
+{
+    0xD8ACDEA946EF1938ULL, 0x3F349CE33F76FAA8ULL, 0x1D4F0BC7C7BBDCF9ULL, 0x3159B4CD4BE0518AULL
+};
+
+uint64_t readUint64(const uint8_t* data)
+{
+    uint64_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+uint64_t avalanche(uint64_t hash)
+{
+    hash ^= hash >> 33;
+    hash *= kPrime64_2;
+    hash ^= hash >> 29;
+    hash *= kPrime64_3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+uint64_t mergeAccumulators(const uint64_t acc[kLanes], int size)
+{
+    uint64_t hash = static_cast<uint64_t>(size) * kPrime64_1;
+
+    for (int i = 0; i < kLanes; ++i)
+    {
+        hash ^= avalanche(acc[i] + kScrambleKeys[i]);
+        hash = hash * kPrime64_1 + kPrime64_3;
+    }
+
+    return avalanche(hash);
+}
+
+void accumulateStripe_C(uint64_t acc[kLanes], const uint8_t* data, const uint64_t* keys)
+{
+    for (int i = 0; i < kLanes; ++i)
+    {
+        const uint64_t value = readUint64(data + i * sizeof(uint64_t));
+        const uint64_t value_key = value ^ keys[i];
+
+        acc[i] += (value_key & 0xFFFFFFFF) * (value_key >> 32);
+        acc[i ^ 1] += value;
+    }
+}
+
+void scramble_C(uint64_t acc[kLanes])
+{
+    for (int i = 0; i < kLanes; ++i)
+    {
+        acc[i] ^= acc[i] >> 47;
+        acc[i] ^= kScrambleKeys[i];
+        acc[i] *= kPrime32;
+    }
+}
+
+FORCEINLINE __m128i accumulate_SSE2(__m128i acc, __m128i value, __m128i key)
+{
+    const __m128i value_key = _mm_xor_si128(value, key);
+
+    // Multiplies the low and the high 32 bits of each 64-bit lane.
+    const __m128i product =
+        _mm_mul_epu32(value_key, _mm_shuffle_epi32(value_key, _MM_SHUFFLE(0, 3, 0, 1)));
+
+    acc = _mm_add_epi64(acc, product);
+
+    // Adds the value to the neighboring lane.
+    return _mm_add_epi64(acc, _mm_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2)));
+}
+
+FORCEINLINE __m128i scramble_SSE2(__m128i acc, __m128i key)
+{
+    const __m128i prime = _mm_set1_epi32(static_cast<int>(kPrime32));
+
+    acc = _mm_xor_si128(acc, _mm_srli_epi64(acc, 47));
+    acc = _mm_xor_si128(acc, key);
+
+    // 64-bit multiplication by a 32-bit constant.
+    const __m128i low = _mm_mul_epu32(acc, prime);
+    const __m128i high = _mm_mul_epu32(_mm_srli_epi64(acc, 32), prime);
+
+    return _mm_add_epi64(low, _mm_slli_epi64(high, 32));
+}
+
+} // namespace
+
+uint64_t hashScanline_C(const uint8_t* data, int size)
+{
+    uint64_t acc[kLanes] = { kPrime32, kPrime64_1, kPrime64_2, kPrime64_3 };
+
+    const int full_stripes = size / kStripeSize;
+    int stripe = 0;
+
+    for (; stripe < full_stripes; ++stripe)
+    {
+        accumulateStripe_C(acc, data, &kStripeKeys[stripe % kStripesPerBlock]);
+        data += kStripeSize;
+
+        if (stripe % kStripesPerBlock == kStripesPerBlock - 1)
+            scramble_C(acc);
+    }
+
+    const int partial_size = size - full_stripes * kStripeSize;
+    if (partial_size)
+    {
+        uint8_t last_stripe[kStripeSize] = { 0 };
+        memcpy(last_stripe, data, partial_size);
+
+        accumulateStripe_C(acc, last_stripe, &kStripeKeys[stripe % kStripesPerBlock]);
+    }
+
+    return mergeAccumulators(acc, size);
+}
+
+uint64_t hashScanline_SSE2(const uint8_t* data, int size)
+{
+    __m128i acc0 = _mm_set_epi64x(static_cast<int64_t>(kPrime64_1), kPrime32);
+    __m128i acc1 = _mm_set_epi64x(static_cast<int64_t>(kPrime64_3),
+                                  static_cast<int64_t>(kPrime64_2));
+
+    const __m128i* scramble_keys = reinterpret_cast<const __m128i*>(kScrambleKeys);
+    const __m128i scramble_key0 = _mm_loadu_si128(scramble_keys + 0);
+    const __m128i scramble_key1 = _mm_loadu_si128(scramble_keys + 1);
+
+    const int full_stripes = size / kStripeSize;
+    int stripe = 0;
+
+    for (; stripe < full_stripes; ++stripe)
+    {
+        const __m128i* keys =
+            reinterpret_cast<const __m128i*>(&kStripeKeys[stripe % kStripesPerBlock]);
+        const __m128i* values = reinterpret_cast<const __m128i*>(data);
+
+        acc0 = accumulate_SSE2(acc0, _mm_loadu_si128(values + 0), _mm_loadu_si128(keys + 0));
+        acc1 = accumulate_SSE2(acc1, _mm_loadu_si128(values + 1), _mm_loadu_si128(keys + 1));
+
+        data += kStripeSize;
+
+        if (stripe % kStripesPerBlock == kStripesPerBlock - 1)
+        {
+            acc0 = scramble_SSE2(acc0, scramble_key0);
+            acc1 = scramble_SSE2(acc1, scramble_key1);
+        }
+    }
+
+    uint64_t acc[kLanes];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(acc) + 0, acc0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(acc) + 1, acc1);
+
+    const int partial_size = size - full_stripes * kStripeSize;
+    if (partial_size)
+    {
+        uint8_t last_stripe[kStripeSize] = { 0 };
+        memcpy(last_stripe, data, partial_size);
+
+        accumulateStripe_C(acc, last_stripe, &kStripeKeys[stripe % kStripesPerBlock]);
+    }
+
+    return mergeAccumulators(acc, size);
+}
+
+} // namespace desktop
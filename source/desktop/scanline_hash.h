@@ -0,0 +1,36 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef DESKTOP__SCANLINE_HASH_H
+#define DESKTOP__SCANLINE_HASH_H
+
+#include <cstdint>
+
+namespace desktop {
+
+// Calculates a 64-bit fingerprint of |size| bytes at |data|. The functions are used to detect
+// quickly whether a row of pixels has changed since the previous frame. The hash is not
+// cryptographic, it is an xxHash3-like accumulation of 32-byte stripes. All implementations
+// return the same value for the same input.
+uint64_t hashScanline_C(const uint8_t* data, int size);
+
+uint64_t hashScanline_SSE2(const uint8_t* data, int size);
+
+} // namespace desktop
+
+#endif // DESKTOP__SCANLINE_HASH_H
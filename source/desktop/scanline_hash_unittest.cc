@@ -0,0 +1,86 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "desktop/scanline_hash.h"
+
+#include <gtest/gtest.h>
+#include <libyuv/cpu_id.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace desktop {
+
+namespace {
+
+std::vector<uint8_t> randomData(int size, uint32_t seed)
+{
+    std::mt19937 random(seed);
+    std::vector<uint8_t> data(size);
+
+    for (auto& value : data)
+        value = static_cast<uint8_t>(random());
+
+    return data;
+}
+
+} // namespace
+
+TEST(scanline_hash, sse2_matches_c)
+{
+    if (!libyuv::TestCpuFlag(libyuv::kCpuHasSSE2))
+        return;
+
+    for (int size = 0; size < 1100; size += 7)
+    {
+        std::vector<uint8_t> data = randomData(size, size);
+        EXPECT_EQ(hashScanline_C(data.data(), size), hashScanline_SSE2(data.data(), size));
+    }
+}
+
+TEST(scanline_hash, detects_changes)
+{
+    const int kSize = 1920 * 4;
+
+    std::vector<uint8_t> data = randomData(kSize, 1);
+    const uint64_t hash = hashScanline_C(data.data(), kSize);
+
+    for (int i = 0; i < kSize; i += 13)
+    {
+        data[i] ^= 1;
+        EXPECT_NE(hash, hashScanline_C(data.data(), kSize)) << i;
+        data[i] ^= 1;
+    }
+
+    EXPECT_EQ(hash, hashScanline_C(data.data(), kSize));
+}
+
+TEST(scanline_hash, detects_swapped_pixels)
+{
+    const int kSize = 1024 * 4;
+
+    std::vector<uint8_t> data = randomData(kSize, 2);
+    const uint64_t hash = hashScanline_C(data.data(), kSize);
+
+    // Swap two 32-byte stripes.
+    std::swap_ranges(data.begin(), data.begin() + 32, data.begin() + 64);
+    EXPECT_NE(hash, hashScanline_C(data.data(), kSize));
+}
+
+} // namespace desktop
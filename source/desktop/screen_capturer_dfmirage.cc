@@ -20,7 +20,8 @@
 
 #include "base/logging.h"
 #include "desktop/dfmirage_helper.h"
-#include "desktop/desktop_frame_aligned.h"
+#include "desktop/differ.h"
+#include "desktop/frame_pool.h"
 #include "desktop/win/screen_capture_utils.h"
 
 namespace desktop {
@@ -85,14 +86,22 @@ const Frame* ScreenCapturerDFMirage::captureFrame()
         }
     }
 
+    bool is_new_frame = false;
+
     if (!frame_)
     {
-        frame_ = FrameAligned::create(screen_rect.size(), PixelFormat::ARGB(), 32);
+        frame_ = FramePool::instance()->allocate(screen_rect.size(), PixelFormat::ARGB());
         if (!frame_)
         {
             LOG(LS_WARNING) << "Failed to create frame";
             return nullptr;
         }
+
+        const Size& screen_size = screen_rect.size();
+        differ_ = std::make_unique<Differ>(screen_size,
+                                           Differ::defaultBlockSize(screen_size),
+                                           Differ::defaultThreadCount(screen_size));
+        is_new_frame = true;
     }
 
     DfmChangesBuffer* changes_buffer = helper_->changesBuffer();
@@ -103,22 +112,42 @@ const Frame* ScreenCapturerDFMirage::captureFrame()
 
     next_update_ = changes_buffer->counter;
 
-    for (int i = last_update_; i != next_update_; i = (i + 1) % kDfmMaxChanges)
+    if (is_new_frame)
     {
-        const DfmRect* dfm_rect = &changes_buffer->records[i].rect;
-
-        Rect rect = Rect::makeLTRB(dfm_rect->left, dfm_rect->top, dfm_rect->right, dfm_rect->bottom);
+        // The new frame does not have a previous content, so it is copied entirely.
+        region->addRect(Rect::makeSize(frame_->size()));
+    }
+    else
+    {
+        Region hint;
 
-        rect.intersectWith(screen_rect);
-        if (!rect.isEmpty())
+        for (int i = last_update_; i != next_update_; i = (i + 1) % kDfmMaxChanges)
         {
-            region->addRect(rect);
+            const DfmRect* dfm_rect = &changes_buffer->records[i].rect;
 
-            const size_t source_offset =
-                frame_->stride() * rect.y() + frame_->format().bytesPerPixel() * rect.x();
+            Rect rect = Rect::makeLTRB(
+                dfm_rect->left, dfm_rect->top, dfm_rect->right, dfm_rect->bottom);
 
-            frame_->copyPixelsFrom(source_buffer + source_offset, frame_->stride(), rect);
+            rect.intersectWith(screen_rect);
+            if (!rect.isEmpty())
+                hint.addRect(rect);
         }
+
+        // The driver reports the areas of all drawing operations, and many of them do not
+        // change the pixels. The frame still contains the previous image, so only the areas
+        // touched by the driver are compared with it.
+        if (!hint.isEmpty())
+            differ_->calcDirtyRegion(frame_->frameData(), source_buffer, hint, region);
+    }
+
+    for (Region::Iterator it(*region); !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+
+        const size_t source_offset =
+            frame_->stride() * rect.y() + frame_->format().bytesPerPixel() * rect.x();
+
+        frame_->copyPixelsFrom(source_buffer + source_offset, frame_->stride(), rect);
     }
 
     last_update_ = next_update_;
@@ -134,6 +163,7 @@ void ScreenCapturerDFMirage::reset()
 
     helper_.reset();
     frame_.reset();
+    differ_.reset();
 }
 
 } // namespace desktop
@@ -24,6 +24,7 @@
 namespace desktop {
 
 class DFMirageHelper;
+class Differ;
 
 class ScreenCapturerDFMirage : public ScreenCapturer
 {
@@ -46,6 +47,7 @@ protected:
 private:
     std::unique_ptr<DFMirageHelper> helper_;
     std::unique_ptr<Frame> frame_;
+    std::unique_ptr<Differ> differ_;
 
     int last_update_ = 0;
     int next_update_ = 0;
@@ -98,7 +98,14 @@ const Frame* ScreenCapturerGdi::captureFrame()
 
     if (!previous || previous->size() != current->size())
     {
-        differ_ = std::make_unique<Differ>(screen_rect.size());
+        const Size& screen_size = screen_rect.size();
+
+        differ_ = std::make_unique<Differ>(screen_size,
+                                           Differ::defaultBlockSize(screen_size),
+                                           Differ::defaultThreadCount(screen_size));
+
+        // Most of the frames on an idle desktop do not differ at all.
+        differ_->setFingerprintsEnabled(true);
         current->updatedRegion()->addRect(Rect::makeSize(screen_rect.size()));
     }
     else
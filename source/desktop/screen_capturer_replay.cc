@@ -0,0 +1,119 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "desktop/screen_capturer_replay.h"
+#include "base/qt_logging.h"
+#include "desktop/frame_pool.h"
+#include "desktop/frame_trace.h"
+
+#include <QFile>
+
+namespace desktop {
+
+ScreenCapturerReplay::ScreenCapturerReplay(std::unique_ptr<FrameSource> source, bool loop)
+    : source_(std::move(source)),
+      loop_(loop)
+{
+    DCHECK(source_);
+}
+
+ScreenCapturerReplay::~ScreenCapturerReplay() = default;
+
+// static
+std::unique_ptr<ScreenCapturerReplay> ScreenCapturerReplay::createFromFile(
+    const QString& file_path)
+{
+    std::unique_ptr<QFile> file = std::make_unique<QFile>(file_path);
+
+    if (!file->open(QFile::ReadOnly))
+    {
+        LOG(LS_WARNING) << "Unable to open trace file: " << file->errorString();
+        return nullptr;
+    }
+
+    const uint8_t* data = file->map(0, file->size());
+    if (!data)
+    {
+        LOG(LS_WARNING) << "Unable to map trace file: " << file->errorString();
+        return nullptr;
+    }
+
+    std::unique_ptr<FrameTraceReader> reader =
+        FrameTraceReader::create(base::ConstBuffer(data, static_cast<size_t>(file->size())));
+    if (!reader)
+        return nullptr;
+
+    std::unique_ptr<ScreenCapturerReplay> capturer =
+        std::make_unique<ScreenCapturerReplay>(std::move(reader), true);
+    capturer->file_ = std::move(file);
+
+    return capturer;
+}
+
+int ScreenCapturerReplay::screenCount()
+{
+    return 1;
+}
+
+bool ScreenCapturerReplay::screenList(ScreenList* screens)
+{
+    screens->push_back({ 0, QString() });
+    return true;
+}
+
+bool ScreenCapturerReplay::selectScreen(ScreenId screen_id)
+{
+    return screen_id == kFullDesktopScreenId || screen_id == 0;
+}
+
+const Frame* ScreenCapturerReplay::captureFrame()
+{
+    if (!frame_)
+    {
+        frame_ = FramePool::instance()->allocate(source_->screenSize(), PixelFormat::ARGB());
+        if (!frame_)
+            return nullptr;
+
+        // The first change of the source covers the whole screen.
+        source_->rewind();
+    }
+
+    frame_->updatedRegion()->clear();
+
+    if (!source_->nextFrame(frame_.get()))
+    {
+        if (!loop_)
+            return nullptr;
+
+        // The frame already contains the last image of the sequence. The first change after the
+        // rewind covers the whole screen and replaces it.
+        source_->rewind();
+
+        if (!source_->nextFrame(frame_.get()))
+            return nullptr;
+    }
+
+    return frame_.get();
+}
+
+void ScreenCapturerReplay::reset()
+{
+    frame_.reset();
+}
+
+} // namespace desktop
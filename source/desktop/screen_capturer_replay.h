@@ -0,0 +1,72 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef DESKTOP__SCREEN_CAPTURER_REPLAY_H
+#define DESKTOP__SCREEN_CAPTURER_REPLAY_H
+
+#include "base/macros_magic.h"
+#include "desktop/screen_capturer.h"
+
+#include <memory>
+
+class QFile;
+
+namespace desktop {
+
+class FrameSource;
+
+// Captures frames from a recorded trace or a generator instead of a real screen. Frames are
+// returned as fast as they are requested, the timestamps of a trace are ignored: the pacing is
+// done by the capture scheduler as for a real screen. This makes runs of the capture-encode
+// pipeline repeatable and independent of the platform.
+class ScreenCapturerReplay : public ScreenCapturer
+{
+public:
+    // If |loop| is true, the source is rewound at the end of the sequence. Otherwise
+    // captureFrame() returns nullptr after the last frame.
+    ScreenCapturerReplay(std::unique_ptr<FrameSource> source, bool loop);
+    ~ScreenCapturerReplay();
+
+    // Creates a capturer which replays the trace file (see FrameTraceWriter) in a loop. The file
+    // is memory-mapped. Returns nullptr if the file could not be opened or is not a trace.
+    static std::unique_ptr<ScreenCapturerReplay> createFromFile(const QString& file_path);
+
+    // ScreenCapturer implementation.
+    int screenCount() override;
+    bool screenList(ScreenList* screens) override;
+    bool selectScreen(ScreenId screen_id) override;
+    const Frame* captureFrame() override;
+
+protected:
+    // ScreenCapturer implementation.
+    void reset() override;
+
+private:
+    // The file must be destroyed after the source, which refers to its memory.
+    std::unique_ptr<QFile> file_;
+    std::unique_ptr<FrameSource> source_;
+    const bool loop_;
+
+    std::unique_ptr<Frame> frame_;
+
+    DISALLOW_COPY_AND_ASSIGN(ScreenCapturerReplay);
+};
+
+} // namespace desktop
+
+#endif // DESKTOP__SCREEN_CAPTURER_REPLAY_H
@@ -0,0 +1,164 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "desktop/screen_capturer_replay.h"
+#include "desktop/desktop_frame_simple.h"
+#include "desktop/frame_generator.h"
+#include "desktop/frame_trace.h"
+
+#include <QTemporaryFile>
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+namespace desktop {
+
+namespace {
+
+const Size kScreenSize(320, 240);
+const int kFrameCount = 10;
+
+bool isEqualFrame(const Frame& frame1, const Frame& frame2)
+{
+    if (frame1.size() != frame2.size())
+        return false;
+
+    const size_t row_size = frame1.size().width() * frame1.format().bytesPerPixel();
+
+    for (int y = 0; y < frame1.size().height(); ++y)
+    {
+        if (memcmp(frame1.frameDataAtPos(0, y), frame2.frameDataAtPos(0, y), row_size) != 0)
+            return false;
+    }
+
+    return true;
+}
+
+std::vector<uint8_t> writeTrace(FrameGenerator::Type type)
+{
+    FrameGenerator generator(type, kScreenSize, kFrameCount);
+    FrameTraceWriter writer(kScreenSize);
+
+    std::unique_ptr<Frame> frame = FrameSimple::create(kScreenSize, PixelFormat::ARGB());
+
+    for (int i = 0; i < kFrameCount; ++i)
+    {
+        frame->updatedRegion()->clear();
+
+        EXPECT_TRUE(generator.nextFrame(frame.get()));
+        EXPECT_TRUE(writer.addFrame(*frame, std::chrono::milliseconds(i * 40)));
+    }
+
+    return writer.finish();
+}
+
+// Compares |kFrameCount| frames of |capturer| with the frames of a generator of |type|.
+void expectGeneratorFrames(ScreenCapturer* capturer, FrameGenerator::Type type)
+{
+    FrameGenerator generator(type, kScreenSize, kFrameCount);
+    std::unique_ptr<Frame> expected = FrameSimple::create(kScreenSize, PixelFormat::ARGB());
+
+    for (int i = 0; i < kFrameCount; ++i)
+    {
+        expected->updatedRegion()->clear();
+        ASSERT_TRUE(generator.nextFrame(expected.get()));
+
+        const Frame* frame = capturer->captureFrame();
+        ASSERT_TRUE(frame) << i;
+
+        EXPECT_TRUE(isEqualFrame(*expected, *frame)) << i;
+        EXPECT_TRUE(expected->constUpdatedRegion().equals(frame->constUpdatedRegion())) << i;
+    }
+}
+
+} // namespace
+
+class ScreenCapturerReplayTest : public testing::TestWithParam<FrameGenerator::Type>
+{
+    // Nothing
+};
+
+TEST_P(ScreenCapturerReplayTest, Generator)
+{
+    ScreenCapturerReplay capturer(
+        std::make_unique<FrameGenerator>(GetParam(), kScreenSize, kFrameCount), false);
+
+    EXPECT_EQ(capturer.screenCount(), 1);
+    EXPECT_TRUE(capturer.selectScreen(ScreenCapturer::kFullDesktopScreenId));
+
+    expectGeneratorFrames(&capturer, GetParam());
+
+    // The sequence is not repeated.
+    EXPECT_FALSE(capturer.captureFrame());
+}
+
+TEST_P(ScreenCapturerReplayTest, TraceLoop)
+{
+    std::vector<uint8_t> trace = writeTrace(GetParam());
+
+    std::unique_ptr<FrameTraceReader> reader =
+        FrameTraceReader::create(base::ConstBuffer(trace.data(), trace.size()));
+    ASSERT_TRUE(reader);
+
+    ScreenCapturerReplay capturer(std::move(reader), true);
+
+    // After the last frame the trace starts again with a frame that covers the whole screen.
+    expectGeneratorFrames(&capturer, GetParam());
+    expectGeneratorFrames(&capturer, GetParam());
+}
+
+INSTANTIATE_TEST_CASE_P(Types,
+                        ScreenCapturerReplayTest,
+                        testing::Values(FrameGenerator::Type::TYPING,
+                                        FrameGenerator::Type::SCROLLING,
+                                        FrameGenerator::Type::WINDOW_DRAG,
+                                        FrameGenerator::Type::VIDEO));
+
+TEST(ScreenCapturerReplayFileTest, CreateFromFile)
+{
+    std::vector<uint8_t> trace = writeTrace(FrameGenerator::Type::WINDOW_DRAG);
+
+    QTemporaryFile file;
+    ASSERT_TRUE(file.open());
+    ASSERT_EQ(file.write(reinterpret_cast<const char*>(trace.data()), trace.size()),
+              static_cast<qint64>(trace.size()));
+    file.close();
+
+    std::unique_ptr<ScreenCapturerReplay> capturer =
+        ScreenCapturerReplay::createFromFile(file.fileName());
+    ASSERT_TRUE(capturer);
+
+    expectGeneratorFrames(capturer.get(), FrameGenerator::Type::WINDOW_DRAG);
+
+    // The file is replayed in a loop.
+    expectGeneratorFrames(capturer.get(), FrameGenerator::Type::WINDOW_DRAG);
+}
+
+TEST(ScreenCapturerReplayFileTest, InvalidFile)
+{
+    QTemporaryFile file;
+    ASSERT_TRUE(file.open());
+    ASSERT_EQ(file.write("not a trace", 11), 11);
+    file.close();
+
+    EXPECT_FALSE(ScreenCapturerReplay::createFromFile(file.fileName()));
+    EXPECT_FALSE(ScreenCapturerReplay::createFromFile(file.fileName() + QStringLiteral(".none")));
+}
+
+} // namespace desktop
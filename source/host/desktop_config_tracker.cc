@@ -61,6 +61,15 @@ uint32_t DesktopConfigTracker::changesMask(const proto::desktop::Config& new_con
     if (old_config_->compress_ratio() != new_config.compress_ratio())
         result |= HAS_VIDEO;
 
+    if (old_config_->tile_cache_size() != new_config.tile_cache_size())
+        result |= HAS_VIDEO;
+
+    if (old_config_->zstd_dictionary_id() != new_config.zstd_dictionary_id())
+        result |= HAS_VIDEO;
+
+    if (old_config_->zstd_tile_size() != new_config.zstd_tile_size())
+        result |= HAS_VIDEO;
+
     if ((old_config_->flags() & proto::desktop::ENABLE_CURSOR_SHAPE) !=
         (new_config.flags() & proto::desktop::ENABLE_CURSOR_SHAPE))
     {
@@ -91,6 +100,30 @@ uint32_t DesktopConfigTracker::changesMask(const proto::desktop::Config& new_con
         result |= HAS_VIDEO;
     }
 
+    if ((old_config_->flags() & proto::desktop::ENABLE_COPY_RECT) !=
+        (new_config.flags() & proto::desktop::ENABLE_COPY_RECT))
+    {
+        result |= HAS_VIDEO;
+    }
+
+    if ((old_config_->flags() & proto::desktop::ENABLE_RECT_ENCODING) !=
+        (new_config.flags() & proto::desktop::ENABLE_RECT_ENCODING))
+    {
+        result |= HAS_VIDEO;
+    }
+
+    if ((old_config_->flags() & proto::desktop::ENABLE_ZSTD_HISTORY) !=
+        (new_config.flags() & proto::desktop::ENABLE_ZSTD_HISTORY))
+    {
+        result |= HAS_VIDEO;
+    }
+
+    if ((old_config_->flags() & proto::desktop::ENABLE_ZSTD_LONG_DISTANCE) !=
+        (new_config.flags() & proto::desktop::ENABLE_ZSTD_LONG_DISTANCE))
+    {
+        result |= HAS_VIDEO;
+    }
+
     if ((old_config_->flags() & proto::desktop::BLOCK_REMOTE_INPUT) !=
         (new_config.flags() & proto::desktop::BLOCK_REMOTE_INPUT))
     {
@@ -114,6 +114,18 @@ void HostServer::stopSession(const std::string& uuid)
     }
 }
 
+void HostServer::requestSessionStats(const std::string& uuid)
+{
+    for (const auto& session : sessions_)
+    {
+        if (session->uuid() == uuid)
+        {
+            session->requestStats();
+            break;
+        }
+    }
+}
+
 void HostServer::customEvent(QEvent* event)
 {
     if (event->type() == kStartEvent)
@@ -191,6 +203,19 @@ void HostServer::onNewConnection()
                 this, &HostServer::onSessionFinished,
                 Qt::QueuedConnection);
 
+        connect(session_process.get(), &SessionProcess::statsReceived, this,
+                [this, process = session_process.get()](const proto::desktop::PipelineStats& stats)
+        {
+            if (!ui_server_)
+                return;
+
+            proto::host::SessionStats session_stats;
+            session_stats.set_uuid(process->uuid());
+            session_stats.mutable_pipeline_stats()->CopyFrom(stats);
+
+            ui_server_->setSessionStats(process->sessionId(), session_stats);
+        });
+
         if (session_process->start(session_id))
         {
             sessions_.emplace_front(std::move(session_process));
@@ -293,6 +318,8 @@ void HostServer::startServer()
     connect(ui_server_.get(), &UiServer::processEvent, this, &HostServer::onUiProcessEvent);
     connect(ui_server_.get(), &UiServer::userListChanged, this, &HostServer::reloadUsers);
     connect(ui_server_.get(), &UiServer::killSession, this, &HostServer::stopSession);
+    connect(ui_server_.get(), &UiServer::sessionStatsRequest,
+            this, &HostServer::requestSessionStats);
 
     if (!ui_server_->start())
     {
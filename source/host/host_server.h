@@ -47,6 +47,7 @@ public:
     void stop();
     void setSessionEvent(base::win::SessionStatus status, base::win::SessionId session_id);
     void stopSession(const std::string& uuid);
+    void requestSessionStats(const std::string& uuid);
 
 protected:
     // QObject implementation.
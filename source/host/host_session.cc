@@ -18,6 +18,7 @@
 
 #include "host/host_session.h"
 #include "base/logging.h"
+#include "common/service_message.h"
 #include "host/host_session_desktop.h"
 #include "host/host_session_file_transfer.h"
 #include "ipc/ipc_channel.h"
@@ -68,7 +69,8 @@ void Session::start()
     connect(channel_, &ipc::Channel::connected, this, &Session::sessionStarted);
     connect(channel_, &ipc::Channel::disconnected, this, &Session::stop, Qt::QueuedConnection);
     connect(channel_, &ipc::Channel::errorOccurred, this, &Session::stop, Qt::QueuedConnection);
-    connect(channel_, &ipc::Channel::messageReceived, this, &Session::messageReceived);
+    connect(channel_, &ipc::Channel::messageReceived, this, &Session::onMessageReceived);
+    connect(channel_, &ipc::Channel::messageWritten, this, &Session::messageWritten);
 
     channel_->connectToServer(channel_id_);
 }
@@ -78,9 +80,43 @@ void Session::sendMessage(const QByteArray& message)
     channel_->send(message);
 }
 
+int64_t Session::pendingBytes() const
+{
+    return channel_->pendingBytes();
+}
+
+void Session::messageWritten()
+{
+    // Nothing
+}
+
+void Session::serviceMessageReceived(const proto::host::ServiceToSession& /* message */)
+{
+    LOG(LS_WARNING) << "Unhandled message from service";
+}
+
 void Session::stop()
 {
     QCoreApplication::quit();
 }
 
+void Session::onMessageReceived(const QByteArray& buffer)
+{
+    if (!common::isServiceMessage(buffer))
+    {
+        messageReceived(buffer);
+        return;
+    }
+
+    proto::host::ServiceToSession message;
+
+    if (!common::parseServiceMessage(buffer, &message))
+    {
+        stop();
+        return;
+    }
+
+    serviceMessageReceived(message);
+}
+
 } // namespace host
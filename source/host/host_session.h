@@ -20,6 +20,7 @@
 #define HOST__HOST_SESSION_H
 
 #include "base/macros_magic.h"
+#include "proto/host.pb.h"
 
 #include <QByteArray>
 #include <QObject>
@@ -46,10 +47,21 @@ protected:
     // Sends outgoing message.
     void sendMessage(const QByteArray& message);
 
+    // Returns the size of the outgoing messages which are not sent yet.
+    int64_t pendingBytes() const;
+
     virtual void sessionStarted() = 0;
     virtual void messageReceived(const QByteArray& buffer) = 0;
 
+    // Called when a message from the host service is received (see common/service_message.h).
+    virtual void serviceMessageReceived(const proto::host::ServiceToSession& message);
+
+    // Called when an outgoing message is sent.
+    virtual void messageWritten();
+
 private:
+    void onMessageReceived(const QByteArray& buffer);
+
     QString channel_id_;
     ipc::Channel* channel_ = nullptr;
 
@@ -18,9 +18,12 @@
 
 #include "host/host_session_desktop.h"
 #include "base/power_controller.h"
+#include "codec/tile_cache.h"
+#include "codec/zstd_dictionary.h"
 #include "common/clipboard.h"
 #include "common/desktop_session_constants.h"
 #include "common/message_serialization.h"
+#include "common/service_message.h"
 #include "host/input_thread.h"
 #include "host/host_system_info.h"
 #include "proto/desktop_extensions.pb.h"
@@ -51,6 +54,9 @@ SessionDesktop::~SessionDesktop() = default;
 void SessionDesktop::onScreenUpdate(const QByteArray& message)
 {
     sendMessage(message);
+
+    if (screen_updater_)
+        screen_updater_->setPendingBytes(pendingBytes());
 }
 
 void SessionDesktop::sessionStarted()
@@ -72,6 +78,8 @@ void SessionDesktop::sessionStarted()
     // Add supported extensions and video encodings.
     request->set_extensions(extensions);
     request->set_video_encodings(common::kSupportedVideoEncodings);
+    request->set_tile_cache_size(codec::TileCache::kMaxCacheSize);
+    request->set_zstd_dictionary_id(codec::ZstdDictionary::kBuiltinId);
 
     // Send the request.
     sendMessage(common::serializeMessage(outgoing_message_));
@@ -103,6 +111,20 @@ void SessionDesktop::messageReceived(const QByteArray& buffer)
     }
 }
 
+void SessionDesktop::serviceMessageReceived(const proto::host::ServiceToSession& message)
+{
+    if (message.pipeline_stats_request())
+        sendPipelineStats();
+    else
+        LOG(LS_WARNING) << "Unhandled message from service";
+}
+
+void SessionDesktop::messageWritten()
+{
+    if (screen_updater_)
+        screen_updater_->setPendingBytes(pendingBytes());
+}
+
 void SessionDesktop::clipboardEvent(const proto::desktop::ClipboardEvent& event)
 {
     if (session_type_ != proto::SESSION_TYPE_DESKTOP_MANAGE)
@@ -124,6 +146,9 @@ void SessionDesktop::readPointerEvent(const proto::desktop::PointerEvent& event)
 
     if (input_thread_)
         input_thread_->injectPointerEvent(event);
+
+    if (screen_updater_)
+        screen_updater_->wakeUp();
 }
 
 void SessionDesktop::readKeyEvent(const proto::desktop::KeyEvent& event)
@@ -137,6 +162,9 @@ void SessionDesktop::readKeyEvent(const proto::desktop::KeyEvent& event)
 
     if (input_thread_)
         input_thread_->injectKeyEvent(event);
+
+    if (screen_updater_)
+        screen_updater_->wakeUp();
 }
 
 void SessionDesktop::readClipboardEvent(const proto::desktop::ClipboardEvent& clipboard_event)
@@ -255,7 +283,7 @@ void SessionDesktop::readConfig(const proto::desktop::Config& config)
 
     if (mask & DesktopConfigTracker::HAS_VIDEO)
     {
-        screen_updater_.reset(new ScreenUpdater(this));
+        screen_updater_.reset(new ScreenUpdater(this, &pipeline_stats_));
 
         if (!screen_updater_->start(config))
             stop();
@@ -276,4 +304,17 @@ void SessionDesktop::sendSystemInfo()
     sendMessage(common::serializeMessage(outgoing_message_));
 }
 
+void SessionDesktop::sendPipelineStats()
+{
+    proto::host::SessionToService message;
+
+    proto::desktop::PipelineStats* stats = message.mutable_pipeline_stats();
+    pipeline_stats_.serialize(stats);
+
+    if (screen_updater_)
+        screen_updater_->serializeStats(stats);
+
+    sendMessage(common::serializeServiceMessage(message));
+}
+
 } // namespace host
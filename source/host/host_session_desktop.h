@@ -21,6 +21,7 @@
 
 #include "host/desktop_config_tracker.h"
 #include "host/host_session.h"
+#include "host/pipeline_stats.h"
 #include "host/screen_updater.h"
 #include "proto/common.pb.h"
 #include "build/build_config.h"
@@ -50,6 +51,8 @@ protected:
     // Session implementation.
     void sessionStarted() override;
     void messageReceived(const QByteArray& buffer) override;
+    void serviceMessageReceived(const proto::host::ServiceToSession& message) override;
+    void messageWritten() override;
 
 private slots:
     void clipboardEvent(const proto::desktop::ClipboardEvent& event);
@@ -62,6 +65,7 @@ private:
     void readConfig(const proto::desktop::Config& config);
 
     void sendSystemInfo();
+    void sendPipelineStats();
 
     const proto::SessionType session_type_;
 
@@ -72,6 +76,9 @@ private:
 
     DesktopConfigTracker config_tracker_;
 
+    // Must be destroyed after the screen updater.
+    PipelineStats pipeline_stats_;
+
     std::unique_ptr<ScreenUpdater> screen_updater_;
     std::unique_ptr<common::Clipboard> clipboard_;
     std::unique_ptr<InputThread> input_thread_;
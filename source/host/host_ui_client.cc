@@ -99,6 +99,16 @@ void UiClient::killSession(const std::string& uuid)
     channel_->send(common::serializeMessage(message));
 }
 
+void UiClient::requestSessionStats(const std::string& uuid)
+{
+    if (!channel_)
+        return;
+
+    proto::host::UiToService message;
+    message.mutable_session_stats_request()->set_uuid(uuid);
+    channel_->send(common::serializeMessage(message));
+}
+
 void UiClient::onChannelMessage(const QByteArray& buffer)
 {
     proto::host::ServiceToUi message;
@@ -121,6 +131,10 @@ void UiClient::onChannelMessage(const QByteArray& buffer)
     {
         emit disconnectEvent(message.disconnect_event());
     }
+    else if (message.has_session_stats())
+    {
+        emit sessionStatsReceived(message.session_stats());
+    }
     else
     {
         LOG(LS_WARNING) << "Unhandled message from service";
@@ -49,6 +49,7 @@ public:
     void refresh();
     void newPassword();
     void killSession(const std::string& uuid);
+    void requestSessionStats(const std::string& uuid);
 
 signals:
     void connected();
@@ -57,6 +58,7 @@ signals:
     void credentialsReceived(const proto::host::Credentials& credentials);
     void connectEvent(const proto::host::ConnectEvent& event);
     void disconnectEvent(const proto::host::DisconnectEvent& event);
+    void sessionStatsReceived(const proto::host::SessionStats& stats);
 
 private slots:
     void onChannelMessage(const QByteArray& buffer);
@@ -86,6 +86,13 @@ void UiProcess::setDisconnectEvent(const std::string& uuid)
     channel_->send(common::serializeMessage(message));
 }
 
+void UiProcess::setSessionStats(const proto::host::SessionStats& stats)
+{
+    proto::host::ServiceToUi message;
+    message.mutable_session_stats()->CopyFrom(stats);
+    channel_->send(common::serializeMessage(message));
+}
+
 bool UiProcess::start()
 {
     if (state_ != State::STOPPED)
@@ -155,6 +162,10 @@ void UiProcess::onMessageReceived(const QByteArray& buffer)
     {
         emit killSession(message.kill_session().uuid());
     }
+    else if (message.has_session_stats_request())
+    {
+        emit sessionStatsRequest(message.session_stats_request().uuid());
+    }
     else
     {
         LOG(LS_WARNING) << "Unhandled message from UI";
@@ -46,6 +46,7 @@ public:
 
     void setConnectEvent(const proto::host::ConnectEvent& event);
     void setDisconnectEvent(const std::string& uuid);
+    void setSessionStats(const proto::host::SessionStats& stats);
 
     enum class State { STOPPED, STARTED };
 
@@ -59,6 +60,7 @@ signals:
     void finished();
     void userChanged(base::win::SessionId session_id, const std::string& password);
     void killSession(const std::string& session_uuid);
+    void sessionStatsRequest(const std::string& session_uuid);
 
 private slots:
     void onProcessFinished(int exit_code);
@@ -143,6 +143,14 @@ void UiServer::setDisconnectEvent(base::win::SessionId session_id, const std::st
         (*result)->setDisconnectEvent(uuid);
 }
 
+void UiServer::setSessionStats(
+    base::win::SessionId session_id, const proto::host::SessionStats& stats)
+{
+    auto result = std::find_if(processes_.cbegin(), processes_.cend(), IsProcessInSession(session_id));
+    if (result != processes_.cend())
+        (*result)->setSessionStats(stats);
+}
+
 void UiServer::onChannelConnected(ipc::Channel* channel)
 {
     base::win::SessionId session_id = channel->clientSessionId();
@@ -163,6 +171,7 @@ void UiServer::onChannelConnected(ipc::Channel* channel)
 
     connect(process, &UiProcess::userChanged, this, &UiServer::onUserChanged);
     connect(process, &UiProcess::killSession, this, &UiServer::killSession);
+    connect(process, &UiProcess::sessionStatsRequest, this, &UiServer::sessionStatsRequest);
     connect(process, &UiProcess::finished, this, &UiServer::onProcessFinished);
 
     processes_.emplace_front(process);
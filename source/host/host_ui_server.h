@@ -60,6 +60,7 @@ public:
     void setSessionEvent(base::win::SessionStatus status, base::win::SessionId session_id);
     void setConnectEvent(base::win::SessionId session_id, const proto::host::ConnectEvent& event);
     void setDisconnectEvent(base::win::SessionId session_id, const std::string& uuid);
+    void setSessionStats(base::win::SessionId session_id, const proto::host::SessionStats& stats);
 
     const UserList& userList() const { return users_; }
 
@@ -67,6 +68,7 @@ signals:
     void processEvent(EventType event, base::win::SessionId session_id);
     void userListChanged();
     void killSession(const std::string& uuid);
+    void sessionStatsRequest(const std::string& uuid);
     void finished();
 
 private slots:
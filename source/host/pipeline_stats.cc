@@ -0,0 +1,101 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "host/pipeline_stats.h"
+
+#include <algorithm>
+
+namespace host {
+
+void PipelineStats::addTime(Stage stage, const Clock::time_point& begin_time)
+{
+    addTime(stage, std::chrono::duration_cast<std::chrono::microseconds>(
+        Clock::now() - begin_time));
+}
+
+void PipelineStats::addTime(Stage stage, const std::chrono::microseconds& time)
+{
+    std::scoped_lock lock(lock_);
+    histograms_[stage].add(time);
+}
+
+void PipelineStats::serialize(proto::desktop::PipelineStats* stats) const
+{
+    std::scoped_lock lock(lock_);
+
+    for (int i = 0; i < proto::desktop::PipelineStats::Stage_ARRAYSIZE; ++i)
+        serializeHistogram(static_cast<Stage>(i), histograms_[i], stats);
+}
+
+// static
+void PipelineStats::serializeHistogram(Stage stage,
+                                       const base::LatencyHistogram& histogram,
+                                       proto::desktop::PipelineStats* stats)
+{
+    if (!histogram.count())
+        return;
+
+    proto::desktop::PipelineStats::Histogram* item = stats->add_histogram();
+
+    item->set_stage(stage);
+    item->set_count(histogram.count());
+    item->set_p50(static_cast<uint32_t>(histogram.percentile(50).count()));
+    item->set_p95(static_cast<uint32_t>(histogram.percentile(95).count()));
+    item->set_p99(static_cast<uint32_t>(histogram.percentile(99).count()));
+    item->set_max(static_cast<uint32_t>(histogram.max().count()));
+}
+
+// static
+void PipelineStats::serializeCaptureScheduler(const desktop::CaptureScheduler::Counters& counters,
+                                              proto::desktop::PipelineStats* stats)
+{
+    proto::desktop::PipelineStats::CaptureScheduler* item = stats->mutable_capture_scheduler();
+
+    item->set_interval(static_cast<uint32_t>(counters.interval.count()));
+
+    switch (counters.reason)
+    {
+        case desktop::CaptureScheduler::Reason::MIN_INTERVAL:
+            item->set_reason(proto::desktop::PipelineStats::CAPTURE_REASON_MIN_INTERVAL);
+            break;
+
+        case desktop::CaptureScheduler::Reason::CPU:
+            item->set_reason(proto::desktop::PipelineStats::CAPTURE_REASON_CPU);
+            break;
+
+        case desktop::CaptureScheduler::Reason::BACKLOG:
+            item->set_reason(proto::desktop::PipelineStats::CAPTURE_REASON_BACKLOG);
+            break;
+
+        case desktop::CaptureScheduler::Reason::IDLE:
+            item->set_reason(proto::desktop::PipelineStats::CAPTURE_REASON_IDLE);
+            break;
+    }
+
+    item->set_min_interval_count(counters.min_interval_count);
+    item->set_cpu_count(counters.cpu_count);
+    item->set_backlog_count(counters.backlog_count);
+    item->set_idle_count(counters.idle_count);
+
+    item->set_capture_time(static_cast<uint32_t>(counters.capture_time.count()));
+    item->set_encode_time(static_cast<uint32_t>(counters.encode_time.count()));
+
+    item->set_pending_bytes(static_cast<uint64_t>(std::max<int64_t>(counters.pending_bytes, 0)));
+}
+
+} // namespace host
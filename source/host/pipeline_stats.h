@@ -0,0 +1,66 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef HOST__PIPELINE_STATS_H
+#define HOST__PIPELINE_STATS_H
+
+#include "base/latency_histogram.h"
+#include "base/macros_magic.h"
+#include "desktop/capture_scheduler.h"
+#include "proto/desktop_extensions.pb.h"
+
+#include <array>
+#include <mutex>
+
+namespace host {
+
+// Collects the latencies of the stages of the video pipeline for the whole session. The stages
+// are measured in different threads, so the class is thread-safe.
+class PipelineStats
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using Stage = proto::desktop::PipelineStats::Stage;
+
+    PipelineStats() = default;
+    ~PipelineStats() = default;
+
+    // Adds the time from |begin_time| to the current moment to the histogram of |stage|.
+    void addTime(Stage stage, const Clock::time_point& begin_time);
+    void addTime(Stage stage, const std::chrono::microseconds& time);
+
+    // Adds the percentiles of all the stages which have values to |stats|.
+    void serialize(proto::desktop::PipelineStats* stats) const;
+
+    static void serializeHistogram(Stage stage,
+                                   const base::LatencyHistogram& histogram,
+                                   proto::desktop::PipelineStats* stats);
+
+    static void serializeCaptureScheduler(const desktop::CaptureScheduler::Counters& counters,
+                                          proto::desktop::PipelineStats* stats);
+
+private:
+    mutable std::mutex lock_;
+    std::array<base::LatencyHistogram, proto::desktop::PipelineStats::Stage_ARRAYSIZE> histograms_;
+
+    DISALLOW_COPY_AND_ASSIGN(PipelineStats);
+};
+
+} // namespace host
+
+#endif // HOST__PIPELINE_STATS_H
@@ -17,6 +17,8 @@
 //
 
 #include "host/screen_updater.h"
+#include "base/logging.h"
+#include "host/pipeline_stats.h"
 #include "host/screen_updater_impl.h"
 
 namespace host {
@@ -25,16 +27,17 @@ namespace host {
 // ScreenUpdater implementation.
 //================================================================================================
 
-ScreenUpdater::ScreenUpdater(Delegate* delegate, QObject* parent)
+ScreenUpdater::ScreenUpdater(Delegate* delegate, PipelineStats* stats, QObject* parent)
     : QObject(parent),
-      delegate_(delegate)
+      delegate_(delegate),
+      stats_(stats)
 {
-    // Nothing
+    DCHECK(stats_);
 }
 
 bool ScreenUpdater::start(const proto::desktop::Config& config)
 {
-    impl_ = new ScreenUpdaterImpl(this);
+    impl_ = new ScreenUpdaterImpl(stats_, this);
     return impl_->startUpdater(config);
 }
 
@@ -43,12 +46,33 @@ void ScreenUpdater::selectScreen(int64_t screen_id)
     impl_->selectScreen(screen_id);
 }
 
+void ScreenUpdater::setPendingBytes(int64_t pending_bytes)
+{
+    impl_->setPendingBytes(pending_bytes);
+}
+
+void ScreenUpdater::wakeUp()
+{
+    impl_->wakeUp();
+}
+
+void ScreenUpdater::serializeStats(proto::desktop::PipelineStats* stats) const
+{
+    impl_->serializeStats(stats);
+}
+
 void ScreenUpdater::customEvent(QEvent* event)
 {
     if (event->type() != ScreenUpdaterImpl::MessageEvent::kType)
         return;
 
-    delegate_->onScreenUpdate(static_cast<ScreenUpdaterImpl::MessageEvent*>(event)->buffer());
+    ScreenUpdaterImpl::MessageEvent* message_event =
+        static_cast<ScreenUpdaterImpl::MessageEvent*>(event);
+
+    delegate_->onScreenUpdate(message_event->buffer());
+
+    if (message_event->captureTime() != PipelineStats::Clock::time_point())
+        stats_->addTime(proto::desktop::PipelineStats::STAGE_TOTAL, message_event->captureTime());
 }
 
 } // namespace host
@@ -21,11 +21,13 @@
 
 #include "base/macros_magic.h"
 #include "proto/desktop.pb.h"
+#include "proto/desktop_extensions.pb.h"
 
 #include <QObject>
 
 namespace host {
 
+class PipelineStats;
 class ScreenUpdaterImpl;
 
 class ScreenUpdater : public QObject
@@ -41,13 +43,25 @@ public:
         virtual void onScreenUpdate(const QByteArray& message) = 0;
     };
 
-    ScreenUpdater(Delegate* delegate, QObject* parent = nullptr);
+    // The latencies of the pipeline stages are added to |stats|, which must outlive the updater.
+    ScreenUpdater(Delegate* delegate, PipelineStats* stats, QObject* parent = nullptr);
     ~ScreenUpdater() = default;
 
+    // Adds the state of the capture scheduler to |stats|.
+    void serializeStats(proto::desktop::PipelineStats* stats) const;
+
 public slots:
     bool start(const proto::desktop::Config& config);
     void selectScreen(int64_t screen_id);
 
+    // Reports the size of the outgoing data which is not sent yet. The updater captures the
+    // screen less often if the data is not sent in time.
+    void setPendingBytes(int64_t pending_bytes);
+
+    // Called when the user input arrives. The screen is likely to change soon, so the updater
+    // leaves the idle mode.
+    void wakeUp();
+
 protected:
     // QObject implementation.
     void customEvent(QEvent* event) override;
@@ -55,6 +69,7 @@ protected:
 private:
     ScreenUpdaterImpl* impl_ = nullptr;
     Delegate* delegate_;
+    PipelineStats* stats_;
 
     DISALLOW_COPY_AND_ASSIGN(ScreenUpdater);
 };
@@ -23,10 +23,14 @@
 #include "codec/video_encoder_vpx.h"
 #include "codec/video_encoder_zstd.h"
 #include "codec/video_util.h"
+#include "codec/zstd_dictionary.h"
 #include "common/desktop_session_constants.h"
 #include "common/message_serialization.h"
 #include "desktop/capture_scheduler.h"
 #include "desktop/cursor_capturer_win.h"
+#include "desktop/frame_pool.h"
+#include "desktop/mouse_cursor.h"
+#include "desktop/move_detector.h"
 #include "desktop/screen_capturer_wrapper.h"
 #include "proto/desktop_extensions.pb.h"
 
@@ -34,8 +38,9 @@
 
 namespace host {
 
-ScreenUpdaterImpl::ScreenUpdaterImpl(QObject* parent)
-    : QThread(parent)
+ScreenUpdaterImpl::ScreenUpdaterImpl(PipelineStats* stats, QObject* parent)
+    : QThread(parent),
+      stats_(stats)
 {
     // Nothing
 }
@@ -60,6 +65,14 @@ bool ScreenUpdaterImpl::startUpdater(const proto::desktop::Config& config)
     if (!scale_reducer_)
         return false;
 
+    uint32_t dictionary_id = config.zstd_dictionary_id();
+
+    if (dictionary_id && dictionary_id != codec::ZstdDictionary::kBuiltinId)
+    {
+        LOG(LS_WARNING) << "Unknown Zstd dictionary: " << dictionary_id;
+        dictionary_id = 0;
+    }
+
     switch (config.video_encoding())
     {
         case proto::desktop::VIDEO_ENCODING_VP8:
@@ -71,10 +84,31 @@ bool ScreenUpdaterImpl::startUpdater(const proto::desktop::Config& config)
             break;
 
         case proto::desktop::VIDEO_ENCODING_ZSTD:
+        {
+            size_t tile_cache_size = config.tile_cache_size();
+
+            if (tile_cache_size && !codec::TileCache::isValidCacheSize(tile_cache_size))
+            {
+                LOG(LS_WARNING) << "Invalid tile cache size: " << tile_cache_size;
+                tile_cache_size = 0;
+            }
+
+            uint32_t zstd_tile_size = config.zstd_tile_size();
+
+            if (zstd_tile_size && !codec::VideoEncoderZstd::isValidZstdTileSize(zstd_tile_size))
+            {
+                LOG(LS_WARNING) << "Invalid Zstd tile size: " << zstd_tile_size;
+                zstd_tile_size = 0;
+            }
+
             video_encoder_.reset(codec::VideoEncoderZstd::create(
-                codec::VideoUtil::fromVideoPixelFormat(
-                    config.pixel_format()), config.compress_ratio()));
-            break;
+                codec::VideoUtil::fromVideoPixelFormat(config.pixel_format()),
+                config.compress_ratio(),
+                tile_cache_size,
+                config.flags(),
+                static_cast<int>(zstd_tile_size)));
+        }
+        break;
 
         default:
         {
@@ -88,10 +122,20 @@ bool ScreenUpdaterImpl::startUpdater(const proto::desktop::Config& config)
     if (!video_encoder_)
         return false;
 
+    video_encoding_ = config.video_encoding();
+
+    // The moves are detected in the source frame, the coordinates do not match the scaled frame.
+    if ((config.flags() & proto::desktop::ENABLE_COPY_RECT) &&
+        codec::VideoUtil::isCopyRectSupported(video_encoding_) &&
+        config.scale_factor() == 100)
+    {
+        move_detector_ = std::make_unique<desktop::MoveDetector>();
+    }
+
     if (config.flags() & proto::desktop::ENABLE_CURSOR_SHAPE)
     {
         cursor_capturer_.reset(new desktop::CursorCapturerWin());
-        cursor_encoder_.reset(new codec::CursorEncoder());
+        cursor_encoder_.reset(new codec::CursorEncoder(dictionary_id));
     }
 
     capture_scheduler_.reset(
@@ -118,9 +162,43 @@ void ScreenUpdaterImpl::selectScreen(desktop::ScreenCapturer::ScreenId screen_id
     event_condition_.notify_all();
 }
 
+void ScreenUpdaterImpl::wakeUp()
+{
+    std::scoped_lock lock(event_lock_);
+    wake_up_ = true;
+    event_condition_.notify_all();
+}
+
+void ScreenUpdaterImpl::setPendingBytes(int64_t pending_bytes)
+{
+    if (capture_scheduler_)
+        capture_scheduler_->setPendingBytes(pending_bytes);
+
+    {
+        std::scoped_lock lock(frame_lock_);
+
+        // If the outgoing messages exceed the high watermark, no new messages are created until
+        // the size is reduced to the low watermark. The capture scheduler increases the interval
+        // at the same sizes.
+        if (pending_bytes >= desktop::CaptureScheduler::kBacklogHighBytes)
+            send_blocked_ = true;
+        else if (pending_bytes <= desktop::CaptureScheduler::kBacklogLowBytes)
+            send_blocked_ = false;
+    }
+
+    frame_condition_.notify_one();
+}
+
+void ScreenUpdaterImpl::serializeStats(proto::desktop::PipelineStats* stats) const
+{
+    if (capture_scheduler_)
+        PipelineStats::serializeCaptureScheduler(capture_scheduler_->counters(), stats);
+}
+
 void ScreenUpdaterImpl::run()
 {
     screen_capturer_ = std::make_unique<desktop::ScreenCapturerWrapper>(screen_capturer_flags_);
+    encode_thread_ = std::thread(&ScreenUpdaterImpl::encodeThread, this);
 
     while (true)
     {
@@ -164,40 +242,48 @@ void ScreenUpdaterImpl::run()
 
         capture_scheduler_->beginCapture();
 
+        const PipelineStats::Clock::time_point capture_time = PipelineStats::Clock::now();
+        bool has_changes = false;
+
         const desktop::Frame* screen_frame = screen_capturer_->captureFrame();
         if (screen_frame)
         {
-            message_.Clear();
-
-            if (!screen_frame->constUpdatedRegion().isEmpty())
-            {
-                video_encoder_->encode(scale_reducer_->scaleFrame(screen_frame),
-                                       message_.mutable_video_packet());
-            }
+            std::unique_ptr<desktop::MouseCursor> mouse_cursor;
 
             if (cursor_capturer_ && cursor_encoder_)
-            {
-                std::unique_ptr<desktop::MouseCursor> mouse_cursor(
-                    cursor_capturer_->captureCursor());
-                if (mouse_cursor)
-                {
-                    cursor_encoder_->encode(std::move(mouse_cursor),
-                                            message_.mutable_cursor_shape());
-                }
-            }
+                mouse_cursor.reset(cursor_capturer_->captureCursor());
 
-            if (message_.has_video_packet() || message_.has_cursor_shape())
-            {
-                QCoreApplication::postEvent(parent(),
-                                        new MessageEvent(common::serializeMessage(message_)),
-                                        Qt::HighEventPriority);
-            }
+            has_changes = !screen_frame->constUpdatedRegion().isEmpty() || mouse_cursor;
+
+            // Captures without changes are not counted, otherwise the idle screen hides the
+            // latency of the real updates.
+            if (has_changes)
+                stats_->addTime(proto::desktop::PipelineStats::STAGE_CAPTURE, capture_time);
+
+            queueFrame(screen_frame, std::move(mouse_cursor), capture_time);
         }
 
-        capture_scheduler_->endCapture();
+        capture_scheduler_->endCapture(has_changes);
 
         std::unique_lock lock(event_lock_);
-        event_condition_.wait_for(lock, capture_scheduler_->nextCaptureDelay());
+
+        while (event_ == Event::NO_EVENT)
+        {
+            if (wake_up_)
+            {
+                // The user input leaves the idle mode. The delay is recalculated: after the idle
+                // mode the capture happens immediately, otherwise the normal interval is kept.
+                wake_up_ = false;
+                capture_scheduler_->wakeUp();
+            }
+
+            std::chrono::milliseconds delay = capture_scheduler_->nextCaptureDelay();
+            if (delay <= std::chrono::milliseconds::zero())
+                break;
+
+            if (event_condition_.wait_for(lock, delay) == std::cv_status::timeout)
+                break;
+        }
 
         switch (event_)
         {
@@ -205,6 +291,8 @@ void ScreenUpdaterImpl::run()
                 break;
 
             case Event::TERMINATE:
+                lock.unlock();
+                stopEncodeThread();
                 return;
 
             case Event::SELECT_SCREEN:
@@ -216,4 +304,196 @@ void ScreenUpdaterImpl::run()
     }
 }
 
+void ScreenUpdaterImpl::queueFrame(const desktop::Frame* frame,
+                                   std::unique_ptr<desktop::MouseCursor> mouse_cursor,
+                                   const PipelineStats::Clock::time_point& capture_time)
+{
+    std::scoped_lock lock(frame_lock_);
+
+    const bool was_empty = !pending_cursor_ &&
+        (!pending_frame_ || pending_frame_->constUpdatedRegion().isEmpty());
+
+    if (!pending_frame_ ||
+        pending_frame_->size() != frame->size() ||
+        pending_frame_->format() != frame->format())
+    {
+        pending_frame_.reset();
+        pending_frame_ = desktop::FramePool::instance()->allocate(frame->size(), frame->format());
+        if (!pending_frame_)
+        {
+            LOG(LS_WARNING) << "Failed to allocate frame";
+            return;
+        }
+
+        // The new frame is sent completely.
+        const desktop::Rect frame_rect = desktop::Rect::makeSize(frame->size());
+
+        pending_frame_->copyPixelsFrom(*frame, frame_rect.topLeft(), frame_rect);
+        pending_frame_->updatedRegion()->addRect(frame_rect);
+    }
+    else
+    {
+        const desktop::Region& updated_region = frame->constUpdatedRegion();
+
+        for (desktop::Region::Iterator it(updated_region); !it.isAtEnd(); it.advance())
+            pending_frame_->copyPixelsFrom(*frame, it.rect().topLeft(), it.rect());
+
+        pending_frame_->updatedRegion()->addRegion(updated_region);
+    }
+
+    pending_frame_->setTopLeft(frame->topLeft());
+
+    if (mouse_cursor)
+        pending_cursor_ = std::move(mouse_cursor);
+
+    if (!pending_frame_->constUpdatedRegion().isEmpty() || pending_cursor_)
+    {
+        if (was_empty)
+            pending_time_ = capture_time;
+
+        frame_condition_.notify_one();
+    }
+}
+
+void ScreenUpdaterImpl::encodeThread()
+{
+    while (true)
+    {
+        std::unique_ptr<desktop::MouseCursor> mouse_cursor;
+        PipelineStats::Clock::time_point capture_time;
+
+        bool has_move = false;
+        desktop::Rect move_rect;
+        desktop::Point move_source;
+
+        {
+            std::unique_lock lock(frame_lock_);
+
+            // While the outgoing messages are not sent, the changes are accumulated in the
+            // pending frame and then sent together.
+            frame_condition_.wait(lock, [this]()
+            {
+                return encode_terminate_ || (!send_blocked_ && (pending_cursor_ ||
+                    (pending_frame_ && !pending_frame_->constUpdatedRegion().isEmpty())));
+            });
+
+            if (encode_terminate_)
+                return;
+
+            capture_time = pending_time_;
+            stats_->addTime(proto::desktop::PipelineStats::STAGE_QUEUE, capture_time);
+
+            if (pending_frame_ && !pending_frame_->constUpdatedRegion().isEmpty())
+            {
+                if (!encode_frame_ ||
+                    encode_frame_->size() != pending_frame_->size() ||
+                    encode_frame_->format() != pending_frame_->format())
+                {
+                    // The pending frame was recreated with the full updated region, so the
+                    // whole new frame is copied below.
+                    encode_frame_.reset();
+                    encode_frame_ = desktop::FramePool::instance()->allocate(
+                        pending_frame_->size(), pending_frame_->format());
+                    if (!encode_frame_)
+                    {
+                        // The next captured frame is recreated and sent completely.
+                        LOG(LS_WARNING) << "Failed to allocate frame";
+                        pending_frame_.reset();
+                        continue;
+                    }
+                }
+                else if (move_detector_ && encode_frame_->topLeft() == pending_frame_->topLeft())
+                {
+                    // The encoding frame contains the image which the client has. If a part of
+                    // it is moved, the client copies it instead of decoding it.
+                    has_move = move_detector_->detect(*encode_frame_, *pending_frame_,
+                                                      pending_frame_->constUpdatedRegion(),
+                                                      &move_rect, &move_source);
+                    if (has_move)
+                        encode_frame_->copyPixelsWithin(move_source, move_rect);
+                }
+
+                desktop::Region copy_region(pending_frame_->constUpdatedRegion());
+                if (has_move)
+                    copy_region.subtract(move_rect);
+
+                // Only the changed areas are copied. The capture thread is blocked for this time
+                // only, not for the time of the encoding.
+                for (desktop::Region::Iterator it(copy_region); !it.isAtEnd(); it.advance())
+                    encode_frame_->copyPixelsFrom(*pending_frame_, it.rect().topLeft(), it.rect());
+
+                encode_frame_->copyFrameInfoFrom(*pending_frame_);
+                pending_frame_->updatedRegion()->clear();
+
+                // The moved area is already equal to the pending frame.
+                if (has_move)
+                    encode_frame_->updatedRegion()->subtract(move_rect);
+            }
+
+            mouse_cursor = std::move(pending_cursor_);
+        }
+
+        video_message_.Clear();
+
+        if (encode_frame_ && !encode_frame_->constUpdatedRegion().isEmpty())
+        {
+            const PipelineStats::Clock::time_point begin_time = PipelineStats::Clock::now();
+
+            const desktop::Frame* scaled_frame = scale_reducer_->scaleFrame(encode_frame_.get());
+
+            const PipelineStats::Clock::time_point encode_time = PipelineStats::Clock::now();
+            stats_->addTime(proto::desktop::PipelineStats::STAGE_SCALE, begin_time);
+
+            video_encoder_->encode(scaled_frame, video_message_.mutable_video_packet());
+            encode_frame_->updatedRegion()->clear();
+
+            stats_->addTime(proto::desktop::PipelineStats::STAGE_ENCODE, encode_time);
+
+            capture_scheduler_->addEncodeTime(std::chrono::duration_cast<std::chrono::microseconds>(
+                PipelineStats::Clock::now() - begin_time));
+        }
+
+        if (has_move)
+        {
+            proto::desktop::VideoPacket* video_packet = video_message_.mutable_video_packet();
+
+            // The packet may contain only the move.
+            if (!video_packet->dirty_rect_size())
+                video_packet->set_encoding(video_encoding_);
+
+            proto::desktop::CopyRect* copy_rect = video_packet->add_copy_rect();
+            codec::VideoUtil::toVideoRect(move_rect, copy_rect->mutable_dest_rect());
+            copy_rect->set_source_x(move_source.x());
+            copy_rect->set_source_y(move_source.y());
+        }
+
+        if (mouse_cursor)
+            cursor_encoder_->encode(std::move(mouse_cursor), video_message_.mutable_cursor_shape());
+
+        if (video_message_.has_video_packet() || video_message_.has_cursor_shape())
+        {
+            const PipelineStats::Clock::time_point serialize_time = PipelineStats::Clock::now();
+
+            QByteArray buffer = common::serializeMessage(video_message_);
+
+            stats_->addTime(proto::desktop::PipelineStats::STAGE_SERIALIZE, serialize_time);
+
+            QCoreApplication::postEvent(parent(),
+                                        new MessageEvent(std::move(buffer), capture_time),
+                                        Qt::HighEventPriority);
+        }
+    }
+}
+
+void ScreenUpdaterImpl::stopEncodeThread()
+{
+    {
+        std::scoped_lock lock(frame_lock_);
+        encode_terminate_ = true;
+    }
+
+    frame_condition_.notify_one();
+    encode_thread_.join();
+}
+
 } // namespace host
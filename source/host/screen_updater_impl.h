@@ -20,11 +20,16 @@
 #define HOST__SCREEN_UPDATER_IMPL_H
 
 #include "desktop/screen_capturer_wrapper.h"
+#include "host/pipeline_stats.h"
 #include "proto/desktop.pb.h"
 
 #include <QEvent>
 #include <QThread>
 
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 namespace codec {
 class CursorEncoder;
 class ScaleReducer;
@@ -34,6 +39,9 @@ class VideoEncoder;
 namespace desktop {
 class CaptureScheduler;
 class CursorCapturer;
+class Frame;
+class MouseCursor;
+class MoveDetector;
 } // namespace desktop
 
 namespace host {
@@ -41,7 +49,7 @@ namespace host {
 class ScreenUpdaterImpl : public QThread
 {
 public:
-    explicit ScreenUpdaterImpl(QObject* parent);
+    ScreenUpdaterImpl(PipelineStats* stats, QObject* parent);
     ~ScreenUpdaterImpl();
 
     class MessageEvent : public QEvent
@@ -49,22 +57,31 @@ public:
     public:
         static const int kType = QEvent::User + 1;
 
-        MessageEvent(QByteArray&& buffer) noexcept
+        // |capture_time| is the time of the capture of the oldest change in the message or the
+        // default value if the message does not contain screen changes.
+        MessageEvent(QByteArray&& buffer,
+                     const PipelineStats::Clock::time_point& capture_time = {}) noexcept
             : QEvent(static_cast<QEvent::Type>(kType)),
-              buffer_(std::move(buffer))
+              buffer_(std::move(buffer)),
+              capture_time_(capture_time)
         {
             // Nothing
         }
 
         const QByteArray& buffer() const { return buffer_; }
+        const PipelineStats::Clock::time_point& captureTime() const { return capture_time_; }
 
     private:
         QByteArray buffer_;
+        const PipelineStats::Clock::time_point capture_time_;
         DISALLOW_COPY_AND_ASSIGN(MessageEvent);
     };
 
     bool startUpdater(const proto::desktop::Config& config);
     void selectScreen(desktop::ScreenCapturer::ScreenId screen_id);
+    void setPendingBytes(int64_t pending_bytes);
+    void wakeUp();
+    void serializeStats(proto::desktop::PipelineStats* stats) const;
 
 protected:
     // QThread implementation.
@@ -73,6 +90,18 @@ protected:
 private:
     enum class Event { NO_EVENT, SELECT_SCREEN, TERMINATE };
 
+    // Copies the changed areas of |frame| to the pending frame and wakes up the encoding thread.
+    // Called from the capture thread.
+    void queueFrame(const desktop::Frame* frame,
+                    std::unique_ptr<desktop::MouseCursor> mouse_cursor,
+                    const PipelineStats::Clock::time_point& capture_time);
+
+    // The encoding thread takes the changes accumulated in the pending frame, scales, encodes
+    // and sends them.
+    void encodeThread();
+    void stopEncodeThread();
+
+    PipelineStats* const stats_;
     uint32_t screen_capturer_flags_ = 0;
 
     std::unique_ptr<desktop::CaptureScheduler> capture_scheduler_;
@@ -80,6 +109,10 @@ private:
     std::unique_ptr<desktop::ScreenCapturerWrapper> screen_capturer_;
     std::unique_ptr<codec::ScaleReducer> scale_reducer_;
     std::unique_ptr<codec::VideoEncoder> video_encoder_;
+    proto::desktop::VideoEncoding video_encoding_ = proto::desktop::VIDEO_ENCODING_UNKNOWN;
+
+    // Created if the client supports copying of rectangles. Used only by the encoding thread.
+    std::unique_ptr<desktop::MoveDetector> move_detector_;
 
     std::unique_ptr<desktop::CursorCapturer> cursor_capturer_;
     std::unique_ptr<codec::CursorEncoder> cursor_encoder_;
@@ -90,11 +123,33 @@ private:
     int screen_count_ = 0;
 
     Event event_ = Event::NO_EVENT;
+    bool wake_up_ = false;
     std::condition_variable event_condition_;
     std::mutex event_lock_;
 
     proto::desktop::HostToClient message_;
 
+    // The capture and the encoding work in separate threads. The capture thread accumulates the
+    // changes of the screen in |pending_frame_| while the encoding thread encodes the previous
+    // changes. If the encoding is slower than the capture, the changes of several captured frames
+    // are encoded together.
+    std::unique_ptr<desktop::Frame> pending_frame_;
+    std::unique_ptr<desktop::MouseCursor> pending_cursor_;
+
+    // The capture time of the oldest change which is not taken by the encoding thread yet.
+    PipelineStats::Clock::time_point pending_time_;
+    bool encode_terminate_ = false;
+
+    // Set while the outgoing messages are not sent in time.
+    bool send_blocked_ = false;
+    std::condition_variable frame_condition_;
+    std::mutex frame_lock_;
+
+    // Used only by the encoding thread.
+    std::unique_ptr<desktop::Frame> encode_frame_;
+    proto::desktop::HostToClient video_message_;
+    std::thread encode_thread_;
+
     DISALLOW_COPY_AND_ASSIGN(ScreenUpdaterImpl);
 };
 
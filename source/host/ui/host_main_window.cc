@@ -109,6 +109,12 @@ void MainWindow::connectToService()
             connect(notifier_, &NotifierWindow::killSession,
                     client_, &UiClient::killSession);
 
+            connect(notifier_, &NotifierWindow::sessionStatsRequest,
+                    client_, &UiClient::requestSessionStats);
+
+            connect(client_, &UiClient::sessionStatsReceived,
+                    notifier_, &NotifierWindow::onSessionStats);
+
             notifier_->setAttribute(Qt::WA_DeleteOnClose);
             notifier_->show();
             notifier_->activateWindow();
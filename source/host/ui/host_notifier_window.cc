@@ -21,6 +21,7 @@
 #include "build/build_config.h"
 
 #include <QMenu>
+#include <QMessageBox>
 #include <QMouseEvent>
 #include <QScreen>
 #include <QTranslator>
@@ -66,6 +67,39 @@ private:
     DISALLOW_COPY_AND_ASSIGN(SessionTreeItem);
 };
 
+QString stageName(proto::desktop::PipelineStats::Stage stage)
+{
+    switch (stage)
+    {
+        case proto::desktop::PipelineStats::STAGE_CAPTURE:
+            return NotifierWindow::tr("Capture");
+
+        case proto::desktop::PipelineStats::STAGE_QUEUE:
+            return NotifierWindow::tr("Queue");
+
+        case proto::desktop::PipelineStats::STAGE_SCALE:
+            return NotifierWindow::tr("Scale");
+
+        case proto::desktop::PipelineStats::STAGE_ENCODE:
+            return NotifierWindow::tr("Encode");
+
+        case proto::desktop::PipelineStats::STAGE_SERIALIZE:
+            return NotifierWindow::tr("Serialize");
+
+        case proto::desktop::PipelineStats::STAGE_TOTAL:
+            return NotifierWindow::tr("Total");
+
+        case proto::desktop::PipelineStats::STAGE_ENCRYPT:
+            return NotifierWindow::tr("Encrypt");
+
+        case proto::desktop::PipelineStats::STAGE_NETWORK_WRITE:
+            return NotifierWindow::tr("Network write");
+
+        default:
+            return NotifierWindow::tr("Unknown");
+    }
+}
+
 } // namespace
 
 NotifierWindow::NotifierWindow(QWidget* parent)
@@ -118,6 +152,55 @@ void NotifierWindow::onDisconnectEvent(const proto::host::DisconnectEvent& event
     }
 }
 
+void NotifierWindow::onSessionStats(const proto::host::SessionStats& stats)
+{
+    QString title;
+
+    for (int i = 0; i < ui.tree->topLevelItemCount(); ++i)
+    {
+        SessionTreeItem* item = dynamic_cast<SessionTreeItem*>(ui.tree->topLevelItem(i));
+        if (item && item->uuid() == stats.uuid())
+        {
+            title = item->text(0);
+            break;
+        }
+    }
+
+    // The session is already disconnected.
+    if (title.isEmpty())
+        return;
+
+    const proto::desktop::PipelineStats& pipeline_stats = stats.pipeline_stats();
+    QStringList lines;
+
+    // The latencies are in microseconds.
+    for (const auto& histogram : pipeline_stats.histogram())
+    {
+        lines.append(tr("%1: %2 times, p50 %3 ms, p95 %4 ms, p99 %5 ms, max %6 ms")
+                     .arg(stageName(histogram.stage()))
+                     .arg(histogram.count())
+                     .arg(histogram.p50() / 1000.0, 0, 'f', 1)
+                     .arg(histogram.p95() / 1000.0, 0, 'f', 1)
+                     .arg(histogram.p99() / 1000.0, 0, 'f', 1)
+                     .arg(histogram.max() / 1000.0, 0, 'f', 1));
+    }
+
+    if (pipeline_stats.has_capture_scheduler())
+    {
+        const proto::desktop::PipelineStats::CaptureScheduler& scheduler =
+            pipeline_stats.capture_scheduler();
+
+        lines.append(tr("Capture interval: %1 ms, unsent data: %2 bytes")
+                     .arg(scheduler.interval())
+                     .arg(scheduler.pending_bytes()));
+    }
+
+    if (lines.isEmpty())
+        lines.append(tr("No statistics are collected yet."));
+
+    QMessageBox::information(this, title, lines.join(QLatin1Char('\n')));
+}
+
 void NotifierWindow::disconnectAll()
 {
     for (int i = 0; i < ui.tree->topLevelItemCount(); ++i)
@@ -191,12 +274,17 @@ void NotifierWindow::onContextMenu(const QPoint& point)
         return;
 
     QAction disconnect_action(tr("Disconnect"));
+    QAction stats_action(tr("Statistics"));
 
     QMenu menu;
     menu.addAction(&disconnect_action);
+    menu.addAction(&stats_action);
 
-    if (menu.exec(ui.tree->viewport()->mapToGlobal(point)) == &disconnect_action)
+    QAction* action = menu.exec(ui.tree->viewport()->mapToGlobal(point));
+    if (action == &disconnect_action)
         emit killSession(item->uuid());
+    else if (action == &stats_action)
+        emit sessionStatsRequest(item->uuid());
 }
 
 void NotifierWindow::updateWindowPosition()
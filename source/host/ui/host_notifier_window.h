@@ -36,10 +36,12 @@ public:
 public slots:
     void onConnectEvent(const proto::host::ConnectEvent& event);
     void onDisconnectEvent(const proto::host::DisconnectEvent& event);
+    void onSessionStats(const proto::host::SessionStats& stats);
     void disconnectAll();
 
 signals:
     void killSession(const std::string& uuid);
+    void sessionStatsRequest(const std::string& uuid);
     void finished();
 
 protected:
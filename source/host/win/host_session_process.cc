@@ -18,15 +18,27 @@
 
 #include "host/win/host_session_process.h"
 #include "base/qt_logging.h"
+#include "common/service_message.h"
 #include "host/host_session_fake.h"
+#include "host/pipeline_stats.h"
 #include "ipc/ipc_channel.h"
 #include "ipc/ipc_server.h"
 #include "net/network_channel_host.h"
+#include "proto/host.pb.h"
 
 #include <QCoreApplication>
 
 namespace host {
 
+namespace {
+
+// If the network sending queue exceeds this size, the messages from the session are not read
+// until the queue is reduced to the low watermark.
+const int64_t kNetworkHighWatermark = 2 * 1024 * 1024; // 2MB
+const int64_t kNetworkLowWatermark = 512 * 1024; // 512kB
+
+} // namespace
+
 SessionProcess::SessionProcess(QObject* parent)
     : QObject(parent)
 {
@@ -149,6 +161,27 @@ bool SessionProcess::start(base::win::SessionId session_id)
     return true;
 }
 
+void SessionProcess::requestStats()
+{
+    const proto::SessionType session_type = network_channel_->sessionType();
+
+    if (state_ != State::ATTACHED || !ipc_channel_ ||
+        (session_type != proto::SESSION_TYPE_DESKTOP_MANAGE &&
+         session_type != proto::SESSION_TYPE_DESKTOP_VIEW))
+    {
+        // There is no video pipeline in the session, only the network statistics are available.
+        proto::desktop::PipelineStats stats;
+        addNetworkStats(&stats);
+        emit statsReceived(stats);
+        return;
+    }
+
+    proto::host::ServiceToSession message;
+    message.set_pipeline_stats_request(true);
+
+    ipc_channel_->send(common::serializeServiceMessage(message));
+}
+
 void SessionProcess::stop()
 {
     if (state_ == State::STOPPED || state_ == State::STOPPING)
@@ -346,8 +379,28 @@ void SessionProcess::ipcNewConnection(ipc::Channel* channel)
             Qt::QueuedConnection);
 
     connect(ipc_channel_, &ipc::Channel::disconnected, ipc_channel_, &ipc::Channel::deleteLater);
-    connect(ipc_channel_, &ipc::Channel::messageReceived, network_channel_, &net::Channel::send);
-    connect(network_channel_, &net::Channel::messageReceived, ipc_channel_, &ipc::Channel::send);
+    connect(ipc_channel_, &ipc::Channel::messageReceived,
+            this, &SessionProcess::ipcMessageReceived);
+    // The connection is removed with the IPC channel when the session is detached.
+    connect(network_channel_, &net::Channel::messageReceived, ipc_channel_,
+            [this](const QByteArray& buffer) { networkMessageReceived(buffer); });
+
+    // While the network does not keep up, the messages from the session are not read. The
+    // session sees that its own messages are not sent and stops sending new frames.
+    connect(ipc_channel_, &ipc::Channel::messageReceived, this, [this]()
+    {
+        if (network_channel_->pendingBytes() >= kNetworkHighWatermark)
+            ipc_channel_->pause();
+    });
+
+    connect(network_channel_, &net::Channel::messageWritten, ipc_channel_, [this]()
+    {
+        if (ipc_channel_->isPaused() &&
+            network_channel_->pendingBytes() <= kNetworkLowWatermark)
+        {
+            ipc_channel_->start();
+        }
+    });
 
     LOG(LS_INFO) << "Session process is attached (SID: " << session_id_ << ")";
     state_ = State::ATTACHED;
@@ -383,4 +436,49 @@ bool SessionProcess::startFakeSession()
     return true;
 }
 
+void SessionProcess::ipcMessageReceived(const QByteArray& buffer)
+{
+    if (!common::isServiceMessage(buffer))
+    {
+        network_channel_->send(buffer);
+        return;
+    }
+
+    proto::host::SessionToService message;
+
+    if (!common::parseServiceMessage(buffer, &message))
+        return;
+
+    if (message.has_pipeline_stats())
+    {
+        proto::desktop::PipelineStats* stats = message.mutable_pipeline_stats();
+        addNetworkStats(stats);
+        emit statsReceived(*stats);
+    }
+    else
+    {
+        LOG(LS_WARNING) << "Unhandled message from session";
+    }
+}
+
+void SessionProcess::networkMessageReceived(const QByteArray& buffer)
+{
+    // Only the service can send its messages to the session.
+    if (common::isServiceMessage(buffer))
+    {
+        LOG(LS_WARNING) << "Service message from client is ignored";
+        return;
+    }
+
+    ipc_channel_->send(buffer);
+}
+
+void SessionProcess::addNetworkStats(proto::desktop::PipelineStats* stats)
+{
+    PipelineStats::serializeHistogram(proto::desktop::PipelineStats::STAGE_ENCRYPT,
+                                      network_channel_->encryptTime(), stats);
+    PipelineStats::serializeHistogram(proto::desktop::PipelineStats::STAGE_NETWORK_WRITE,
+                                      network_channel_->writeTime(), stats);
+}
+
 } // namespace host
@@ -23,6 +23,7 @@
 #include "base/win/session_status.h"
 #include "host/win/host_process.h"
 #include "proto/common.pb.h"
+#include "proto/desktop_extensions.pb.h"
 
 namespace ipc {
 class Channel;
@@ -64,6 +65,10 @@ public:
 
     bool start(base::win::SessionId session_id);
 
+    // Requests the latency statistics of the session. The signal |statsReceived| is emitted with
+    // the reply.
+    void requestStats();
+
 public slots:
     void stop();
     void setSessionEvent(base::win::SessionStatus status, base::win::SessionId session_id);
@@ -72,6 +77,7 @@ public slots:
 
 signals:
     void finished();
+    void statsReceived(const proto::desktop::PipelineStats& stats);
 
 protected:
     // QObject implementation.
@@ -79,9 +85,13 @@ protected:
 
 private slots:
     void ipcNewConnection(ipc::Channel* channel);
+    void ipcMessageReceived(const QByteArray& buffer);
 
 private:
     bool startFakeSession();
+    void networkMessageReceived(const QByteArray& buffer);
+
+    void addNetworkStats(proto::desktop::PipelineStats* stats);
 
     std::string uuid_;
 
@@ -32,6 +32,7 @@ Q_DECLARE_METATYPE(QLocalSocket::LocalSocketError);
 namespace {
 
 constexpr uint32_t kMaxMessageSize = 16 * 1024 * 1024; // 16MB
+constexpr int64_t kPausedReadBufferSize = 64 * 1024; // 64kB
 
 #if defined(OS_WIN)
 base::ProcessId clientProcessIdImpl(HANDLE pipe_handle)
@@ -146,14 +147,33 @@ void Channel::stop()
 
 void Channel::start()
 {
+    if (read_paused_)
+    {
+        read_paused_ = false;
+        socket_->setReadBufferSize(0);
+    }
+
     onReadyRead();
 }
 
+void Channel::pause()
+{
+    if (read_paused_)
+        return;
+
+    read_paused_ = true;
+
+    // By default, the socket reads all available data into its own buffer. Limit the buffer so
+    // that the pipe is filled and the writer is blocked.
+    socket_->setReadBufferSize(kPausedReadBufferSize);
+}
+
 void Channel::send(const QByteArray& buffer)
 {
     bool schedule_write = write_queue_.isEmpty();
 
     write_queue_.push_back(buffer);
+    pending_bytes_ += buffer.size();
 
     if (schedule_write)
         scheduleWrite();
@@ -183,11 +203,14 @@ void Channel::onBytesWritten(int64_t bytes)
     }
     else
     {
+        pending_bytes_ -= write_buffer.size();
         write_queue_.pop_front();
         written_ = 0;
 
         if (!write_queue_.empty())
             scheduleWrite();
+
+        emit messageWritten();
     }
 }
 
@@ -197,6 +220,9 @@ void Channel::onReadyRead()
 
     for (;;)
     {
+        if (read_paused_)
+            break;
+
         if (!read_size_received_)
         {
             current = socket_->read(reinterpret_cast<char*>(&read_size_) + read_,
@@ -50,6 +50,11 @@ public:
 
     void connectToServer(const QString& channel_name);
 
+    // Returns the size of the messages which are queued but not written yet.
+    int64_t pendingBytes() const { return pending_bytes_; }
+
+    bool isPaused() const { return read_paused_; }
+
 #if defined(OS_WIN)
     base::ProcessId clientProcessId() const { return client_process_id_; }
     base::ProcessId serverProcessId() const { return server_process_id_; }
@@ -63,6 +68,10 @@ public slots:
     // Starts reading the message.
     void start();
 
+    // Suspends reading messages until |start| is called. The unread data stays in the pipe, so
+    // the sender is slowed down.
+    void pause();
+
     // Sends a message.
     void send(const QByteArray& buffer);
 
@@ -72,6 +81,9 @@ signals:
     void errorOccurred();
     void messageReceived(const QByteArray& buffer);
 
+    // Emitted when a message from the sending queue is written.
+    void messageWritten();
+
 private slots:
     void onError(QLocalSocket::LocalSocketError socket_error);
     void onBytesWritten(int64_t bytes);
@@ -92,7 +104,9 @@ private:
     QQueue<QByteArray> write_queue_;
     MessageSizeType write_size_ = 0;
     int64_t written_ = 0;
+    int64_t pending_bytes_ = 0;
 
+    bool read_paused_ = false;
     bool read_size_received_ = false;
     QByteArray read_buffer_;
     MessageSizeType read_size_ = 0;
@@ -143,6 +143,8 @@ void Channel::send(const QByteArray& buffer)
 
     // Add the buffer to the queue for sending.
     write_.queue.push_back(buffer);
+    write_.queue_times.push_back(std::chrono::steady_clock::now());
+    write_.pending_bytes += buffer.size();
 
     if (schedule_write)
         scheduleWrite();
@@ -309,11 +311,18 @@ void Channel::onMessageWritten()
         DCHECK(!write_.queue.empty());
 
         // Delete the sent message from the queue.
+        write_.pending_bytes -= write_.queue.front().size();
         write_.queue.pop_front();
 
+        write_time_.add(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - write_.queue_times.front()));
+        write_.queue_times.pop_front();
+
         // If the queue is not empty, then we send the following message.
         if (!write_.queue.isEmpty())
             scheduleWrite();
+
+        emit messageWritten();
     }
     else
     {
@@ -399,6 +408,8 @@ void Channel::scheduleWrite()
     // Copy the size of the message to the buffer.
     memcpy(write_.buffer.data(), length_data, length_data_size);
 
+    const auto encrypt_begin_time = std::chrono::steady_clock::now();
+
     // Encrypt the message.
     if (!cryptor_->encrypt(source_buffer.constData(),
                            source_buffer.size(),
@@ -408,6 +419,9 @@ void Channel::scheduleWrite()
         return;
     }
 
+    encrypt_time_.add(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - encrypt_begin_time));
+
     // Send the buffer to the recipient.
     socket_->write(write_.buffer);
 }
@@ -19,6 +19,7 @@
 #ifndef NET__NETWORK_CHANNEL_H
 #define NET__NETWORK_CHANNEL_H
 
+#include "base/latency_histogram.h"
 #include "base/macros_magic.h"
 #include "base/version.h"
 
@@ -73,6 +74,16 @@ public:
     // Returns the version of the connected peer.
     base::Version peerVersion() const { return peer_version_; }
 
+    // Returns the size of the messages in the sending queue.
+    int64_t pendingBytes() const { return write_.pending_bytes; }
+
+    // Returns the time of the encryption of the sent messages.
+    const base::LatencyHistogram& encryptTime() const { return encrypt_time_; }
+
+    // Returns the time from the queuing of the sent messages to the completion of their writing
+    // to the socket.
+    const base::LatencyHistogram& writeTime() const { return write_time_; }
+
 signals:
     // Emits when the connection is aborted.
     void disconnected();
@@ -83,6 +94,9 @@ signals:
     // Emitted when a new message is received.
     void messageReceived(const QByteArray& buffer);
 
+    // Emitted when a message from the sending queue is written.
+    void messageWritten();
+
 public slots:
     // Starts reading messages from the channel. After receiving each new message, the signal
     // |messageReceived| will be emmited.
@@ -137,11 +151,17 @@ private:
         // The queue contains unencrypted source messages.
         QQueue<QByteArray> queue;
 
+        // The time of the queuing of each message in |queue|.
+        QQueue<std::chrono::steady_clock::time_point> queue_times;
+
         // The buffer contains an encrypted message that is being sent to the current moment.
         QByteArray buffer;
 
         // Number of bytes transferred from the |buffer|.
         int64_t bytes_transferred = 0;
+
+        // Total size of the messages in the |queue|.
+        int64_t pending_bytes = 0;
     };
 
     struct ReadContext
@@ -165,6 +185,9 @@ private:
     ReadContext read_;
     WriteContext write_;
 
+    base::LatencyHistogram encrypt_time_;
+    base::LatencyHistogram write_time_;
+
     DISALLOW_COPY_AND_ASSIGN(Channel);
 };
 